@@ -0,0 +1,123 @@
+// Adjacency.cpp
+
+#include "Main.hpp"
+#include "Adjacency.hpp"
+#include "ArrayList.hpp"
+
+// an undirected edge and the first two distinct vertices found opposite to it
+struct edge_t {
+	Uint64 key = UINT64_MAX;
+	GLuint opp0 = 0;
+	GLuint opp1 = 0;
+	bool hasOpp1 = false;
+};
+
+static inline Uint64 edgeKey(GLuint v1, GLuint v2) {
+	return v1 < v2 ? ((Uint64)v1 << 32) | v2 : ((Uint64)v2 << 32) | v1;
+}
+
+static inline Uint32 edgeHash(Uint64 key) {
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDULL;
+	key ^= key >> 33;
+	return (Uint32)key;
+}
+
+static inline edge_t& findEdge(ArrayList<edge_t>& table, Uint64 key) {
+	Uint32 mask = table.getSize() - 1;
+	Uint32 slot = edgeHash(key) & mask;
+	while (table[slot].key != key && table[slot].key != UINT64_MAX) {
+		slot = (slot + 1) & mask;
+	}
+	return table[slot];
+}
+
+static inline void addEdge(ArrayList<edge_t>& table, GLuint v1, GLuint v2, GLuint opp) {
+	Uint64 key = edgeKey(v1, v2);
+	edge_t& edge = findEdge(table, key);
+	if (edge.key == UINT64_MAX) {
+		edge.key = key;
+		edge.opp0 = opp;
+	} else if (!edge.hasOpp1 && edge.opp0 != opp) {
+		edge.opp1 = opp;
+		edge.hasOpp1 = true;
+	}
+}
+
+static inline GLuint findAdjacent(ArrayList<edge_t>& table, GLuint v1, GLuint v2, GLuint opp) {
+	edge_t& edge = findEdge(table, edgeKey(v1, v2));
+	if (edge.opp0 != opp) {
+		return edge.opp0;
+	} else if (edge.hasOpp1) {
+		return edge.opp1;
+	} else {
+		return opp;
+	}
+}
+
+void Adjacency::build(const GLuint* triangles, Uint32 numTriangles, GLuint* out) {
+	if (!numTriangles) {
+		return;
+	}
+
+	// size the table to at most 50% load
+	Uint32 tableSize = 16;
+	while (tableSize < numTriangles * 6) {
+		tableSize <<= 1;
+	}
+	ArrayList<edge_t> table;
+	table.resize(tableSize);
+
+	for (Uint32 c = 0; c < numTriangles; ++c) {
+		const GLuint* t = &triangles[c * 3];
+		addEdge(table, t[0], t[1], t[2]);
+		addEdge(table, t[1], t[2], t[0]);
+		addEdge(table, t[2], t[0], t[1]);
+	}
+
+	for (Uint32 c = 0; c < numTriangles; ++c) {
+		const GLuint* t = &triangles[c * 3];
+		GLuint* p = &out[c * 6];
+		p[0] = t[0];
+		p[1] = findAdjacent(table, t[0], t[1], t[2]);
+		p[2] = t[1];
+		p[3] = findAdjacent(table, t[1], t[2], t[0]);
+		p[4] = t[2];
+		p[5] = findAdjacent(table, t[2], t[0], t[1]);
+	}
+}
+
+static GLuint findAdjacentSlow(const GLuint* triangles, Uint32 numTriangles, GLuint index1, GLuint index2, GLuint index3) {
+	GLuint indices[6];
+	for (Uint32 c = 0; c < numTriangles; ++c) {
+		indices[0] = indices[3] = triangles[c * 3];
+		indices[1] = indices[4] = triangles[c * 3 + 1];
+		indices[2] = indices[5] = triangles[c * 3 + 2];
+		for (int edge = 0; edge < 3; ++edge) {
+			GLuint v1 = indices[edge]; // first edge index
+			GLuint v2 = indices[edge + 1]; // second edge index
+			GLuint vOpp = indices[edge + 2]; // index of opposite vertex
+
+			// if the edge matches the search edge and the opposite vertex does not match
+			if (((v1 == index1 && v2 == index2) || (v2 == index1 && v1 == index2)) && vOpp != index3) {
+				return vOpp; // we have found the adjacent vertex
+			}
+		}
+	}
+
+	// no opposite edge found
+	return index3;
+}
+
+void Adjacency::buildSlow(const GLuint* triangles, Uint32 numTriangles, GLuint* out) {
+	for (Uint32 c = 0; c < numTriangles; ++c) {
+		const GLuint* t = &triangles[c * 3];
+		GLuint* p = &out[c * 6];
+		p[0] = t[0];
+		p[1] = findAdjacentSlow(triangles, numTriangles, t[0], t[1], t[2]);
+		p[2] = t[1];
+		p[3] = findAdjacentSlow(triangles, numTriangles, t[1], t[2], t[0]);
+		p[4] = t[2];
+		p[5] = findAdjacentSlow(triangles, numTriangles, t[2], t[0], t[1]);
+	}
+}
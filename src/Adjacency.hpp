@@ -0,0 +1,25 @@
+//! @file Adjacency.hpp
+
+#pragma once
+
+#include "Main.hpp"
+
+//! Builds triangle adjacency (the extra vertices used by GL_TRIANGLES_ADJACENCY for shadow volumes and edge detection).
+//! Edges are gathered into a hash table in one pass and resolved in a second one, so the whole thing is O(triangles).
+class Adjacency {
+public:
+	//! build adjacency indices for a triangle list
+	//! for each edge of each triangle, the adjacent vertex is the opposite vertex of the first other triangle
+	//! (in list order) sharing that edge, or the triangle's own opposite vertex if there is none.
+	//! @param triangles 3 vertex indices per triangle
+	//! @param numTriangles the number of triangles in the list
+	//! @param out receives 6 indices per triangle (vertex, adjacent vertex, vertex, adjacent vertex, ...)
+	static void build(const GLuint* triangles, Uint32 numTriangles, GLuint* out);
+
+	//! reference implementation that scans every triangle for every edge (O(triangles^2)).
+	//! only kept around for benchmarking and validating build()
+	//! @param triangles 3 vertex indices per triangle
+	//! @param numTriangles the number of triangles in the list
+	//! @param out receives 6 indices per triangle
+	static void buildSlow(const GLuint* triangles, Uint32 numTriangles, GLuint* out);
+};
@@ -4,6 +4,7 @@
 
 #include "ArrayList.hpp"
 #include "String.hpp"
+#include "StringID.hpp"
 #include "Animation.hpp"
 
 class Speaker;
@@ -74,20 +75,24 @@ public:
 	float							getBegin() const { return begin; }
 	float							getEnd() const { return end; }
 	float							getLength() const { return length; }
-	float							getWeight(const char* bone) const { if (const state_t *state = weights[bone]) { return state->value; } else { return 0.f; } }
-	float							getWeightRate(const char* bone) const { if (const state_t *state = weights[bone]) { return state->rate; } else { return 0.f; } }
+	float							getWeight(const char* bone) const { return getWeight(StringID::find(bone)); }
+	float							getWeight(StringID bone) const { if (const state_t *state = weights[bone]) { return state->value; } else { return 0.f; } }
+	float							getWeightRate(const char* bone) const { return getWeightRate(StringID::find(bone)); }
+	float							getWeightRate(StringID bone) const { if (const state_t *state = weights[bone]) { return state->rate; } else { return 0.f; } }
 	bool							isLoop() const { return loop; }
 	unsigned int					getBeginLastSoundFrame() const { return beginLastSoundFrame; }
 	unsigned int					getEndLastSoundFrame() const { return endLastSoundFrame; }
 	const ArrayList<sound_t>&		getSounds() const { return sounds; }
 	ArrayList<sound_t>&				getSounds() { return sounds; }
 	bool							isFinished() const { return ticks >= (end - begin) && !loop; }
-	const Map<String, state_t>&		getWeights() const { return weights; }
+	const Map<StringID, state_t>&	getWeights() const { return weights; }
 
 	void	setTicks(float _ticks) { ticks = _ticks; updated = true; }
 	void	setTicksRate(float _ticksRate) { ticksRate = _ticksRate; updated = true; }
-	void	setWeight(const char* bone, float _weight) { if (state_t *state = weights[bone]) { state->value = _weight; } else { weights.insert(bone, state_t(_weight, 0.f)); } updated = true; }
-	void	setWeightRate(const char* bone, float _weightRate) { if (state_t *state = weights[bone]) { state->rate = _weightRate; } else { weights.insert(bone, state_t(0.f, _weightRate)); } updated = true; }
+	void	setWeight(const char* bone, float _weight) { setWeight(StringID(bone), _weight); }
+	void	setWeight(StringID bone, float _weight) { if (state_t *state = weights[bone]) { state->value = _weight; } else { weights.insert(bone, state_t(_weight, 0.f)); } updated = true; }
+	void	setWeightRate(const char* bone, float _weightRate) { setWeightRate(StringID(bone), _weightRate); }
+	void	setWeightRate(StringID bone, float _weightRate) { if (state_t *state = weights[bone]) { state->rate = _weightRate; } else { weights.insert(bone, state_t(0.f, _weightRate)); } updated = true; }
 
 private:
 	String name;					//! animation name
@@ -96,7 +101,7 @@ private:
 	float begin;					//! start frame of the animation
 	float end;						//! end frame of the animation
 	float length;					//! length of the animation (end - begin)
-	Map<String, state_t> weights;	//! influences, or "blending" on bones
+	Map<StringID, state_t> weights;	//! influences, or "blending" on bones
 	bool loop;						//! if true, animation loops when ticks > end
 	bool updated = false;			//! if true, forces the skin to update
 
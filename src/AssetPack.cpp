@@ -0,0 +1,693 @@
+// AssetPack.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "AssetPack.hpp"
+#include "MeshCache.hpp"
+#include "Console.hpp"
+
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <chrono>
+
+static const char packMagic[4] = { 'S', 'P', 'A', 'K' };
+
+const char* AssetPack::defaultName = "assets.pak";
+
+static Cvar cvar_assetPacks("assets.packs", "read assets from the asset pack (assets.pak) of the game and each mod, where one exists", "1");
+static Cvar cvar_assetPacksMap("assets.packs.mmap", "memory-map asset packs instead of reading them through stdio", "1");
+
+struct AssetPack::mapping_t {
+	MeshCache::MappedFile file;
+};
+
+AssetPack::~AssetPack() {
+	close();
+}
+
+AssetPack* AssetPack::openFolder(const char* folder) {
+	if (!folder || !cvar_assetPacks.toInt()) {
+		return nullptr;
+	}
+	StringBuf<256> packPath("%s/%s", 2, folder, defaultName);
+	FILE* fp = fopen(packPath.get(), "rb");
+	if (!fp) {
+		return nullptr;
+	}
+	fclose(fp);
+
+	AssetPack* pack = new AssetPack();
+	if (!pack->open(packPath.get(), cvar_assetPacksMap.toInt() != 0)) {
+		mainEngine->fmsg(Engine::MSG_WARN, "failed to open asset pack '%s', using loose files instead", packPath.get());
+		delete pack;
+		return nullptr;
+	}
+	mainEngine->fmsg(Engine::MSG_INFO, "using asset pack '%s' (%u files)", packPath.get(), pack->getNumEntries());
+	return pack;
+}
+
+Uint64 AssetPack::hashPath(const char* name) {
+	Uint64 hash = 0xCBF29CE484222325ULL;
+	for (const char* c = name; c && *c; ++c) {
+		hash ^= (Uint8)*c;
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+bool AssetPack::open(const char* _path, bool map) {
+	close();
+	if (!_path) {
+		return false;
+	}
+
+	struct stat st;
+	if (stat(_path, &st) != 0) {
+		return false;
+	}
+	const Uint64 size = (Uint64)st.st_size;
+
+	// read the header, index and name table in one go
+	header_t header;
+	const Uint8* base = nullptr;
+	if (map) {
+		mapping = new mapping_t();
+		if (!mapping->file.open(_path) || mapping->file.getSize() < sizeof(header_t)) {
+			close();
+			return false;
+		}
+		base = mapping->file.getData();
+		memcpy(&header, base, sizeof(header_t));
+	} else {
+		fp = fopen(_path, "rb");
+		if (!fp || fread(&header, sizeof(header_t), 1, fp) != 1) {
+			close();
+			return false;
+		}
+	}
+	const Uint64 indexSize = (Uint64)sizeof(entry_t) * header.numEntries;
+	if (memcmp(header.magic, packMagic, sizeof(packMagic)) != 0 ||
+		header.version != version ||
+		header.namesSize == 0 ||
+		sizeof(header_t) + indexSize + header.namesSize > header.dataOffset ||
+		header.dataOffset > size) {
+		mainEngine->fmsg(Engine::MSG_WARN, "asset pack '%s' is corrupt or out of date", _path);
+		close();
+		return false;
+	}
+	entries.resize(header.numEntries);
+	names.resize(header.namesSize);
+	if (base) {
+		memcpy(entries.getArray(), base + sizeof(header_t), (size_t)indexSize);
+		memcpy(names.getArray(), base + sizeof(header_t) + indexSize, header.namesSize);
+	} else if ((header.numEntries && fread(entries.getArray(), sizeof(entry_t), header.numEntries, fp) != header.numEntries) ||
+		fread(names.getArray(), 1, header.namesSize, fp) != header.namesSize) {
+		close();
+		return false;
+	}
+
+	// check every entry against the file, so reads need no checks of their own
+	bool good = names[header.namesSize - 1] == '\0';
+	const Uint64 dataSize = size - header.dataOffset;
+	for (Uint32 c = 0; good && c < header.numEntries; ++c) {
+		const entry_t& entry = entries[c];
+		good = entry.name < header.namesSize &&
+			entry.offset + entry.packedSize <= dataSize &&
+			(c == 0 || entries[c - 1].pathHash <= entry.pathHash) &&
+			((entry.compression == COMPRESSION_NONE && entry.packedSize == entry.size) ||
+			(entry.compression == COMPRESSION_LZ4 && entry.packedSize <= compressBound(entry.size)));
+	}
+	if (!good) {
+		mainEngine->fmsg(Engine::MSG_WARN, "asset pack '%s' is corrupt", _path);
+		close();
+		return false;
+	}
+
+	path = _path;
+	dataOffset = header.dataOffset;
+	time = (Sint64)st.st_mtime;
+	return true;
+}
+
+void AssetPack::close() {
+	if (fp) {
+		fclose(fp);
+		fp = nullptr;
+	}
+	if (mapping) {
+		delete mapping;
+		mapping = nullptr;
+	}
+	entries.clear();
+	names.clear();
+	dataOffset = 0;
+	time = 0;
+}
+
+const AssetPack::entry_t* AssetPack::find(const char* name) const {
+	if (!name || entries.getSize() == 0) {
+		return nullptr;
+	}
+	while (*name == '/') {
+		++name;
+	}
+	const Uint64 hash = hashPath(name);
+
+	// lower bound on the hash, then check names in case of a collision
+	Uint32 lo = 0, hi = entries.getSize();
+	while (lo < hi) {
+		const Uint32 mid = lo + (hi - lo) / 2;
+		if (entries[mid].pathHash < hash) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	for (; lo < entries.getSize() && entries[lo].pathHash == hash; ++lo) {
+		if (strcmp(&names[entries[lo].name], name) == 0) {
+			return &entries[lo];
+		}
+	}
+	return nullptr;
+}
+
+bool AssetPack::read(const entry_t& entry, ArrayList<Uint8>& data) {
+	data.resize(entry.size);
+	if (entry.size == 0) {
+		return true;
+	}
+
+	const Uint8* src = nullptr;
+	ArrayList<Uint8> packed;
+	if (mapping) {
+		src = mapping->file.getData() + dataOffset + entry.offset;
+	} else {
+		Uint8* dest = data.getArray();
+		if (entry.compression != COMPRESSION_NONE) {
+			packed.resize(entry.packedSize);
+			dest = packed.getArray();
+		}
+		std::lock_guard<std::mutex> guard(lock);
+		const bool good = fp &&
+#ifdef PLATFORM_WINDOWS
+			_fseeki64(fp, (__int64)(dataOffset + entry.offset), SEEK_SET) == 0 &&
+#else
+			fseeko(fp, (off_t)(dataOffset + entry.offset), SEEK_SET) == 0 &&
+#endif
+			fread(dest, 1, entry.packedSize, fp) == entry.packedSize;
+		if (!good) {
+			data.resize(0);
+			return false;
+		}
+		src = dest;
+	}
+
+	bool good = true;
+	if (entry.compression == COMPRESSION_LZ4) {
+		good = decompressBlock(src, entry.packedSize, data.getArray(), entry.size);
+	} else if (mapping) {
+		memcpy(data.getArray(), src, entry.size);
+	}
+	if (!good) {
+		mainEngine->fmsg(Engine::MSG_WARN, "asset pack '%s': '%s' is corrupt", path.get(), getName(entry));
+		data.resize(0);
+	}
+	return good;
+}
+
+void AssetPack::list(const char* folder, ArrayList<String>& result) const {
+	const size_t len = folder ? strlen(folder) : 0;
+	for (auto& entry : entries) {
+		const char* name = getName(entry);
+		if (len) {
+			if (strncmp(name, folder, len) != 0 || name[len] != '/') {
+				continue;
+			}
+			name += len + 1;
+		}
+		if (strchr(name, '/') == nullptr) {
+			result.push(String(name));
+		}
+	}
+
+	// the index is in hash order, but callers expect names in the same order as a directory listing
+	class SortFn : public ArrayList<String>::SortFunction {
+	public:
+		virtual ~SortFn() {}
+		virtual const bool operator()(String a, String b) const override {
+			return strcmp(a.get(), b.get()) < 0;
+		}
+	};
+	result.sort(SortFn());
+}
+
+void AssetPack::findFiles(const char* folder, ArrayList<String>& result) {
+	ArrayList<String> folders;
+	folders.push(String());
+	while (folders.getSize()) {
+		String sub = folders.pop();
+		StringBuf<256> dirPath(folder);
+		if (sub.length()) {
+			dirPath.appendf("/%s", sub.get());
+		}
+		DIR* dir = opendir(dirPath.get());
+		if (!dir) {
+			continue;
+		}
+		struct dirent* ent;
+		while ((ent = readdir(dir)) != nullptr) {
+			if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+				continue;
+			}
+			String name;
+			name.alloc((Uint32)(sub.length() + strlen(ent->d_name) + 2));
+			if (sub.length()) {
+				name.format("%s/%s", sub.get(), ent->d_name);
+			} else {
+				name.format("%s", ent->d_name);
+			}
+			StringBuf<256> fullPath("%s/%s", 2, folder, name.get());
+			struct stat st;
+			if (stat(fullPath.get(), &st) != 0) {
+				continue;
+			}
+			if ((st.st_mode & S_IFMT) == S_IFDIR) {
+				folders.push(name);
+			} else {
+				result.push(name);
+			}
+		}
+		closedir(dir);
+	}
+}
+
+bool AssetPack::build(const char* folder, const char* _path, bool compress) {
+	if (!folder || !_path) {
+		return false;
+	}
+	ArrayList<String> files;
+	findFiles(folder, files);
+
+	// pack files in name order, so that neighbouring files sit near each other on disk
+	class SortFn : public ArrayList<String>::SortFunction {
+	public:
+		virtual ~SortFn() {}
+		virtual const bool operator()(String a, String b) const override {
+			return strcmp(a.get(), b.get()) < 0;
+		}
+	};
+	files.sort(SortFn());
+
+	// leave out other packs (including the one being written)
+	ArrayList<entry_t> index;
+	ArrayList<char> table;
+	index.alloc(files.getSize());
+	for (auto& file : files) {
+		const Uint32 len = file.length();
+		if (len >= 4 && strcmp(file.get() + len - 4, ".pak") == 0) {
+			continue;
+		}
+		entry_t entry;
+		memset(&entry, 0, sizeof(entry));
+		entry.pathHash = hashPath(file.get());
+		entry.name = table.getSize();
+		if (table.getSize() + len + 1 > table.getMaxSize()) {
+			table.alloc(std::max(table.getSize() + len + 1, table.getMaxSize() * 2));
+		}
+		table.resize(table.getSize() + len + 1);
+		memcpy(&table[entry.name], file.get(), len + 1);
+		index.push(entry);
+	}
+	if (table.getSize() == 0) {
+		table.push('\0');
+	}
+
+	header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, packMagic, sizeof(packMagic));
+	header.version = version;
+	header.numEntries = index.getSize();
+	header.namesSize = table.getSize();
+	header.dataOffset = sizeof(header_t) + (Uint64)sizeof(entry_t) * index.getSize() + table.getSize();
+
+	// the index is written once its offsets are known, so reserve its space first
+	StringBuf<256> tempPath("%s.tmp", 1, _path);
+	FILE* out = fopen(tempPath.get(), "wb");
+	if (!out) {
+		mainEngine->fmsg(Engine::MSG_WARN, "failed to write asset pack '%s'", _path);
+		return false;
+	}
+	bool good = fwrite(&header, sizeof(header_t), 1, out) == 1 &&
+		(index.getSize() == 0 || fwrite(index.getArray(), sizeof(entry_t), index.getSize(), out) == index.getSize()) &&
+		fwrite(table.getArray(), 1, table.getSize(), out) == table.getSize();
+
+	ArrayList<Uint8> data;
+	ArrayList<Uint8> packed;
+	Uint64 offset = 0;
+	for (Uint32 c = 0; good && c < index.getSize(); ++c) {
+		entry_t& entry = index[c];
+		const char* name = &table[entry.name];
+		StringBuf<256> filePath("%s/%s", 2, folder, name);
+		FILE* fp = fopen(filePath.get(), "rb");
+		if (!fp) {
+			mainEngine->fmsg(Engine::MSG_WARN, "failed to read '%s'", filePath.get());
+			good = false;
+			break;
+		}
+		fseek(fp, 0, SEEK_END);
+		const long size = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+		if (size < 0 || (Uint64)size >= UINT32_MAX / 2) {
+			mainEngine->fmsg(Engine::MSG_WARN, "'%s' is too large to pack", filePath.get());
+			fclose(fp);
+			good = false;
+			break;
+		}
+		data.resize((Uint32)size);
+		good = size == 0 || fread(data.getArray(), 1, (size_t)size, fp) == (size_t)size;
+		fclose(fp);
+
+		Uint64 hash = 0xCBF29CE484222325ULL;
+		for (Uint32 i = 0; i < data.getSize(); ++i) {
+			hash ^= data[i];
+			hash *= 0x100000001B3ULL;
+		}
+		entry.contentHash = hash;
+		entry.offset = offset;
+		entry.size = data.getSize();
+
+		// keep files stored as they are when compression does not pay for itself
+		const Uint8* src = data.getArray();
+		entry.compression = COMPRESSION_NONE;
+		entry.packedSize = entry.size;
+		if (compress && entry.size) {
+			packed.resize((Uint32)compressBound(entry.size));
+			const size_t packedSize = compressBlock(data.getArray(), entry.size, packed.getArray(), packed.getSize());
+			if (packedSize && packedSize < entry.size - entry.size / 16) {
+				entry.compression = COMPRESSION_LZ4;
+				entry.packedSize = (Uint32)packedSize;
+				src = packed.getArray();
+			}
+		}
+		good = good && (entry.packedSize == 0 || fwrite(src, 1, entry.packedSize, out) == entry.packedSize);
+		offset += entry.packedSize;
+	}
+
+	// the index is searched by hash
+	class IndexSortFn : public ArrayList<entry_t>::SortFunction {
+	public:
+		IndexSortFn(const ArrayList<char>& _table) : table(_table) {}
+		virtual ~IndexSortFn() {}
+		virtual const bool operator()(entry_t a, entry_t b) const override {
+			if (a.pathHash != b.pathHash) {
+				return a.pathHash < b.pathHash;
+			}
+			return strcmp(&table[a.name], &table[b.name]) < 0;
+		}
+	private:
+		const ArrayList<char>& table;
+	};
+	index.sort(IndexSortFn(table));
+	good = good &&
+		fseek(out, (long)sizeof(header_t), SEEK_SET) == 0 &&
+		(index.getSize() == 0 || fwrite(index.getArray(), sizeof(entry_t), index.getSize(), out) == index.getSize());
+	good = (fclose(out) == 0) && good;
+	if (!good) {
+		remove(tempPath.get());
+		mainEngine->fmsg(Engine::MSG_WARN, "failed to write asset pack '%s'", _path);
+		return false;
+	}
+	remove(_path);
+	if (rename(tempPath.get(), _path) != 0) {
+		remove(tempPath.get());
+		mainEngine->fmsg(Engine::MSG_WARN, "failed to write asset pack '%s'", _path);
+		return false;
+	}
+	mainEngine->fmsg(Engine::MSG_INFO, "wrote asset pack '%s': %u files, %llu bytes",
+		_path, index.getSize(), (unsigned long long)(header.dataOffset + offset));
+	return true;
+}
+
+// LZ4 block format: a run of sequences, each a token (literal length << 4 | match length - 4), the literals,
+// then a 16-bit little-endian match offset. Lengths of 15 or more continue in bytes of 255 until a smaller one.
+// The last sequence has only literals: matches must end 5 bytes before the end of the data and start 12 before.
+static const Uint32 lz4MinMatch = 4;
+static const Uint32 lz4LastLiterals = 5;
+static const Uint32 lz4MatchLimit = 12;
+static const Uint32 lz4MaxOffset = 65535;
+static const Uint32 lz4HashLog = 14;
+
+static inline Uint32 lz4Read32(const Uint8* p) {
+	Uint32 value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static inline Uint32 lz4Hash(Uint32 sequence) {
+	return (sequence * 2654435761U) >> (32 - lz4HashLog);
+}
+
+// writes a length which did not fit in its token
+// @return false if it would not fit in the output
+static bool lz4WriteLength(Uint8* dest, size_t capacity, size_t& op, size_t len) {
+	for (; len >= 255; len -= 255) {
+		if (op >= capacity) {
+			return false;
+		}
+		dest[op++] = 255;
+	}
+	if (op >= capacity) {
+		return false;
+	}
+	dest[op++] = (Uint8)len;
+	return true;
+}
+
+// writes one sequence (or the final run of literals, if matchLen is 0)
+// @return false if it would not fit in the output
+static bool lz4WriteSequence(Uint8* dest, size_t capacity, size_t& op, const Uint8* literals, size_t litLen, Uint32 offset, size_t matchLen) {
+	if (op >= capacity) {
+		return false;
+	}
+	const size_t matchCode = matchLen ? matchLen - lz4MinMatch : 0;
+	Uint8& token = dest[op++];
+	token = (Uint8)((std::min(litLen, (size_t)15) << 4) | std::min(matchCode, (size_t)15));
+	if (litLen >= 15 && !lz4WriteLength(dest, capacity, op, litLen - 15)) {
+		return false;
+	}
+	if (litLen > capacity - op) {
+		return false;
+	}
+	memcpy(dest + op, literals, litLen);
+	op += litLen;
+	if (!matchLen) {
+		return true;
+	}
+	if (capacity - op < 2) {
+		return false;
+	}
+	dest[op++] = (Uint8)(offset & 0xff);
+	dest[op++] = (Uint8)(offset >> 8);
+	return matchCode < 15 || lz4WriteLength(dest, capacity, op, matchCode - 15);
+}
+
+size_t AssetPack::compressBlock(const Uint8* src, size_t size, Uint8* dest, size_t capacity) {
+	ArrayList<Uint32> table;
+	table.resize(1 << lz4HashLog);
+
+	size_t op = 0;
+	size_t anchor = 0;
+	if (size > lz4MatchLimit) {
+		const size_t matchEnd = size - lz4LastLiterals;
+		for (size_t ip = 0; ip + lz4MatchLimit <= size;) {
+			const Uint32 sequence = lz4Read32(src + ip);
+			const Uint32 h = lz4Hash(sequence);
+			const size_t ref = table[h];
+			table[h] = (Uint32)ip;
+			if (ref >= ip || ip - ref > lz4MaxOffset || lz4Read32(src + ref) != sequence) {
+				++ip;
+				continue;
+			}
+			size_t matchLen = lz4MinMatch;
+			while (ip + matchLen < matchEnd && src[ref + matchLen] == src[ip + matchLen]) {
+				++matchLen;
+			}
+			if (!lz4WriteSequence(dest, capacity, op, src + anchor, ip - anchor, (Uint32)(ip - ref), matchLen)) {
+				return 0;
+			}
+			ip += matchLen;
+			anchor = ip;
+
+			// remember the last position of the match too, it often starts the next one
+			if (ip >= 2 && ip + lz4MatchLimit <= size) {
+				table[lz4Hash(lz4Read32(src + ip - 2))] = (Uint32)(ip - 2);
+			}
+		}
+	}
+	if (!lz4WriteSequence(dest, capacity, op, src + anchor, size - anchor, 0, 0)) {
+		return 0;
+	}
+	return op;
+}
+
+bool AssetPack::decompressBlock(const Uint8* src, size_t size, Uint8* dest, size_t destSize) {
+	size_t ip = 0, op = 0;
+	while (ip < size) {
+		const Uint8 token = src[ip++];
+		size_t litLen = token >> 4;
+		if (litLen == 15) {
+			Uint8 b;
+			do {
+				if (ip >= size) {
+					return false;
+				}
+				b = src[ip++];
+				litLen += b;
+			} while (b == 255);
+		}
+		if (litLen > size - ip || litLen > destSize - op) {
+			return false;
+		}
+		memcpy(dest + op, src + ip, litLen);
+		ip += litLen;
+		op += litLen;
+		if (ip == size) {
+			break;
+		}
+
+		if (size - ip < 2) {
+			return false;
+		}
+		const size_t offset = (size_t)src[ip] | ((size_t)src[ip + 1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > op) {
+			return false;
+		}
+		size_t matchLen = token & 15;
+		if (matchLen == 15) {
+			Uint8 b;
+			do {
+				if (ip >= size) {
+					return false;
+				}
+				b = src[ip++];
+				matchLen += b;
+			} while (b == 255);
+		}
+		matchLen += lz4MinMatch;
+		if (matchLen > destSize - op) {
+			return false;
+		}
+
+		// matches may overlap the bytes they produce, so copy forwards one byte at a time when they do
+		const Uint8* match = dest + op - offset;
+		if (offset >= matchLen) {
+			memcpy(dest + op, match, matchLen);
+		} else {
+			for (size_t c = 0; c < matchLen; ++c) {
+				dest[op + c] = match[c];
+			}
+		}
+		op += matchLen;
+	}
+	return op == destSize;
+}
+
+static int console_packBuild(int argc, const char** argv) {
+	if (argc < 2) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "A folder is needed. ex: assets.pack.build base");
+		return 1;
+	}
+	StringBuf<256> packPath;
+	if (argc > 2) {
+		packPath = argv[2];
+	} else {
+		packPath.format("%s/%s", argv[1], AssetPack::defaultName);
+	}
+	const bool compress = argc > 3 ? strtol(argv[3], nullptr, 10) != 0 : true;
+	return AssetPack::build(argv[1], packPath.get(), compress) ? 0 : 1;
+}
+
+static Ccmd ccmd_packBuild("assets.pack.build", "packs every file in a game or mod folder into an asset pack. ex: assets.pack.build base [base/assets.pak] [1]", &console_packBuild);
+
+static int console_packBenchmark(int argc, const char** argv) {
+	if (argc < 2) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "A folder is needed. ex: assets.pack.benchmark base");
+		return 1;
+	}
+	const char* folder = argv[1];
+	StringBuf<256> packPath("%s/%s", 2, folder, AssetPack::defaultName);
+
+	// the loose files to compare against are whatever the pack holds
+	AssetPack index;
+	if (!index.open(packPath.get(), false)) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "failed to open '%s', build it first with assets.pack.build", packPath.get());
+		return 1;
+	}
+	ArrayList<String> files;
+	Uint64 packedBytes = 0;
+	files.alloc(index.getNumEntries());
+	for (Uint32 c = 0; c < index.getNumEntries(); ++c) {
+		files.push(String(index.getName(index.getEntries()[c])));
+		packedBytes += index.getEntries()[c].packedSize;
+	}
+	index.close();
+
+	// loose files: open, size and read each one
+	ArrayList<Uint8> data;
+	Uint64 looseBytes = 0;
+	Uint32 missing = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (auto& file : files) {
+		StringBuf<256> filePath("%s/%s", 2, folder, file.get());
+		FILE* fp = fopen(filePath.get(), "rb");
+		if (!fp) {
+			++missing;
+			continue;
+		}
+		fseek(fp, 0, SEEK_END);
+		const long size = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+		data.resize((Uint32)std::max(size, 0L));
+		if (size > 0) {
+			looseBytes += fread(data.getArray(), 1, (size_t)size, fp);
+		}
+		fclose(fp);
+	}
+	const double looseTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	// packed files: open the pack and look up and read each one, through stdio and then through a mapping
+	double packTimes[2] = { 0.0, 0.0 };
+	Uint64 packBytes[2] = { 0, 0 };
+	for (int map = 0; map < 2; ++map) {
+		start = std::chrono::high_resolution_clock::now();
+		AssetPack pack;
+		if (!pack.open(packPath.get(), map != 0)) {
+			mainEngine->fmsg(Engine::MSG_ERROR, "failed to open '%s'", packPath.get());
+			return 1;
+		}
+		for (auto& file : files) {
+			const AssetPack::entry_t* entry = pack.find(file.get());
+			if (entry && pack.read(*entry, data)) {
+				packBytes[map] += data.getSize();
+			}
+		}
+		packTimes[map] = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	mainEngine->fmsg(Engine::MSG_INFO, "%s: %u files, %llu bytes loose, %llu bytes packed (%.1f%%)",
+		folder, files.getSize(), (unsigned long long)packBytes[0], (unsigned long long)packedBytes,
+		packBytes[0] ? packedBytes * 100.0 / packBytes[0] : 100.0);
+	mainEngine->fmsg(Engine::MSG_INFO, "loose files %.2f ms, pack %.2f ms (%.1fx), mapped pack %.2f ms (%.1fx)",
+		looseTime * 1000.0, packTimes[0] * 1000.0, packTimes[0] > 0.0 ? looseTime / packTimes[0] : 0.0,
+		packTimes[1] * 1000.0, packTimes[1] > 0.0 ? looseTime / packTimes[1] : 0.0);
+	mainEngine->fmsg(Engine::MSG_INFO, "the loose files are read first; for cold start numbers, drop the OS file cache before each run and time one mode per run");
+	if (missing || looseBytes != packBytes[0] || packBytes[0] != packBytes[1]) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "%u files are missing and %llu bytes differ; rebuild the pack",
+			missing, (unsigned long long)(looseBytes > packBytes[0] ? looseBytes - packBytes[0] : packBytes[0] - looseBytes));
+	}
+	return 0;
+}
+
+static Ccmd ccmd_packBenchmark("assets.pack.benchmark", "times reading every file of an asset pack from the pack against reading the loose files. ex: assets.pack.benchmark base", &console_packBenchmark);
@@ -0,0 +1,147 @@
+//! @file AssetPack.hpp
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+#include "String.hpp"
+
+#include <mutex>
+
+//! An AssetPack bundles the files of a game or mod folder into one archive, so that a cold start reads one file
+//! instead of thousands. The pack begins with a central index sorted by path hash, followed by a name table
+//! and then the file contents, each compressed on its own (LZ4 block format) so that any file can be read
+//! without touching the others. The whole pack can optionally be memory-mapped.
+//! Packs are found by the engine as "assets.pak" inside a game or mod folder; see Engine::buildPath() for how
+//! they take part in mod precedence.
+class AssetPack {
+public:
+	//! bump whenever the layout of a pack changes
+	static const Uint32 version = 1;
+
+	//! name of the pack the engine looks for in each game or mod folder
+	static const char* defaultName;
+
+	//! how an entry is stored
+	enum compression_t : Uint32 {
+		COMPRESSION_NONE,
+		COMPRESSION_LZ4
+	};
+
+	//! pack header
+	struct header_t {
+		char magic[4];
+		Uint32 version;
+		Uint32 numEntries;
+		Uint32 namesSize;		//!< size of the name table, which follows the index
+		Uint64 dataOffset;		//!< start of the file contents, from the start of the pack
+	};
+
+	//! index entry
+	struct entry_t {
+		Uint64 pathHash;		//!< hash of the path (see hashPath())
+		Uint64 contentHash;		//!< hash of the uncompressed contents (64-bit FNV-1a, as MeshCache::hashFile())
+		Uint64 offset;			//!< start of the stored contents, from dataOffset
+		Uint32 size;			//!< uncompressed size
+		Uint32 packedSize;		//!< stored size
+		Uint32 name;			//!< offset of the path in the name table
+		Uint32 compression;		//!< see compression_t
+	};
+
+	AssetPack() = default;
+	AssetPack(const AssetPack&) = delete;
+	AssetPack(AssetPack&&) = delete;
+	~AssetPack();
+
+	AssetPack& operator=(const AssetPack&) = delete;
+	AssetPack& operator=(AssetPack&&) = delete;
+
+	//! open the asset pack of a game or mod folder, if it has one and packs are enabled
+	//! @param folder the game or mod folder
+	//! @return the pack, or nullptr if the folder's files should be read loose
+	static AssetPack* openFolder(const char* folder);
+
+	//! open a pack, reading its index
+	//! @param _path the pack to open
+	//! @param map if true, the whole pack is memory-mapped and reads are served from the mapping
+	//! @return true on success
+	bool open(const char* _path, bool map);
+
+	//! close the pack
+	void close();
+
+	//! find a file in the pack
+	//! @param name the path of the file, relative to the packed folder
+	//! @return the file's entry, or nullptr if it is not in the pack
+	const entry_t* find(const char* name) const;
+
+	//! read and decompress a file. Safe to call from several threads at once
+	//! @param entry the file to read
+	//! @param data where to store the contents
+	//! @return true on success
+	bool read(const entry_t& entry, ArrayList<Uint8>& data);
+
+	//! list the files directly inside a folder of the pack, sorted by name like a directory listing
+	//! @param folder the folder, relative to the packed folder (eg. "entities")
+	//! @param names the list to fill with file names (without the folder)
+	void list(const char* folder, ArrayList<String>& names) const;
+
+	//! @param entry an entry of this pack
+	//! @return the path of the entry
+	const char* getName(const entry_t& entry) const { return &names[entry.name]; }
+
+	const String&			getPath() const			{ return path; }
+	Uint32					getNumEntries() const	{ return entries.getSize(); }
+	const entry_t*			getEntries() const		{ return entries.getArray(); }
+	Sint64					getTime() const			{ return time; }
+	bool					isMapped() const		{ return mapping != nullptr; }
+
+	//! hash a path the way the index does (64-bit FNV-1a)
+	//! @param name the path to hash
+	//! @return the hash
+	static Uint64 hashPath(const char* name);
+
+	//! pack every file in a folder (and its subfolders)
+	//! @param folder the folder to pack
+	//! @param _path the pack to write
+	//! @param compress if true, files are compressed where it saves space
+	//! @return true on success
+	static bool build(const char* folder, const char* _path, bool compress);
+
+	//! list every file in a folder and its subfolders
+	//! @param folder the folder to search
+	//! @param names the list to append paths to, relative to the folder
+	static void findFiles(const char* folder, ArrayList<String>& names);
+
+	//! @param size the size of some data
+	//! @return the most space compressBlock() can need for it
+	static size_t compressBound(size_t size) { return size + size / 255 + 16; }
+
+	//! compress data in the LZ4 block format
+	//! @param src the data to compress
+	//! @param size the size of the data
+	//! @param dest where to write the compressed data
+	//! @param capacity the space available at dest
+	//! @return the compressed size, or 0 if it did not fit
+	static size_t compressBlock(const Uint8* src, size_t size, Uint8* dest, size_t capacity);
+
+	//! decompress data in the LZ4 block format
+	//! @param src the compressed data
+	//! @param size the size of the compressed data
+	//! @param dest where to write the data
+	//! @param destSize the exact size of the uncompressed data
+	//! @return true if the data was valid and filled dest exactly
+	static bool decompressBlock(const Uint8* src, size_t size, Uint8* dest, size_t destSize);
+
+private:
+	struct mapping_t;
+
+	String path;
+	FILE* fp = nullptr;
+	std::mutex lock;			//!< guards fp
+	mapping_t* mapping = nullptr;
+	Uint64 dataOffset = 0;
+	Sint64 time = 0;			//!< modification time of the pack
+	ArrayList<entry_t> entries;
+	ArrayList<char> names;
+};
@@ -38,7 +38,7 @@ const char* BBox::shapeStr[SHAPE_MAX] = {
 
 BBox::BBox(Entity& _entity, Component* _parent) :
 	Component(_entity, _parent) {
-	name = typeStr[COMPONENT_BBOX];
+	setName(typeStr[COMPONENT_BBOX]);
 
 	// exposed attributes
 	attributes.push(new AttributeBool("Enabled", enabled));
@@ -17,6 +17,24 @@
 #include "Component.hpp"
 #include "Light.hpp"
 #include "Camera.hpp"
+#include "Random.hpp"
+#include "WorldSnapshot.hpp"
+#include "WorldChunks.hpp"
+
+#include <chrono>
+
+static Cvar cvar_worldSnapshots("world.snapshots", "load worlds from binary snapshots kept in the cache folder, writing one the first time a world is read", "1");
+static Cvar cvar_lightCellSize("render.lights.cellsize", "size of the cells used to match lights with the entities they touch", "512");
+
+//! light relevance statistics, see render.lights.culling
+struct lightcullstats_t {
+	Uint64 passes = 0;		//!< camera passes
+	Uint64 lookups = 0;		//!< lights tested for relevance
+	Uint64 rebuilds = 0;	//!< influence lists that had to be rebuilt
+	double seconds = 0.0;
+	double maxSeconds = 0.0;
+};
+static lightcullstats_t lightCullStats;
 
 // there are two strings so we can convert different formats if need be.
 const char* BasicWorld::fileMagicNumber = "SPACEPUNK_BWD_01";
@@ -94,6 +112,11 @@ void BasicWorld::drawSceneObjects(Camera& camera, const ArrayList<Light*>& light
 		glEnable(GL_POLYGON_OFFSET_FILL);
 	}
 
+	// pack the lights once for every draw in this pass
+	if (lights.getSize() && camera.getDrawMode() == Camera::DRAW_STANDARD) {
+		ShaderProgram::packLights(camera, lights);
+	}
+
 	// draw entities
 	if (camera.getDrawMode() != Camera::DRAW_STENCIL) {
 		if (camera.getDrawMode() != Camera::DRAW_GLOW || !editorActive || !showTools) {
@@ -131,19 +154,58 @@ void BasicWorld::fillDrawList(const Camera& camera, float maxLength, ArrayList<E
 		}
 		entities.push(entity);
 	}
+	sortDrawList(camera.getGlobalPos(), entities);
+}
+
+void BasicWorld::sortDrawList(const Vector& origin, ArrayList<Entity*>& entities) {
 	class SortFn : public ArrayList<Entity*>::SortFunction {
 	public:
-		SortFn(const Camera& _camera) :
-			camera(_camera) {}
+		SortFn(const Vector& _origin) :
+			origin(_origin) {}
 		virtual ~SortFn() {}
 		virtual const bool operator()(Entity* a, Entity* b) const override {
-			float lengthA = Engine::measurePointToBounds(camera.getGlobalPos(), a->getBoundsMin() + a->getPos(), a->getBoundsMax() + a->getPos());
-			float lengthB = Engine::measurePointToBounds(camera.getGlobalPos(), b->getBoundsMin() + b->getPos(), b->getBoundsMax() + b->getPos());
+			float lengthA = Engine::measurePointToBounds(origin, a->getBoundsMin() + a->getPos(), a->getBoundsMax() + a->getPos());
+			float lengthB = Engine::measurePointToBounds(origin, b->getBoundsMin() + b->getPos(), b->getBoundsMax() + b->getPos());
 			return lengthA < lengthB;
 		}
-		const Camera& camera;
+		const Vector& origin;
 	};
-	entities.sort(SortFn(camera));
+	entities.sort(SortFn(origin));
+}
+
+const ArrayList<Entity*>& BasicWorld::findLightInfluence(Light& light) {
+	auto& influence = light.getInfluence();
+	const Vector pos = light.getGlobalPos();
+	const float radius = light.getRadius();
+	const Vector min = pos - Vector(radius);
+	const Vector max = pos + Vector(radius);
+	if (influence.world == this && influence.pos == pos && influence.radius == radius &&
+		entityHash.getStamp(min, max) <= influence.stamp) {
+		return influence.entities;
+	}
+	++lightCullStats.rebuilds;
+
+	// the hash returns everything in the light's bounding box, trim that down to its sphere
+	auto& list = influence.entities;
+	list.resize(0);
+	entityHash.query(min, max, list);
+	Uint32 count = 0;
+	for (Uint32 c = 0; c < list.getSize(); ++c) {
+		Entity* entity = list[c];
+		if (Engine::measurePointToBounds(pos,
+			entity->getBoundsMin() + entity->getPos(), entity->getBoundsMax() + entity->getPos()) <= radius * radius) {
+			list[count] = entity;
+			++count;
+		}
+	}
+	list.resize(count);
+	sortDrawList(pos, list);
+
+	influence.world = this;
+	influence.pos = pos;
+	influence.radius = radius;
+	influence.stamp = entityHash.getStamp();
+	return list;
 }
 
 void BasicWorld::draw() {
@@ -155,19 +217,21 @@ void BasicWorld::draw() {
 		return;
 	Editor* editor = client->getEditor();
 
-	// build camera list
+	// build camera and light lists, and sort entity bounds into the spatial hash.
+	// the shadow camera is left out of the hash, since it jumps between lights every frame
 	LinkedList<Camera*> cameras;
-	for (auto pair : entities) {
-		Entity* entity = pair.b;
-		entity->findAllComponents<Camera>(Component::COMPONENT_CAMERA, cameras);
-	}
-
-	// build light list
 	LinkedList<Light*> lights;
+	entityHash.setCellSize(cvar_lightCellSize.toFloat());
 	for (auto pair : entities) {
 		Entity* entity = pair.b;
+		entity->findAllComponents<Camera>(Component::COMPONENT_CAMERA, cameras);
 		entity->findAllComponents<Light>(Component::COMPONENT_LIGHT, lights);
+		if (entity != shadowCamera) {
+			entityHash.update(entity->getUID(), entity,
+				entity->getBoundsMin() + entity->getPos(), entity->getBoundsMax() + entity->getPos());
+		}
 	}
+	entityHash.sweep();
 
 	// cull unselected cameras (editor)
 	if (editor && editor->isInitialized()) {
@@ -222,7 +286,20 @@ void BasicWorld::draw() {
 		}
 		int shadowEntitiesDrawn = 0;
 
+		// mark what this camera can see, so that each light only has to check its own neighbourhood
+		++visibleMark;
+		for (auto entity : reducedDrawList) {
+			if (entity->isFlag(Entity::FLAG_VISIBLE) && entity->isShouldSave()) {
+				Uint32 slot = entity->getOcclusionSlot();
+				if (slot >= visibleMarks.getSize()) {
+					visibleMarks.resize(std::max(slot + 1, visibleMarks.getSize() * 2));
+				}
+				visibleMarks[slot] = visibleMark;
+			}
+		}
+
 		// build relevant light list
+		double cullSeconds = 0.0;
 		ArrayList<Light*> cameraLightList;
 		const bool shadowsEnabled = (!client->isEditorActive() || !showTools) && !cvar_renderFullbright.toInt() && cvar_shadowsEnabled.toInt();
 		for (Node<Light*>* node = lights.getFirst(); node != nullptr; node = node->getNext()) {
@@ -234,19 +311,17 @@ void BasicWorld::draw() {
 			}
 
 			// figure out if the light is affecting any visible objects
+			auto cullStart = std::chrono::high_resolution_clock::now();
 			bool relevant = false;
-			for (auto entity : reducedDrawList) {
-				if (entity->isFlag(Entity::FLAG_VISIBLE)) {
-					if (!light->isOccluded(*entity) && entity->isShouldSave()) {
-						float dist = Engine::measurePointToBounds(light->getGlobalPos(),
-							entity->getBoundsMin() + entity->getPos(), entity->getBoundsMax() + entity->getPos());
-						if (dist <= light->getRadius() * light->getRadius()) {
-							relevant = true;
-							break;
-						}
-					}
+			for (auto entity : findLightInfluence(*light)) {
+				Uint32 slot = entity->getOcclusionSlot();
+				if (slot < visibleMarks.getSize() && visibleMarks[slot] == visibleMark && !light->isOccluded(*entity)) {
+					relevant = true;
+					break;
 				}
 			}
+			cullSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - cullStart).count();
+			++lightCullStats.lookups;
 			if (!relevant) {
 				continue;
 			}
@@ -264,6 +339,9 @@ void BasicWorld::draw() {
 			}
 		}
 		int numLights = cameraLightList.getSize();
+		++lightCullStats.passes;
+		lightCullStats.seconds += cullSeconds;
+		lightCullStats.maxSeconds = std::max(lightCullStats.maxSeconds, cullSeconds);
 		glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
 		// clear the window area
@@ -588,13 +666,42 @@ bool BasicWorld::saveFile(const char* _filename, bool updateFilename) {
 		mainEngine->fmsg(Engine::MSG_INFO, "saving world file '%s'...", _filename);
 	}
 
-	if (filetype == FILE_BINARY) {
+	if (chunks) {
+		return chunks->save(path.get());
+	} else if (filetype == FILE_BINARY) {
 		return FileHelper::writeObject(path.get(), EFileFormat::Binary, *this);
 	} else {
 		return FileHelper::writeObject(path.get(), EFileFormat::Json, *this);
 	}
 }
 
+bool BasicWorld::loadFile(const char* path) {
+	if (WorldChunks::isChunkStore(path)) {
+		// a client of a server streams only what the server does not replicate (eg. static geometry)
+		Net* net = game ? game->getNet() : nullptr;
+		const bool replica = clientObj && net && net->isConnected();
+		chunks = new WorldChunks(*this, replica);
+		if (!chunks->open(path)) {
+			delete chunks;
+			chunks = nullptr;
+			return false;
+		}
+		return true;
+	}
+
+	const bool useSnapshots = cvar_worldSnapshots.toInt() != 0;
+	if (useSnapshots && WorldSnapshot::load(*this, path)) {
+		return true;
+	}
+	if (!FileHelper::readObject(path, *this)) {
+		return false;
+	}
+	if (useSnapshots) {
+		WorldSnapshot::save(*this, path);
+	}
+	return true;
+}
+
 void BasicWorld::serialize(FileInterface * file) {
 	Uint32 version = 0;
 
@@ -606,7 +713,7 @@ void BasicWorld::serialize(FileInterface * file) {
 		Uint32 numEntities = 0;
 		file->beginArray(numEntities);
 
-		for (Uint32 index = 0; index < numEntities; ++index) {
+		for (Uint32 index = 0; file->arrayElement(index, numEntities); ++index) {
 			Entity * entity = new Entity(this);
 			file->value(*entity);
 		}
@@ -637,4 +744,103 @@ void BasicWorld::serialize(FileInterface * file) {
 
 		file->endArray();
 	}
-}
\ No newline at end of file
+}
+
+static int console_lightCulling(int argc, const char** argv) {
+	if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+		lightCullStats = lightcullstats_t();
+		return 0;
+	}
+	const auto& stats = lightCullStats;
+	if (!stats.passes) {
+		mainEngine->fmsg(Engine::MSG_INFO, "no camera passes have been drawn yet");
+		return 0;
+	}
+	mainEngine->fmsg(Engine::MSG_INFO, "light culling: %llu camera passes, %.1f lights tested per pass, %.3f ms avg, %.3f ms max",
+		(unsigned long long)stats.passes, (double)stats.lookups / stats.passes,
+		stats.seconds * 1000.0 / stats.passes, stats.maxSeconds * 1000.0);
+	mainEngine->fmsg(Engine::MSG_INFO, " %llu of %llu influence lists rebuilt (%.1f%%)",
+		(unsigned long long)stats.rebuilds, (unsigned long long)stats.lookups,
+		stats.lookups ? stats.rebuilds * 100.0 / stats.lookups : 0.0);
+	return 0;
+}
+
+static Ccmd ccmd_lightCulling("render.lights.culling", "prints the CPU time spent matching lights to visible entities. ex: render.lights.culling [reset]", &console_lightCulling);
+
+static int console_lightBenchmark(int argc, const char** argv) {
+	const Uint32 numLights = argc > 1 ? (Uint32)strtol(argv[1], nullptr, 10) : 256;
+	const Uint32 numEntities = argc > 2 ? (Uint32)strtol(argv[2], nullptr, 10) : 4096;
+	const float extent = argc > 3 ? (float)strtod(argv[3], nullptr) : 16384.f;
+	const float radius = 512.f;
+
+	// scatter boxes and lights about a cube
+	Random rand;
+	rand.seedValue(1);
+	ArrayList<Vector> boxMins, boxMaxs, lightPos;
+	boxMins.resize(numEntities);
+	boxMaxs.resize(numEntities);
+	lightPos.resize(numLights);
+	for (Uint32 c = 0; c < numEntities; ++c) {
+		Vector pos(rand.getFloatRange(-extent, extent), rand.getFloatRange(-extent, extent), rand.getFloatRange(-extent, extent));
+		Vector size(rand.getFloatRange(8.f, 128.f), rand.getFloatRange(8.f, 128.f), rand.getFloatRange(8.f, 128.f));
+		boxMins[c] = pos - size;
+		boxMaxs[c] = pos + size;
+	}
+	for (Uint32 c = 0; c < numLights; ++c) {
+		lightPos[c] = Vector(rand.getFloatRange(-extent, extent), rand.getFloatRange(-extent, extent), rand.getFloatRange(-extent, extent));
+	}
+
+	typedef std::chrono::high_resolution_clock clock;
+
+	// every light against every entity, as draw() used to
+	auto start = clock::now();
+	Uint64 bruteHits = 0;
+	for (auto& pos : lightPos) {
+		for (Uint32 c = 0; c < numEntities; ++c) {
+			if (Engine::measurePointToBounds(pos, boxMins[c], boxMaxs[c]) <= radius * radius) {
+				++bruteHits;
+			}
+		}
+	}
+	double bruteTime = std::chrono::duration<double>(clock::now() - start).count();
+
+	// fill the hash
+	SpatialHash<Uint32> hash(cvar_lightCellSize.toFloat());
+	start = clock::now();
+	for (Uint32 c = 0; c < numEntities; ++c) {
+		hash.update(c, c, boxMins[c], boxMaxs[c]);
+	}
+	double buildTime = std::chrono::duration<double>(clock::now() - start).count();
+
+	// overlap queries, as when every influence list is rebuilt
+	start = clock::now();
+	Uint64 hashHits = 0;
+	ArrayList<Uint32> found;
+	for (auto& pos : lightPos) {
+		found.resize(0);
+		hash.query(pos - Vector(radius), pos + Vector(radius), found);
+		for (auto index : found) {
+			if (Engine::measurePointToBounds(pos, boxMins[index], boxMaxs[index]) <= radius * radius) {
+				++hashHits;
+			}
+		}
+	}
+	double queryTime = std::chrono::duration<double>(clock::now() - start).count();
+
+	// stamp checks, as when nothing has moved
+	start = clock::now();
+	Uint32 stale = 0;
+	const Uint32 stamp = hash.getStamp();
+	for (auto& pos : lightPos) {
+		stale += hash.getStamp(pos - Vector(radius), pos + Vector(radius)) > stamp ? 1 : 0;
+	}
+	double cachedTime = std::chrono::duration<double>(clock::now() - start).count();
+
+	mainEngine->fmsg(Engine::MSG_INFO, "%u lights, %u entities, %u cells (%.0f units):", numLights, numEntities, hash.getNumCells(), hash.getCellSize());
+	mainEngine->fmsg(Engine::MSG_INFO, " brute force: %.3f ms (%llu hits)", bruteTime * 1000.0, (unsigned long long)bruteHits);
+	mainEngine->fmsg(Engine::MSG_INFO, " hash build: %.3f ms, queries: %.3f ms (%llu hits), cached: %.3f ms (%u stale)",
+		buildTime * 1000.0, queryTime * 1000.0, (unsigned long long)hashHits, cachedTime * 1000.0, stale);
+	return 0;
+}
+
+static Ccmd ccmd_lightBenchmark("render.lights.benchmark", "times light relevance tests on random boxes, brute force against the spatial hash. ex: render.lights.benchmark 256 4096 16384", &console_lightBenchmark);
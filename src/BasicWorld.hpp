@@ -3,6 +3,9 @@
 #pragma once
 
 #include "World.hpp"
+#include "SpatialHash.hpp"
+
+class Light;
 
 //! BasicWorld is the primary world implementation as of the latest version of the engine.
 //! See World for more info.
@@ -50,6 +53,23 @@ public:
 	//! @param entities the draw list to fill
 	void fillDrawList(const Camera& camera, float maxLength, ArrayList<Entity*>& entities);
 
+	//! sort a draw list by distance to a point, nearest first
+	//! @param origin the point to measure from
+	//! @param entities the draw list to sort
+	static void sortDrawList(const Vector& origin, ArrayList<Entity*>& entities);
+
+	//! find the entities within a light's radius. The light keeps the list and it is only rebuilt
+	//! once the light, or something in the cells around it, has moved
+	//! @param light the light in question
+	//! @return the entities within the light's radius, nearest first
+	const ArrayList<Entity*>& findLightInfluence(Light& light);
+
+	//! reads the world contents from a file, through its snapshot when there is a valid one.
+	//! Chunk stores are opened for streaming instead (see WorldChunks)
+	//! @param path full path of the file to read
+	//! @return true on success, false on failure
+	bool loadFile(const char* path);
+
 	//! writes the world contents to a file
 	//! @param _filename the filename to write to, or blank to use our last filename
 	//! @param updateFilename if true, our current filename is changed, otherwise, it is not
@@ -97,6 +117,13 @@ private:
 		BUFFER_INDEX,
 		BUFFER_MAX
 	};
-	GLuint vbo[BUFFER_MAX];
+	GLuint vbo[BUFFER_MAX] = { 0 };
 	GLuint vao = 0;
+
+	//! entity bounds sorted into cells, refreshed at the start of each draw
+	SpatialHash<Entity*> entityHash;
+
+	//! the last camera pass which could see each entity, indexed by occlusion slot
+	ArrayList<Uint32> visibleMarks;
+	Uint32 visibleMark = 0;
 };
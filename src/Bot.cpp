@@ -0,0 +1,248 @@
+// Bot.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "Bot.hpp"
+#include "Server.hpp"
+#include "World.hpp"
+#include "NetSDL.hpp"
+#include "Console.hpp"
+
+#include <chrono>
+#include <memory>
+
+Bot::Bot(Uint32 _index) :
+	index(_index)
+{
+	net = new NetSDL(*this);
+	rand.seedValue(index + 1);
+}
+
+bool Bot::connect(const char* address, Uint16 port) {
+	return net->connect(address, port);
+}
+
+void Bot::onEstablishConnection(Uint32 remoteID) {
+	joined = true;
+}
+
+void Bot::onDisconnect(Uint32 remoteID) {
+	joined = false;
+	spawned = false;
+}
+
+void Bot::tick(Server& server) {
+	net->update();
+	handleNetMessages(server);
+
+	if (joined && !spawnRequested) {
+		sendSpawnRequest();
+		spawnRequested = true;
+	}
+	if (spawned) {
+		// wander about
+		vel.x = std::min(std::max(vel.x + rand.getFloatRange(-1.f, 1.f), -8.f), 8.f);
+		vel.y = std::min(std::max(vel.y + rand.getFloatRange(-1.f, 1.f), -8.f), 8.f);
+		pos += vel;
+		sendUpdate();
+	}
+}
+
+void Bot::handleNetMessages(Server& server) {
+	for (int remoteIndex = 0; remoteIndex < (int)net->numRemoteHosts(); ++remoteIndex) {
+		Packet* recvPacket = nullptr;
+		while ((recvPacket = net->recvPacket(remoteIndex)) != nullptr) {
+			std::unique_ptr<Packet> owner(recvPacket);
+			Packet& packet = *recvPacket;
+
+			Uint32 id, timestamp;
+			char packetType[4] = { 0 };
+			if (!packet.read32(id) || !packet.read32(timestamp) || !packet.read(packetType, 4)) {
+				continue;
+			}
+			if (int result = net->handleNetworkPacket(packet, (const char*)packetType, id)) {
+				if (result == 2) {
+					--remoteIndex;
+					break;
+				}
+				continue;
+			}
+
+			// server has spawned a player. everything else is ignored
+			if (strncmp((const char*)packetType, "SPWN", 4) == 0) {
+				Uint32 clientID, localID, serverID;
+				packet.read32(clientID);
+				packet.read32(localID);
+				packet.read32(serverID);
+				if (clientID != net->getLocalID() || localID != 0) {
+					continue;
+				}
+
+				Uint32 worldFilenameLen;
+				packet.read32(worldFilenameLen);
+				String worldFilename;
+				worldFilename.alloc(worldFilenameLen + 1);
+				worldFilename[worldFilenameLen] = '\0';
+				packet.read(&worldFilename[0], worldFilenameLen);
+				World* world = server.worldForName(worldFilename.get());
+				if (!world) {
+					continue;
+				}
+				worldIndex = server.indexForWorld(world);
+
+				Uint32 posInt[3];
+				packet.read32(posInt[0]);
+				packet.read32(posInt[1]);
+				packet.read32(posInt[2]);
+				pos = Vector((Sint32)posInt[0], (Sint32)posInt[1], (Sint32)posInt[2]);
+				spawned = true;
+			}
+		}
+	}
+}
+
+void Bot::sendSpawnRequest() {
+	Packet packet;
+
+	// colors: feet, arms, torso, head (all black)
+	for (int c = 0; c < 36; ++c) {
+		packet.write8(0);
+	}
+
+	StringBuf<32> name("bot%u", 1, index);
+	packet.write(name.get());
+	packet.write8((Uint8)name.length());
+	packet.write32(0);
+	packet.write("SPWN");
+
+	net->signPacket(packet);
+	net->sendPacketSafe(0, packet);
+}
+
+void Bot::sendUpdate() {
+	Packet packet;
+	packet.write32(0); // look dir
+	packet.write32(0);
+	packet.write32(0);
+	packet.write8(0); // jumped
+	packet.write8(1); // moving
+	packet.write8(0); // crouching
+	packet.write8(0); // falling
+	packet.write32(256); // ang (identity)
+	packet.write32(0);
+	packet.write32(0);
+	packet.write32(0);
+	packet.write32((Sint32)(vel.z * 128));
+	packet.write32((Sint32)(vel.y * 128));
+	packet.write32((Sint32)(vel.x * 128));
+	packet.write32((Sint32)(pos.z * 32));
+	packet.write32((Sint32)(pos.y * 32));
+	packet.write32((Sint32)(pos.x * 32));
+	packet.write32(worldIndex);
+	packet.write32(0);
+	packet.write("PLAY");
+
+	net->signPacket(packet);
+	net->sendPacket(0, packet);
+}
+
+// runs a single server tick with every bot ticking first
+// @return the time the server spent on the tick, in seconds
+static double soakTick(Server& server, ArrayList<Bot*>& bots) {
+	for (auto bot : bots) {
+		bot->tick(server);
+	}
+	auto start = std::chrono::high_resolution_clock::now();
+	server.incrementFrame();
+	server.preProcess();
+	server.process();
+	server.postProcess();
+	return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static int console_serverSoak(int argc, const char** argv) {
+	Server* server = mainEngine->getLocalServer();
+	if (!server || !server->getNet()->isHosting()) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "No server currently running.");
+		return 1;
+	}
+	if (server->getNumWorlds() == 0) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "The server needs a world with player starts, load one first.");
+		return 1;
+	}
+
+	const Uint32 connected = server->getNet()->numRemoteHosts();
+	const Uint32 freeSlots = connected < Net::maxPlayers ? Net::maxPlayers - connected : 0;
+	Uint32 maxBots = argc > 1 ? (Uint32)strtol(argv[1], nullptr, 10) : freeSlots;
+	Uint32 step = argc > 2 ? (Uint32)strtol(argv[2], nullptr, 10) : 8;
+	Uint32 seconds = argc > 3 ? (Uint32)strtol(argv[3], nullptr, 10) : 5;
+	maxBots = std::min(maxBots, freeSlots);
+	step = std::max(step, 1U);
+
+	const Uint32 tps = (Uint32)mainEngine->getTicksPerSecond();
+	const Uint32 measureTicks = std::max(seconds * tps, 1U);
+
+	ArrayList<Bot*> bots;
+	for (Uint32 count = std::min(step, maxBots); count > 0; count = std::min(count + step, maxBots)) {
+		while (bots.getSize() < count) {
+			Bot* bot = new Bot(bots.getSize());
+			if (!bot->connect("localhost", Net::defaultPort)) {
+				delete bot;
+				break;
+			}
+			bots.push(bot);
+		}
+
+		// give everyone a few seconds to join and spawn
+		for (Uint32 tick = 0; tick < tps * 5; ++tick) {
+			Uint32 waiting = 0;
+			for (auto bot : bots) {
+				waiting += bot->isSpawned() ? 0 : 1;
+			}
+			if (!waiting) {
+				break;
+			}
+			soakTick(*server, bots);
+		}
+
+		Uint32 spawned = 0;
+		for (auto bot : bots) {
+			spawned += bot->isSpawned() ? 1 : 0;
+		}
+
+		const Uint64 bytesSent = server->getNet()->getBytesSent();
+		const Uint64 packetsSent = server->getNet()->getPacketsSent();
+		const Uint64 bytesReceived = server->getNet()->getBytesReceived();
+		double total = 0.0, worst = 0.0;
+		for (Uint32 tick = 0; tick < measureTicks; ++tick) {
+			double time = soakTick(*server, bots);
+			total += time;
+			worst = std::max(worst, time);
+		}
+		const double gameSeconds = (double)measureTicks / tps;
+
+		mainEngine->fmsg(Engine::MSG_INFO, "%u bots (%u spawned): tick %.3f ms avg, %.3f ms max (budget %.3f ms)",
+			bots.getSize(), spawned, total * 1000.0 / measureTicks, worst * 1000.0, 1000.0 / tps);
+		mainEngine->fmsg(Engine::MSG_INFO, " server sent %.1f KB/s in %.0f packets/s, received %.1f KB/s",
+			(server->getNet()->getBytesSent() - bytesSent) / gameSeconds / 1024.0,
+			(server->getNet()->getPacketsSent() - packetsSent) / gameSeconds,
+			(server->getNet()->getBytesReceived() - bytesReceived) / gameSeconds / 1024.0);
+
+		if (count == maxBots) {
+			break;
+		}
+	}
+
+	// disconnect the bots and let the server notice
+	for (auto bot : bots) {
+		delete bot;
+	}
+	bots.clear();
+	for (Uint32 tick = 0; tick < tps; ++tick) {
+		soakTick(*server, bots);
+	}
+
+	return 0;
+}
+
+static Ccmd ccmd_serverSoak("server.soak", "connects headless bots to the local server over loopback, reporting tick time and bandwidth as they are added. ex: server.soak 64 8 5", &console_serverSoak);
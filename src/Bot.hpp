@@ -0,0 +1,66 @@
+//! @file Bot.hpp
+
+#pragma once
+
+#include "Game.hpp"
+#include "Vector.hpp"
+#include "Random.hpp"
+
+class Server;
+
+//! A Bot is a headless stand-in for a Client, used to load test a server over loopback.
+//! It joins the server, asks for a single player, and streams movement updates the way a real client does,
+//! but it has no renderer, mixer, script engine or worlds of its own.
+class Bot : public Game {
+public:
+	Bot() = delete;
+	Bot(Uint32 _index);
+	Bot(const Bot&) = delete;
+	Bot(Bot&&) = delete;
+	virtual ~Bot() = default;
+
+	Bot& operator=(const Bot&) = delete;
+	Bot& operator=(Bot&&) = delete;
+
+	virtual bool	isServer() const override { return false; }
+	virtual bool	isClient() const override { return true; }
+
+	//! connects to a server
+	//! @param address the address of the server
+	//! @param port the port the server is hosted on
+	//! @return true if the connection request was sent
+	bool connect(const char* address, Uint16 port);
+
+	//! runs one client tick: pumps the net interface, reads messages, and sends a player update
+	//! @param server the server under test, used to look up world indices by name
+	void tick(Server& server);
+
+	//! called when the server accepts our connection
+	virtual void onEstablishConnection(Uint32 remoteID) override;
+
+	//! called when we are disconnected from the server
+	virtual void onDisconnect(Uint32 remoteID) override;
+
+	bool	isJoined() const { return joined; }
+	bool	isSpawned() const { return spawned; }
+
+private:
+	Uint32 index = 0;
+	bool joined = false;
+	bool spawnRequested = false;
+	bool spawned = false;
+
+	Uint32 worldIndex = 0;
+	Vector pos;
+	Vector vel;
+	Random rand;
+
+	//! read messages from the net interface
+	void handleNetMessages(Server& server);
+
+	//! ask the server for a player
+	void sendSpawnRequest();
+
+	//! send our player's position, like Client::postProcess()
+	void sendUpdate();
+};
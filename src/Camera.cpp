@@ -21,15 +21,17 @@
 
 const char* Camera::meshStr = "assets/editor/camera/camera.FBX";
 const char* Camera::materialStr = "assets/editor/camera/material.json";
+Uint32 Camera::occlusionGenerations = 0;
 
 Camera::Camera(Entity& _entity, Component* _parent) :
 	Component(_entity, _parent) {
+	newOcclusionGeneration();
 	Client* client = mainEngine->getLocalClient();
 	if (client) {
 		renderer = client->getRenderer();
 	}
 
-	name = typeStr[COMPONENT_CAMERA];
+	setName(typeStr[COMPONENT_CAMERA]);
 	if (renderer) {
 		win.x = 0;
 		win.y = 0;
@@ -71,31 +73,70 @@ Camera::~Camera() {
 }
 
 void Camera::clearOcclusionData() {
-	for (auto& occlusion : occlusionData) {
-		for (auto& query : occlusion.b) {
-			if (query.b.id) {
-				glDeleteQueries(1, &query.b.id);
-				query.b.id = 0;
+	for (auto& queries : occlusionSets) {
+		for (auto& query : queries) {
+			if (query.id) {
+				glDeleteQueries(1, &query.id);
+				query.id = 0;
 			}
 		}
 	}
-	occlusionData.clear();
+	occlusionSets.clear();
+	occlusionSetIndices.clear();
+	occlusionSet = UINT32_MAX;
+	newOcclusionGeneration();
+}
+
+void Camera::newOcclusionGeneration() {
+	occlusionGeneration = ++occlusionGenerations;
+	if (occlusionGeneration == 0) {
+		// zero means no generation was seen yet
+		occlusionGeneration = ++occlusionGenerations;
+	}
+}
+
+void Camera::setOcclusionIndex(Uint64 _occlusionIndex) {
+	if (occlusionIndex != _occlusionIndex || occlusionSet == UINT32_MAX) {
+		occlusionIndex = _occlusionIndex;
+		occlusionSet = findOcclusionSet(occlusionIndex);
+	}
+}
+
+Uint32 Camera::findOcclusionSet(Uint64 index) {
+	auto set = occlusionSetIndices.find(index);
+	if (set) {
+		return *set;
+	}
+	Uint32 result = occlusionSets.getSize();
+	occlusionSets.push(ArrayList<occlusion_query_t>());
+	occlusionSetIndices.insert(index, result);
+	return result;
 }
 
 Camera::occlusion_query_t& Camera::getOcclusionQuery(Entity* entity) {
-	auto map = occlusionData.find(occlusionIndex);
-	if (!map) {
-		occlusionData.insert(occlusionIndex, Map<Entity*, occlusion_query_t>());
-		map = occlusionData.find(occlusionIndex);
+	if (occlusionSet == UINT32_MAX) {
+		occlusionSet = findOcclusionSet(occlusionIndex);
+	}
+	return getOcclusionQuery(occlusionSet, entity);
+}
+
+Camera::occlusion_query_t& Camera::getOcclusionQuery(Uint32 set, Entity* entity) {
+	assert(set < occlusionSets.getSize());
+	auto& queries = occlusionSets[set];
+	Uint32 slot = entity->getOcclusionSlot();
+	if (slot >= queries.getSize()) {
+		queries.resize(std::max(slot + 1, queries.getSize() * 2));
 	}
-	assert(map);
-	auto query = map->find(entity);
-	if (!query) {
-		map->insert(entity, occlusion_query_t());
-		query = map->find(entity);
+	auto& query = queries[slot];
+	if (query.stamp != entity->getOcclusionStamp()) {
+		// the slot last belonged to an entity which has since been deleted
+		if (query.id) {
+			glDeleteQueries(1, &query.id);
+		}
+		query = occlusion_query_t();
+		query.stamp = entity->getOcclusionStamp();
 	}
-	assert(query);
-	return *query;
+	return query;
 }
 
 void Camera::setListener() {
@@ -56,6 +56,7 @@ public:
 	struct occlusion_query_t {
 		bool result = false;
 		GLuint id = 0;
+		Uint32 stamp = 0;	//!< occlusion stamp of the entity the query belongs to (see Entity::getOcclusionStamp())
 	};
 
 	Camera() = delete;
@@ -84,6 +85,10 @@ public:
 	const bool&			isEnabled() const { return enabled; }
 	Uint64				getOcclusionIndex() const { return occlusionIndex; }
 
+	//! changes whenever set numbers from findOcclusionSet() stop being valid. Generations are unique across
+	//! cameras, so a camera made where a deleted one was is never mistaken for it
+	Uint32				getOcclusionGeneration() const { return occlusionGeneration; }
+
 	void	setClipNear(float _clipNear) { clipNear = _clipNear; }
 	void	setClipFar(float _clipFar) { clipFar = _clipFar; }
 	void	setWin(const Rect<Sint32>& rect) { win = rect; }
@@ -91,7 +96,6 @@ public:
 	void	setDrawMode(drawmode_t _drawMode) { drawMode = _drawMode; }
 	void	setOrtho(const bool _ortho) { ortho = _ortho; }
 	void	setEnabled(const bool _enabled) { enabled = _enabled; }
-	void	setOcclusionIndex(Uint64 _occlusionIndex) { occlusionIndex = _occlusionIndex; }
 
 	//! make a reversed-Z projection matrix with infinite range
 	//! @param radians The vertical fov
@@ -187,11 +191,27 @@ public:
 	//! clear all occlusion data
 	void clearOcclusionData();
 
-	//! get the occlusion query for a given entity
+	//! select the set of occlusion queries that subsequent queries refer to
+	//! @param _occlusionIndex the key of the set (eg a light and cube face)
+	void setOcclusionIndex(Uint64 _occlusionIndex);
+
+	//! find the set of occlusion queries for the given key, creating it if needed.
+	//! set numbers are stable for the life of the camera (or until clearOcclusionData())
+	//! @param index the key of the set
+	//! @return the set number
+	Uint32 findOcclusionSet(Uint64 index);
+
+	//! get the occlusion query for a given entity, in the set chosen by setOcclusionIndex()
 	//! @param entity the entity in question
 	//! @return the occlusion query
 	occlusion_query_t& getOcclusionQuery(Entity* entity);
 
+	//! get the occlusion query for a given entity
+	//! @param set the set number, from findOcclusionSet()
+	//! @param entity the entity in question
+	//! @return the occlusion query
+	occlusion_query_t& getOcclusionQuery(Uint32 set, Entity* entity);
+
 	Camera& operator=(const Camera& src) {
 		projMatrix = src.projMatrix;
 		viewMatrix = src.viewMatrix;
@@ -210,9 +230,17 @@ public:
 protected:
 	Renderer* renderer = nullptr;
 
-	//! occlusion data
-	Map<Uint64, Map<Entity*, occlusion_query_t>> occlusionData;
+	//! occlusion data: one dense array of queries per set, indexed by entity occlusion slot
+	ArrayList<ArrayList<occlusion_query_t>> occlusionSets;
+	Map<Uint64, Uint32> occlusionSetIndices;	//!< occlusion index -> set number
 	Uint64 occlusionIndex = 0;
+	Uint32 occlusionSet = UINT32_MAX;			//!< set number for occlusionIndex, resolved lazily
+	Uint32 occlusionGeneration = 0;
+
+	static Uint32 occlusionGenerations;
+
+	//! give the camera an occlusion generation no camera has had before
+	void newOcclusionGeneration();
 
 	//! drawing mode
 	drawmode_t drawMode = DRAW_STANDARD;
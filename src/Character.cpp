@@ -13,7 +13,7 @@ const char* Character::sexStr[SEX_MAX] = {
 Character::Character(Entity& entity, Component* parent) :
 	Component(entity, parent) {
 
-	name = typeStr[COMPONENT_CHARACTER];
+	setName(typeStr[COMPONENT_CHARACTER]);
 
 	//General
 	hp = DEFAULT_HP;
@@ -19,6 +19,8 @@
 #include "Player.hpp"
 #include "World.hpp"
 
+#include <memory>
+
 Client::Client() {
 	net = new NetSDL(*this);
 	renderer = mainEngine->getRenderer();
@@ -85,8 +87,9 @@ void Client::handleNetMessages() {
 		// receive packets
 		Packet* recvPacket = nullptr;
 		while ((recvPacket = net->recvPacket(remoteIndex)) != nullptr) {
-			Packet packet(*recvPacket);
-			delete recvPacket;
+			// parse straight out of the received buffer, which goes back to the pool after this iteration
+			std::unique_ptr<Packet> owner(recvPacket);
+			Packet& packet = *recvPacket;
 
 			Uint32 id, timestamp;
 			if (packet.read32(id) && packet.read32(timestamp)) {
@@ -218,6 +221,7 @@ void Client::handleNetMessages() {
 							}
 						}
 						player->setServerID(serverID);
+						invalidatePlayerIndex();
 
 						continue;
 					}
@@ -251,6 +255,7 @@ void Client::handleNetMessages() {
 						Player* player = findPlayer(clientID, localID);
 						assert(player);
 						player->setServerID(serverID);
+						invalidatePlayerIndex();
 
 						// read anchor uid
 						Uint32 anchorUID = World::nuid;
@@ -307,6 +312,7 @@ void Client::handleNetMessages() {
 						Player* player = findPlayer(clientID, localID);
 						assert(player);
 						player->setServerID(serverID);
+						invalidatePlayerIndex();
 
 						// read pos
 						Uint32 posInt[3];
@@ -522,6 +528,7 @@ void Client::handleNetMessages() {
 									const Entity::def_t* def = Entity::findDef(type);
 									entity = Entity::spawnFromDef(&world, *def, pos, ang.toRotation(), uid);
 									if (entity) {
+										entity->setReplicated(true);
 										entity->setVel(vel);
 										entity->setLastUpdate(ticks);
 									}
@@ -575,6 +582,37 @@ void Client::handleNetMessages() {
 						continue;
 					}
 
+					// entity left our interest
+					else if (strncmp((const char*)packetType, "ENTX", 4) == 0) {
+						// read world
+						Uint32 worldID;
+						packet.read32(worldID);
+						Node<World*>* node = worlds[worldID];
+						if (node) {
+							World& world = *node->getData();
+
+							// get uid
+							Uint32 uid;
+							packet.read32(uid);
+
+							// only entities spawned by server updates are removed, since the next update spawns them again.
+							// anything else (players, entities loaded with the map and maybe edited) stays where it is
+							// and stops receiving updates until it comes back into our interest
+							Entity* entity = world.uidToEntity(uid);
+							if (entity) {
+								if (entity->isReplicated() && !entity->getPlayer()) {
+									entity->remove();
+								} else {
+									entity->setVel(Vector());
+									entity->setNewPos(entity->getPos());
+									entity->setNewAng(entity->getAng());
+								}
+							}
+						}
+
+						continue;
+					}
+
 					// player interaction broadcast message
 					else if (strncmp((const char*)packetType, "PINT", 4) == 0) {
 						// read world
@@ -624,6 +662,7 @@ void Client::onDisconnect(Uint32 remoteID) {
 			players.removeNode(node);
 		}
 	}
+	invalidatePlayerIndex();
 }
 
 void Client::spawn(Uint32 localID) {
@@ -631,6 +670,7 @@ void Client::spawn(Uint32 localID) {
 	if (player == nullptr) {
 		player = &players.addNodeLast(Player())->getData();
 		player->setLocalID(localID);
+		invalidatePlayerIndex();
 	}
 
 	Packet packet;
@@ -705,6 +745,7 @@ void Client::startEditor(const char* path) {
 
 	// destroy all players
 	players.removeAll();
+	invalidatePlayerIndex();
 
 	editor->init(*this, path);
 }
@@ -914,6 +955,11 @@ void Client::postProcess() {
 					player.updateCamera();
 				}
 			}
+
+			// with speakers and the listener placed, hand out the mixer's sources
+			if (mixer) {
+				mixer->update();
+			}
 		}
 
 		// rendering
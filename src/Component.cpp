@@ -474,7 +474,7 @@ Component::Component(Entity& _entity, Component* _parent) {
 
 	uid = entity->getNewComponentID();
 
-	name = typeStr[COMPONENT_BASIC];
+	setName(typeStr[COMPONENT_BASIC]);
 	lPos = Vector(0.f, 0.f, 0.f);
 	lAng = Quaternion(0.f, 0.f, 0.f, 1.f);
 	lScale = Vector(1.f, 1.f, 1.f);
@@ -912,6 +912,9 @@ void Component::serialize(FileInterface * file) {
 	Uint32 version = 1;
 	file->property("Component::version", version);
 	file->property("name", name);
+	if (file->isReading()) {
+		nameID = StringID(name.get());
+	}
 	file->property("lPos", lPos);
 	if (version == 0) {
 		Rotation rotation;
@@ -929,7 +932,7 @@ void Component::serializeComponents(FileInterface* file) {
 		Uint32 componentCount = 0;
 		file->propertyName("components");
 		file->beginArray(componentCount);
-		for (Uint32 index = 0; index < componentCount; ++index) {
+		for (Uint32 index = 0; file->arrayElement(index, componentCount); ++index) {
 			file->beginObject();
 
 			Component::type_t type = Component::type_t::COMPONENT_BASIC;
@@ -6,6 +6,7 @@
 #include "Vector.hpp"
 #include "ArrayList.hpp"
 #include "String.hpp"
+#include "StringID.hpp"
 #include "LinkedList.hpp"
 #include "Rect.hpp"
 #include "WideVector.hpp"
@@ -447,11 +448,20 @@ public:
 	//! @return the component, or nullptr if it could not be found
 	template <typename T>
 	T* findComponentByName(const char* name) {
-		if (name == nullptr || strcmp(name, "") == 0) {
+		// a string which was never interned cannot be any component's name
+		return findComponentByName<T>(StringID::find(name));
+	}
+
+	//! find the component with the given name
+	//! @param name the interned name of the component
+	//! @return the component, or nullptr if it could not be found
+	template <typename T>
+	T* findComponentByName(StringID name) {
+		if (name.empty()) {
 			return nullptr;
 		}
 		for (Uint32 c = 0; c < components.getSize(); ++c) {
-			if (strcmp(components[c]->getName(), name) == 0) {
+			if (components[c]->getNameID() == name) {
 				return static_cast<T*>(components[c]);
 			} else {
 				T* result = components[c]->findComponentByName<T>(name);
@@ -575,6 +585,7 @@ public:
 	ArrayList<Component*>&			getComponents() { return components; }
 	Uint32							getUID() const { return uid; }
 	const char*						getName() const { return name.get(); }
+	StringID						getNameID() const { return nameID; }
 	const Vector&					getLocalPos() const { return lPos; }
 	const Quaternion&				getLocalAng() const { return lAng; }
 	const Vector&					getLocalScale() const { return lScale; }
@@ -589,7 +600,7 @@ public:
 	const Vector&					getBoundsMin() const { return boundsMin; }
 
 	void				setEditorOnly(bool _editorOnly) { editorOnly = _editorOnly; }
-	void				setName(const char* _name) { name = _name; }
+	void				setName(const char* _name) { name = _name; nameID = StringID(_name); }
 	void				setLocalPos(const Vector& _pos) { lPos = _pos; updateNeeded = true; }
 	void				setLocalAng(const Quaternion& _ang) { lAng = _ang; updateNeeded = true; }
 	void				setLocalScale(const Vector& _scale) { lScale = _scale; updateNeeded = true; }
@@ -600,6 +611,7 @@ public:
 		toBeDeleted = src.toBeDeleted;
 		editorOnly = src.editorOnly;
 		name = src.name;
+		nameID = src.nameID;
 		lPos = src.lPos;
 		lAng = src.lAng;
 		lScale = src.lScale;
@@ -635,6 +647,7 @@ protected:
 
 	Uint32 uid = nuid;		//!< component uid
 	String name;			//!< component name
+	StringID nameID;		//!< interned component name, for fast lookups
 
 	//! local space
 	Vector		lPos;		//!< position
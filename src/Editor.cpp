@@ -2411,8 +2411,7 @@ void Editor::updateContentNavigatorFilters() {
 	// repopulate entries
 	{
 		Frame* frame = gui->findFrame("editor_FrameContentNavigatorList"); assert(frame);
-		for (const Node<Entity::def_t*>* node = mainEngine->getEntityDefs().getFirst(); node != nullptr; node = node->getNext()) {
-			const Entity::def_t* def = node->getData();
+		for (const Entity::def_t* def : mainEngine->getEntityDefs()) {
 			bool matchesFilter = true;
 			for (auto c : filters) {
 				if (!def->entity.hasComponent(c)) {
@@ -10,9 +10,11 @@
 #include "Console.hpp"
 #include "Editor.hpp"
 #include "Mixer.hpp"
+#include "AssetPack.hpp"
 
 #include <thread>
 #include <chrono>
+#include <atomic>
 
 #ifdef PLATFORM_WINDOWS
 #include <DbgHelp.h>
@@ -49,9 +51,11 @@ Engine::Engine(int argc, char **argv) :
 	}
 
 	// open log file
-	logLock = SDL_CreateMutex();
 	if (!logFile)
 		logFile = freopen("log.txt", "wb" /*or "wt"*/, stderr);
+	logger.start(
+		[this](Uint32 kind, const char* timestamp, const char* text) { writeLog(kind, timestamp, text); },
+		[]() { fflush(stderr); fflush(stdout); });
 	fmsg(Engine::MSG_INFO, "hello.");
 
 	// read command line
@@ -63,7 +67,6 @@ Engine::~Engine() {
 }
 
 static int console_clear(int argc, const char** argv) {
-	mainEngine->getTextResource().dumpCache();
 	mainEngine->clearLog();
 	return 0;
 }
@@ -312,6 +315,56 @@ static int console_map(int argc, const char** argv) {
 	return 0;
 }
 
+static int console_logStats(int argc, const char** argv) {
+	Logger& logger = mainEngine->getLogger();
+	mainEngine->fmsg(Engine::MSG_INFO, "log: %llu written, %llu collapsed as repeats, %llu dropped",
+		(unsigned long long)logger.getWritten(), (unsigned long long)logger.getCollapsed(), (unsigned long long)logger.getDropped());
+	return 0;
+}
+
+static int console_tickStats(int argc, const char** argv) {
+	const Engine::tickstats_t& stats = mainEngine->getTickStats();
+	const double passes = (double)std::max(stats.passes, (Uint64)1);
+	mainEngine->fmsg(Engine::MSG_INFO, "tick: %llu run at %d/s, %llu dropped, %llu passes caught up",
+		(unsigned long long)stats.ticks, mainEngine->getTicksPerSecond(), (unsigned long long)stats.dropped, (unsigned long long)stats.catchUps);
+	mainEngine->fmsg(Engine::MSG_INFO, " late %.3f ms avg, %.3f ms max; work %.3f ms avg, %.3f ms max; slept %.1f s",
+		stats.totalLate * 1000.0 / passes, stats.maxLate * 1000.0,
+		stats.totalWork * 1000.0 / passes, stats.maxWork * 1000.0, stats.totalSleep);
+	if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+		mainEngine->resetTickStats();
+	}
+	return 0;
+}
+
+static int console_defsBenchmark(int argc, const char** argv) {
+	const ArrayList<Entity::def_t*>& defs = mainEngine->getEntityDefs();
+	if (defs.getSize() == 0) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "No entity defs are loaded.");
+		return 1;
+	}
+	Uint32 iterations = argc > 1 ? (Uint32)strtol(argv[1], nullptr, 10) : 100000;
+	iterations = std::max(iterations, 1U);
+
+	// look up every def once per iteration, the way spawning by name and decoding ENTU packets do
+	Uint32 misses = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (Uint32 c = 0; c < iterations; ++c) {
+		const Entity::def_t* def = defs[c % defs.getSize()];
+		misses += Entity::findDef(def->entity.getName().get()) == def ? 0 : 1;
+	}
+	auto mid = std::chrono::steady_clock::now();
+	for (Uint32 c = 0; c < iterations; ++c) {
+		misses += Entity::findDef(c % defs.getSize()) ? 0 : 1;
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	double byName = std::chrono::duration<double, std::nano>(mid - start).count() / iterations;
+	double byIndex = std::chrono::duration<double, std::nano>(end - mid).count() / iterations;
+	mainEngine->fmsg(Engine::MSG_INFO, "%u entity defs: %.1f ns per lookup by name, %.1f ns per lookup by index (%u misses)",
+		defs.getSize(), byName, byIndex, misses);
+	return 0;
+}
+
 static Ccmd ccmd_help("help", "lists all console commands and variables", &console_help);
 static Ccmd ccmd_shutdown("exit", "kill engine immediately", &console_shutdown);
 static Ccmd ccmd_windowed("windowed", "set the engine to windowed mode", &console_windowed);
@@ -329,7 +382,12 @@ static Ccmd ccmd_sleep("sleep", "waits X seconds before running the next command
 static Ccmd ccmd_cachesize("cachesize", "prints the size of all resource caches in bytes", &console_cacheSize);
 static Ccmd ccmd_printDir("printdir", "shows the directory that the engine is running from", &console_printDir);
 static Ccmd ccmd_map("map", "start a new game map", &console_map);
+static Ccmd ccmd_logStats("log.stats", "prints how many log lines were written, collapsed, and dropped", &console_logStats);
+static Ccmd ccmd_tickStats("tickrate.stats", "prints tick scheduler timing; pass 'reset' to clear it afterwards", &console_tickStats);
+static Ccmd ccmd_defsBenchmark("entity.defs.benchmark", "times entity def lookups by name and by index. ex: entity.defs.benchmark 100000", &console_defsBenchmark);
 static Cvar cvar_tickrate("tickrate", "number of frames processed in a second", "60");
+static Cvar cvar_tickCatchUp("tickrate.catchup", "most ticks run back-to-back to catch up after a stall; time owed beyond this is dropped", "4");
+static Cvar cvar_logLevel("log.level", "lowest severity written to the log (0 = debug, 1 = info, 2 = warn, 3 = error, 4 = critical, 5 = fatal)", "0");
 
 // gameplay specific cvars:
 static Cvar cvar_streamerMode("gameplay.streamer.enabled", "privacy mode for streamers, obscures addresses etc.", "0");
@@ -755,7 +813,7 @@ void Engine::init() {
 	}
 
 	// instantiate a timer
-	lastTick = clock();
+	lastTick = std::chrono::steady_clock::now();
 	SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
 
 	// initialize renderer
@@ -783,11 +841,16 @@ void Engine::init() {
 	resources.insertUnique("staticmesh", new Resource<Mesh, false>());
 	resources.insertUnique("image", new Resource<Image, true>());
 	resources.insertUnique("material", new Resource<Material>());
-	resources.insertUnique("text", new Resource<Text>());
 	resources.insertUnique("sound", new Resource<Sound>());
 	resources.insertUnique("animation", new Resource<Animation>());
 	resources.insertUnique("cubemap", new Resource<Cubemap>());
 
+	// mount asset packs (mods added on the command line came in before the engine was up)
+	game.pack.reset(AssetPack::openFolder(game.path.get()));
+	for (mod_t& mod : mods) {
+		mod.pack.reset(AssetPack::openFolder(mod.path.get()));
+	}
+
 	// cache resources
 	fmsg(Engine::MSG_INFO, "game folder is '%s'", game.path.get());
 	loadAllResources();
@@ -801,32 +864,81 @@ void Engine::loadResources(const char* folder) {
 	// deprecated
 }
 
-void Engine::loadDefs(const char* folder) {
+Uint32 Engine::loadDefs(const char* folder) {
 	StringBuf<64> entitiesDirPath;
 	entitiesDirPath.format("%s/entities", folder);
-	Directory entitiesDir(entitiesDirPath.get());
-	if (entitiesDir.isLoaded()) {
+
+	// a folder with an asset pack lists its defs from the pack's index
+	ArrayList<String> names;
+	const char* packedDir = nullptr;
+	if (AssetPack* pack = findPack(entitiesDirPath.get(), packedDir)) {
+		pack->list(packedDir, names);
+	} else {
+		Directory entitiesDir(entitiesDirPath.get());
+		if (!entitiesDir.isLoaded()) {
+			return 0;
+		}
 		for (Node<String>* node = entitiesDir.getList().getFirst(); node != nullptr; node = node->getNext()) {
-			String& str = node->getData();
-			StringBuf<256> entityPath("entities/");
-			entityPath.append(str.get());
-			entityPath = buildPath(entityPath.get()).get();
-			Entity::def_t* def = Entity::loadDef(entityPath.get());
-			entityDefs.addNodeLast(def);
+			names.push(node->getData());
+		}
+	}
+
+	ArrayList<String> paths;
+	for (auto& str : names) {
+		StringBuf<256> entityPath("entities/");
+		entityPath.append(str.get());
+		paths.push(buildPath(entityPath.get()));
+	}
+	if (paths.getSize() == 0) {
+		return 0;
+	}
+
+	// reading and parsing the files touches no engine state, so spread it across worker threads.
+	// building the entities does (components pull from the resource caches), so that stays on this thread
+	ArrayList<FileHelper::ParsedFile*> parsed;
+	parsed.resize(paths.getSize());
+	std::atomic<Uint32> next(0);
+	auto parse = [&paths, &parsed, &next]() {
+		for (Uint32 c = next++; c < paths.getSize(); c = next++) {
+			parsed[c] = FileHelper::parseFile(paths[c].get());
+		}
+	};
+	Uint32 numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+	numThreads = std::min(numThreads, paths.getSize());
+	ArrayList<std::thread> workers;
+	workers.resize(numThreads - 1);
+	for (auto& worker : workers) {
+		worker = std::thread(parse);
+	}
+	parse();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	Uint32 loaded = 0;
+	for (Uint32 c = 0; c < parsed.getSize(); ++c) {
+		Entity::def_t* def = parsed[c] ? Entity::loadDef(parsed[c]) : nullptr;
+		FileHelper::freeParsedFile(parsed[c]);
+		if (!def) {
+			fmsg(MSG_ERROR, "failed to load entity def '%s'", paths[c].get());
+			continue;
+		}
+		def->index = entityDefs.getSize();
+		entityDefs.push(def);
+		if (!entityDefIndices.exists(def->entity.getName())) {
+			entityDefIndices.insert(def->entity.getName(), def->index);
 		}
+		++loaded;
 	}
+	return loaded;
 }
 
 Uint32 Engine::findEntityDefIndexByName(const char* name) {
 	if (!name || name[0] == '\0') {
 		return UINT32_MAX;
 	}
-	for (auto def : entityDefs) {
-		if (def->entity.getName() == name) {
-			return def->index;
-		}
-	}
-	return UINT32_MAX;
+	const Uint32* index = entityDefIndices.find(name);
+	return index ? *index : UINT32_MAX;
 }
 
 void Engine::term() {
@@ -882,6 +994,8 @@ void Engine::term() {
 	fmsg(MSG_INFO, "successfully shut down game engine.");
 	fmsg(MSG_INFO, "goodbye.");
 
+	// finish writing the log before the file goes away
+	logger.stop();
 	if (logFile)
 		fclose(logFile);
 
@@ -933,14 +1047,19 @@ void Engine::loadAllResources() {
 }
 
 void Engine::loadAllDefs() {
-	while (entityDefs.getFirst()) {
-		delete entityDefs.getFirst()->getData();
-		entityDefs.removeNode(entityDefs.getFirst());
+	for (auto def : entityDefs) {
+		delete def;
 	}
-	loadDefs(game.path.get());
+	entityDefs.clear();
+	entityDefIndices.clear();
+
+	auto start = std::chrono::steady_clock::now();
+	Uint32 loaded = loadDefs(game.path.get());
 	for (mod_t& mod : mods) {
-		loadDefs(mod.path.get());
+		loaded += loadDefs(mod.path.get());
 	}
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	fmsg(MSG_INFO, "loaded %u entity defs in %.1f ms", loaded, ms);
 }
 
 void Engine::dumpResources(const char* type) {
@@ -968,79 +1087,52 @@ void Engine::fmsg(const Uint32 msgType, const char* fmt, ...) {
 	}
 #endif
 
-	// wait for current log to finish
-	if (!logLock) {
-		while (1) {
-			SDL_LockMutex(logLock);
-			if (logging) {
-				SDL_UnlockMutex(logLock);
-			} else {
-				logging = true;
-				SDL_UnlockMutex(logLock);
-				break;
-			}
-		}
+	// filter by severity before paying for formatting (notes and chat always pass)
+	if (msgType <= MSG_FATAL && (int)msgType < cvar_logLevel.toInt()) {
+		return;
 	}
 
-	char str[1024];
-	str[1024 - 1] = '\0';
+	char str[Logger::maxLineLength];
+	str[Logger::maxLineLength - 1] = '\0';
 
 	// format the string
 	va_list argptr;
 	va_start(argptr, fmt);
-	vsnprintf(str, 1024, fmt, argptr);
+	vsnprintf(str, Logger::maxLineLength, fmt, argptr);
 	va_end(argptr);
-	str[1024 - 1] = '\0';
-
-	// bust multi-line strings into individual strings...
-	for (Uint32 c = 0; c < (Uint32)strlen(str); ++c) {
-		if (str[c] == '\n') {
-			str[c] = 0;
-
-			// disable lock temporarily
-			if (logLock) {
-				SDL_LockMutex(logLock);
-				logging = false;
-				SDL_UnlockMutex(logLock);
-			}
-
-			// write second line
-			fmsg(msgType, (const char *)(str + c + 1));
-
-			// reactivate log lock
-			if (logLock) {
-				while (1) {
-					SDL_LockMutex(logLock);
-					if (logging) {
-						SDL_UnlockMutex(logLock);
-					} else {
-						logging = true;
-						SDL_UnlockMutex(logLock);
-						break;
-					}
-				}
+	str[Logger::maxLineLength - 1] = '\0';
+
+	// errors and worse are never dropped, even when the log is backed up
+	const bool mustDeliver = msgType >= MSG_ERROR && msgType <= MSG_FATAL;
+
+	// bust multi-line strings into individual lines
+	char* line = str;
+	for (char* c = str; ; ++c) {
+		if (*c == '\n' || *c == '\0') {
+			const bool last = *c == '\0';
+			*c = '\0';
+			logger.push(msgType, line, mustDeliver);
+			if (last) {
+				break;
 			}
+			line = c + 1;
 		}
 	}
 
-	// create timestamp string
-	time_t timer;
-	char buffer[32];
-	struct tm* tm_info;
-	time(&timer);
-	tm_info = localtime(&timer);
-	strftime(buffer, 32, "%H-%M-%S", tm_info);
+	// the caller is about to exit(), make sure it all hits the disk
+	if (msgType == MSG_FATAL) {
+		logger.flush();
+	}
+}
 
+void Engine::writeLog(const Uint32 msgType, const char* timestamp, const char* str) {
 	// print message to stderr and stdout
-	fprintf(stderr, "[%s] %s: %s\r\n", buffer, (const char *)msgTypeStr[msgType], str);
-	fprintf(stdout, "[%s] %s: %s\r\n", buffer, (const char *)msgTypeStr[msgType], str);
-	fflush(stderr);
-	fflush(stdout);
+	fprintf(stderr, "[%s] %s: %s\r\n", timestamp, (const char *)msgTypeStr[msgType], str);
+	fprintf(stdout, "[%s] %s: %s\r\n", timestamp, (const char *)msgTypeStr[msgType], str);
 
 	// add message to log list
 	logmsg_t logMsg;
 	logMsg.text = str;
-	logMsg.uid = logUids++;
 	logMsg.kind = static_cast<msg_t>(msgType);
 	switch (msgType) {
 	case MSG_DEBUG:
@@ -1075,14 +1167,9 @@ void Engine::fmsg(const Uint32 msgType, const char* fmt, ...) {
 		break;
 	}
 
+	std::lock_guard<std::mutex> lock(logListLock);
+	logMsg.uid = logUids++;
 	logList.addNodeLast(logMsg);
-
-	// unlock log stuff
-	if (logLock) {
-		SDL_LockMutex(logLock);
-		logging = false;
-		SDL_UnlockMutex(logLock);
-	}
 }
 
 void Engine::smsg(const Uint32 msgType, const String& str) {
@@ -1296,32 +1383,41 @@ void Engine::preProcess() {
 		resource.b->update();
 	}
 
-	// do timer
-	constexpr int maxFramesBeforeDrop = 16;
-	ticksPerSecond = cvar_tickrate.toInt();
-	double interval = (double)CLOCKS_PER_SEC / (double)ticksPerSecond;
-	double now = clock();
+	// do timer: wall time accumulates and is paid out in fixed ticks. if we fall too far behind
+	// (a stall, a breakpoint) the excess is dropped rather than run back-to-back
+	ticksPerSecond = std::max(cvar_tickrate.toInt(), 1);
+	tickInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds(1)) / ticksPerSecond;
+	const Uint32 maxCatchUp = (Uint32)std::max(cvar_tickCatchUp.toInt(), 1);
+	auto now = std::chrono::steady_clock::now();
+	tickAccumulator += now - lastTick;
+	lastTick = now;
 	int framesCounted = 0;
-	frameDiff += now - lastTick;
-	while (frameDiff >= interval) {
-	    frameDiff -= interval;
-		if (!paused && framesCounted < maxFramesBeforeDrop) {
-			SDL_Event event;
-			SDL_UserEvent userevent;
-
-			userevent.type = SDL_USEREVENT;
-			userevent.code = 0;
-			userevent.data1 = nullptr;
-			userevent.data2 = nullptr;
-
-			event.type = SDL_USEREVENT;
-			event.user = userevent;
-
-			SDL_PushEvent(&event);
-			++framesCounted;
+	if (tickAccumulator >= tickInterval) {
+		const double late = std::chrono::duration<double>(tickAccumulator - tickInterval).count();
+		Uint64 due = (Uint64)(tickAccumulator / tickInterval);
+		tickAccumulator -= tickInterval * due;
+		if (!paused) {
+			framesCounted = (int)std::min(due, (Uint64)maxCatchUp);
+			tickStats.ticks += framesCounted;
+			tickStats.dropped += due - framesCounted;
+			tickStats.catchUps += framesCounted > 1 ? 1 : 0;
+			tickStats.totalLate += late;
+			tickStats.maxLate = std::max(tickStats.maxLate, late);
+			++tickStats.passes;
+			passStart = now;
+		}
+	}
+	for (int c = 0; c < framesCounted; ++c) {
+		executedFrames = true;
+
+		++ticks;
+		if (localServer) {
+			localServer->incrementFrame();
+		}
+		if (localClient) {
+			localClient->incrementFrame();
 		}
 	}
-	lastTick = clock();
 
 	SDL_GameController* pad = nullptr;
 	SDL_Joystick* joystick = nullptr;
@@ -1581,19 +1677,6 @@ void Engine::preProcess() {
 			}
 			SDL_free(event.drop.file);
 		}
-		case SDL_USEREVENT: // if the game timer has elapsed
-		{
-			executedFrames = true;
-
-			++ticks;
-			if (localServer) {
-				localServer->incrementFrame();
-			}
-			if (localClient) {
-				localClient->incrementFrame();
-			}
-			break;
-		}
 		}
 	}
 	if (!mousestatus[SDL_BUTTON_LEFT]) {
@@ -1678,6 +1761,10 @@ void Engine::postProcess() {
 	if (executedFrames) {
 		executedFrames = false;
 
+		const double work = std::chrono::duration<double>(std::chrono::steady_clock::now() - passStart).count();
+		tickStats.totalWork += work;
+		tickStats.maxWork = std::max(tickStats.maxWork, work);
+
 		mousexrel = 0;
 		mouseyrel = 0;
 		mousewheelx = 0;
@@ -1713,8 +1800,17 @@ void Engine::postProcess() {
 	}
 	++cycles;
 
-	// sleep thread for a bit
-	std::this_thread::yield();
+	// a dedicated server has nothing to draw, so it sleeps until the next tick falls due instead of spinning
+	if (!runningClient && !paused) {
+		auto now = std::chrono::steady_clock::now();
+		auto nextTick = lastTick + (tickInterval - tickAccumulator);
+		if (nextTick > now) {
+			std::this_thread::sleep_until(nextTick);
+			tickStats.totalSleep += std::chrono::duration<double>(std::chrono::steady_clock::now() - now).count();
+		}
+	} else {
+		std::this_thread::yield();
+	}
 }
 
 ArrayList<String> Engine::getDisplayModes() const {
@@ -1803,6 +1899,14 @@ String Engine::buildPath(const char* path) const {
 		StringBuf<256> modResult(mod.path.get());
 		modResult.appendf("/%s", path);
 
+		// a mod with an asset pack is served entirely from it
+		if (mod.pack) {
+			if (mod.pack->find(path)) {
+				result = modResult;
+			}
+			continue;
+		}
+
 		FILE* fp = nullptr;
 		if ((fp = fopen(modResult.get(), "rb")) != nullptr) {
 			result = modResult;
@@ -1813,6 +1917,46 @@ String Engine::buildPath(const char* path) const {
 	return result;
 }
 
+AssetPack* Engine::findPack(const char* path, const char*& name) const {
+	if (!path) {
+		return nullptr;
+	}
+	auto serves = [path, &name](const mod_t& mod) {
+		const Uint32 len = mod.path.length();
+		if (mod.pack && len && strncmp(path, mod.path.get(), len) == 0 && path[len] == '/') {
+			name = path + len + 1;
+			return true;
+		}
+		return false;
+	};
+	for (const mod_t& mod : mods) {
+		if (serves(mod)) {
+			return mod.pack.get();
+		}
+	}
+	return serves(game) ? game.pack.get() : nullptr;
+}
+
+bool Engine::readPackedFile(const char* path, ArrayList<Uint8>& data) const {
+	const char* name = nullptr;
+	AssetPack* pack = findPack(path, name);
+	const AssetPack::entry_t* entry = pack ? pack->find(name) : nullptr;
+	return entry && pack->read(*entry, data);
+}
+
+bool Engine::statPackedFile(const char* path, Uint64& size, Sint64& time, Uint64& hash) const {
+	const char* name = nullptr;
+	AssetPack* pack = findPack(path, name);
+	const AssetPack::entry_t* entry = pack ? pack->find(name) : nullptr;
+	if (!entry) {
+		return false;
+	}
+	size = entry->size;
+	time = pack->getTime();
+	hash = entry->contentHash;
+	return true;
+}
+
 void Engine::loadMapServer(const char* path) {
 	if (!localServer)
 		return;
@@ -1846,6 +1990,9 @@ bool Engine::addMod(const char* name) {
 			Engine::fmsg(MSG_ERROR, "failed to install '%s' mod.", name);
 			return false;
 		}
+		if (initialized) {
+			mod.pack.reset(AssetPack::openFolder(name));
+		}
 		mods.addNodeLast(mod);
 
 		Engine::fmsg(MSG_INFO, "installed '%s' mod", name);
@@ -1880,22 +2027,9 @@ bool Engine::removeMod(const char* name) {
 bool Engine::copyLog(LinkedList<Engine::logmsg_t>& dest) {
 	bool result = false;
 
-	// wait for current logging action to finish
-	while (1) {
-		SDL_LockMutex(logLock);
-		if (logging) {
-			SDL_UnlockMutex(logLock);
-		} else {
-			logging = true;
-			SDL_UnlockMutex(logLock);
-			break;
-		}
-	}
+	std::lock_guard<std::mutex> lock(logListLock);
 
 	if (dest.getSize() == logList.getSize()) {
-		SDL_LockMutex(logLock);
-		logging = false;
-		SDL_UnlockMutex(logLock);
 		return false;
 	} else if (dest.getSize() > logList.getSize()) {
 		dest.removeAll();
@@ -1908,32 +2042,12 @@ bool Engine::copyLog(LinkedList<Engine::logmsg_t>& dest) {
 		dest.addNodeLast(newMsg);
 	}
 
-	SDL_LockMutex(logLock);
-	logging = false;
-	SDL_UnlockMutex(logLock);
-
 	return result;
 }
 
 void Engine::clearLog() {
-
-	// wait for current logging action to finish
-	while (1) {
-		SDL_LockMutex(logLock);
-		if (logging) {
-			SDL_UnlockMutex(logLock);
-		} else {
-			logging = true;
-			SDL_UnlockMutex(logLock);
-			break;
-		}
-	}
-
+	std::lock_guard<std::mutex> lock(logListLock);
 	logList.removeAll();
-
-	SDL_LockMutex(logLock);
-	logging = false;
-	SDL_UnlockMutex(logLock);
 }
 
 Uint32 Engine::random() {
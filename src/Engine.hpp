@@ -18,10 +18,15 @@
 #include "Dictionary.hpp"
 #include "Cubemap.hpp"
 #include "Font.hpp"
+#include "Logger.hpp"
+
+#include <chrono>
+#include <memory>
 
 class Server;
 class Client;
 class FileInterface;
+class AssetPack;
 
 //! The Engine object is the root of the entire engine. Here lives top level data about the current engine state:
 //! the local Client and Server (if they are running), functions to step everything forward, update devices, etc.
@@ -71,6 +76,7 @@ public:
 		String name;
 		String author;
 		bool loaded = false;
+		std::shared_ptr<AssetPack> pack;	//!< the folder's asset pack, if it has one (see AssetPack)
 
 		void serialize(FileInterface * file);
 	};
@@ -78,6 +84,19 @@ public:
 	//! default ticks per second
 	static const unsigned int defaultTickRate = 60;
 
+	//! tick scheduler statistics, accumulated since startup or the last reset
+	struct tickstats_t {
+		Uint64 ticks = 0;				//!< ticks run
+		Uint64 passes = 0;				//!< main loop passes which ran at least one tick
+		Uint64 catchUps = 0;			//!< passes which ran more than one tick to catch up
+		Uint64 dropped = 0;				//!< ticks skipped because the loop fell further behind than the catch-up limit
+		double totalLate = 0.0;			//!< seconds between when ticks fell due and when they ran
+		double maxLate = 0.0;			//!< the latest any pass started its ticks, in seconds
+		double totalWork = 0.0;			//!< seconds spent in passes which ran ticks
+		double maxWork = 0.0;			//!< the longest such pass, in seconds
+		double totalSleep = 0.0;		//!< seconds spent sleeping until the next tick (dedicated servers only)
+	};
+
 	//! amount of ticks within which two clicks register as a "double-click"
 	static const unsigned int doubleClickTime = 30;
 
@@ -91,6 +110,9 @@ public:
 	Renderer*							getRenderer() { return renderer; }
 	Client*								getLocalClient() { return localClient; }
 	Server*								getLocalServer() { return localServer; }
+	Logger&								getLogger() { return logger; }
+	const tickstats_t&					getTickStats() const { return tickStats; }
+	void								resetTickStats() { tickStats = tickstats_t(); }
 	int									getXres() const { return xres; }
 	int									getYres() const { return yres; }
 	bool								getKeyStatus(const int index) const { return keystatus[index]; }
@@ -117,11 +139,10 @@ public:
 	auto&								getStaticMeshResource() { return *static_cast<Resource<Mesh, false>*>(*resources.find("staticmesh")); }
 	auto&								getImageResource() { return *static_cast<Resource<Image, true>*>(*resources.find("image")); }
 	auto&								getMaterialResource() { return *static_cast<Resource<Material, false>*>(*resources.find("material")); }
-	auto&								getTextResource() { return *static_cast<Resource<Text, false>*>(*resources.find("text")); }
 	auto&								getSoundResource() { return *static_cast<Resource<Sound, false>*>(*resources.find("sound")); }
 	auto&								getAnimationResource() { return *static_cast<Resource<Animation, false>*>(*resources.find("animation")); }
 	auto&								getCubemapResource() { return *static_cast<Resource<Cubemap, false>*>(*resources.find("cubemap")); }
-	const LinkedList<Entity::def_t*>&	getEntityDefs() { return entityDefs; }
+	const ArrayList<Entity::def_t*>&	getEntityDefs() { return entityDefs; }
 	LinkedList<String>&					getCommandHistory() { return commandHistory; }
 	const char*							getInputStr() { return inputstr; }
 	bool								isCursorVisible() const { return (ticks - cursorflash) % ticksPerSecond < ticksPerSecond / 2; }
@@ -162,7 +183,10 @@ public:
 	void loadAllDefs();
 
 	//! load entity defs from a particular mod / game folder
-	void loadDefs(const char* folder);
+	//! files are read and parsed on worker threads, then deserialized in directory order on the calling thread
+	//! @param folder the mod / game folder to search
+	//! @return the number of defs loaded
+	Uint32 loadDefs(const char* folder);
 
 	//! clears all resource caches, effectively starting the engine "fresh"
 	//! this does NOT unmount mods! It simply causes the engine to recache any loaded resources
@@ -386,6 +410,20 @@ public:
 	//! @return the complete path string
 	String buildPath(const char* path) const;
 
+	//! read a file which buildPath() resolved into the asset pack of a game or mod folder
+	//! @param path the complete path to the file
+	//! @param data where to store the file's contents
+	//! @return true if the file is packed and was read, false if it should be read from disk
+	bool readPackedFile(const char* path, ArrayList<Uint8>& data) const;
+
+	//! get details of a file which buildPath() resolved into an asset pack
+	//! @param path the complete path to the file
+	//! @param size where to store the size of the file
+	//! @param time where to store the modification time (that of the pack)
+	//! @param hash where to store the hash of the file's contents (64-bit FNV-1a)
+	//! @return true if the file is packed
+	bool statPackedFile(const char* path, Uint64& size, Sint64& time, Uint64& hash) const;
+
 	//! add a mod to the game
 	//! @param name the name of the mod folder to add
 	//! @return true if the mod was added, false otherwise
@@ -409,6 +447,12 @@ private:
 	//! shuts down the engine
 	void term();
 
+	//! writes a line to the log file, stdout, and the console (called from the logger thread)
+	//! @param msgType the type of message
+	//! @param timestamp time the message was logged
+	//! @param str the text of the message
+	void writeLog(const Uint32 msgType, const char* timestamp, const char* str);
+
 	//! handles segfault
 	static void handleSIGSEGV(int input);
 
@@ -426,13 +470,19 @@ private:
 	mod_t game;
 	LinkedList<mod_t> mods;
 
+	//! find the asset pack which serves a path
+	//! @param path the complete path to a file
+	//! @param name where to store the path of the file within the pack
+	//! @return the pack, or nullptr if the path is not in a game or mod folder with a pack
+	AssetPack* findPack(const char* path, const char*& name) const;
+
 	//! log data
 	FILE *logFile = nullptr;
 	LinkedList<logmsg_t> logList;
 	LinkedList<String> commandHistory;
 	unsigned int logUids = 0;
-	SDL_mutex* logLock = nullptr;
-	bool logging = false;
+	std::mutex logListLock;
+	Logger logger;
 
 	//! local client and server data
 	bool runningClient = true;
@@ -443,8 +493,11 @@ private:
 	//! resource caches
 	Map<StringBuf<32>, ResourceBase*> resources;
 
-	//! entity definitions
-	LinkedList<Entity::def_t*> entityDefs;
+	//! entity definitions, indexed by def_t::index
+	ArrayList<Entity::def_t*> entityDefs;
+
+	//! entity def name -> index in entityDefs (the first def loaded with a name wins)
+	Map<String, Uint32> entityDefIndices;
 
 	//! random number generator
 	Random rand;
@@ -461,8 +514,11 @@ private:
 	double frameval[fpsAverage];
 	Uint32 ticks = 0, cycles = 0, lastfpscount = 0;
 	bool executedFrames = false;
-	double lastTick = 0.0;
-	double frameDiff = 0.0;
+	std::chrono::steady_clock::time_point lastTick;		//!< when the scheduler last ran
+	std::chrono::steady_clock::duration tickAccumulator = std::chrono::steady_clock::duration::zero();	//!< wall time owed to the simulation
+	std::chrono::steady_clock::duration tickInterval = std::chrono::steady_clock::duration::zero();		//!< wall time per tick at the current rate
+	std::chrono::steady_clock::time_point passStart;		//!< when the current pass started running ticks
+	tickstats_t tickStats;
 
 	//! console data
 	Uint32 consoleSleep = 0;
@@ -29,6 +29,9 @@
 #include "Character.hpp"
 #include "Multimesh.hpp"
 
+//! name of the bbox which gives an entity its physics
+static const StringID physicsName("physics");
+
 const char* Entity::flagStr[static_cast<int>(Entity::flag_t::FLAG_NUM)] = {
 	"VISIBLE",
 	"PASSABLE",
@@ -44,7 +47,8 @@ const char* Entity::flagStr[static_cast<int>(Entity::flag_t::FLAG_NUM)] = {
 	"DEPTHFAIL",
 	"OCCLUDE",
 	"INTERACTABLE",
-	"STATIC"
+	"STATIC",
+	"RELEVANT"
 };
 
 const char* Entity::flagDesc[static_cast<int>(Entity::flag_t::FLAG_NUM)] = {
@@ -62,7 +66,8 @@ const char* Entity::flagDesc[static_cast<int>(Entity::flag_t::FLAG_NUM)] = {
 	"Enables drawing in the depth fail pass",
 	"Causes the entity to block occlusion tests",
 	"Indicates to clients whether an entity is interactible",
-	"Heavily optimize the entity but render it immobile"
+	"Heavily optimize the entity but render it immobile",
+	"Replicates the entity to every client at full rate, regardless of distance"
 };
 
 const char* Entity::sortStr[SORT_MAX] = {
@@ -75,6 +80,10 @@ const char* Entity::sortStr[SORT_MAX] = {
 	"trigger"
 };
 
+ArrayList<Uint32> Entity::freeOcclusionSlots;
+Uint32 Entity::numOcclusionSlots = 0;
+Uint32 Entity::occlusionStamps = 0;
+
 Entity::Entity(World* _world, Uint32 _uid) {
 	// insert the entity into the world
 	world = _world;
@@ -133,6 +142,12 @@ Entity::~Entity() {
 	if (path) {
 		delete path;
 	}
+
+	// give back our occlusion slot
+	if (occlusionSlot != UINT32_MAX) {
+		freeOcclusionSlots.push(occlusionSlot);
+		occlusionSlot = UINT32_MAX;
+	}
 }
 
 bool Entity::isOccluded(Camera& camera) {
@@ -140,6 +155,18 @@ bool Entity::isOccluded(Camera& camera) {
 	return query.result;
 }
 
+Uint32 Entity::getOcclusionSlot() {
+	if (occlusionSlot == UINT32_MAX) {
+		occlusionSlot = freeOcclusionSlots.getSize() ? freeOcclusionSlots.pop() : numOcclusionSlots++;
+		occlusionStamp = ++occlusionStamps;
+		if (occlusionStamp == 0) {
+			// zero marks an unused query
+			occlusionStamp = ++occlusionStamps;
+		}
+	}
+	return occlusionSlot;
+}
+
 Game* Entity::getGame() {
 	if (world) {
 		return world->getGame();
@@ -685,13 +712,18 @@ void Entity::animate(const char* name, bool blend) {
 }
 
 void Entity::warp() {
-	BBox* bbox = findComponentByName<BBox>("physics");
+	BBox* bbox = findComponentByName<BBox>(physicsName);
 	if (bbox) {
 		bbox->setPhysicsTransform(pos + bbox->getLocalPos(), ang * bbox->getLocalAng());
 	}
 }
 
-void Entity::depositItem(Entity * entityToDeposit, String invSlot)
+void Entity::depositItem(Entity * entityToDeposit, const char* invSlot)
+{
+	depositItem(entityToDeposit, StringID::find(invSlot));
+}
+
+void Entity::depositItem(Entity * entityToDeposit, StringID invSlot)
 {
 	item.depositItem(entityToDeposit, invSlot);
 	entityToDeposit->insertIntoWorld(nullptr, entityToDeposit, Vector());
@@ -699,27 +731,27 @@ void Entity::depositItem(Entity * entityToDeposit, String invSlot)
 
 void Entity::depositInAvailableSlot(Entity* entityToDeposit)
 {
-	if (!item.isSlotFilled("RightHand"))
+	if (!item.isSlotFilled(Inventory::slotRightHand))
 	{
-		depositItem(entityToDeposit, "RightHand");
-	} else if (!item.isSlotFilled("LeftHand"))
+		depositItem(entityToDeposit, Inventory::slotRightHand);
+	} else if (!item.isSlotFilled(Inventory::slotLeftHand))
 	{
-		depositItem(entityToDeposit, "LeftHand");
-	} else if (!item.isSlotFilled("Back"))
+		depositItem(entityToDeposit, Inventory::slotLeftHand);
+	} else if (!item.isSlotFilled(Inventory::slotBack))
 	{
-		depositItem(entityToDeposit, "Back");
-	} else if (!item.isSlotFilled("RightHip"))
+		depositItem(entityToDeposit, Inventory::slotBack);
+	} else if (!item.isSlotFilled(Inventory::slotRightHip))
 	{
-		depositItem(entityToDeposit, "RightHip");
-	} else if (!item.isSlotFilled("LeftHip"))
+		depositItem(entityToDeposit, Inventory::slotRightHip);
+	} else if (!item.isSlotFilled(Inventory::slotLeftHip))
 	{
-		depositItem(entityToDeposit, "LeftHip");
-	} else if (!item.isSlotFilled("Waist"))
+		depositItem(entityToDeposit, Inventory::slotLeftHip);
+	} else if (!item.isSlotFilled(Inventory::slotWaist))
 	{
-		depositItem(entityToDeposit, "Waist");
+		depositItem(entityToDeposit, Inventory::slotWaist);
 	} else
 	{
-		depositItem(entityToDeposit, "RightHand");
+		depositItem(entityToDeposit, Inventory::slotRightHand);
 	}
 }
 
@@ -833,7 +865,7 @@ void Entity::setMat(const glm::mat4& _mat) {
 }
 
 void Entity::applyForce(const Vector& force, const Vector& origin) {
-	BBox* bbox = findComponentByName<BBox>("physics");
+	BBox* bbox = findComponentByName<BBox>(physicsName);
 	if (bbox) {
 		bbox->applyForce(force, origin);
 	}
@@ -846,31 +878,28 @@ Entity::def_t* Entity::loadDef(const char* filename) {
 	return def;
 }
 
+Entity::def_t* Entity::loadDef(FileHelper::ParsedFile* file) {
+	def_t* def = new def_t();
+	def->index = (Uint32)mainEngine->getEntityDefs().getSize();
+	if (!FileHelper::readObject(file, *def)) {
+		delete def;
+		return nullptr;
+	}
+	return def;
+}
+
 bool Entity::saveDef(const char* filename) const {
 	def_t def(*this);
 	return FileHelper::writeObject(filename, EFileFormat::Json, def);
 }
 
 const Entity::def_t* Entity::findDef(const char* name) {
-	for (const Node<Entity::def_t*>* node = mainEngine->getEntityDefs().getFirst(); node != nullptr; node = node->getNext()) {
-		const Entity::def_t* def = node->getData();
-		if (def->entity.getName() == name) {
-			return def;
-		}
-	}
-	return nullptr;
+	return findDef(mainEngine->findEntityDefIndexByName(name));
 }
 
 const Entity::def_t* Entity::findDef(const Uint32 index) {
-	Uint32 c;
-	const Node<Entity::def_t*>* node;
-	for (c = 0, node = mainEngine->getEntityDefs().getFirst(); node != nullptr; node = node->getNext(), ++c) {
-		const Entity::def_t* def = node->getData();
-		if (c == index) {
-			return def;
-		}
-	}
-	return nullptr;
+	const ArrayList<Entity::def_t*>& defs = mainEngine->getEntityDefs();
+	return index < defs.getSize() ? defs[index] : nullptr;
 }
 
 Entity* Entity::spawnFromDef(World* world, const Entity::def_t& def, const Vector& pos, const Rotation& ang, Uint32 uid) {
@@ -886,7 +915,7 @@ Entity* Entity::spawnFromDef(World* world, const Entity::def_t& def, const Vecto
 	entity->setAng(q);
 	entity->setNewAng(q);
 
-	BBox* bbox = entity->findComponentByName<BBox>("physics");
+	BBox* bbox = entity->findComponentByName<BBox>(physicsName);
 	if (bbox && bbox->getMass() != 0.f && !bbox->getParent()) {
 		bbox->setPhysicsTransform(pos + bbox->getLocalPos(), bbox->getLocalAng() * q);
 	}
@@ -1047,7 +1076,7 @@ void Entity::serialize(FileInterface * file) {
 		Uint32 componentCount = 0;
 		file->propertyName("components");
 		file->beginArray(componentCount);
-		for (Uint32 index = 0; index < componentCount; ++index) {
+		for (Uint32 index = 0; file->arrayElement(index, componentCount); ++index) {
 			file->beginObject();
 
 			Component::type_t type = Component::type_t::COMPONENT_BASIC;
@@ -1097,6 +1126,43 @@ void Entity::serialize(FileInterface * file) {
 }
 
 void Entity::setKeyValue(const char* key, const char* value)
+{
+	setKeyValue(StringID(key), value);
+}
+
+void Entity::deleteKeyValue(const char* key)
+{
+	deleteKeyValue(StringID::find(key));
+}
+
+// a key which was never interned cannot be in any entity, so these look up without interning it
+
+const char* Entity::getKeyValueAsString(const char* key) const
+{
+	return getKeyValueAsString(StringID::find(key));
+}
+
+float Entity::getKeyValueAsFloat(const char* key) const
+{
+	return getKeyValueAsFloat(StringID::find(key));
+}
+
+int Entity::getKeyValueAsInt(const char* key) const
+{
+	return getKeyValueAsInt(StringID::find(key));
+}
+
+bool Entity::getKeyValueAsBool(const char* key) const
+{
+	return getKeyValueAsBool(StringID::find(key));
+}
+
+const char* Entity::getKeyValue(const char* key) const
+{
+	return getKeyValueAsString(key);
+}
+
+void Entity::setKeyValue(StringID key, const char* value)
 {
 	String* exists = keyvalues[key];
 	if (exists) {
@@ -1106,12 +1172,12 @@ void Entity::setKeyValue(const char* key, const char* value)
 	}
 }
 
-void Entity::deleteKeyValue(const char* key)
+void Entity::deleteKeyValue(StringID key)
 {
 	keyvalues.remove(key);
 }
 
-const char* Entity::getKeyValueAsString(const char* key) const
+const char* Entity::getKeyValueAsString(StringID key) const
 {
 	const String* value = keyvalues.find(key);
 	if (value) {
@@ -1121,7 +1187,7 @@ const char* Entity::getKeyValueAsString(const char* key) const
 	}
 }
 
-float Entity::getKeyValueAsFloat(const char* key) const
+float Entity::getKeyValueAsFloat(StringID key) const
 {
 	const String* value = keyvalues.find(key);
 	if (value) {
@@ -1131,7 +1197,7 @@ float Entity::getKeyValueAsFloat(const char* key) const
 	}
 }
 
-int Entity::getKeyValueAsInt(const char* key) const
+int Entity::getKeyValueAsInt(StringID key) const
 {
 	const String* value = keyvalues.find(key);
 	if (value) {
@@ -1141,7 +1207,7 @@ int Entity::getKeyValueAsInt(const char* key) const
 	}
 }
 
-bool Entity::getKeyValueAsBool(const char* key) const
+bool Entity::getKeyValueAsBool(StringID key) const
 {
 	const String* value = keyvalues.find(key);
 	if (value) {
@@ -1151,7 +1217,7 @@ bool Entity::getKeyValueAsBool(const char* key) const
 	}
 }
 
-const char* Entity::getKeyValue(const char* key) const
+const char* Entity::getKeyValue(StringID key) const
 {
 	return getKeyValueAsString(key);
 }
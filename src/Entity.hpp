@@ -53,7 +53,8 @@ public:
 		FLAG_OCCLUDE = 1 << 12,
 		FLAG_INTERACTABLE = 1 << 13,
 		FLAG_STATIC = 1 << 14,
-		FLAG_NUM = 15
+		FLAG_RELEVANT = 1 << 15,
+		FLAG_NUM = 16
 	};
 	static const char* flagStr[static_cast<int>(flag_t::FLAG_NUM)];
 	static const char* flagDesc[static_cast<int>(flag_t::FLAG_NUM)];
@@ -97,9 +98,10 @@ public:
 	bool							    isToBeDeleted() const { return toBeDeleted; }
 	const Vector&						getScale() const { return scale; }
 	const Uint32&						getFlags() const { return flags; }
-	const Map<String, String>&			getKeyValues() const { return keyvalues; }
+	const Map<StringID, String>&		getKeyValues() const { return keyvalues; }
 	bool							    isFlag(const flag_t flag) const { return ((flags&static_cast<Uint32>(flag)) != 0); }
 	bool							    isShouldSave() const { return shouldSave; }
+	bool								isReplicated() const { return replicated; }
 	World*								getWorld() { return world; }
 	const World*						getWorld() const { return world; }
 	Player*								getPlayer() { return player; }
@@ -141,6 +143,7 @@ public:
 	void					resetFlag(const Uint32 flag) { flags &= ~flag; }
 	void					toggleFlag(const Uint32 flag) { flags ^= flag; }
 	void					setShouldSave(const bool _shouldSave) { shouldSave = _shouldSave; }
+	void					setReplicated(const bool _replicated) { replicated = _replicated; }
 	void					setPlayer(Player* _player) { player = _player; }
 	void					setFalling(const bool b) { falling = b; }
 	void					setLastUpdate(const Uint32 _lastUpdate) { lastUpdate = _lastUpdate; }
@@ -163,6 +166,14 @@ public:
 	//! @return true if it is potentially visible, otherwise false
 	bool isOccluded(Camera& camera);
 
+	//! get the entity's occlusion slot, allocating one if needed.
+	//! slots are small integers unique among live entities which cameras use to index their occlusion arrays
+	//! @return the slot
+	Uint32 getOcclusionSlot();
+
+	//! @return a value unique to this entity's tenure of its occlusion slot (0 if it has none yet)
+	Uint32 getOcclusionStamp() const { return occlusionStamp; }
+
 	//! get game sim that we are living in (if any)
 	//! @return the Game* that we are in, or nullptr if we aren't in a game
 	Game* getGame();
@@ -235,6 +246,15 @@ public:
 	//! @return the value associated with the key, or "" if it could not be found
 	const char* getKeyValue(const char* key) const;
 
+	//! overloads of the above which take an interned key, so the lookup hashes and compares integers
+	void setKeyValue(StringID key, const char* value);
+	void deleteKeyValue(StringID key);
+	const char* getKeyValueAsString(StringID key) const;
+	float getKeyValueAsFloat(StringID key) const;
+	int getKeyValueAsInt(StringID key) const;
+	bool getKeyValueAsBool(StringID key) const;
+	const char* getKeyValue(StringID key) const;
+
 	//! runs the entity's pre-process script
 	void preProcess();
 
@@ -277,6 +297,11 @@ public:
 	//! @return a newly created def_t struct
 	static def_t* loadDef(const char* filename);
 
+	//! loads an entity definition from a file which has already been parsed
+	//! @param file the parsed file to read from
+	//! @return a newly created def_t struct, or nullptr on failure
+	static def_t* loadDef(FileHelper::ParsedFile* file);
+
 	//! saves an entity definition to a json file
 	//! @param filename the file to load
 	//! @return true on success, false on failure
@@ -349,11 +374,20 @@ public:
 	//! @return the component, or nullptr if it could not be found
 	template <typename T>
 	T* findComponentByName(const char* name) {
-		if (name == nullptr || strcmp(name, "") == 0) {
+		// a string which was never interned cannot be any component's name
+		return findComponentByName<T>(StringID::find(name));
+	}
+
+	//! find the component with the given name
+	//! @param name the interned name of the component
+	//! @return the component, or nullptr if it could not be found
+	template <typename T>
+	T* findComponentByName(StringID name) {
+		if (name.empty()) {
 			return nullptr;
 		}
 		for (Uint32 c = 0; c < components.getSize(); ++c) {
-			if (strcmp(components[c]->getName(), name) == 0) {
+			if (components[c]->getNameID() == name) {
 				return static_cast<T*>(components[c]);
 			} else {
 				T* result = components[c]->findComponentByName<T>(name);
@@ -457,7 +491,8 @@ public:
 	void warp();
 
 	//! deposit an item into the specified inventory slot
-	void depositItem(Entity* entityToDeposit, String invSlot);
+	void depositItem(Entity* entityToDeposit, const char* invSlot);
+	void depositItem(Entity* entityToDeposit, StringID invSlot);
 
 	//! check if this entity is existing on the client
 	//! @return true if the entity is a client object
@@ -511,13 +546,16 @@ protected:
 	bool ranScript = false;					//!< is true if script has run at least once
 
 	Uint32 uid = 0;							//!< entity id number
+	Uint32 occlusionSlot = UINT32_MAX;		//!< index into per-camera occlusion arrays (see getOcclusionSlot())
+	Uint32 occlusionStamp = 0;				//!< distinguishes us from previous owners of our occlusion slot
 	Uint32 ticks = 0;						//!< lifespan of the entity
 	Uint32 lastUpdate = 0;					//!< time of last remote update of the entity (netplay)
 	bool toBeDeleted = false;				//!< if true, the entity has been marked for deletion at the end of the current frame
 	bool shouldSave = true;					//!< if true, the entity is saved when the world is saved to a file; if false, it is not
+	bool replicated = false;				//!< if true, a client spawned the entity from a server update (netplay)
 	bool falling = false;					//!< when true the entity is off the floor, otherwise they are on the floor
 
-	Map<String, String> keyvalues;
+	Map<StringID, String> keyvalues;
 
 	Item item;
 	bool canBePickedUp = false;
@@ -536,6 +574,11 @@ protected:
 	void updateRigidBody();
 	void deleteRigidBody();
 
+	//! occlusion slot allocator
+	static ArrayList<Uint32> freeOcclusionSlots;
+	static Uint32 numOcclusionSlots;
+	static Uint32 occlusionStamps;
+
 	Vector pathNode;
 	Vector pathDir;
 	std::future<PathFinder::Path*> pathTask;
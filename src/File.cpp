@@ -3,14 +3,25 @@
 #include "Main.hpp"
 #include "Engine.hpp"
 #include "File.hpp"
+#include "Console.hpp"
 
 #include "rapidjson/document.h"
 #include "rapidjson/writer.h"
 #include "rapidjson/prettywriter.h"
 #include "rapidjson/error/en.h"
+#include "rapidjson/reader.h"
+#include "rapidjson/filereadstream.h"
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 const Uint32 BinaryFormatTag = 0x73706666; // 'spff'
 
+//! json files at least this big are streamed (see JsonStreamReader); smaller ones are parsed whole first
+static const long JsonStreamSize = 1024 * 1024;
+
 class JsonFileWriter : public FileInterface {
 public:
 
@@ -97,9 +108,24 @@ public:
 			return false;
 		}
 
-		jfr.beginObject();
-		serialize(&jfr);
-		jfr.endObject();
+		return jfr.readParsed(serialize);
+	}
+
+	static bool readObject(const Uint8 * data, size_t size, const FileHelper::SerializationFunc & serialize) {
+		JsonFileReader jfr;
+
+		if (!jfr.readAllData((const char *)data, size)) {
+			return false;
+		}
+
+		return jfr.readParsed(serialize);
+	}
+
+	//! deserialize from the document already loaded by readAllFileData()
+	bool readParsed(const FileHelper::SerializationFunc & serialize) {
+		beginObject();
+		serialize(this);
+		endObject();
 
 		return true;
 	}
@@ -218,10 +244,17 @@ protected:
 		// null terminate
 		data[size] = 0;
 
-		rapidjson::ParseResult result = doc.Parse(data);
+		bool result = readAllData(data, size);
 
 		free(data);
 
+		return result;
+	}
+
+	//! parse a document which is already in memory (eg. read from an asset pack)
+	bool readAllData(const char * data, size_t size) {
+		rapidjson::ParseResult result = doc.Parse(data, size);
+
 		if (!result) {
 			mainEngine->fmsg(Engine::MSG_ERROR, "JsonFileReader: parse error: %s (%d)", rapidjson::GetParseError_En(result.Code()), result.Offset());
 			return false;
@@ -240,19 +273,587 @@ protected:
 	ArrayList<DocIterator> stack;
 };
 
+//! Reads JSON while it is still being parsed. A worker thread runs the RapidJSON SAX reader over the file
+//! and hands tokens over in batches, which the symmetric serialize() functions then pull off in order.
+//! Only a few batches are in flight at once, so memory stays bounded however large the file is.
+//! When an object's members are not in the order serialize() asks for them, the rest of that object is
+//! gathered into a DOM and read by name instead (see propertyName()).
+//! The object is filled in as the file is parsed, so a parse error part way through leaves it partly read.
+//! Callers must treat a failed read as having left the object in an unknown state.
+class JsonStreamReader : public FileInterface {
+public:
+
+	JsonStreamReader(FILE * file)
+		: fp(file)
+	{
+		thread = std::thread(&JsonStreamReader::run, this);
+	}
+
+	~JsonStreamReader() {
+		stop();
+	}
+
+	static bool readObject(FILE * fp, const FileHelper::SerializationFunc & serialize) {
+		JsonStreamReader jsr(fp);
+
+		jsr.beginObject();
+		serialize(&jsr);
+		jsr.endObject();
+
+		jsr.stop();
+		if (jsr.result.IsError() && jsr.result.Code() != rapidjson::kParseErrorTermination) {
+			mainEngine->fmsg(Engine::MSG_ERROR, "JsonStreamReader: parse error: %s (%d)", rapidjson::GetParseError_En(jsr.result.Code()), jsr.result.Offset());
+			return false;
+		}
+		if (!jsr.good) {
+			mainEngine->fmsg(Engine::MSG_ERROR, "JsonStreamReader: unexpected value for '%s'", jsr.badProperty.get());
+			return false;
+		}
+		return true;
+	}
+
+	virtual bool isReading() const override { return true; }
+
+	virtual void beginObject() override {
+		const token_t& t = fetch();
+		frame_t frame;
+		if (t.type == token_t::START_OBJECT) {
+			frame.dom = t.dom;
+		} else {
+			unexpected(t);
+			frame.dom = &emptyObject;
+		}
+		stack.push(frame);
+	}
+
+	virtual void endObject() override {
+		frame_t frame = stack.pop();
+		if (!frame.dom) {
+			// skip members nobody asked for
+			while (true) {
+				const token_t& t = nextToken();
+				if (t.type == token_t::KEY) {
+					skipValue(nextToken());
+				} else {
+					break;
+				}
+			}
+		}
+	}
+
+	virtual void beginArray(Uint32 & size) override {
+		const token_t& t = fetch();
+		frame_t frame;
+		frame.array = true;
+		if (t.type == token_t::START_ARRAY) {
+			frame.dom = t.dom;
+		} else {
+			unexpected(t);
+			frame.dom = &emptyArray;
+		}
+		size = frame.dom ? frame.dom->Size() : 0;
+		stack.push(frame);
+	}
+
+	virtual bool arrayElement(Uint32 index, Uint32 size) override {
+		const frame_t& frame = stack.peek();
+		if (frame.dom) {
+			return index < size;
+		}
+		const token_t& t = peekToken();
+		return t.type != token_t::END_ARRAY && t.type != token_t::MISSING;
+	}
+
+	virtual void endArray() override {
+		frame_t frame = stack.pop();
+		if (!frame.dom) {
+			// skip items nobody asked for
+			while (true) {
+				const token_t& t = nextToken();
+				if (t.type == token_t::END_ARRAY || t.type == token_t::MISSING) {
+					break;
+				}
+				skipValue(t);
+			}
+		}
+	}
+
+	virtual void propertyName(const char * fieldName) override {
+		propName = fieldName;
+		if (stack.empty() || stack.peek().dom || stack.peek().array) {
+			return;
+		}
+
+		const token_t& t = nextToken();
+		if (t.type == token_t::KEY && strcmp(t.str, fieldName) == 0) {
+			return;
+		}
+
+		// out of order (or missing): read the rest of the object into memory and look members up by name
+		rapidjson::Value* object = newValue();
+		object->SetObject();
+		if (t.type == token_t::KEY) {
+			rapidjson::Value key(t.str, t.len, fallback.GetAllocator());
+			rapidjson::Value member;
+			buildValue(nextToken(), member);
+			object->AddMember(key, member, fallback.GetAllocator());
+			buildMembers(*object);
+		} else if (t.type != token_t::END_OBJECT) {
+			unexpected(t);
+		}
+		stack.peek().dom = object;
+	}
+
+	virtual void value(Uint32& value) override {
+		readNumber(value);
+	}
+	virtual void value(Sint32& value) override {
+		readNumber(value);
+	}
+	virtual void value(float& value) override {
+		readNumber(value);
+	}
+	virtual void value(double& value) override {
+		readNumber(value);
+	}
+	virtual void value(bool& value) override {
+		const token_t& t = fetch();
+		if (t.type == token_t::BOOL) {
+			value = t.b;
+		} else {
+			unexpected(t);
+		}
+	}
+	virtual void value(String& value, Uint32 maxLength) override {
+		const token_t& t = fetch();
+		if (t.type == token_t::STRING) {
+			assert(maxLength == 0 || t.len <= maxLength);
+			value = t.str;
+		} else {
+			unexpected(t);
+		}
+	}
+	virtual void value(Uint32& v, Dictionary * lookup) override {
+		const token_t& t = fetch();
+		if (t.type == token_t::STRING) {
+			v = (Uint32)lookup->findOrInsert(t.str);
+		} else {
+			unexpected(t);
+		}
+	}
+
+private:
+
+	//! number of tokens handed over at a time
+	static const Uint32 batchSize = 4096;
+
+	//! number of batches which may be parsed ahead of the reader
+	static const Uint32 maxBatches = 4;
+
+	struct token_t {
+		enum type_t {
+			MISSING,		//!< the value is not in the file
+			NULLVALUE,
+			BOOL,
+			INT,
+			UINT,
+			DOUBLE,
+			STRING,
+			KEY,
+			START_OBJECT,
+			END_OBJECT,
+			START_ARRAY,
+			END_ARRAY
+		};
+		type_t type = MISSING;
+		union {
+			bool b;
+			Sint64 i;
+			Uint64 u;
+			double d;
+		};
+		Uint32 offset = 0;						//!< where the string starts in its batch's text
+		Uint32 len = 0;							//!< length of the string
+		const char* str = "";					//!< the string, once the reader has the token
+		const rapidjson::Value* dom = nullptr;	//!< for containers that were gathered into a DOM
+	};
+
+	struct batch_t {
+		ArrayList<token_t> tokens;
+		ArrayList<char> text;
+	};
+
+	struct frame_t {
+		bool array = false;
+		const rapidjson::Value* dom = nullptr;	//!< set if the container is read from memory rather than the stream
+		Uint32 index = 0;
+	};
+
+	//! SAX handler, run on the parser thread
+	class Handler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, Handler> {
+	public:
+		Handler(JsonStreamReader& _owner) :
+			owner(_owner) {}
+
+		bool Null() { token_t t; t.type = token_t::NULLVALUE; return owner.push(t); }
+		bool Bool(bool b) { token_t t; t.type = token_t::BOOL; t.b = b; return owner.push(t); }
+		bool Int(int i) { token_t t; t.type = token_t::INT; t.i = i; return owner.push(t); }
+		bool Uint(unsigned u) { token_t t; t.type = token_t::UINT; t.u = u; return owner.push(t); }
+		bool Int64(int64_t i) { token_t t; t.type = token_t::INT; t.i = i; return owner.push(t); }
+		bool Uint64(uint64_t u) { token_t t; t.type = token_t::UINT; t.u = u; return owner.push(t); }
+		bool Double(double d) { token_t t; t.type = token_t::DOUBLE; t.d = d; return owner.push(t); }
+		bool String(const char* str, rapidjson::SizeType len, bool copy) { token_t t; t.type = token_t::STRING; return owner.push(t, str, len); }
+		bool Key(const char* str, rapidjson::SizeType len, bool copy) { token_t t; t.type = token_t::KEY; return owner.push(t, str, len); }
+		bool StartObject() { token_t t; t.type = token_t::START_OBJECT; return owner.push(t); }
+		bool EndObject(rapidjson::SizeType members) { token_t t; t.type = token_t::END_OBJECT; return owner.push(t); }
+		bool StartArray() { token_t t; t.type = token_t::START_ARRAY; return owner.push(t); }
+		bool EndArray(rapidjson::SizeType elements) { token_t t; t.type = token_t::END_ARRAY; return owner.push(t); }
+
+	private:
+		JsonStreamReader& owner;
+	};
+
+	FILE* fp = nullptr;
+	std::thread thread;
+	std::mutex lock;
+	std::condition_variable ready;
+
+	//! batches are filled in a ring, guarded by the lock
+	batch_t batches[maxBatches];
+	Uint32 produced = 0;			//!< batches handed to the reader
+	Uint32 consumed = 0;			//!< batches the reader is done with
+	bool finished = false;			//!< the parser thread has stopped
+	bool aborted = false;			//!< the reader wants the parser thread to stop
+	rapidjson::ParseResult result;
+
+	//! parser thread state
+	batch_t* filling = nullptr;
+
+	//! reader state
+	batch_t* reading = nullptr;
+	Uint32 position = 0;
+	token_t missing;
+	token_t domToken;
+	ArrayList<frame_t> stack;
+	const char* propName = nullptr;
+	rapidjson::Document fallback;
+	const rapidjson::Value emptyObject{ rapidjson::kObjectType };
+	const rapidjson::Value emptyArray{ rapidjson::kArrayType };
+	bool good = true;
+	String badProperty;
+
+	//! parser thread entry point
+	void run() {
+		char buffer[65536];
+		rapidjson::FileReadStream stream(fp, buffer, sizeof(buffer));
+		rapidjson::Reader reader;
+		Handler handler(*this);
+		rapidjson::ParseResult parsed = reader.Parse(stream, handler);
+
+		std::lock_guard<std::mutex> guard(lock);
+		if (filling && filling->tokens.getSize()) {
+			++produced;
+		}
+		filling = nullptr;
+		result = parsed;
+		finished = true;
+		ready.notify_all();
+	}
+
+	//! wait for the parser thread to stop
+	void stop() {
+		if (thread.joinable()) {
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				aborted = true;
+				ready.notify_all();
+			}
+			thread.join();
+		}
+	}
+
+	//! add a token to the batch being filled (parser thread)
+	//! @return false if the reader has given up
+	bool push(token_t& t, const char* str = nullptr, Uint32 len = 0) {
+		if (!filling) {
+			std::unique_lock<std::mutex> guard(lock);
+			ready.wait(guard, [this]() { return produced - consumed < maxBatches || aborted; });
+			if (aborted) {
+				return false;
+			}
+			filling = &batches[produced % maxBatches];
+			filling->tokens.resize(0);
+			filling->text.resize(0);
+		}
+		if (str) {
+			auto& text = filling->text;
+			const Uint32 size = text.getSize();
+			if (size + len + 1 > text.getMaxSize()) {
+				text.alloc(std::max(size + len + 1, text.getMaxSize() * 2));
+			}
+			text.resize(size + len + 1);
+			memcpy(&text[size], str, len);
+			text[size + len] = '\0';
+			t.offset = size;
+			t.len = len;
+		}
+		filling->tokens.push(t);
+		if (filling->tokens.getSize() >= batchSize) {
+			std::lock_guard<std::mutex> guard(lock);
+			++produced;
+			filling = nullptr;
+			ready.notify_all();
+		}
+		return true;
+	}
+
+	//! make sure the reader has a token to look at
+	//! @return false if the stream has ended
+	bool ensureToken() {
+		while (!reading || position >= reading->tokens.getSize()) {
+			std::unique_lock<std::mutex> guard(lock);
+			if (reading) {
+				reading = nullptr;
+				++consumed;
+				ready.notify_all();
+			}
+			ready.wait(guard, [this]() { return produced > consumed || finished; });
+			if (produced == consumed) {
+				return false;
+			}
+			reading = &batches[consumed % maxBatches];
+			position = 0;
+		}
+		return true;
+	}
+
+	//! @return the next token without taking it
+	const token_t& peekToken() {
+		if (!ensureToken()) {
+			return missing;
+		}
+		token_t& t = reading->tokens[position];
+		if (t.type == token_t::STRING || t.type == token_t::KEY) {
+			t.str = &reading->text[t.offset];
+		}
+		return t;
+	}
+
+	//! @return the next token. It stays valid until the next token is taken
+	const token_t& nextToken() {
+		const token_t& t = peekToken();
+		if (&t != &missing) {
+			++position;
+		}
+		return t;
+	}
+
+	//! @return the value that the next call should read, from the stream or from a gathered DOM
+	const token_t& fetch() {
+		if (stack.empty() || !stack.peek().dom) {
+			return nextToken();
+		}
+
+		frame_t& frame = stack.peek();
+		const rapidjson::Value* v = nullptr;
+		if (frame.array) {
+			if (frame.index < frame.dom->Size()) {
+				v = &(*frame.dom)[frame.index];
+				++frame.index;
+			}
+		} else if (propName) {
+			auto member = frame.dom->FindMember(propName);
+			if (member != frame.dom->MemberEnd()) {
+				v = &member->value;
+			}
+		}
+		propName = nullptr;
+		if (!v) {
+			return missing;
+		}
+
+		domToken = token_t();
+		if (v->IsNull()) {
+			domToken.type = token_t::NULLVALUE;
+		} else if (v->IsBool()) {
+			domToken.type = token_t::BOOL;
+			domToken.b = v->GetBool();
+		} else if (v->IsUint64()) {
+			domToken.type = token_t::UINT;
+			domToken.u = v->GetUint64();
+		} else if (v->IsInt64()) {
+			domToken.type = token_t::INT;
+			domToken.i = v->GetInt64();
+		} else if (v->IsNumber()) {
+			domToken.type = token_t::DOUBLE;
+			domToken.d = v->GetDouble();
+		} else if (v->IsString()) {
+			domToken.type = token_t::STRING;
+			domToken.str = v->GetString();
+			domToken.len = v->GetStringLength();
+		} else if (v->IsObject()) {
+			domToken.type = token_t::START_OBJECT;
+			domToken.dom = v;
+		} else if (v->IsArray()) {
+			domToken.type = token_t::START_ARRAY;
+			domToken.dom = v;
+		}
+		return domToken;
+	}
+
+	//! read a number, converting from whatever type the file holds
+	template <typename T>
+	void readNumber(T& value) {
+		const token_t& t = fetch();
+		switch (t.type) {
+		case token_t::INT: value = (T)t.i; break;
+		case token_t::UINT: value = (T)t.u; break;
+		case token_t::DOUBLE: value = (T)t.d; break;
+		default: unexpected(t); break;
+		}
+	}
+
+	//! note a value of the wrong type. Missing values leave the destination untouched
+	void unexpected(const token_t& t) {
+		if (t.type == token_t::MISSING) {
+			return;
+		}
+		if (good) {
+			badProperty = propName ? propName : "(array item)";
+			good = false;
+		}
+		if (t.type == token_t::START_OBJECT || t.type == token_t::START_ARRAY) {
+			if (!t.dom) {
+				skipValue(t);
+			}
+		}
+	}
+
+	//! skip over a value in the stream
+	//! @param first the first token of the value, already taken
+	void skipValue(const token_t& first) {
+		if (first.type != token_t::START_OBJECT && first.type != token_t::START_ARRAY) {
+			return;
+		}
+		Uint32 depth = 1;
+		while (depth) {
+			const token_t& t = nextToken();
+			switch (t.type) {
+			case token_t::START_OBJECT:
+			case token_t::START_ARRAY: ++depth; break;
+			case token_t::END_OBJECT:
+			case token_t::END_ARRAY: --depth; break;
+			case token_t::MISSING: return;
+			default: break;
+			}
+		}
+	}
+
+	//! @return a new value owned by the fallback document
+	rapidjson::Value* newValue() {
+		void* mem = fallback.GetAllocator().Malloc(sizeof(rapidjson::Value));
+		return new (mem) rapidjson::Value();
+	}
+
+	//! read a value from the stream into memory
+	//! @param first the first token of the value, already taken
+	//! @param out where to store the value
+	void buildValue(const token_t& first, rapidjson::Value& out) {
+		auto& allocator = fallback.GetAllocator();
+		switch (first.type) {
+		case token_t::NULLVALUE: out.SetNull(); break;
+		case token_t::BOOL: out.SetBool(first.b); break;
+		case token_t::INT: out.SetInt64(first.i); break;
+		case token_t::UINT: out.SetUint64(first.u); break;
+		case token_t::DOUBLE: out.SetDouble(first.d); break;
+		case token_t::STRING: out.SetString(first.str, first.len, allocator); break;
+		case token_t::START_OBJECT:
+			out.SetObject();
+			buildMembers(out);
+			break;
+		case token_t::START_ARRAY:
+			out.SetArray();
+			while (true) {
+				const token_t& t = nextToken();
+				if (t.type == token_t::END_ARRAY || t.type == token_t::MISSING) {
+					break;
+				}
+				rapidjson::Value item;
+				buildValue(t, item);
+				out.PushBack(item, allocator);
+			}
+			break;
+		default:
+			out.SetNull();
+			break;
+		}
+	}
+
+	//! read the remaining members of an object from the stream into memory
+	//! @param object the object to add members to
+	void buildMembers(rapidjson::Value& object) {
+		auto& allocator = fallback.GetAllocator();
+		while (true) {
+			const token_t& t = nextToken();
+			if (t.type != token_t::KEY) {
+				break;
+			}
+			rapidjson::Value key(t.str, t.len, allocator);
+			rapidjson::Value member;
+			buildValue(nextToken(), member);
+			object.AddMember(key, member, allocator);
+		}
+	}
+};
+
+//! Binary files are read and written through a staging buffer of this size, so that
+//! each scalar costs a memcpy rather than a stdio call. A buffer size of 0 gives the old
+//! unbuffered, value-at-a-time behavior, which file.benchmark compares against
+static const size_t BinaryBufferSize = 64 * 1024;
+
 class BinaryFileWriter : public FileInterface {
 public:
 
-	BinaryFileWriter(FILE * file)
+	//! @param file the file to write to
+	//! @param _bufferSize size of the staging buffer, or 0 to write every value straight to the file
+	BinaryFileWriter(FILE * file, size_t _bufferSize = BinaryBufferSize)
 		: fp(file)
+		, bufferSize(_bufferSize)
+	{
+		if (bufferSize) {
+			buffer = new Uint8[bufferSize];
+		}
+	}
+
+	//! @param _memory the buffer to append to, instead of a file
+	BinaryFileWriter(ArrayList<Uint8>& _memory)
+		: memory(&_memory)
 	{
 	}
 
 	~BinaryFileWriter() {
+		flush();
+		delete[] buffer;
 	}
 
-	static bool writeObject(FILE * fp, const FileHelper::SerializationFunc & serialize) {
-		BinaryFileWriter bfw(fp);
+	static bool writeObject(FILE * fp, const FileHelper::SerializationFunc & serialize, size_t bufferSize = BinaryBufferSize) {
+		BinaryFileWriter bfw(fp, bufferSize);
+
+		bfw.writeHeader();
+
+		bfw.beginObject();
+		serialize(&bfw);
+		bfw.endObject();
+
+		bfw.flush();
+		if (!bfw.good) {
+			mainEngine->fmsg(Engine::MSG_ERROR, "BinaryFileWriter: failed to write data (%d)", errno);
+		}
+		return bfw.good;
+	}
+
+	static bool writeObject(ArrayList<Uint8>& memory, const FileHelper::SerializationFunc & serialize) {
+		BinaryFileWriter bfw(memory);
 
 		bfw.writeHeader();
 
@@ -272,7 +873,7 @@ public:
 	}
 
 	virtual void beginArray(Uint32 & size) override {
-		fwrite(&size, sizeof(size), 1, fp);
+		write(&size, sizeof(size));
 	}
 
 	virtual void endArray() override {
@@ -282,19 +883,19 @@ public:
 	}
 
 	virtual void value(Uint32& v) override {
-		fwrite(&v, sizeof(v), 1, fp);
+		write(&v, sizeof(v));
 	}
 	virtual void value(Sint32& v) override {
-		fwrite(&v, sizeof(v), 1, fp);
+		write(&v, sizeof(v));
 	}
 	virtual void value(float& v) override {
-		fwrite(&v, sizeof(v), 1, fp);
+		write(&v, sizeof(v));
 	}
 	virtual void value(double& v) override {
-		fwrite(&v, sizeof(v), 1, fp);
+		write(&v, sizeof(v));
 	}
 	virtual void value(bool& v) override {
-		fwrite(&v, sizeof(v), 1, fp);
+		write(&v, sizeof(v));
 	}
 	virtual void value(String& v, Uint32 maxLength) override {
 		assert(maxLength == 0 || v.getSize() <= maxLength);
@@ -304,34 +905,95 @@ public:
 		const String& str = lookup->getWords()[v];
 		writeStringInternal(str);
 	}
+	virtual bool valueBlock(void* data, Uint32 elementSize, Uint32 count) override {
+		if (fp && !bufferSize) {
+			return false;
+		}
+		write(data, (size_t)elementSize * count);
+		return true;
+	}
 
 private:
 
 	void writeHeader() {
-		fwrite(&BinaryFormatTag, sizeof(BinaryFormatTag), 1, fp);
+		write(&BinaryFormatTag, sizeof(BinaryFormatTag));
 	}
 
 	void writeStringInternal(const String& v) {
 		Uint32 len = (Uint32)v.getSize();
-		fwrite(&len, sizeof(len), 1, fp);
+		write(&len, sizeof(len));
 		if (len) {
-			fwrite(v.get(), sizeof(char), len, fp);
+			write(v.get(), len);
+		}
+	}
+
+	void write(const void * src, size_t bytes) {
+		if (memory) {
+			const Uint32 size = memory->getSize();
+			if (size + bytes > memory->getMaxSize()) {
+				memory->alloc(std::max((Uint32)(size + bytes), memory->getMaxSize() * 2));
+			}
+			memory->resize(size + (Uint32)bytes);
+			memcpy(&(*memory)[size], src, bytes);
+			return;
+		}
+		if (used + bytes > bufferSize) {
+			flush();
+			if (bytes >= bufferSize) {
+				// too big to be worth staging
+				good = fwrite(src, 1, bytes, fp) == bytes && good;
+				return;
+			}
+		}
+		memcpy(buffer + used, src, bytes);
+		used += bytes;
+	}
+
+	void flush() {
+		if (used) {
+			good = fwrite(buffer, 1, used, fp) == used && good;
+			used = 0;
 		}
 	}
 
 	FILE* fp = nullptr;
+	ArrayList<Uint8>* memory = nullptr;
+	Uint8* buffer = nullptr;
+	size_t bufferSize = 0;
+	size_t used = 0;
+	bool good = true;
 };
 
 class BinaryFileReader : public FileInterface {
 public:
 
-	BinaryFileReader(FILE * file)
+	//! @param file the file to read from
+	//! @param _bufferSize size of the staging buffer, or 0 to read every value straight from the file
+	BinaryFileReader(FILE * file, size_t _bufferSize = BinaryBufferSize)
 		: fp(file)
+		, bufferSize(_bufferSize)
+	{
+		if (bufferSize) {
+			buffer = new Uint8[bufferSize];
+		}
+		window = buffer;
+	}
+
+	//! @param data binary data in memory (eg. a mapped file) to read from, instead of a file
+	//! @param size the number of bytes of data
+	BinaryFileReader(const Uint8 * data, size_t size)
+		: fp(nullptr)
+		, window(data)
+		, end(size)
 	{
 	}
 
-	static bool readObject(FILE * fp, const FileHelper::SerializationFunc & serialize) {
-		BinaryFileReader bfr(fp);
+	~BinaryFileReader() {
+		delete[] buffer;
+	}
+
+	static bool readObject(FILE * fp, const FileHelper::SerializationFunc & serialize, size_t bufferSize = BinaryBufferSize) {
+		BinaryFileReader bfr(fp, bufferSize);
 
 		if (!bfr.readHeader()) {
 			return false;
@@ -341,7 +1003,27 @@ public:
 		serialize(&bfr);
 		bfr.endObject();
 
-		return true;
+		if (!bfr.good) {
+			mainEngine->fmsg(Engine::MSG_ERROR, "BinaryFileReader: file is truncated");
+		}
+		return bfr.good;
+	}
+
+	static bool readObject(const Uint8 * data, size_t size, const FileHelper::SerializationFunc & serialize) {
+		BinaryFileReader bfr(data, size);
+
+		if (!bfr.readHeader()) {
+			return false;
+		}
+
+		bfr.beginObject();
+		serialize(&bfr);
+		bfr.endObject();
+
+		if (!bfr.good) {
+			mainEngine->fmsg(Engine::MSG_ERROR, "BinaryFileReader: data is truncated");
+		}
+		return bfr.good;
 	}
 
 	virtual bool isReading() const override { return true; }
@@ -353,8 +1035,8 @@ public:
 	}
 
 	virtual void beginArray(Uint32 & size) override {
-		size_t read = fread(&size, sizeof(size), 1, fp);
-		assert(read == 1);
+		bool result = read(&size, sizeof(size));
+		assert(result);
 	}
 
 	virtual void endArray() override {
@@ -364,24 +1046,24 @@ public:
 	}
 
 	virtual void value(Uint32& v) override {
-		size_t read = fread(&v, sizeof(v), 1, fp);
-		assert(read == 1);
+		bool result = read(&v, sizeof(v));
+		assert(result);
 	}
 	virtual void value(Sint32& v) override {
-		size_t read = fread(&v, sizeof(v), 1, fp);
-		assert(read == 1);
+		bool result = read(&v, sizeof(v));
+		assert(result);
 	}
 	virtual void value(float& v) override {
-		size_t read = fread(&v, sizeof(v), 1, fp);
-		assert(read == 1);
+		bool result = read(&v, sizeof(v));
+		assert(result);
 	}
 	virtual void value(double& v) override {
-		size_t read = fread(&v, sizeof(v), 1, fp);
-		assert(read == 1);
+		bool result = read(&v, sizeof(v));
+		assert(result);
 	}
 	virtual void value(bool& v) override {
-		size_t read = fread(&v, sizeof(v), 1, fp);
-		assert(read == 1);
+		bool result = read(&v, sizeof(v));
+		assert(result);
 	}
 	virtual void value(String& v, Uint32 maxLength) override {
 		readStringInternal(v);
@@ -392,13 +1074,20 @@ public:
 		readStringInternal(str);
 		v = (Uint32)lookup->findOrInsert(str.get());
 	}
+	virtual bool valueBlock(void* data, Uint32 elementSize, Uint32 count) override {
+		if (fp && !bufferSize) {
+			return false;
+		}
+		bool result = read(data, (size_t)elementSize * count);
+		assert(result);
+		return true;
+	}
 
 private:
 
 	bool readHeader() {
 		Uint32 fileFormatTag;
-		size_t read = fread(&fileFormatTag, sizeof(fileFormatTag), 1, fp);
-		if (read != 1) {
+		if (!read(&fileFormatTag, sizeof(fileFormatTag))) {
 			mainEngine->fmsg(Engine::MSG_ERROR, "BinaryFileReader: failed to read format tag (%d)", errno);
 			return false;
 		}
@@ -413,17 +1102,60 @@ private:
 
 	void readStringInternal(String & v) {
 		Uint32 len;
-		size_t read = fread(&len, sizeof(len), 1, fp);
-		assert(read == 1);
+		bool result = read(&len, sizeof(len));
+		assert(result);
 
-		if (len) {
+		if (result && len) {
 			v.alloc(len);
-			read = fread(&v[0u], sizeof(char), len, fp);
-			assert(read == len);
+			result = read(&v[0u], len);
+			assert(result);
 		}
 	}
 
+	//! copy bytes out of the staging buffer (or memory), refilling it as needed
+	//! @return false if the file ran out first (the destination is zeroed)
+	bool read(void * dest, size_t bytes) {
+		Uint8* out = (Uint8*)dest;
+		while (bytes) {
+			if (pos == end) {
+				if (!fp) {
+					memset(out, 0, bytes);
+					good = false;
+					return false;
+				}
+				if (bytes >= bufferSize) {
+					// too big to be worth staging
+					size_t count = fread(out, 1, bytes, fp);
+					if (count != bytes) {
+						memset(out + count, 0, bytes - count);
+						good = false;
+					}
+					return good;
+				}
+				pos = 0;
+				end = fread(buffer, 1, bufferSize, fp);
+				if (!end) {
+					memset(out, 0, bytes);
+					good = false;
+					return false;
+				}
+			}
+			size_t count = std::min(bytes, end - pos);
+			memcpy(out, window + pos, count);
+			out += count;
+			pos += count;
+			bytes -= count;
+		}
+		return good;
+	}
+
 	FILE* fp;
+	Uint8* buffer = nullptr;
+	const Uint8* window = nullptr;	//!< what read() copies from: the staging buffer, or the caller's memory
+	size_t bufferSize = 0;
+	size_t pos = 0;
+	size_t end = 0;
+	bool good = true;
 };
 
 static EFileFormat GetFileFormat(FILE * file) {
@@ -438,6 +1170,19 @@ static EFileFormat GetFileFormat(FILE * file) {
 	}
 }
 
+static EFileFormat GetFileFormat(const Uint8 * data, size_t size) {
+	Uint32 fileFormatTag = 0;
+	if (size >= sizeof(fileFormatTag)) {
+		memcpy(&fileFormatTag, data, sizeof(fileFormatTag));
+	}
+
+	if (fileFormatTag == BinaryFormatTag) {
+		return EFileFormat::Binary;
+	} else {
+		return EFileFormat::Json;
+	}
+}
+
 bool FileHelper::writeObjectInternal(const char * filename, EFileFormat format, const SerializationFunc& serialize) {
 	FILE * file = fopen(filename, "wb");
 	if (mainEngine) {
@@ -462,7 +1207,25 @@ bool FileHelper::writeObjectInternal(const char * filename, EFileFormat format,
 	return success;
 }
 
+bool FileHelper::writeObjectInternal(ArrayList<Uint8>& buffer, const SerializationFunc& serialize) {
+	return BinaryFileWriter::writeObject(buffer, serialize);
+}
+
+bool FileHelper::readObjectInternal(const Uint8 * data, size_t size, const SerializationFunc& serialize) {
+	if (GetFileFormat(data, size) == EFileFormat::Binary) {
+		return BinaryFileReader::readObject(data, size, serialize);
+	} else {
+		return JsonFileReader::readObject(data, size, serialize);
+	}
+}
+
 bool FileHelper::readObjectInternal(const char * filename, const SerializationFunc& serialize) {
+	ArrayList<Uint8> packed;
+	if (mainEngine && mainEngine->readPackedFile(filename, packed)) {
+		mainEngine->fmsg(Engine::MSG_DEBUG, "Reading packed file '%s'", filename);
+		return readObjectInternal(packed.getArray(), packed.getSize(), serialize);
+	}
+
 	FILE * file = fopen(filename, "rb");
 	if (mainEngine) {
 		mainEngine->fmsg(Engine::MSG_DEBUG, "Opening file '%s' for read", filename);
@@ -478,7 +1241,18 @@ bool FileHelper::readObjectInternal(const char * filename, const SerializationFu
 	if (format == EFileFormat::Binary) {
 		success = BinaryFileReader::readObject(file, serialize);
 	} else if (format == EFileFormat::Json) {
-		success = JsonFileReader::readObject(file, serialize);
+		// starting a parser thread costs more than it saves on small files. Parsing them whole also means
+		// a parse error is found before the object is touched
+		long size = -1;
+		if (fseek(file, 0, SEEK_END) == 0) {
+			size = ftell(file);
+			fseek(file, 0, SEEK_SET);
+		}
+		if (size >= 0 && size < JsonStreamSize) {
+			success = JsonFileReader::readObject(file, serialize);
+		} else {
+			success = JsonStreamReader::readObject(file, serialize);
+		}
 	} else {
 		assert(false);
 	}
@@ -487,3 +1261,211 @@ bool FileHelper::readObjectInternal(const char * filename, const SerializationFu
 
 	return success;
 }
+
+class FileHelper::ParsedFile {
+public:
+	String filename;
+	EFileFormat format = EFileFormat::Json;
+	JsonFileReader json;
+	ArrayList<Uint8> packed;	//!< contents of a packed binary file, read from an asset pack
+};
+
+FileHelper::ParsedFile* FileHelper::parseFile(const char * filename) {
+	ArrayList<Uint8> packed;
+	if (mainEngine && mainEngine->readPackedFile(filename, packed)) {
+		ParsedFile* parsed = new ParsedFile();
+		parsed->filename = filename;
+		parsed->format = GetFileFormat(packed.getArray(), packed.getSize());
+		if (parsed->format == EFileFormat::Binary) {
+			parsed->packed = std::move(packed);
+		} else if (!parsed->json.readAllData((const char *)packed.getArray(), packed.getSize())) {
+			delete parsed;
+			return nullptr;
+		}
+		return parsed;
+	}
+
+	FILE * file = fopen(filename, "rb");
+	if (!file) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "Unable to open file '%s' for read (%d)", filename, errno);
+		return nullptr;
+	}
+
+	ParsedFile* parsed = new ParsedFile();
+	parsed->filename = filename;
+	parsed->format = GetFileFormat(file);
+
+	// binary files are cheap to read and stream straight from disk, so they are read later
+	bool success = true;
+	if (parsed->format == EFileFormat::Json) {
+		success = parsed->json.readAllFileData(file);
+	}
+
+	fclose(file);
+
+	if (!success) {
+		delete parsed;
+		return nullptr;
+	}
+	return parsed;
+}
+
+void FileHelper::freeParsedFile(ParsedFile * file) {
+	delete file;
+}
+
+bool FileHelper::readParsedInternal(ParsedFile * file, const SerializationFunc& serialize) {
+	if (!file) {
+		return false;
+	}
+	if (mainEngine) {
+		mainEngine->fmsg(Engine::MSG_DEBUG, "Reading parsed file '%s'", file->filename.get());
+	}
+	if (file->format == EFileFormat::Binary) {
+		if (file->packed.getSize()) {
+			return readObjectInternal(file->packed.getArray(), file->packed.getSize(), serialize);
+		}
+		return readObjectInternal(file->filename.get(), serialize);
+	}
+	return file->json.readParsed(serialize);
+}
+
+//! stand-ins for a world full of entities, used by file.benchmark
+struct BenchmarkComponent {
+	String name = "component";
+	Uint32 type = 0;
+	float pos[3] = { 1.f, 2.f, 3.f };
+	float ang[4] = { 0.f, 0.f, 0.f, 1.f };
+	bool enabled = true;
+	ArrayList<float> weights;
+
+	void serialize(FileInterface * file) {
+		file->property("name", name);
+		file->property("type", type);
+		file->property("pos", pos);
+		file->property("ang", ang);
+		file->property("enabled", enabled);
+		file->property("weights", weights);
+	}
+};
+
+struct BenchmarkEntity {
+	String name = "entity";
+	Uint32 uid = 0;
+	ArrayList<BenchmarkComponent> components;
+
+	void serialize(FileInterface * file) {
+		file->property("name", name);
+		file->property("uid", uid);
+		file->property("components", components);
+	}
+};
+
+struct BenchmarkWorld {
+	ArrayList<BenchmarkEntity> entities;
+	ArrayList<Uint32> tiles;
+
+	void serialize(FileInterface * file) {
+		file->property("entities", entities);
+		file->property("tiles", tiles);
+	}
+};
+
+static int console_fileBenchmark(int argc, const char** argv) {
+	const Uint32 numEntities = argc > 1 ? (Uint32)strtol(argv[1], nullptr, 10) : 10000;
+	const Uint32 iterations = std::max(argc > 2 ? (Uint32)strtol(argv[2], nullptr, 10) : 5U, 1U);
+
+	BenchmarkWorld world;
+	world.entities.resize(numEntities);
+	for (Uint32 c = 0; c < numEntities; ++c) {
+		auto& entity = world.entities[c];
+		entity.uid = c;
+		entity.components.resize(4);
+		for (auto& component : entity.components) {
+			component.type = c;
+			component.weights.resize(16);
+		}
+	}
+	world.tiles.resize(256 * 256);
+	for (Uint32 c = 0; c < world.tiles.getSize(); ++c) {
+		world.tiles[c] = c;
+	}
+
+	using std::placeholders::_1;
+	FileHelper::SerializationFunc write = std::bind(&BenchmarkWorld::serialize, &world, _1);
+
+	static const size_t bufferSizes[2] = { 0, BinaryBufferSize };
+	static const char* names[2] = { "unbuffered", "buffered" };
+	for (Uint32 mode = 0; mode < 2; ++mode) {
+		double writeTime = 0.0, readTime = 0.0;
+		long bytes = 0;
+		bool success = true;
+		for (Uint32 iteration = 0; iteration < iterations && success; ++iteration) {
+			FILE* fp = tmpfile();
+			if (!fp) {
+				mainEngine->fmsg(Engine::MSG_ERROR, "file.benchmark: unable to create temporary file (%d)", errno);
+				return 1;
+			}
+
+			auto start = std::chrono::high_resolution_clock::now();
+			success = BinaryFileWriter::writeObject(fp, write, bufferSizes[mode]) && fflush(fp) == 0;
+			writeTime += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			bytes = ftell(fp);
+			rewind(fp);
+
+			BenchmarkWorld copy;
+			FileHelper::SerializationFunc read = std::bind(&BenchmarkWorld::serialize, &copy, _1);
+			start = std::chrono::high_resolution_clock::now();
+			success = success && BinaryFileReader::readObject(fp, read, bufferSizes[mode]);
+			readTime += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			fclose(fp);
+
+			success = success && copy.entities.getSize() == numEntities && copy.tiles.getSize() == world.tiles.getSize() &&
+				copy.tiles[copy.tiles.getSize() - 1] == world.tiles[world.tiles.getSize() - 1];
+		}
+		if (!success) {
+			mainEngine->fmsg(Engine::MSG_ERROR, "file.benchmark: %s round trip failed", names[mode]);
+			return 1;
+		}
+		const double megabytes = bytes / (1024.0 * 1024.0);
+		mainEngine->fmsg(Engine::MSG_INFO, "%s: %.1f MB, write %.2f ms (%.0f MB/s), read %.2f ms (%.0f MB/s)",
+			names[mode], megabytes,
+			writeTime * 1000.0 / iterations, megabytes * iterations / writeTime,
+			readTime * 1000.0 / iterations, megabytes * iterations / readTime);
+	}
+
+	// json, read into a document first versus streamed
+	FILE* fp = tmpfile();
+	if (!fp) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "file.benchmark: unable to create temporary file (%d)", errno);
+		return 1;
+	}
+	JsonFileWriter::writeObject(fp, write);
+	fflush(fp);
+	const double megabytes = ftell(fp) / (1024.0 * 1024.0);
+	static const char* jsonNames[2] = { "json document", "json stream" };
+	for (Uint32 mode = 0; mode < 2; ++mode) {
+		double readTime = 0.0;
+		bool success = true;
+		for (Uint32 iteration = 0; iteration < iterations && success; ++iteration) {
+			BenchmarkWorld copy;
+			FileHelper::SerializationFunc read = std::bind(&BenchmarkWorld::serialize, &copy, _1);
+			rewind(fp);
+			auto start = std::chrono::high_resolution_clock::now();
+			success = mode == 0 ? JsonFileReader::readObject(fp, read) : JsonStreamReader::readObject(fp, read);
+			readTime += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			success = success && copy.entities.getSize() == numEntities && copy.tiles.getSize() == world.tiles.getSize();
+		}
+		if (!success) {
+			mainEngine->fmsg(Engine::MSG_ERROR, "file.benchmark: %s read failed", jsonNames[mode]);
+			fclose(fp);
+			return 1;
+		}
+		mainEngine->fmsg(Engine::MSG_INFO, "%s: %.1f MB, read %.2f ms (%.0f MB/s)",
+			jsonNames[mode], megabytes, readTime * 1000.0 / iterations, megabytes * iterations / readTime);
+	}
+	fclose(fp);
+	return 0;
+}
+
+static Ccmd ccmd_fileBenchmark("file.benchmark", "round trips a synthetic world through the file backends: binary with and without buffering, and json as a document or a stream. ex: file.benchmark 10000 5", &console_fileBenchmark);
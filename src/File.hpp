@@ -20,10 +20,12 @@
 
 #include "Main.hpp"
 #include "String.hpp"
+#include "StringID.hpp"
 #include "ArrayList.hpp"
 #include "Dictionary.hpp"
 
 #include <functional>
+#include <type_traits>
 
 enum class EFileFormat {
 	Json,
@@ -49,8 +51,14 @@ public:
 	virtual void endObject() = 0;
 
 	//! Signals the beginning of an array in the file
-	//! @param size number of items in the array
+	//! @param size number of items in the array. A reader which cannot know the size ahead of time
+	//! sets it to 0, so callers should step through the items with arrayElement()
 	virtual void beginArray(Uint32 & size) = 0;
+	//! Checks for another item in the current array
+	//! @param index the index of the item about to be serialized
+	//! @param size the size given by beginArray()
+	//! @return true if there is an item at the given index
+	virtual bool arrayElement(Uint32 index, Uint32 size) { return index < size; }
 	//! Signals the end of an array in the file
 	virtual void endArray() = 0;
 
@@ -77,6 +85,23 @@ public:
 	//! @param lookup dictionary to lookup the string in
 	virtual void value(Uint32& v, Dictionary * lookup) = 0;
 
+	//! Serialize a run of plain values in one go, for formats which store them back to back
+	//! @param data the first value
+	//! @param elementSize the size of each value in bytes
+	//! @param count the number of values
+	//! @return false if the values must be serialized one at a time instead
+	virtual bool valueBlock(void* data, Uint32 elementSize, Uint32 count) { return false; }
+
+	//! Serializes an interned string as the string itself, so files do not depend on the ids
+	//! @param v the value to serialize
+	void value(StringID& v) {
+		String str(v.get());
+		value(str);
+		if (isReading()) {
+			v = StringID(str.get());
+		}
+	}
+
 	//! Serialize an ArrayList with a max length
 	//! @param v the value to serialize
 	//! @param maxLength maximum number of items, 0 is no limit
@@ -84,11 +109,16 @@ public:
 	void value(ArrayList<T>& v, Uint32 maxLength = 0, Args ... args) {
 		Uint32 size = (Uint32)v.getSize();
 		beginArray(size);
-		assert(maxLength == 0 || size <= maxLength);
 		v.resize(size);
-		for (Uint32 index = 0; index < size; ++index) {
-			value(v[index], args...);
+		if (!(sizeof...(Args) == 0 && std::is_arithmetic<T>::value && size && valueBlock(&v[0], sizeof(T), size))) {
+			for (Uint32 index = 0; arrayElement(index, size); ++index) {
+				if (index == v.getSize()) {
+					v.push(T());
+				}
+				value(v[index], args...);
+			}
 		}
+		assert(maxLength == 0 || v.getSize() <= maxLength);
 		endArray();
 	}
 
@@ -128,9 +158,11 @@ public:
 	void value(T(&v)[Size], Args ... args) {
 		Uint32 size = Size;
 		beginArray(size);
-		assert(size == Size);
-		for (Uint32 index = 0; index < size; ++index) {
-			value(v[index], args...);
+		assert(size == Size || size == 0);
+		if (!(sizeof...(Args) == 0 && std::is_arithmetic<T>::value && size && valueBlock(&v[0], sizeof(T), Size))) {
+			for (Uint32 index = 0; index < Size && arrayElement(index, Size); ++index) {
+				value(v[index], args...);
+			}
 		}
 		endArray();
 	}
@@ -168,7 +200,8 @@ public:
 		return writeObjectInternal(filename, format, serialize);
 	}
 
-	//! Read an object's data from a file
+	//! Read an object's data from a file. Large json files are read while they are parsed, so if one turns
+	//! out to be malformed the object may be left partly read
 	//! @param filename the name of the file to read
 	//! @param v the object to populate with data
 	template<typename T>
@@ -178,10 +211,56 @@ public:
 		return readObjectInternal(filename, serialize);
 	}
 
+	//! Write an object's data to memory in the binary format
+	//! @param buffer the buffer to append to
+	//! @param v the object to write
+	template<typename T>
+	static bool writeObject(ArrayList<Uint8>& buffer, T & v) {
+		using std::placeholders::_1;
+		SerializationFunc serialize = std::bind(&T::serialize, &v, _1);
+		return writeObjectInternal(buffer, serialize);
+	}
+
+	//! Read an object's data from memory, such as a mapped file or a file from an asset pack
+	//! @param data the data written by writeObject(), or the contents of a file in either format
+	//! @param size the number of bytes of data
+	//! @param v the object to populate with data
+	template<typename T>
+	static bool readObject(const Uint8 * data, size_t size, T & v) {
+		using std::placeholders::_1;
+		SerializationFunc serialize = std::bind(&T::serialize, &v, _1);
+		return readObjectInternal(data, size, serialize);
+	}
+
 	typedef std::function<void(FileInterface*)> SerializationFunc;
 
+	//! A file which has been read and parsed ahead of time, but not yet deserialized into an object
+	class ParsedFile;
+
+	//! Read and parse a file without deserializing it. This touches no engine state, so it is safe to call from worker threads
+	//! @param filename the name of the file to read
+	//! @return the parsed file (free with freeParsedFile()), or nullptr on failure
+	static ParsedFile* parseFile(const char * filename);
+
+	//! Free a file returned by parseFile()
+	//! @param file the file to free
+	static void freeParsedFile(ParsedFile * file);
+
+	//! Read an object's data from a file that has already been parsed
+	//! @param file the parsed file
+	//! @param v the object to populate with data
+	template<typename T>
+	static bool readObject(ParsedFile * file, T & v) {
+		using std::placeholders::_1;
+		SerializationFunc serialize = std::bind(&T::serialize, &v, _1);
+		return readParsedInternal(file, serialize);
+	}
+
 private:
 
 	static bool writeObjectInternal(const char * filename, EFileFormat format, const SerializationFunc& serialize);
 	static bool readObjectInternal(const char * filename, const SerializationFunc& serialize);
+	static bool writeObjectInternal(ArrayList<Uint8>& buffer, const SerializationFunc& serialize);
+	static bool readObjectInternal(const Uint8 * data, size_t size, const SerializationFunc& serialize);
+	static bool readParsedInternal(ParsedFile * file, const SerializationFunc& serialize);
 };
@@ -3,6 +3,8 @@
 #include "Main.hpp"
 #include "Engine.hpp"
 #include "Font.hpp"
+#include "Text.hpp"
+#include "GlyphAtlas.hpp"
 
 const char* Font::defaultFont = "fonts/mono.ttf#16";
 
@@ -23,6 +25,10 @@ Font::Font(const char* _name) : Asset(_name) {
 }
 
 Font::~Font() {
+	if (atlas) {
+		delete atlas;
+		atlas = nullptr;
+	}
 	if (font) {
 		TTF_CloseFont(font);
 	}
@@ -42,6 +48,13 @@ int Font::sizeText(const char* str, int* out_w, int* out_h) const {
 	}
 }
 
+GlyphAtlas* Font::getAtlas() {
+	if (!atlas && font) {
+		atlas = new GlyphAtlas(font, Text::outlineSize);
+	}
+	return atlas;
+}
+
 int Font::height() const {
 	if (font) {
 		return TTF_FontHeight(font);
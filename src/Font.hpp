@@ -5,6 +5,8 @@
 #include "Main.hpp"
 #include "Asset.hpp"
 
+class GlyphAtlas;
+
 class Font : public Asset {
 public:
 	Font() = default;
@@ -33,7 +35,12 @@ public:
 	//! @return the font height in pixels
 	int height() const;
 
+	//! get the font's glyph atlas, which Text draws from
+	//! @return the atlas, or nullptr if the font failed to load
+	GlyphAtlas* getAtlas();
+
 private:
 	TTF_Font* font = nullptr;
 	int pointSize = 16;
+	GlyphAtlas* atlas = nullptr;
 };
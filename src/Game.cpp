@@ -30,9 +30,8 @@ void Game::init() {
 }
 
 void Game::incrementFrame() {
-	if (framesToRun < 4) {
-		++framesToRun;
-	}
+	// the engine's scheduler bounds how many ticks are owed in one pass (see tickrate.catchup)
+	++framesToRun;
 }
 
 World* Game::loadWorld(const char* filename, bool buildPath) {
@@ -42,13 +41,13 @@ World* Game::loadWorld(const char* filename, bool buildPath) {
 
 		auto bworld = new BasicWorld(this, false, (Uint32)worlds.getSize(), "Untitled World");
 		bworld->changeFilename(path.get());
-		FileHelper::readObject(path.get(), *bworld);
+		bworld->loadFile(path.get());
 		bworld->initialize(!bworld->isLoaded());
 		world = bworld;
 	} else {
 		auto bworld = new BasicWorld(this, false, (Uint32)worlds.getSize(), "Untitled World");
 		bworld->changeFilename(filename);
-		FileHelper::readObject(filename, *bworld);
+		bworld->loadFile(filename);
 		bworld->initialize(!bworld->isLoaded());
 		world = bworld;
 	}
@@ -138,24 +137,30 @@ void Game::postProcess() {
 	++ticks;
 }
 
-Player* Game::findPlayer(Uint32 clientID, Uint32 localID) {
+void Game::indexPlayers() {
+	if (!playerIndexDirty) {
+		return;
+	}
+	playersByServerID.clear();
+	playersByClientID.clear();
 	for (Node<Player>* node = players.getFirst(); node != nullptr; node = node->getNext()) {
 		Player& player = node->getData();
-		if (player.getClientID() == clientID && player.getLocalID() == localID) {
-			return &player;
-		}
+		playersByServerID.insert(player.getServerID(), &player);
+		playersByClientID.insert(((Uint64)player.getClientID() << 32) | player.getLocalID(), &player);
 	}
-	return nullptr;
+	playerIndexDirty = false;
+}
+
+Player* Game::findPlayer(Uint32 clientID, Uint32 localID) {
+	indexPlayers();
+	Player** player = playersByClientID.find(((Uint64)clientID << 32) | localID);
+	return player ? *player : nullptr;
 }
 
 Player* Game::findPlayer(Uint32 serverID) {
-	for (Node<Player>* node = players.getFirst(); node != nullptr; node = node->getNext()) {
-		Player& player = node->getData();
-		if (player.getServerID() == serverID) {
-			return &player;
-		}
-	}
-	return nullptr;
+	indexPlayers();
+	Player** player = playersByServerID.find(serverID);
+	return player ? *player : nullptr;
 }
 
 int Game::numLocalPlayers() const {
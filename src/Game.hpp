@@ -3,6 +3,7 @@
 #pragma once
 
 #include "LinkedList.hpp"
+#include "Map.hpp"
 #include "Player.hpp"
 #include "Net.hpp"
 
@@ -95,6 +96,10 @@ public:
 	//! @return the associated Player, or nullptr if the Player could not be found
 	Player* findPlayer(Uint32 serverID);
 
+	//! marks the player lookup tables for rebuilding.
+	//! call this after adding or removing players, or changing their ids
+	void invalidatePlayerIndex() { playerIndexDirty = true; }
+
 	//! when a net connection is setup, this function gets called
 	virtual void onEstablishConnection(Uint32 remoteID) = 0;
 
@@ -124,6 +129,14 @@ protected:
 
 	LinkedList<Player> players;
 	LinkedList<World*> worlds;
+
+	//! player lookup tables, rebuilt on demand
+	Map<Uint32, Player*> playersByServerID;
+	Map<Uint64, Player*> playersByClientID;		//! key is client id << 32 | local id
+	bool playerIndexDirty = true;
+
+	//! rebuild the player lookup tables if they are out of date
+	void indexPlayers();
 	Uint32 ticks = 0;
 	Uint32 framesToRun = 0;
 	bool suicide = false; //! if a game wants to end itself, setting this flag is the way to do it.
@@ -0,0 +1,363 @@
+// GlyphAtlas.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "GlyphAtlas.hpp"
+
+//! generations are unique across atlases, so an atlas made where a freed one was is never mistaken for it
+static Uint32 nextGeneration = 1;
+
+//! decode one character of a utf-8 string
+//! @param str the string, which is moved past the character
+//! @return the character, or 0xfffd if it is malformed
+static Uint32 decodeUTF8(const char*& str) {
+	const Uint8* c = (const Uint8*)str;
+	Uint32 codepoint = 0;
+	int len = 0;
+	if (c[0] < 0x80) {
+		codepoint = c[0];
+		len = 1;
+	} else if ((c[0] & 0xe0) == 0xc0) {
+		codepoint = c[0] & 0x1f;
+		len = 2;
+	} else if ((c[0] & 0xf0) == 0xe0) {
+		codepoint = c[0] & 0x0f;
+		len = 3;
+	} else if ((c[0] & 0xf8) == 0xf0) {
+		codepoint = c[0] & 0x07;
+		len = 4;
+	} else {
+		++str;
+		return 0xfffd;
+	}
+	for (int i = 1; i < len; ++i) {
+		if ((c[i] & 0xc0) != 0x80) {
+			str += i;
+			return 0xfffd;
+		}
+		codepoint = (codepoint << 6) | (c[i] & 0x3f);
+	}
+	str += len;
+	return codepoint;
+}
+
+GlyphAtlas::GlyphAtlas(TTF_Font* _ttf, int _outline) :
+	ttf(_ttf),
+	outline(_outline) {
+	lineSkip = TTF_FontLineSkip(ttf);
+	fontHeight = TTF_FontHeight(ttf);
+
+	// start with room for a few rows of glyphs
+	int size = initialSize;
+	while (size < (fontHeight + outline * 2) * 8 && size < maxSize) {
+		size *= 2;
+	}
+	reset(size);
+}
+
+GlyphAtlas::~GlyphAtlas() {
+	if (texid) {
+		glDeleteTextures(1, &texid);
+		texid = 0;
+	}
+}
+
+void GlyphAtlas::reset(int size) {
+	glyphs.clear();
+	width = size;
+	height = size;
+	pixels.resize(0);
+	pixels.resize((Uint32)(width * height));
+	shelfX = 0;
+	shelfY = 0;
+	shelfHeight = 0;
+	dirtyMin = 0;
+	dirtyMax = height - 1;
+	generation = nextGeneration++;
+}
+
+bool GlyphAtlas::grow() {
+	if (height * 2 > maxSize) {
+		return false;
+	}
+
+	// rows are stored one after another, so glyphs stay put when more rows are added
+	pixels.resize((Uint32)(width * height * 2));
+	height *= 2;
+	return true;
+}
+
+bool GlyphAtlas::pack(int w, int h, Rect<int>& outRect) {
+	if (w > width) {
+		return false;
+	}
+	if (shelfX + w > width) {
+		shelfY += shelfHeight + padding;
+		shelfX = 0;
+		shelfHeight = 0;
+	}
+	while (shelfY + h > height) {
+		if (!grow()) {
+			return false;
+		}
+	}
+	outRect = Rect<int>(shelfX, shelfY, w, h);
+	shelfX += w + padding;
+	shelfHeight = std::max(shelfHeight, h);
+	return true;
+}
+
+bool GlyphAtlas::rasterize(Uint32 codepoint, glyph_t& glyph) {
+	if (codepoint > 0xffff || !TTF_GlyphIsProvided(ttf, (Uint16)codepoint)) {
+		return false;
+	}
+
+	// glyphs are rendered as one character strings, which gives them the same cell (and baseline) as a whole line
+	char str[4] = { 0 };
+	if (codepoint < 0x80) {
+		str[0] = (char)codepoint;
+	} else if (codepoint < 0x800) {
+		str[0] = (char)(0xc0 | (codepoint >> 6));
+		str[1] = (char)(0x80 | (codepoint & 0x3f));
+	} else {
+		str[0] = (char)(0xe0 | (codepoint >> 12));
+		str[1] = (char)(0x80 | ((codepoint >> 6) & 0x3f));
+		str[2] = (char)(0x80 | (codepoint & 0x3f));
+	}
+	int advance = 0;
+	TTF_SizeUTF8(ttf, str, &advance, nullptr);
+	glyph.advance = advance;
+
+	SDL_Color colorBlack = { 0, 0, 0, 255 };
+	SDL_Color colorWhite = { 255, 255, 255, 255 };
+	SDL_Surface* body = trim(TTF_RenderUTF8_Blended(ttf, str, colorWhite), glyph.body);
+	if (!body) {
+		// nothing to draw (eg. a space)
+		return true;
+	}
+	SDL_Surface* back = nullptr;
+	if (outline > 0) {
+		TTF_SetFontOutline(ttf, outline);
+		back = trim(TTF_RenderUTF8_Blended(ttf, str, colorBlack), glyph.outline);
+		TTF_SetFontOutline(ttf, 0);
+	}
+
+	// when the atlas is full, start over. Anything laid out before is stale, which the new generation tells
+	bool packed = false;
+	for (int attempt = 0; attempt < 2 && !packed; ++attempt) {
+		if (attempt > 0) {
+			reset(width);
+		}
+		packed = pack(glyph.body.rect.w, glyph.body.rect.h, glyph.body.rect) &&
+			(!back || pack(glyph.outline.rect.w, glyph.outline.rect.h, glyph.outline.rect));
+	}
+	if (!packed) {
+		SDL_FreeSurface(body);
+		if (back) {
+			SDL_FreeSurface(back);
+		}
+		return false;
+	}
+	copy(body, glyph.body);
+	if (back) {
+		copy(back, glyph.outline);
+	}
+
+	// the body sits inside its outline
+	glyph.body.x += outline;
+	glyph.body.y += outline;
+	return true;
+}
+
+SDL_Surface* GlyphAtlas::trim(SDL_Surface* surf, image_t& image) {
+	image = image_t();
+	if (!surf) {
+		return nullptr;
+	}
+	SDL_Surface* rgba = SDL_ConvertSurfaceFormat(surf, SDL_PIXELFORMAT_ABGR8888, 0);
+	SDL_FreeSurface(surf);
+	if (!rgba) {
+		return nullptr;
+	}
+
+	// blended text fills the rest of the surface with transparent color, so only alpha tells what is drawn
+	int x0 = rgba->w, y0 = rgba->h, x1 = -1, y1 = -1;
+	SDL_LockSurface(rgba);
+	for (int y = 0; y < rgba->h; ++y) {
+		const Uint32* row = (const Uint32*)((const Uint8*)rgba->pixels + y * rgba->pitch);
+		for (int x = 0; x < rgba->w; ++x) {
+			if (row[x] & 0xff000000) {
+				x0 = std::min(x0, x);
+				y0 = std::min(y0, y);
+				x1 = std::max(x1, x);
+				y1 = std::max(y1, y);
+			}
+		}
+	}
+	SDL_UnlockSurface(rgba);
+	if (x1 < 0) {
+		SDL_FreeSurface(rgba);
+		return nullptr;
+	}
+	image.x = x0;
+	image.y = y0;
+	image.rect = Rect<int>(0, 0, x1 - x0 + 1, y1 - y0 + 1);
+	return rgba;
+}
+
+void GlyphAtlas::copy(SDL_Surface* rgba, const image_t& image) {
+	SDL_LockSurface(rgba);
+	for (int y = 0; y < image.rect.h; ++y) {
+		const Uint8* row = (const Uint8*)rgba->pixels + (image.y + y) * rgba->pitch + image.x * sizeof(Uint32);
+		memcpy(&pixels[(image.rect.y + y) * width + image.rect.x], row, image.rect.w * sizeof(Uint32));
+	}
+	SDL_UnlockSurface(rgba);
+	SDL_FreeSurface(rgba);
+
+	dirtyMin = std::min(dirtyMin, image.rect.y);
+	dirtyMax = std::max(dirtyMax, image.rect.y + image.rect.h - 1);
+}
+
+const GlyphAtlas::glyph_t* GlyphAtlas::getGlyph(Uint32 codepoint) {
+	glyph_t* found = glyphs.find(codepoint);
+	if (found) {
+		return found;
+	}
+	glyph_t glyph;
+	if (!rasterize(codepoint, glyph)) {
+		// remember the stand-in, so the font is only asked once
+		const glyph_t* missing = codepoint != '?' ? getGlyph('?') : nullptr;
+		if (!missing) {
+			return nullptr;
+		}
+		glyph = *missing;
+	}
+	glyphs.insert(codepoint, glyph);
+	return glyphs.find(codepoint);
+}
+
+//! place part of a glyph
+//! @param image the outline or body
+//! @param x the pen position
+//! @param y the top of the line
+//! @return the quad
+static GlyphAtlas::quad_t placeImage(const GlyphAtlas::image_t& image, int x, int y) {
+	GlyphAtlas::quad_t quad;
+	quad.dest = Rect<int>(x + image.x, y + image.y, image.rect.w, image.rect.h);
+	quad.src = image.rect;
+	return quad;
+}
+
+void GlyphAtlas::layout(const char* str, int wrap, ArrayList<quad_t>& quads, int& outWidth, int& outHeight) {
+	outWidth = 0;
+	outHeight = 0;
+	quads.resize(0);
+	if (!str || str[0] == '\0') {
+		return;
+	}
+
+	// a glyph added part way through could start the atlas over, in which case the text is laid out again
+	for (int attempt = 0; attempt < 2; ++attempt) {
+		const Uint32 startGeneration = generation;
+		quads.resize(0);
+		bodies.resize(0);
+		int x = 0;
+		int y = 0;
+		Uint32 breakQuad = UINT32_MAX;		// first outline quad after the last space on the line
+		Uint32 breakBody = UINT32_MAX;		// first body quad after the last space on the line
+		int breakX = 0;						// pen after the last space on the line
+		for (const char* c = str; *c != '\0';) {
+			Uint32 codepoint = decodeUTF8(c);
+			if (codepoint == '\n') {
+				x = 0;
+				y += lineSkip;
+				breakQuad = UINT32_MAX;
+				continue;
+			} else if (codepoint == '\r') {
+				continue;
+			} else if (codepoint == '\t') {
+				codepoint = ' ';
+			}
+			const glyph_t* glyph = getGlyph(codepoint);
+			if (!glyph) {
+				continue;
+			}
+
+			// carry the last word onto a new line, or break it if there is no space to break at
+			if (wrap > 0 && codepoint != ' ' && x + glyph->advance > wrap && x > 0) {
+				if (breakQuad != UINT32_MAX) {
+					for (Uint32 q = breakQuad; q < quads.getSize(); ++q) {
+						quads[q].dest.x -= breakX;
+						quads[q].dest.y += lineSkip;
+					}
+					for (Uint32 q = breakBody; q < bodies.getSize(); ++q) {
+						bodies[q].dest.x -= breakX;
+						bodies[q].dest.y += lineSkip;
+					}
+					x -= breakX;
+				} else {
+					x = 0;
+				}
+				y += lineSkip;
+				breakQuad = UINT32_MAX;
+			}
+
+			if (glyph->outline.rect.w > 0) {
+				quads.push(placeImage(glyph->outline, x, y));
+			}
+			if (glyph->body.rect.w > 0) {
+				bodies.push(placeImage(glyph->body, x, y));
+			}
+			if (codepoint == ' ') {
+				breakQuad = quads.getSize();
+				breakBody = bodies.getSize();
+				breakX = x + glyph->advance;
+			}
+			x += glyph->advance;
+		}
+		if (generation == startGeneration) {
+			for (auto& quad : bodies) {
+				quads.push(quad);
+			}
+
+			// measured the way text was when each string had its own texture: to the last drawn pixel, plus 4
+			int right = -1;
+			int bottom = -1;
+			for (auto& quad : quads) {
+				right = std::max(right, quad.dest.x + quad.dest.w - 1);
+				bottom = std::max(bottom, quad.dest.y + quad.dest.h - 1);
+			}
+			if (right >= 0) {
+				outWidth = right + 4;
+				outHeight = bottom + 4;
+			}
+			return;
+		}
+	}
+}
+
+GLuint GlyphAtlas::bind() {
+	if (!texid) {
+		glGenTextures(1, &texid);
+		if (!texid) {
+			return 0;
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, texid);
+	if (texWidth != width || texHeight != height) {
+		// new or grown: upload the lot
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.getArray());
+		texWidth = width;
+		texHeight = height;
+	} else if (dirtyMax >= dirtyMin) {
+		// only the rows with new glyphs
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, dirtyMin, width, dirtyMax - dirtyMin + 1, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[dirtyMin * width]);
+	}
+	dirtyMin = INT32_MAX;
+	dirtyMax = -1;
+	return texid;
+}
@@ -0,0 +1,146 @@
+//! @file GlyphAtlas.hpp
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+#include "Map.hpp"
+#include "Rect.hpp"
+
+//! A GlyphAtlas holds every glyph of one font that has been drawn so far, packed into a single texture.
+//! Each glyph is rasterized (with its outline) the first time it is used and never again, so text of any
+//! length or content is laid out as a list of quads into the atlas (see layout()) without touching SDL_ttf.
+//! The pixels live on the CPU; the texture is only created and updated when the atlas is bound to draw.
+//! When the atlas is full, rasterizing a new glyph empties it and starts over, which moves every glyph.
+//! Quads from an earlier layout() are then wrong: keep the getGeneration() they were made in, and lay the
+//! text out again if it has changed by the time it is drawn.
+class GlyphAtlas {
+public:
+	//! width and height of a new atlas
+	static const int initialSize = 256;
+
+	//! largest the atlas will grow before starting over
+	static const int maxSize = 4096;
+
+	//! empty pixels between glyphs
+	static const int padding = 1;
+
+	//! part of a glyph in the atlas, trimmed to the pixels it actually draws
+	struct image_t {
+		Rect<int> rect;				//!< where the image is in the atlas (0 size if it is empty)
+		int x = 0;					//!< how far right of the pen the image starts
+		int y = 0;					//!< how far below the top of the line the image starts
+	};
+
+	//! a rasterized glyph. The outline and body are separate images, so a line's outlines can all be drawn
+	//! before any of its bodies (otherwise each outline covers the edge of the glyph before it)
+	struct glyph_t {
+		image_t body;				//!< the glyph itself, in white
+		image_t outline;			//!< the black outline around it (empty if the atlas has no outline)
+		int advance = 0;			//!< how far the pen moves past the glyph
+	};
+
+	//! a glyph placed by layout()
+	struct quad_t {
+		Rect<int> dest;				//!< position and size, relative to the top-left of the text
+		Rect<int> src;				//!< position and size in the atlas
+	};
+
+	//! @param _ttf the font to rasterize
+	//! @param _outline size of the black outline around each glyph
+	GlyphAtlas(TTF_Font* _ttf, int _outline);
+	GlyphAtlas(const GlyphAtlas&) = delete;
+	GlyphAtlas(GlyphAtlas&&) = delete;
+	~GlyphAtlas();
+
+	GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+	GlyphAtlas& operator=(GlyphAtlas&&) = delete;
+
+	//! find a glyph, rasterizing it if it is not in the atlas yet
+	//! @param codepoint the unicode character
+	//! @return the glyph, or nullptr if the font cannot draw it
+	const glyph_t* getGlyph(Uint32 codepoint);
+
+	//! lay out some text as quads into the atlas. Every outline quad comes before every body quad
+	//! @param str the utf-8 string to lay out
+	//! @param wrap lines longer than this many pixels are broken at the last space (0 for no wrapping)
+	//! @param quads the list to fill with quads (its memory is reused)
+	//! @param outWidth set to the width of the text, in pixels (to the last drawn column, plus a margin)
+	//! @param outHeight set to the height of the text, in pixels (to the last drawn row, plus a margin)
+	void layout(const char* str, int wrap, ArrayList<quad_t>& quads, int& outWidth, int& outHeight);
+
+	//! upload any new glyphs and bind the atlas texture
+	//! @return the texture, or 0 on failure
+	GLuint bind();
+
+	int						getWidth() const			{ return width; }
+	int						getHeight() const			{ return height; }
+	const ArrayList<Uint32>& getPixels() const			{ return pixels; }
+	Uint32					getNumGlyphs() const		{ return glyphs.getSize(); }
+	int						getLineSkip() const			{ return lineSkip; }
+
+	//! changes whenever glyphs already in the atlas move (the atlas filled up and started over), so layouts
+	//! made before are stale. This can happen during any getGlyph() or layout() call
+	Uint32					getGeneration() const		{ return generation; }
+
+private:
+	TTF_Font* ttf = nullptr;
+	int outline = 0;
+	int lineSkip = 0;
+	int fontHeight = 0;
+
+	Map<Uint32, glyph_t> glyphs;
+	glyph_t missing;				//!< stands in for glyphs the font cannot draw
+	bool hasMissing = false;
+
+	//! RGBA pixels of the atlas, row by row
+	ArrayList<Uint32> pixels;
+	int width = 0;
+	int height = 0;
+	Uint32 generation = 0;
+
+	//! shelf packing: glyphs fill rows left to right, each row as tall as its tallest glyph
+	int shelfX = 0;
+	int shelfY = 0;
+	int shelfHeight = 0;
+
+	GLuint texid = 0;
+	int texWidth = 0;
+	int texHeight = 0;
+	int dirtyMin = INT32_MAX;		//!< first row not uploaded yet
+	int dirtyMax = -1;				//!< last row not uploaded yet
+
+	//! body quads while a layout is made, before they go after the outlines
+	ArrayList<quad_t> bodies;
+
+	//! empty the atlas and make it the given size
+	void reset(int size);
+
+	//! make room for a glyph
+	//! @param w the glyph's width
+	//! @param h the glyph's height
+	//! @param outRect set to where the glyph goes
+	//! @return false if the atlas is full
+	bool pack(int w, int h, Rect<int>& outRect);
+
+	//! double the height of the atlas, keeping every glyph where it is
+	//! @return false if the atlas is as big as it gets
+	bool grow();
+
+	//! trim a rendered surface to the pixels it draws and convert it for the atlas
+	//! @param surf the surface, which is freed
+	//! @param image filled with where the drawn pixels are in the surface, and their size
+	//! @return the converted surface, or nullptr if it is empty or cannot be converted
+	static SDL_Surface* trim(SDL_Surface* surf, image_t& image);
+
+	//! copy a converted surface into the atlas
+	//! @param rgba the surface, which is freed
+	//! @param image where the pixels are in the surface and where in the atlas they go
+	void copy(SDL_Surface* rgba, const image_t& image);
+
+	//! rasterize a glyph into the atlas
+	//! @param codepoint the unicode character
+	//! @param glyph filled with the glyph's position and metrics
+	//! @return true on success
+	bool rasterize(Uint32 codepoint, glyph_t& glyph);
+};
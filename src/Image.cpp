@@ -52,7 +52,13 @@ Image::Image(const char* _name) : Asset(_name) {
 	path = mainEngine->buildPath(clippedName).get();
 
 	mainEngine->fmsg(Engine::MSG_DEBUG, "loading image '%s'...", _name);
-	if ((surf = IMG_Load(path.get())) == NULL) {
+	ArrayList<Uint8> packed;
+	if (mainEngine->readPackedFile(path.get(), packed)) {
+		surf = IMG_Load_RW(SDL_RWFromConstMem(packed.getArray(), (int)packed.getSize()), 1);
+	} else {
+		surf = IMG_Load(path.get());
+	}
+	if (surf == NULL) {
 		mainEngine->fmsg(Engine::MSG_ERROR, "failed to load image '%s'", _name);
 		return;
 	}
@@ -10,45 +10,103 @@ Cvar cvar_deadzone("input.deadzone", "controller stick dead-zone range", "0.2");
 
 Map<String, SDL_Scancode> Input::scancodeNames;
 
-float Input::analog(const char* binding) const {
-	auto b = bindings[binding];
+Map<StringBuf<64>, Input::handle_t>& Input::getHandleMap() {
+	static Map<StringBuf<64>, handle_t> handles;
+	return handles;
+}
+
+ArrayList<String>& Input::getHandleNames() {
+	static ArrayList<String> names;
+	return names;
+}
+
+Input::handle_t Input::handleFor(const char* binding) {
+	auto& handles = getHandleMap();
+	auto handle = handles.find(binding);
+	if (handle) {
+		return *handle;
+	}
+	auto& names = getHandleNames();
+	handle_t result = names.getSize();
+	names.push(String(binding));
+	handles.insert(binding, result);
+	return result;
+}
+
+Input::handle_t Input::findHandle(const char* binding) {
+	auto handle = getHandleMap().find(binding);
+	return handle ? *handle : UINT32_MAX;
+}
+
+const char* Input::nameOf(handle_t handle) {
+	auto& names = getHandleNames();
+	return handle < names.getSize() ? names[handle].get() : "";
+}
+
+float Input::analog(handle_t handle) const {
+	auto b = find(handle);
 	return b ? b->analog : 0.f;
 }
 
-bool Input::binary(const char* binding) const {
-	auto b = bindings[binding];
+bool Input::binary(handle_t handle) const {
+	auto b = find(handle);
 	return b ? b->binary : false;
 }
 
-bool Input::binaryToggle(const char* binding) const {
-	auto b = bindings[binding];
+bool Input::binaryToggle(handle_t handle) const {
+	auto b = find(handle);
 	return b ? b->binary && !b->consumed : false;
 }
 
-void Input::consumeBinaryToggle(const char* binding) {
-	auto b = bindings[binding];
-	if (b && b->binary) {
-		b->consumed = true;
+void Input::consumeBinaryToggle(handle_t handle) {
+	if (handle < bindings.getSize()) {
+		auto& b = bindings[handle];
+		if (b.binary) {
+			b.consumed = true;
+			binaryStates[handle] &= ~BINARY_TOGGLE;
+		}
 	}
 }
 
+float Input::analog(const char* binding) const {
+	return analog(findHandle(binding));
+}
+
+bool Input::binary(const char* binding) const {
+	return binary(findHandle(binding));
+}
+
+bool Input::binaryToggle(const char* binding) const {
+	return binaryToggle(findHandle(binding));
+}
+
+void Input::consumeBinaryToggle(const char* binding) {
+	consumeBinaryToggle(findHandle(binding));
+}
+
 const char* Input::binding(const char* binding) const {
-	auto b = bindings[binding];
+	auto b = find(findHandle(binding));
 	return b ? b->input.get() : "";
 }
 
 void Input::refresh() {
-	for (auto& pair : bindings) {
-		rebind(pair.a, pair.b.input.get());
+	for (Uint32 c = 0; c < bindings.getSize(); ++c) {
+		if (bindings[c].bound) {
+			String input = bindings[c].input;
+			rebind(nameOf(c), input.get());
+		}
 	}
 }
 
 void Input::rebind(const char* binding, const char* input) {
-	auto b = bindings[binding];
-	if (!b) {
-		bindings.insert(binding, binding_t());
-		b = bindings[binding];
+	handle_t handle = handleFor(binding);
+	if (handle >= bindings.getSize()) {
+		bindings.resize(handle + 1);
+		analogStates.resize(handle + 1);
+		binaryStates.resize(handle + 1);
 	}
+	auto b = &bindings[handle];
+	b->bound = true;
 	b->input.assign(input);
 	if (input == nullptr) {
 		b->type = binding_t::INVALID;
@@ -286,8 +344,11 @@ void Input::rebind(const char* binding, const char* input) {
 }
 
 void Input::update() {
-	for (auto& pair : bindings) {
-		auto& binding = pair.b;
+	for (Uint32 c = 0; c < bindings.getSize(); ++c) {
+		auto& binding = bindings[c];
+		if (!binding.bound) {
+			continue;
+		}
 		binding.analog = analogOf(binding);
 		bool oldBinary = binding.binary;
 		binding.binary = binaryOf(binding);
@@ -295,6 +356,8 @@ void Input::update() {
 			// unconsume the input whenever it's released or pressed again.
 			binding.consumed = false;
 		}
+		analogStates[c] = binding.analog;
+		binaryStates[c] = (binding.binary ? BINARY_PRESSED : 0) | (binding.binary && !binding.consumed ? BINARY_TOGGLE : 0);
 	}
 }
 
@@ -5,9 +5,12 @@
 #include "Main.hpp"
 #include "String.hpp"
 #include "Map.hpp"
+#include "ArrayList.hpp"
 
 //! The Input class provides a way to bind physical keys to abstract names like "Move Forward",
 //! collect the input data from the physical devices, and provide it back to you for scripting purposes.
+//! Binding names resolve to integer handles which are shared by every Input, so hot code can look a name up
+//! once and query by handle afterwards; the string functions are thin wrappers around the handle ones.
 class Input {
 public:
 	Input() = default;
@@ -18,12 +21,22 @@ public:
 	Input& operator=(const Input&) = delete;
 	Input& operator=(Input&&) = delete;
 
+	//! stable integer id for a binding name
+	typedef Uint32 handle_t;
+
+	//! flags packed into getBinaryStates()
+	enum binarystate_t {
+		BINARY_PRESSED = 1 << 0,	//!< the binding is held
+		BINARY_TOGGLE = 1 << 1		//!< the binding is held and has not been consumed
+	};
+
 	//! input mapping
 	struct binding_t {
 		String input = "";
 		float analog = 0.f;
 		bool binary = false;
 		bool consumed = false;
+		bool bound = false;
 
 		//! bind type
 		enum bindtype_t {
@@ -61,24 +74,38 @@ public:
 		int mouseButton = 0;
 	};
 
+	//! resolve a binding name to a handle, registering the name if it is new.
+	//! handles never change, and a handle for a name which has not been bound yet reads as released
+	//! @param binding the binding name
+	//! @return the handle for the binding
+	static handle_t handleFor(const char* binding);
+
+	//! @param handle a binding handle
+	//! @return the name the handle was registered with
+	static const char* nameOf(handle_t handle);
+
 	//! gets the analog value of a particular input binding
 	//! @param binding the binding to query
 	//! @return the analog value (range = -1.f : +1.f)
 	float analog(const char* binding) const;
+	float analog(handle_t handle) const;
 
 	//! gets the binary value of a particular input binding
 	//! @param binding the binding to query
 	//! @return the bool value (false = not pressed, true = pressed)
 	bool binary(const char* binding) const;
+	bool binary(handle_t handle) const;
 
 	//! gets the binary value of a particular input binding, if it's not been consumed
 	//! releasing the input and retriggering it "unconsumes"
 	//! @param binding the binding to query
 	//! @return the bool value (false = not pressed, true = pressed)
 	bool binaryToggle(const char* binding) const;
+	bool binaryToggle(handle_t handle) const;
 
 	//! @param binding the binding to flag consumed
 	void consumeBinaryToggle(const char* binding);
+	void consumeBinaryToggle(handle_t handle);
 
 	//! gets the input mapped to a particular input binding
 	//! @param binding the binding to query
@@ -99,10 +126,34 @@ public:
 	bool					    isInverted() const { return inverted; }
 	void						setInverted(bool b) { inverted = b; }
 
+	//! analog value of every binding as of the last update(), indexed by handle
+	const ArrayList<float>&		getAnalogStates() const { return analogStates; }
+
+	//! binarystate_t flags of every binding as of the last update(), indexed by handle
+	const ArrayList<int>&		getBinaryStates() const { return binaryStates; }
+
 private:
-	Map<StringBuf<64>, binding_t> bindings;
+	ArrayList<binding_t> bindings;		//!< indexed by handle
+	ArrayList<float> analogStates;
+	ArrayList<int> binaryStates;
 	bool inverted = false;
 
+	//! binding name -> handle, shared by all inputs
+	static Map<StringBuf<64>, handle_t>& getHandleMap();
+
+	//! handle -> binding name
+	static ArrayList<String>& getHandleNames();
+
+	//! @param handle the handle to look up
+	//! @return the binding for the given handle, or nullptr if it was never bound on this input
+	const binding_t* find(handle_t handle) const {
+		return handle < bindings.getSize() ? &bindings[handle] : nullptr;
+	}
+
+	//! @param binding the name to look up
+	//! @return the handle for the given name, or UINT32_MAX if no input has used it
+	static handle_t findHandle(const char* binding);
+
 	//! converts the given input to a boolean value
 	//! @return the converted value
 	static bool binaryOf(binding_t& binding);
@@ -4,6 +4,17 @@
 #include "Engine.hpp"
 #include "Client.hpp"
 
+const StringID Inventory::slotHelmet("Helmet");
+const StringID Inventory::slotSuit("Suit");
+const StringID Inventory::slotGloves("Gloves");
+const StringID Inventory::slotBoots("Boots");
+const StringID Inventory::slotBack("Back");
+const StringID Inventory::slotRightHip("RightHip");
+const StringID Inventory::slotLeftHip("LeftHip");
+const StringID Inventory::slotWaist("Waist");
+const StringID Inventory::slotRightHand("RightHand");
+const StringID Inventory::slotLeftHand("LeftHand");
+
 void Inventory::serialize(FileInterface * file)
 {
 	file->property("nanoMatter", nanoMatter);
@@ -53,20 +64,20 @@ void Inventory::setVisibility(bool visible)
 			frameSize.w = 250;
 			frameSize.h = 75;
 
-			setupInvSlotDisplay("Helmet", head, frameSize, 175, 200);
-			setupInvSlotDisplay("Suit", suit, frameSize, 50, 300);
-			setupInvSlotDisplay("Gloves", gloves, frameSize, 300, 300);
-			setupInvSlotDisplay("Boots", boots, frameSize, 175, 400);
-			setupInvSlotDisplay("Back", back, frameSize, 1175, 200);
-			setupInvSlotDisplay("RightHip", rightHip, frameSize, 1300, 300);
-			setupInvSlotDisplay("Waist", waist, frameSize, 1175, 400);
-			setupInvSlotDisplay("RightHand", rightHand, frameSize, 175, 600);
-			setupInvSlotDisplay("LeftHand", leftHand, frameSize, 1175, 600);
+			setupInvSlotDisplay(slotHelmet, head, frameSize, 175, 200);
+			setupInvSlotDisplay(slotSuit, suit, frameSize, 50, 300);
+			setupInvSlotDisplay(slotGloves, gloves, frameSize, 300, 300);
+			setupInvSlotDisplay(slotBoots, boots, frameSize, 175, 400);
+			setupInvSlotDisplay(slotBack, back, frameSize, 1175, 200);
+			setupInvSlotDisplay(slotRightHip, rightHip, frameSize, 1300, 300);
+			setupInvSlotDisplay(slotWaist, waist, frameSize, 1175, 400);
+			setupInvSlotDisplay(slotRightHand, rightHand, frameSize, 175, 600);
+			setupInvSlotDisplay(slotLeftHand, leftHand, frameSize, 1175, 600);
 		}
 	}
 }
 
-void Inventory::setupInvSlotDisplay(String slotName, Frame* frame, Rect<int> frameSize, int xPos, int yPos)
+void Inventory::setupInvSlotDisplay(StringID slotName, Frame* frame, Rect<int> frameSize, int xPos, int yPos)
 {
 	Slot* slot = *items.find(slotName);
 	//frame->addField(slotName, 20)->setText(slot-> entity->getName().length() > 0 ? slot->entity->getName() : "");
@@ -82,7 +93,7 @@ void Inventory::Slot::serialize(FileInterface * file)
 	if (file->isReading()) {
 		Uint32 numEntities = 0;
 		file->beginArray(numEntities);
-		for (Uint32 index = 0; index < numEntities; ++index) {
+		for (Uint32 index = 0; file->arrayElement(index, numEntities); ++index) {
 			Entity* entity = new Entity(nullptr);
 			file->value(*entity);
 
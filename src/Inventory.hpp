@@ -4,6 +4,7 @@
 
 #include "Map.hpp"
 #include "String.hpp"
+#include "StringID.hpp"
 #include "Rect.hpp"
 
 class Item;
@@ -30,7 +31,19 @@ public:
 		void serialize(FileInterface * file);
 	};
 
-	Map<String, Slot*> items;
+	//! names of the slots
+	static const StringID slotHelmet;
+	static const StringID slotSuit;
+	static const StringID slotGloves;
+	static const StringID slotBoots;
+	static const StringID slotBack;
+	static const StringID slotRightHip;
+	static const StringID slotLeftHip;
+	static const StringID slotWaist;
+	static const StringID slotRightHand;
+	static const StringID slotLeftHand;
+
+	Map<StringID, Slot*> items;
 
 	//! save/load this object to a file
 	//! @param file interface to serialize with
@@ -38,5 +51,5 @@ public:
 
 	void setVisibility(bool visible);
 
-	void setupInvSlotDisplay(String slotName, Frame* frame, Rect<int> frameSize, int xPos, int yPos);
+	void setupInvSlotDisplay(StringID slotName, Frame* frame, Rect<int> frameSize, int xPos, int yPos);
 };
\ No newline at end of file
@@ -53,19 +53,24 @@ void Item::InitInventory()
 	Inventory::Slot slotRightHand;
 	Inventory::Slot slotLeftHand;
 
-	inventory.items.insert("Helmet", &slotHelmet);
-	inventory.items.insert("Suit", &slotSuit);
-	inventory.items.insert("Gloves", &slotGloves);
-	inventory.items.insert("Boots", &slotBoots);
-	inventory.items.insert("Back", &slotBack);
-	inventory.items.insert("RightHip", &slotRightHip);
-	inventory.items.insert("LeftHip", &slotLeftHip);
-	inventory.items.insert("Waist", &slotWaist);
-	inventory.items.insert("RightHand", &slotRightHand);
-	inventory.items.insert("LeftHand", &slotLeftHand);
+	inventory.items.insert(Inventory::slotHelmet, &slotHelmet);
+	inventory.items.insert(Inventory::slotSuit, &slotSuit);
+	inventory.items.insert(Inventory::slotGloves, &slotGloves);
+	inventory.items.insert(Inventory::slotBoots, &slotBoots);
+	inventory.items.insert(Inventory::slotBack, &slotBack);
+	inventory.items.insert(Inventory::slotRightHip, &slotRightHip);
+	inventory.items.insert(Inventory::slotLeftHip, &slotLeftHip);
+	inventory.items.insert(Inventory::slotWaist, &slotWaist);
+	inventory.items.insert(Inventory::slotRightHand, &slotRightHand);
+	inventory.items.insert(Inventory::slotLeftHand, &slotLeftHand);
 }
 
-void Item::depositItem(Entity* itemToDeposit, String invSlot)
+void Item::depositItem(Entity* itemToDeposit, const char* invSlot)
+{
+	depositItem(itemToDeposit, StringID::find(invSlot));
+}
+
+void Item::depositItem(Entity* itemToDeposit, StringID invSlot)
 {
 	if (inventory.items.find(invSlot))
 	{
@@ -75,12 +80,22 @@ void Item::depositItem(Entity* itemToDeposit, String invSlot)
 	}
 }
 
-bool Item::isSlotFilled(String invSlot)
+bool Item::isSlotFilled(const char* invSlot)
+{
+	return isSlotFilled(StringID::find(invSlot));
+}
+
+bool Item::isSlotFilled(StringID invSlot)
 {
 	return getSlottedItem(invSlot) != nullptr;
 }
 
-Entity* Item::getSlottedItem(String invSlot)
+Entity* Item::getSlottedItem(const char* invSlot)
+{
+	return getSlottedItem(StringID::find(invSlot));
+}
+
+Entity* Item::getSlottedItem(StringID invSlot)
 {
 	Inventory::Slot* slot = *inventory.items.find(invSlot);
 	return slot->entity;
@@ -4,6 +4,7 @@
 
 #include "Main.hpp"
 #include "String.hpp"
+#include "StringID.hpp"
 #include "ArrayList.hpp"
 #include "Map.hpp"
 #include "Inventory.hpp"
@@ -20,7 +21,7 @@ public:
 	Item& operator=(Item&&) = default;
 
 	typedef ArrayList<String> StringList;
-	typedef Map<String, String> StringMap;
+	typedef Map<StringID, String> StringMap;
 
 	struct Action {
 		StringList	comboItems;							//!< a list of items which must be simultaneously activated to trigger this action
@@ -60,13 +61,16 @@ public:
 	void InitInventory();
 
 	//! deposit item into inventory slot
-	void depositItem(Entity* itemToDeposit, String invSlot);
+	void depositItem(Entity* itemToDeposit, const char* invSlot);
+	void depositItem(Entity* itemToDeposit, StringID invSlot);
 
 	//! check if a slot is currently filled
-	bool isSlotFilled(String invSlot);
+	bool isSlotFilled(const char* invSlot);
+	bool isSlotFilled(StringID invSlot);
 
 	//returns entity filling a slot
-	class Entity* getSlottedItem(String invSlot);
+	class Entity* getSlottedItem(const char* invSlot);
+	class Entity* getSlottedItem(StringID invSlot);
 
 	void setInventoryVisibility(bool visible);
 private:
@@ -123,7 +127,7 @@ private:
 
 	//Conditions	conditionalEffects;
 
-	Map<String, Action> actions;			//!< map actions by name (eg "tap", "hold")
+	Map<StringID, Action> actions;			//!< map actions by name (eg "tap", "hold")
 
 	Inventory inventory;
 };
\ No newline at end of file
@@ -35,7 +35,7 @@ Cvar cvar_shadowsStaticOnly("render.shadow.static", "render only static shadow m
 
 Light::Light(Entity& _entity, Component* _parent) :
 	Component(_entity, _parent) {
-	name = typeStr[COMPONENT_LIGHT];
+	setName(typeStr[COMPONENT_LIGHT]);
 
 	// add a bbox for editor usage
 	if (mainEngine->isEditorRunning()) {
@@ -139,9 +139,14 @@ bool Light::isOccluded(Entity& entity) {
 	}
 	Entity* shadowCamera = world->getShadowCamera(); assert(shadowCamera);
 	Camera* camera = shadowCamera->findComponentByUID<Camera>(1); assert(camera);
+	if (occlusionGeneration != camera->getOcclusionGeneration()) {
+		occlusionGeneration = camera->getOcclusionGeneration();
+		for (int c = 0; c < 6; ++c) {
+			occlusionSets[c] = camera->findOcclusionSet((((Uint64)this->entity->getUID()) << 32) | (Uint64)(this->uid << 1) | (Uint64)c);
+		}
+	}
 	for (int c = 0; c < 6; ++c) {
-		camera->setOcclusionIndex((((Uint64)this->entity->getUID()) << 32) | (Uint64)(this->uid << 1) | (Uint64)c);
-		auto& query = camera->getOcclusionQuery(&entity);
+		auto& query = camera->getOcclusionQuery(occlusionSets[c], &entity);
 		if (query.result == false) {
 			return false;
 		}
@@ -173,6 +178,10 @@ int Light::createShadowMap() {
 	Camera* camera = shadowCamera->findComponentByUID<Camera>(1); assert(camera);
 	shadowCamera->setPos(gPos);
 
+	// every face sees the same entities, nearest first
+	auto bw = static_cast<BasicWorld*>(world); assert(bw);
+	const ArrayList<Entity*>& drawList = bw->findLightInfluence(*this);
+
 	glPolygonOffset(cvar_shadowDepthOffset.toFloat(), 0.f);
 	glEnable(GL_DEPTH_TEST);
 	shadowMap.init();
@@ -187,9 +196,6 @@ int Light::createShadowMap() {
 		camera->setClipNear(1.f);
 		camera->setClipFar(radius);
 		camera->setupProjection(false);
-		auto bw = static_cast<BasicWorld*>(world); assert(bw);
-		ArrayList<Entity*> drawList;
-		bw->fillDrawList(*camera, radius * radius, drawList);
 		camera->setOcclusionIndex((((Uint64)this->entity->getUID()) << 32) | (Uint64)(this->uid << 1) | (Uint64)c);
 
 		// create reduced draw list
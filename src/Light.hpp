@@ -56,6 +56,16 @@ public:
 	Uint32				getShadowTicks() const { return shadowTicks; }
 	Shadow&				getShadowMap() { return shadowMap; }
 
+	//! entities whose bounds fall within the light's radius, cached by BasicWorld::findLightInfluence()
+	struct influence_t {
+		ArrayList<Entity*> entities;	//!< sorted nearest first
+		const World* world = nullptr;	//!< world the entities belong to
+		Vector pos;						//!< light position when the list was built
+		float radius = 0.f;				//!< light radius when the list was built
+		Uint32 stamp = 0;				//!< spatial hash stamp when the list was built
+	};
+	influence_t&		getInfluence() { return influence; }
+
 	void	setColor(const Vector& _color) { color = _color; }
 	void	setIntensity(const float _intensity) { intensity = _intensity; }
 	void	setRadius(const float _radius) { radius = _radius; updateNeeded = true; }
@@ -111,6 +121,12 @@ protected:
 	Uint32 lastUpdate = 0;
 	bool chosen = false;
 
+	//! occlusion sets for each cube face, resolved once per shadow camera occlusion generation
+	Uint32 occlusionGeneration = 0;
+	Uint32 occlusionSets[6];
+
+	influence_t influence;
+
 	Vector color = Vector(1.f);
 	float intensity = 1.f;
 	float radius = 512.f;
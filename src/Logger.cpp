@@ -0,0 +1,236 @@
+// Logger.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "Logger.hpp"
+
+#include <chrono>
+
+Logger::Logger() :
+	tail(0),
+	head(0),
+	dropped(0),
+	running(false),
+	quit(false),
+	totalDropped(0),
+	totalWritten(0),
+	totalCollapsed(0)
+{
+	static_assert((queueSize & (queueSize - 1)) == 0, "Logger::queueSize must be a power of two");
+	ring = new entry_t[queueSize];
+	for (Uint32 c = 0; c < queueSize; ++c) {
+		ring[c].sequence.store(c, std::memory_order_relaxed);
+	}
+}
+
+Logger::~Logger() {
+	stop();
+	delete[] ring;
+	ring = nullptr;
+}
+
+void Logger::start(const sink_t& _sink, const flush_t& _flush) {
+	if (running) {
+		return;
+	}
+	sink = _sink;
+	flushSink = _flush;
+	quit = false;
+	running = true;
+	thread = std::thread(&Logger::run, this);
+}
+
+void Logger::stop() {
+	if (!running) {
+		return;
+	}
+
+	// producers that see the thread stopped will wait on this until the ring is empty
+	std::lock_guard<std::mutex> lock(syncLock);
+	quit = true;
+	wake.notify_one();
+	if (thread.joinable()) {
+		thread.join();
+	}
+	running = false;
+
+	// pick up anything that was queued while the thread was shutting down. A producer may have claimed a
+	// slot without publishing it yet, so wait for head to reach tail like flush() does
+	drain();
+	for (Uint64 target = tail.load(std::memory_order_acquire); head.load(std::memory_order_acquire) < target;
+		target = tail.load(std::memory_order_acquire)) {
+		std::this_thread::yield();
+		drain();
+	}
+	writeRepeats();
+	if (flushSink) {
+		flushSink();
+	}
+}
+
+bool Logger::push(Uint32 kind, const char* text, bool mustDeliver) {
+	if (!text) {
+		return false;
+	}
+
+	// no writer thread: write immediately
+	if (!running) {
+		std::lock_guard<std::mutex> lock(syncLock);
+		if (!sink) {
+			return false;
+		}
+		writeRepeats();
+		sink(kind, formatTime(time(nullptr)), text);
+		++totalWritten;
+		if (flushSink) {
+			flushSink();
+		}
+		return true;
+	}
+
+	// claim a slot
+	entry_t* entry = nullptr;
+	Uint64 pos = tail.load(std::memory_order_relaxed);
+	while (1) {
+		entry = &ring[pos & (queueSize - 1)];
+		Uint64 seq = entry->sequence.load(std::memory_order_acquire);
+		Sint64 diff = (Sint64)seq - (Sint64)pos;
+		if (diff == 0) {
+			if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (diff < 0) {
+			// ring is full
+			if (!mustDeliver || !running) {
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				totalDropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			wake.notify_one();
+			std::this_thread::yield();
+			pos = tail.load(std::memory_order_relaxed);
+		} else {
+			pos = tail.load(std::memory_order_relaxed);
+		}
+	}
+
+	// fill and publish it
+	entry->kind = kind;
+	entry->time = time(nullptr);
+	strncpy(entry->text, text, maxLineLength - 1);
+	entry->text[maxLineLength - 1] = '\0';
+	entry->sequence.store(pos + 1, std::memory_order_release);
+
+	wake.notify_one();
+	return true;
+}
+
+void Logger::flush() {
+	if (!running) {
+		return;
+	}
+	const Uint64 target = tail.load(std::memory_order_acquire);
+	while (running && head.load(std::memory_order_acquire) < target) {
+		wake.notify_one();
+		std::this_thread::yield();
+	}
+}
+
+void Logger::run() {
+	while (1) {
+		Uint32 count = drain();
+		if (count) {
+			if (flushSink) {
+				flushSink();
+			}
+			continue;
+		}
+		if (quit) {
+			break;
+		}
+
+		// a run of repeats ends once the window passes without another copy
+		if (repeats && time(nullptr) - lastTime > repeatWindow) {
+			writeRepeats();
+			if (flushSink) {
+				flushSink();
+			}
+		}
+
+		std::unique_lock<std::mutex> lock(wakeLock);
+		wake.wait_for(lock, std::chrono::milliseconds(10));
+	}
+}
+
+Uint32 Logger::drain() {
+	Uint32 count = 0;
+	Uint64 pos = head.load(std::memory_order_relaxed);
+	while (1) {
+		entry_t& entry = ring[pos & (queueSize - 1)];
+		Uint64 seq = entry.sequence.load(std::memory_order_acquire);
+		if (seq != pos + 1) {
+			break;
+		}
+
+		write(entry.kind, entry.time, entry.text);
+
+		// release the slot for the next lap of the ring
+		entry.sequence.store(pos + queueSize, std::memory_order_release);
+		++pos;
+		++count;
+		head.store(pos, std::memory_order_release);
+	}
+
+	Uint64 numDropped = dropped.exchange(0, std::memory_order_relaxed);
+	if (numDropped) {
+		char str[64];
+		snprintf(str, sizeof(str), "log queue full, dropped %llu message(s)", (unsigned long long)numDropped);
+		write(Engine::MSG_WARN, time(nullptr), str);
+		++count;
+	}
+
+	return count;
+}
+
+void Logger::write(Uint32 kind, time_t time, const char* text) {
+	if (!sink) {
+		return;
+	}
+
+	// collapse identical lines arriving close together
+	if (kind == lastKind && time - lastTime <= repeatWindow && strcmp(lastText, text) == 0) {
+		lastTime = time;
+		++repeats;
+		++totalCollapsed;
+		return;
+	}
+	writeRepeats();
+
+	sink(kind, formatTime(time), text);
+	++totalWritten;
+
+	strncpy(lastText, text, maxLineLength - 1);
+	lastText[maxLineLength - 1] = '\0';
+	lastKind = kind;
+	lastTime = time;
+}
+
+void Logger::writeRepeats() {
+	if (!repeats) {
+		return;
+	}
+	char str[64];
+	snprintf(str, sizeof(str), "(previous message repeated %u time(s))", repeats);
+	repeats = 0;
+	sink(lastKind, formatTime(lastTime), str);
+	++totalWritten;
+}
+
+const char* Logger::formatTime(time_t time) {
+	if (time != stampTime || !stamp[0]) {
+		struct tm* tm_info = localtime(&time);
+		strftime(stamp, sizeof(stamp), "%H-%M-%S", tm_info);
+		stampTime = time;
+	}
+	return stamp;
+}
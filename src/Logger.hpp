@@ -0,0 +1,124 @@
+//! @file Logger.hpp
+
+#pragma once
+
+#include "Main.hpp"
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+//! The Logger moves log output off the calling thread.
+//! Callers format their message and drop it into a bounded, lock-free ring; a background
+//! thread drains the ring, timestamps each line, collapses repeated lines, and hands them to a sink
+//! (the engine writes them to the log file, stdout, and the console list).
+//! When the ring is full, low priority messages are dropped and counted instead of blocking.
+class Logger {
+public:
+	//! number of slots in the ring (must be a power of two)
+	static const Uint32 queueSize = 2048;
+
+	//! longest line that can be queued (including terminator)
+	static const Uint32 maxLineLength = 1024;
+
+	//! receives each line from the writer thread
+	//! @param kind the message type (see Engine::msg_t)
+	//! @param timestamp time the message was queued, formatted as H-M-S
+	//! @param text the message text
+	typedef std::function<void(Uint32 kind, const char* timestamp, const char* text)> sink_t;
+
+	//! called by the writer thread after each batch of lines, so the sink can flush its streams
+	typedef std::function<void()> flush_t;
+
+	Logger();
+	Logger(const Logger&) = delete;
+	Logger(Logger&&) = delete;
+	~Logger();
+
+	Logger& operator=(const Logger&) = delete;
+	Logger& operator=(Logger&&) = delete;
+
+	//! start the writer thread. Lines pushed before this are discarded
+	//! @param _sink the function which receives every line
+	//! @param _flush the function to call after every batch of lines
+	void start(const sink_t& _sink, const flush_t& _flush);
+
+	//! drain the ring and stop the writer thread. Afterwards lines go straight to the sink on the calling thread
+	void stop();
+
+	//! queue a line for writing
+	//! @param kind the message type
+	//! @param text the line to write (longer lines are truncated)
+	//! @param mustDeliver if true, wait for room instead of dropping the line when the ring is full
+	//! @return true if the line was queued, false if it was dropped
+	bool push(Uint32 kind, const char* text, bool mustDeliver);
+
+	//! block until every line queued so far has been handed to the sink
+	void flush();
+
+	//! window in seconds in which identical lines are collapsed into one
+	static const time_t repeatWindow = 1;
+
+	Uint64		getDropped() const			{ return totalDropped; }
+	Uint64		getWritten() const			{ return totalWritten; }
+	Uint64		getCollapsed() const		{ return totalCollapsed; }
+	bool		isRunning() const			{ return running; }
+
+private:
+	struct entry_t {
+		std::atomic<Uint64> sequence;
+		Uint32 kind;
+		time_t time;
+		char text[maxLineLength];
+	};
+
+	entry_t* ring = nullptr;
+	alignas(64) std::atomic<Uint64> tail;	//!< next slot a producer will claim
+	alignas(64) std::atomic<Uint64> head;	//!< next slot the writer will read
+	std::atomic<Uint64> dropped;			//!< lines dropped since the writer last reported
+	std::atomic_bool running;
+	std::atomic_bool quit;
+
+	std::thread thread;
+	std::mutex wakeLock;
+	std::condition_variable wake;
+
+	//! serializes sink calls when the writer thread is not running
+	std::mutex syncLock;
+
+	sink_t sink;
+	flush_t flushSink;
+
+	//! duplicate collapsing (writer thread only)
+	char lastText[maxLineLength] = { 0 };
+	Uint32 lastKind = 0;
+	time_t lastTime = 0;
+	Uint32 repeats = 0;
+
+	//! timestamp cache (writer thread only)
+	time_t stampTime = 0;
+	char stamp[32] = { 0 };
+
+	//! statistics
+	std::atomic<Uint64> totalDropped;
+	std::atomic<Uint64> totalWritten;
+	std::atomic<Uint64> totalCollapsed;
+
+	//! writer thread entry point
+	void run();
+
+	//! hand all queued lines to the sink
+	//! @return the number of lines consumed
+	Uint32 drain();
+
+	//! write a single line, collapsing repeats
+	void write(Uint32 kind, time_t time, const char* text);
+
+	//! write out the "repeated N times" line, if there is one pending
+	void writeRepeats();
+
+	//! format a timestamp, caching the result for the current second
+	const char* formatTime(time_t time);
+};
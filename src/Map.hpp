@@ -183,7 +183,7 @@ public:
 			Uint32 keyCount = 0;
 			file->propertyName("data");
 			file->beginArray(keyCount);
-			for (Uint32 c = 0; c < keyCount; ++c) {
+			for (Uint32 c = 0; file->arrayElement(c, keyCount); ++c) {
 				K key;
 				T value;
 
@@ -22,6 +22,11 @@
 #include "Camera.hpp"
 #include "Light.hpp"
 #include "Model.hpp"
+#include "Adjacency.hpp"
+
+#include <chrono>
+
+static Cvar cvar_meshCache("mesh.cache.enabled", "store imported meshes in a binary cache and load them from there when the source is unchanged", "1");
 
 Mesh::Mesh(const char* _name) : Asset(_name) {
 	if (!_name || _name[0] == '\0') {
@@ -45,7 +50,6 @@ Mesh::Mesh(const char* _name) : Asset(_name) {
 			numVertices += entry->getNumVertices();
 		} else {
 			// load standard mesh
-			importer = new Assimp::Importer();
 			unsigned int flags = 0;
 			flags |= aiProcess_SplitByBoneCount;
 			flags |= aiProcess_SplitLargeMeshes;
@@ -65,21 +69,41 @@ Mesh::Mesh(const char* _name) : Asset(_name) {
 			flags |= aiProcess_OptimizeGraph; // ASSIMP crashes on linux when this is used
 #endif
 			flags |= aiProcess_LimitBoneWeights;
-			scene = importer->ReadFile(path.get(), 0);
-			if (!scene) {
-				mainEngine->fmsg(Engine::MSG_ERROR, "failed to load mesh '%s': %s", name.get(), importer->GetErrorString());
-				return;
+			const bool useCache = cvar_meshCache.toInt() != 0;
+			if (useCache && loadCache(flags)) {
+				mainEngine->fmsg(Engine::MSG_DEBUG, "loaded mesh '%s' from cache", name.get());
 			} else {
-				if (!scene->HasAnimations()) {
-					flags |= aiProcess_PreTransformVertices;
+				importer = new Assimp::Importer();
+				ArrayList<Uint8> packed;
+				if (mainEngine->readPackedFile(path.get(), packed)) {
+					const char* extension = strrchr(path.get(), '.');
+					scene = importer->ReadFileFromMemory(packed.getArray(), packed.getSize(), 0, extension ? extension + 1 : "");
+				} else {
+					scene = importer->ReadFile(path.get(), 0);
+				}
+				if (!scene) {
+					mainEngine->fmsg(Engine::MSG_ERROR, "failed to load mesh '%s': %s", name.get(), importer->GetErrorString());
+					return;
+				} else {
+					unsigned int postFlags = flags;
+					if (!scene->HasAnimations()) {
+						postFlags |= aiProcess_PreTransformVertices;
+					}
+					importer->ApplyPostProcessing(postFlags);
+				}
+				for (unsigned int i = 0; i < scene->mNumMeshes; ++i) {
+					subMeshes.addNodeLast(new Mesh::SubMesh(scene, scene->mMeshes[i]));
+				}
+				if (useCache) {
+					saveCache(flags);
 				}
-				importer->ApplyPostProcessing(flags);
 			}
-			for (unsigned int i = 0; i < scene->mNumMeshes; ++i) {
-				Mesh::SubMesh* entry = new Mesh::SubMesh(scene, scene->mMeshes[i]);
-				if (i == 0) {
+			bool first = true;
+			for (auto entry : subMeshes) {
+				if (first) {
 					minBox = entry->getMinBox();
 					maxBox = entry->getMaxBox();
+					first = false;
 				} else {
 					minBox.x = min(minBox.x, entry->getMinBox().x);
 					minBox.y = min(minBox.y, entry->getMinBox().y);
@@ -88,7 +112,6 @@ Mesh::Mesh(const char* _name) : Asset(_name) {
 					maxBox.y = max(maxBox.y, entry->getMaxBox().y);
 					maxBox.z = max(maxBox.z, entry->getMaxBox().z);
 				}
-				subMeshes.addNodeLast(entry);
 				numBones += entry->getNumBones();
 				numVertices += entry->getNumVertices();
 				mainEngine->fmsg(Engine::MSG_DEBUG, "loaded submesh: %d verts, %d bones", entry->getNumVertices(), entry->getNumBones());
@@ -132,6 +155,51 @@ void Mesh::clear() {
 		}
 		delete importer;
 		importer = nullptr;
+	} else if (scene) {
+		// scene was rebuilt from the mesh cache
+		delete scene;
+		scene = nullptr;
+	}
+}
+
+bool Mesh::loadCache(unsigned int flags) {
+	MeshCache::MappedFile file;
+	MeshCache::header_t header;
+	if (!MeshCache::open(file, path.get(), flags, header)) {
+		return false;
+	}
+
+	MeshCache::Reader reader(file.getData() + sizeof(MeshCache::header_t), file.getSize() - sizeof(MeshCache::header_t));
+	scene = MeshCache::readScene(reader);
+	if (!scene) {
+		mainEngine->fmsg(Engine::MSG_WARN, "mesh cache for '%s' is corrupt, reimporting", name.get());
+		return false;
+	}
+	for (Uint32 c = 0; c < header.numSubMeshes; ++c) {
+		Mesh::SubMesh* entry = new Mesh::SubMesh(scene, reader);
+		if (!reader.isGood()) {
+			delete entry;
+			clear();
+			mainEngine->fmsg(Engine::MSG_WARN, "mesh cache for '%s' is corrupt, reimporting", name.get());
+			return false;
+		}
+		subMeshes.addNodeLast(entry);
+	}
+	return true;
+}
+
+void Mesh::saveCache(unsigned int flags) const {
+	MeshCache::Writer writer;
+	if (!MeshCache::begin(writer, path.get(), flags, subMeshes.getSize())) {
+		return;
+	}
+	MeshCache::writeScene(writer, scene);
+	for (auto submesh : subMeshes) {
+		submesh->writeCache(writer);
+	}
+	String cachePath = MeshCache::cachePathFor(path.get());
+	if (!writer.save(cachePath.get())) {
+		mainEngine->fmsg(Engine::MSG_WARN, "failed to write mesh cache '%s' for '%s'", cachePath.get(), name.get());
 	}
 }
 
@@ -375,11 +443,11 @@ ShaderProgram* Mesh::loadShader(const Component& component, Camera& camera, cons
 		if (component.getEntity()->isFlag(Entity::flag_t::FLAG_FULLYLIT) || camera.getDrawMode() == Camera::DRAW_GLOW || camera.getDrawMode() == Camera::DRAW_DEPTHFAIL) {
 			glUniform1i(shader.getUniformLocation("gActiveLight"), GL_FALSE);
 			glUniform1i(shader.getUniformLocation("gNumLights"), 0);
+			shader.invalidateLights();
 
-			char buf[32];
 			for (int index = 0; index < maxLights; ++textureUnit, ++index) {
-				glUniform1i(shader.getUniformLocation(ShaderProgram::uniformArray(buf, "gShadowmapEnabled", 17, index)), GL_FALSE);
-				glUniform1i(shader.getUniformLocation(ShaderProgram::uniformArray(buf, "gShadowmap", 10, index)), textureUnit);
+				glUniform1i(shader.getLightUniformLocation(ShaderProgram::LIGHT_SHADOWMAP_ENABLED, index), GL_FALSE);
+				glUniform1i(shader.getLightUniformLocation(ShaderProgram::LIGHT_SHADOWMAP, index), textureUnit);
 				camera.getEntity()->getWorld()->getDefaultShadow().bindForReading(GL_TEXTURE0 + textureUnit, GL_DEPTH_ATTACHMENT);
 			}
 			/*for (int index = 0; index < maxLights; ++textureUnit, ++index) {
@@ -392,23 +460,24 @@ ShaderProgram* Mesh::loadShader(const Component& component, Camera& camera, cons
 			if (lights.getSize()) {
 				textureUnit = shader.uploadLights(camera, lights, maxLights, textureUnit);
 			} else if (editor) {
-				glUniform3fv(shader.getUniformLocation("gLightPos[0]"), 1, glm::value_ptr(cameraPos));
-				glUniform3fv(shader.getUniformLocation("gLightColor[0]"), 1, glm::value_ptr(glm::vec3(1.f, 1.f, 1.f)));
-				glUniform1f(shader.getUniformLocation("gLightIntensity[0]"), 1.f);
-				glUniform1f(shader.getUniformLocation("gLightRadius[0]"), 16384.f);
-				glUniform3fv(shader.getUniformLocation("gLightScale[0]"), 1, glm::value_ptr(glm::vec3(1.f, 1.f, 1.f)));
-				glUniform1i(shader.getUniformLocation("gLightShape[0]"), 0);
-				glUniform1i(shader.getUniformLocation("gShadowmapEnabled[0]"), GL_FALSE);
+				glUniform3fv(shader.getLightUniformLocation(ShaderProgram::LIGHT_POS, 0), 1, glm::value_ptr(cameraPos));
+				glUniform3fv(shader.getLightUniformLocation(ShaderProgram::LIGHT_COLOR, 0), 1, glm::value_ptr(glm::vec3(1.f, 1.f, 1.f)));
+				glUniform1f(shader.getLightUniformLocation(ShaderProgram::LIGHT_INTENSITY, 0), 1.f);
+				glUniform1f(shader.getLightUniformLocation(ShaderProgram::LIGHT_RADIUS, 0), 16384.f);
+				glUniform3fv(shader.getLightUniformLocation(ShaderProgram::LIGHT_SCALE, 0), 1, glm::value_ptr(glm::vec3(1.f, 1.f, 1.f)));
+				glUniform1i(shader.getLightUniformLocation(ShaderProgram::LIGHT_SHAPE, 0), 0);
+				glUniform1i(shader.getLightUniformLocation(ShaderProgram::LIGHT_SHADOWMAP_ENABLED, 0), GL_FALSE);
 				glUniform1i(shader.getUniformLocation("gNumLights"), 1);
+				shader.invalidateLights();
 			} else {
 				glUniform1i(shader.getUniformLocation("gNumLights"), 0);
+				shader.invalidateLights();
 			}
 
-			char buf[32];
 			unsigned int newTextureUnit = textureUnit;
 			for (int index = newTextureUnit - oldTextureUnit; index < maxLights; ++textureUnit, ++index) {
-				glUniform1i(shader.getUniformLocation(ShaderProgram::uniformArray(buf, "gShadowmapEnabled", 17, index)), GL_FALSE);
-				glUniform1i(shader.getUniformLocation(ShaderProgram::uniformArray(buf, "gShadowmap", 10, index)), textureUnit);
+				glUniform1i(shader.getLightUniformLocation(ShaderProgram::LIGHT_SHADOWMAP_ENABLED, index), GL_FALSE);
+				glUniform1i(shader.getLightUniformLocation(ShaderProgram::LIGHT_SHADOWMAP, index), textureUnit);
 				camera.getEntity()->getWorld()->getDefaultShadow().bindForReading(GL_TEXTURE0 + textureUnit, GL_DEPTH_ATTACHMENT);
 			}
 			/*for (int index = newTextureUnit - oldTextureUnit; index < maxLights; ++textureUnit, ++index) {
@@ -686,8 +755,8 @@ Mesh::SubMesh::SubMesh(const VoxelMeshData& data) {
 
 	// colors
 	{
-		colors = new float[numVertices * 3];
-		memcpy(colors, data.colors.get(), sizeof(float) * numVertices * 3);
+		colors = new float[numVertices * 4];
+		memcpy(colors, data.colors.get(), sizeof(float) * numVertices * 4);
 	}
 
 	// normals
@@ -789,6 +858,7 @@ Mesh::SubMesh::SubMesh(const aiScene* _scene, aiMesh* mesh) {
 				++numBones;
 				boneinfo_t bi;
 				bi.name = boneName;
+				bi.id = StringID(boneName);
 				bi.offset = glm::mat4();
 				bi.real = true;
 				bones.push(bi);
@@ -830,60 +900,178 @@ Mesh::SubMesh::SubMesh(const aiScene* _scene, aiMesh* mesh) {
 			delete[] indices;
 		indices = new GLuint[mesh->mNumFaces * 3 * 2];
 
-		int index = 0;
-		for (unsigned int i = 0; i < mesh->mNumFaces; ++i, ++index) {
-			auto* p = &indices[index * 6];
-			if(mesh->mFaces[i].mNumIndices == 3) {
-				p[0] = mesh->mFaces[i].mIndices[0];
-				p[2] = mesh->mFaces[i].mIndices[1];
-				p[4] = mesh->mFaces[i].mIndices[2];
-				p[1] = findAdjacentIndex(*mesh, p[0], p[2], p[4]);
-				p[3] = findAdjacentIndex(*mesh, p[2], p[4], p[0]);
-				p[5] = findAdjacentIndex(*mesh, p[4], p[0], p[2]);
-			} else {
-				p[0] = 0;
-				p[1] = 0;
-				p[2] = 0;
-				p[3] = 0;
-				p[4] = 0;
-				p[5] = 0;
+		// gather triangles, then build adjacency for all of them at once
+		ArrayList<GLuint> triangles;
+		triangles.alloc(mesh->mNumFaces * 3);
+		for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
+			if (mesh->mFaces[i].mNumIndices == 3) {
+				triangles.push(mesh->mFaces[i].mIndices[0]);
+				triangles.push(mesh->mFaces[i].mIndices[1]);
+				triangles.push(mesh->mFaces[i].mIndices[2]);
+			}
+		}
+		if (triangles.getSize() == mesh->mNumFaces * 3) {
+			Adjacency::build(triangles.getArray(), mesh->mNumFaces, indices);
+		} else {
+			// non-triangle faces are left empty
+			ArrayList<GLuint> adjacency;
+			adjacency.resize(triangles.getSize() * 2);
+			Adjacency::build(triangles.getArray(), triangles.getSize() / 3, adjacency.getArray());
+			unsigned int triangle = 0;
+			for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
+				auto* p = &indices[i * 6];
+				if (mesh->mFaces[i].mNumIndices == 3) {
+					memcpy(p, &adjacency[triangle * 6], sizeof(GLuint) * 6);
+					++triangle;
+				} else {
+					memset(p, 0, sizeof(GLuint) * 6);
+				}
 			}
 		}
 	}
 }
 
-unsigned int Mesh::SubMesh::boneIndexForName(const char* name) const {
-	if (boneMapping.exists(name)) {
-		return *boneMapping.find(name);
-	} else {
-		return UINT32_MAX;
+// which optional streams follow a submesh in the mesh cache
+enum cachestream_t {
+	CACHE_VERTICES = 1 << 0,
+	CACHE_TEXCOORDS = 1 << 1,
+	CACHE_NORMALS = 1 << 2,
+	CACHE_COLORS = 1 << 3,
+	CACHE_TANGENTS = 1 << 4,
+	CACHE_BONEDATA = 1 << 5,
+	CACHE_INDICES = 1 << 6,
+};
+
+// reads an array of numElements * size bytes from the cache, or leaves dest null if it would overrun the file
+template <typename T>
+static void readCacheStream(MeshCache::Reader& reader, T*& dest, size_t numElements) {
+	if (!reader.has(numElements * sizeof(T))) {
+		return;
 	}
+	dest = new T[numElements];
+	reader.readBytes(dest, numElements * sizeof(T));
 }
 
-GLuint Mesh::SubMesh::findAdjacentIndex(const aiMesh& mesh, GLuint index1, GLuint index2, GLuint index3) {
-	GLuint indices[6];
-	for (unsigned int i = 0; i < mesh.mNumFaces; ++i) {
-		unsigned int*& faceIndices = mesh.mFaces[i].mIndices;
-		indices[0] = faceIndices[0];
-		indices[1] = faceIndices[1];
-		indices[2] = faceIndices[2];
-		indices[3] = faceIndices[0];
-		indices[4] = faceIndices[1];
-		indices[5] = faceIndices[2];
-		for (int edge = 0; edge < 3; ++edge) {
-			GLuint v1 = indices[edge]; // first edge index
-			GLuint v2 = indices[edge + 1]; // second edge index
-			GLuint vOpp = indices[edge + 2]; // index of opposite vertex
-
-			// if the edge matches the search edge and the opposite vertex does not match
-			if (((v1 == index1 && v2 == index2) || (v2 == index1 && v1 == index2)) && vOpp != index3) {
-				return vOpp; // we have found the adjacent vertex
-			}
+Mesh::SubMesh::SubMesh(const aiScene* _scene, MeshCache::Reader& reader) {
+	scene = _scene;
+
+	for (int i = 0; i < BUFFER_TYPE_LENGTH; ++i) {
+		vbo[static_cast<buffer_t>(i)] = 0;
+	}
+
+	Uint32 _numVertices = 0, _elementCount = 0, streams = 0;
+	reader.read(_numVertices);
+	reader.read(_elementCount);
+	reader.read(streams);
+	numVertices = _numVertices;
+	elementCount = _elementCount;
+	reader.read(minBox.x);
+	reader.read(minBox.y);
+	reader.read(minBox.z);
+	reader.read(maxBox.x);
+	reader.read(maxBox.y);
+	reader.read(maxBox.z);
+
+	// vertex streams are stored exactly as they are kept in memory
+	if (streams & CACHE_VERTICES) {
+		readCacheStream(reader, vertices, numVertices * 3);
+	}
+	if (streams & CACHE_TEXCOORDS) {
+		readCacheStream(reader, texCoords, numVertices * 2);
+	}
+	if (streams & CACHE_NORMALS) {
+		readCacheStream(reader, normals, numVertices * 3);
+	}
+	if (streams & CACHE_COLORS) {
+		readCacheStream(reader, colors, numVertices * 4);
+	}
+	if (streams & CACHE_TANGENTS) {
+		readCacheStream(reader, tangents, numVertices * 3);
+	}
+	if (streams & CACHE_BONEDATA) {
+		readCacheStream(reader, vertexbonedata, numVertices);
+	}
+	if (streams & CACHE_INDICES) {
+		readCacheStream(reader, indices, elementCount);
+	}
+
+	// bones, including the nodes mapped by mapBones()
+	Uint32 _numBones = 0;
+	if (reader.read(_numBones) && reader.has(_numBones)) {
+		bones.alloc(_numBones);
+		for (Uint32 c = 0; c < _numBones && reader.isGood(); ++c) {
+			boneinfo_t bi;
+			reader.readString(bi.name);
+			bi.id = StringID(bi.name.get());
+			float offset[16];
+			reader.readBytes(offset, sizeof(offset));
+			bi.offset = glm::make_mat4(offset);
+			Uint8 real = 0;
+			reader.read(real);
+			bi.real = real != 0;
+			bones.push(bi);
+			boneMapping.insert(bi.name.get(), c);
 		}
+		numBones = _numBones;
+	}
+}
+
+void Mesh::SubMesh::writeCache(MeshCache::Writer& writer) const {
+	Uint32 streams = 0;
+	streams |= vertices ? CACHE_VERTICES : 0;
+	streams |= texCoords ? CACHE_TEXCOORDS : 0;
+	streams |= normals ? CACHE_NORMALS : 0;
+	streams |= colors ? CACHE_COLORS : 0;
+	streams |= tangents ? CACHE_TANGENTS : 0;
+	streams |= vertexbonedata ? CACHE_BONEDATA : 0;
+	streams |= indices ? CACHE_INDICES : 0;
+
+	writer.write((Uint32)numVertices);
+	writer.write((Uint32)elementCount);
+	writer.write(streams);
+	writer.write(minBox.x);
+	writer.write(minBox.y);
+	writer.write(minBox.z);
+	writer.write(maxBox.x);
+	writer.write(maxBox.y);
+	writer.write(maxBox.z);
+
+	if (vertices) {
+		writer.writeBytes(vertices, sizeof(float) * numVertices * 3);
+	}
+	if (texCoords) {
+		writer.writeBytes(texCoords, sizeof(float) * numVertices * 2);
+	}
+	if (normals) {
+		writer.writeBytes(normals, sizeof(float) * numVertices * 3);
+	}
+	if (colors) {
+		writer.writeBytes(colors, sizeof(float) * numVertices * 4);
+	}
+	if (tangents) {
+		writer.writeBytes(tangents, sizeof(float) * numVertices * 3);
+	}
+	if (vertexbonedata) {
+		writer.writeBytes(vertexbonedata, sizeof(VertexBoneData) * numVertices);
+	}
+	if (indices) {
+		writer.writeBytes(indices, sizeof(GLuint) * elementCount);
 	}
 
-	// no opposite edge found
-	return index3;
+	writer.write((Uint32)bones.getSize());
+	for (auto& bone : bones) {
+		writer.writeString(bone.name.get());
+		writer.writeBytes(glm::value_ptr(bone.offset), sizeof(float) * 16);
+		writer.write((Uint8)(bone.real ? 1 : 0));
+	}
+}
+
+unsigned int Mesh::SubMesh::boneIndexForName(const char* name) const {
+	if (boneMapping.exists(name)) {
+		return *boneMapping.find(name);
+	} else {
+		return UINT32_MAX;
+	}
 }
 
 void Mesh::SubMesh::VertexBoneData::addBoneData(unsigned int boneID, float weight) {
@@ -906,6 +1094,7 @@ void Mesh::SubMesh::mapBones(const aiNode* node) {
 		boneMapping.insert(nodeName, numBones);
 		boneinfo_t bi;
 		bi.name = nodeName;
+		bi.id = StringID(nodeName);
 		bi.offset = glm::mat4();
 		bi.real = false;
 		bones.push(bi);
@@ -937,8 +1126,12 @@ void Mesh::SubMesh::readNodeHierarchy(const AnimationMap* animations, skincache_
 	aiMatrix4x4 nodeTransform = node->mTransformation;
 	const char* nodeName = node->mName.data;
 	const aiNodeAnim* nodeAnim = findNodeAnim(scene->mAnimations[0], nodeName);
+	const unsigned int* boneIndexPtr = boneMapping[nodeName];
 
 	if (nodeAnim) {
+		// every node is mapped to a bone, whose interned name finds the weights without building a string
+		const StringID nodeID = boneIndexPtr ? bones[*boneIndexPtr].id : StringID::find(nodeName);
+
 		aiVector3D scaling;
 		aiQuaternion rotationQ;
 		aiVector3D translation;
@@ -947,7 +1140,7 @@ void Mesh::SubMesh::readNodeHierarchy(const AnimationMap* animations, skincache_
 		bool first = true;
 		for (auto& pair : *animations) {
 			const AnimationState& anim = pair.b;
-			float weight = anim.getWeight(nodeAnim->mNodeName.data);
+			float weight = anim.getWeight(nodeID);
 
 			calcInterpolatedScaling(scaling, anim, weight, nodeAnim);
 			calcInterpolatedRotation(rotationQ, anim, weight, nodeAnim, first);
@@ -969,7 +1162,6 @@ void Mesh::SubMesh::readNodeHierarchy(const AnimationMap* animations, skincache_
 	glm::mat4 glmTransform = glm::transpose(glm::make_mat4(&nodeTransform.a1));
 	glm::mat4 globalTransform = *rootTransform * glmTransform;
 
-	const unsigned int* boneIndexPtr = boneMapping[nodeName];
 	if (boneIndexPtr) {
 		unsigned int boneIndex = *boneIndexPtr;
 		skin->offsets[boneIndex] = globalTransform;
@@ -1209,3 +1401,162 @@ void Mesh::SubMesh::draw(const Camera& camera) {
 	glDrawElements(GL_TRIANGLES_ADJACENCY, elementCount, GL_UNSIGNED_INT, NULL);
 	glBindVertexArray(0);
 }
+
+static int console_meshBenchmark(int argc, const char** argv) {
+	ArrayList<String> names;
+	for (int c = 1; c < argc; ++c) {
+		names.push(String(argv[c]));
+	}
+	if (names.empty()) {
+		for (auto& pair : mainEngine->getMeshResource().getCache()) {
+			if (pair.a.get()[0] != '#') {
+				names.push(String(pair.a.get()));
+			}
+		}
+	}
+	if (names.empty()) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "usage: %s assets/path/to/mesh.FBX [...]", argv[0]);
+		return 1;
+	}
+
+	typedef std::chrono::high_resolution_clock bench_clock;
+	double totalLoad = 0.0, totalFast = 0.0, totalSlow = 0.0;
+	for (auto& name : names) {
+		auto start = bench_clock::now();
+		Mesh* mesh = new Mesh(name.get());
+		double loadTime = std::chrono::duration<double>(bench_clock::now() - start).count();
+
+		// rebuild adjacency for every submesh both ways and make sure they agree
+		Uint32 numTriangles = 0;
+		double fastTime = 0.0, slowTime = 0.0;
+		bool match = true;
+		for (auto submesh : mesh->getSubMeshes()) {
+			Uint32 count = submesh->getNumIndices() / 6;
+			if (!count || !submesh->getIndices()) {
+				continue;
+			}
+			ArrayList<GLuint> triangles;
+			triangles.resize(count * 3);
+			for (Uint32 c = 0; c < count * 3; ++c) {
+				triangles[c] = submesh->getIndices()[c * 2];
+			}
+			ArrayList<GLuint> fast, slow;
+			fast.resize(count * 6);
+			slow.resize(count * 6);
+
+			start = bench_clock::now();
+			Adjacency::build(triangles.getArray(), count, fast.getArray());
+			fastTime += std::chrono::duration<double>(bench_clock::now() - start).count();
+
+			start = bench_clock::now();
+			Adjacency::buildSlow(triangles.getArray(), count, slow.getArray());
+			slowTime += std::chrono::duration<double>(bench_clock::now() - start).count();
+
+			match = match && memcmp(fast.getArray(), slow.getArray(), sizeof(GLuint) * count * 6) == 0;
+			numTriangles += count;
+		}
+		delete mesh;
+
+		totalLoad += loadTime;
+		totalFast += fastTime;
+		totalSlow += slowTime;
+		mainEngine->fmsg(match ? Engine::MSG_INFO : Engine::MSG_ERROR, "%s: %u tris, load %.2f ms (was ~%.2f ms), adjacency %.2f ms (was %.2f ms)%s",
+			name.get(), numTriangles, loadTime * 1000.0, (loadTime - fastTime + slowTime) * 1000.0, fastTime * 1000.0, slowTime * 1000.0,
+			match ? "" : " MISMATCH");
+	}
+	mainEngine->fmsg(Engine::MSG_INFO, "total: load %.2f ms (was ~%.2f ms)", totalLoad * 1000.0, (totalLoad - totalFast + totalSlow) * 1000.0);
+	return 0;
+}
+
+static Ccmd ccmd_meshBenchmark("mesh.benchmark", "loads the given meshes (or every cached mesh) and compares adjacency build times against the old O(n^2) search", &console_meshBenchmark);
+
+// compares two copies of the same mesh stream, either of which may be missing
+static bool streamsMatch(const void* a, const void* b, size_t bytes) {
+	if (!a || !b) {
+		return a == b;
+	}
+	return memcmp(a, b, bytes) == 0;
+}
+
+static int console_meshCacheBenchmark(int argc, const char** argv) {
+	ArrayList<String> names;
+	for (int c = 1; c < argc; ++c) {
+		names.push(String(argv[c]));
+	}
+	if (names.empty()) {
+		for (auto& pair : mainEngine->getMeshResource().getCache()) {
+			if (pair.a.get()[0] != '#') {
+				names.push(String(pair.a.get()));
+			}
+		}
+	}
+	if (names.empty()) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "usage: %s assets/path/to/mesh.FBX [...]", argv[0]);
+		return 1;
+	}
+	if (!cvar_meshCache.toInt()) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "mesh cache is disabled (mesh.cache.enabled)");
+		return 1;
+	}
+
+	// neither load below touches GL (that happens in finalize()), so this runs headless
+	typedef std::chrono::high_resolution_clock bench_clock;
+	double totalCold = 0.0, totalWarm = 0.0;
+	for (auto& name : names) {
+		String path = mainEngine->buildPath(name.get());
+		String cachePath = MeshCache::cachePathFor(path.get());
+		remove(cachePath.get());
+
+		auto start = bench_clock::now();
+		Mesh* cold = new Mesh(name.get());
+		double coldTime = std::chrono::duration<double>(bench_clock::now() - start).count();
+
+		start = bench_clock::now();
+		Mesh* warm = new Mesh(name.get());
+		double warmTime = std::chrono::duration<double>(bench_clock::now() - start).count();
+
+		// the cached copy must be identical to the imported one
+		bool match = cold->getSubMeshes().getSize() == warm->getSubMeshes().getSize() &&
+			cold->hasAnimations() == warm->hasAnimations() &&
+			cold->getAnimLength() == warm->getAnimLength();
+		auto coldNode = cold->getSubMeshes().getFirst();
+		auto warmNode = warm->getSubMeshes().getFirst();
+		for (; match && coldNode && warmNode; coldNode = coldNode->getNext(), warmNode = warmNode->getNext()) {
+			const Mesh::SubMesh* a = coldNode->getData();
+			const Mesh::SubMesh* b = warmNode->getData();
+			Uint32 verts = a->getNumVertices();
+			match = verts == b->getNumVertices() &&
+				a->getNumIndices() == b->getNumIndices() &&
+				a->getNumBones() == b->getNumBones() &&
+				streamsMatch(a->getVertices(), b->getVertices(), sizeof(float) * verts * 3) &&
+				streamsMatch(a->getTexCoords(), b->getTexCoords(), sizeof(float) * verts * 2) &&
+				streamsMatch(a->getNormals(), b->getNormals(), sizeof(float) * verts * 3) &&
+				streamsMatch(a->getColors(), b->getColors(), sizeof(float) * verts * 4) &&
+				streamsMatch(a->getTangents(), b->getTangents(), sizeof(float) * verts * 3) &&
+				streamsMatch(a->getIndices(), b->getIndices(), sizeof(GLuint) * a->getNumIndices());
+			for (Uint32 c = 0; match && c < a->getNumBones(); ++c) {
+				match = a->getBones()[c].name == b->getBones()[c].name.get() &&
+					a->getBones()[c].offset == b->getBones()[c].offset;
+			}
+		}
+
+		size_t cacheSize = 0;
+		MeshCache::MappedFile file;
+		if (file.open(cachePath.get())) {
+			cacheSize = file.getSize();
+		}
+
+		delete cold;
+		delete warm;
+
+		totalCold += coldTime;
+		totalWarm += warmTime;
+		mainEngine->fmsg(match ? Engine::MSG_INFO : Engine::MSG_ERROR, "%s: cold %.2f ms, warm %.2f ms (%.1fx), cache %u KB%s",
+			name.get(), coldTime * 1000.0, warmTime * 1000.0, coldTime / std::max(warmTime, 1e-9), (unsigned int)(cacheSize / 1024),
+			match ? "" : " MISMATCH");
+	}
+	mainEngine->fmsg(Engine::MSG_INFO, "total: cold %.2f ms, warm %.2f ms", totalCold * 1000.0, totalWarm * 1000.0);
+	return 0;
+}
+
+static Ccmd ccmd_meshCacheBenchmark("mesh.cache.benchmark", "imports the given meshes (or every cached mesh) without and then with the mesh cache, and compares load times and data", &console_meshCacheBenchmark);
@@ -19,6 +19,7 @@
 #include "AnimationState.hpp"
 #include "Map.hpp"
 #include "Voxel.hpp"
+#include "MeshCache.hpp"
 
 class ShaderProgram;
 class Camera;
@@ -144,11 +145,16 @@ public:
 		SubMesh(unsigned int _numIndices, unsigned int _numVertices);
 		SubMesh(const VoxelMeshData& data);
 		SubMesh(const aiScene* _scene, aiMesh* mesh);
+		SubMesh(const aiScene* _scene, MeshCache::Reader& reader);
 		SubMesh(const SubMesh& src, const glm::mat4& transform);
 		~SubMesh();
 
 		void finalize();
 		void append(const SubMesh& src, const glm::mat4& transform);
+
+		//! write this submesh to a mesh cache file
+		//! @param writer the cache writer
+		void writeCache(MeshCache::Writer& writer) const;
 		void draw(const Camera& camera);
 		const Vector& getMaxBox() const { return maxBox; }
 		const Vector& getMinBox() const { return minBox; }
@@ -166,12 +172,12 @@ public:
 		struct boneinfo_t {
 			glm::mat4 offset;
 			String name;
+			StringID id;			//!< the name, interned for looking up animation weights
 			bool real;
 		};
 
 		unsigned int boneIndexForName(const char* name) const;
 
-		GLuint findAdjacentIndex(const aiMesh& mesh, GLuint index1, GLuint index2, GLuint index3);
 		void mapBones(const aiNode* node);
 
 		void boneTransform(const AnimationMap& animations, skincache_t& skin) const;
@@ -233,10 +239,19 @@ public:
 
 private:
 	Assimp::Importer* importer = nullptr;
-	const aiScene* scene = nullptr;
+	const aiScene* scene = nullptr; //!< owned by the importer, or by us if it came from the mesh cache
 	LinkedList<Mesh::SubMesh*> subMeshes;
 	Vector minBox, maxBox;
 
 	unsigned int numBones = 0;
 	unsigned int numVertices = 0;
+
+	//! load submeshes, nodes and animations from the mesh cache
+	//! @param flags the import flags the cache must have been built with
+	//! @return true if the cache was valid and loaded
+	bool loadCache(unsigned int flags);
+
+	//! write the imported mesh to the mesh cache
+	//! @param flags the import flags the mesh was built with
+	void saveCache(unsigned int flags) const;
 };
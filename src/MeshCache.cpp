@@ -0,0 +1,507 @@
+// MeshCache.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "MeshCache.hpp"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <atomic>
+
+#ifdef PLATFORM_WINDOWS
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static const char cacheMagic[4] = { 'S', 'P', 'M', 'C' };
+static const char* cacheMeshDir = "cache/meshes";
+
+// deepest node hierarchy we are willing to rebuild (guards against corrupt files)
+static const Uint32 maxNodeDepth = 256;
+
+MeshCache::MappedFile::~MappedFile() {
+	close();
+}
+
+bool MeshCache::MappedFile::open(const char* path) {
+	close();
+	if (!path) {
+		return false;
+	}
+
+#ifdef PLATFORM_WINDOWS
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		close();
+		return false;
+	}
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping) {
+		close();
+		return false;
+	}
+	data = (const Uint8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data) {
+		close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+#else
+	file = ::open(path, O_RDONLY);
+	if (file < 0) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(file, &st) != 0 || st.st_size == 0) {
+		close();
+		return false;
+	}
+	void* result = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	if (result == MAP_FAILED) {
+		close();
+		return false;
+	}
+	data = (const Uint8*)result;
+	size = (size_t)st.st_size;
+#endif
+	return true;
+}
+
+void MeshCache::MappedFile::close() {
+#ifdef PLATFORM_WINDOWS
+	if (data) {
+		UnmapViewOfFile(data);
+	}
+	if (mapping) {
+		CloseHandle(mapping);
+		mapping = nullptr;
+	}
+	if (file != INVALID_HANDLE_VALUE) {
+		CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (data) {
+		munmap((void*)data, size);
+	}
+	if (file >= 0) {
+		::close(file);
+		file = -1;
+	}
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+bool MeshCache::Reader::readBytes(void* dest, size_t bytes) {
+	if (!good || bytes > size - pos) {
+		good = false;
+		return false;
+	}
+	memcpy(dest, data + pos, bytes);
+	pos += bytes;
+	return true;
+}
+
+bool MeshCache::Reader::readString(aiString& str) {
+	Uint32 len = 0;
+	if (!read(len) || len >= MAXLEN) {
+		good = false;
+		return false;
+	}
+	if (!readBytes(str.data, len)) {
+		return false;
+	}
+	str.data[len] = '\0';
+	str.length = len;
+	return true;
+}
+
+bool MeshCache::Reader::readString(String& str) {
+	Uint32 len = 0;
+	if (!read(len) || len > size - pos) {
+		good = false;
+		return false;
+	}
+	str.alloc(len + 1);
+	memcpy(&str[0], data + pos, len);
+	str[len] = '\0';
+	pos += len;
+	return true;
+}
+
+void MeshCache::Writer::writeBytes(const void* src, size_t bytes) {
+	if (!bytes) {
+		return;
+	}
+	Uint32 oldSize = buffer.getSize();
+	Uint32 newSize = oldSize + (Uint32)bytes;
+	if (newSize > buffer.getMaxSize()) {
+		buffer.alloc(std::max(newSize, buffer.getMaxSize() * 2U));
+	}
+	buffer.resize(newSize);
+	memcpy(&buffer[oldSize], src, bytes);
+}
+
+void MeshCache::Writer::writeString(const char* str) {
+	Uint32 len = str ? (Uint32)strlen(str) : 0;
+	write(len);
+	writeBytes(str, len);
+}
+
+bool MeshCache::Writer::save(const char* path) const {
+	if (buffer.empty()) {
+		return false;
+	}
+
+	// make the directories leading up to the file
+	for (const char* slash = strchr(path, '/'); slash != nullptr; slash = strchr(slash + 1, '/')) {
+		char dir[1024];
+		const size_t len = (size_t)(slash - path);
+		if (len == 0 || len >= sizeof(dir)) {
+			continue;
+		}
+		memcpy(dir, path, len);
+		dir[len] = '\0';
+#ifdef PLATFORM_WINDOWS
+		_mkdir(dir);
+#else
+		mkdir(dir, 0755);
+#endif
+	}
+
+	// write to a temporary file first so a reader never maps a half-written cache
+	static std::atomic<Uint32> tempCounter(0);
+	String tempPath;
+	tempPath.alloc((Uint32)strlen(path) + 16);
+	tempPath.format("%s.%u.tmp", path, tempCounter.fetch_add(1));
+
+	FILE* fp = fopen(tempPath.get(), "wb");
+	if (!fp) {
+		return false;
+	}
+	bool result = fwrite(buffer.getArray(), 1, buffer.getSize(), fp) == buffer.getSize();
+	result = fclose(fp) == 0 && result;
+	if (result) {
+#ifdef PLATFORM_WINDOWS
+		result = MoveFileExA(tempPath.get(), path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		result = rename(tempPath.get(), path) == 0;
+#endif
+	}
+	if (!result) {
+		remove(tempPath.get());
+	}
+	return result;
+}
+
+bool MeshCache::getSourceInfo(const char* path, sourceinfo_t& info) {
+	Uint64 hash;
+	if (path && mainEngine && mainEngine->statPackedFile(path, info.size, info.time, hash)) {
+		return true;
+	}
+	struct stat st;
+	if (!path || stat(path, &st) != 0) {
+		return false;
+	}
+	info.size = (Uint64)st.st_size;
+	info.time = (Sint64)st.st_mtime;
+	return true;
+}
+
+Uint64 MeshCache::hashFile(const char* path) {
+	// packed files have their hash in the pack's index
+	Uint64 size, hash;
+	Sint64 time;
+	if (path && mainEngine && mainEngine->statPackedFile(path, size, time, hash)) {
+		return hash;
+	}
+	FILE* fp = path ? fopen(path, "rb") : nullptr;
+	if (!fp) {
+		return 0;
+	}
+	Uint64 hash = 0xCBF29CE484222325ULL;
+	Uint8 chunk[65536];
+	size_t len;
+	while ((len = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+		for (size_t c = 0; c < len; ++c) {
+			hash ^= chunk[c];
+			hash *= 0x100000001B3ULL;
+		}
+	}
+	fclose(fp);
+	return hash;
+}
+
+String MeshCache::cachePathFor(const char* sourcePath) {
+	Uint64 hash = 0xCBF29CE484222325ULL;
+	for (const char* c = sourcePath; c && *c; ++c) {
+		hash ^= (Uint8)*c;
+		hash *= 0x100000001B3ULL;
+	}
+	String result;
+	result.alloc((Uint32)strlen(cacheMeshDir) + 24);
+	result.format("%s/%016llx.mesh", cacheMeshDir, (unsigned long long)hash);
+	return result;
+}
+
+bool MeshCache::open(MappedFile& file, const char* sourcePath, Uint32 importFlags, header_t& header) {
+	String cachePath = cachePathFor(sourcePath);
+	if (!file.open(cachePath.get())) {
+		return false;
+	}
+	Reader reader(file.getData(), file.getSize());
+	if (!reader.read(header) ||
+		memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 ||
+		header.version != version ||
+		header.importFlags != importFlags) {
+		file.close();
+		return false;
+	}
+
+	sourceinfo_t info;
+	if (!getSourceInfo(sourcePath, info) || info.size != header.sourceSize) {
+		file.close();
+		return false;
+	}
+	if (info.time == header.sourceTime) {
+		return true;
+	}
+
+	// the timestamp changed (eg. a fresh checkout), so fall back to comparing contents
+	if (hashFile(sourcePath) != header.sourceHash) {
+		file.close();
+		return false;
+	}
+
+	// contents are the same: restamp the cache so the next load can skip the hash
+	file.close();
+	header.sourceTime = info.time;
+	FILE* fp = fopen(cachePath.get(), "r+b");
+	if (fp) {
+		fwrite(&header, sizeof(header_t), 1, fp);
+		fclose(fp);
+	}
+	return file.open(cachePath.get()) && file.getSize() >= sizeof(header_t);
+}
+
+bool MeshCache::begin(Writer& writer, const char* sourcePath, Uint32 importFlags, Uint32 numSubMeshes) {
+	sourceinfo_t info;
+	if (!getSourceInfo(sourcePath, info)) {
+		return false;
+	}
+	header_t header;
+	memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = version;
+	header.importFlags = importFlags;
+	header.numSubMeshes = numSubMeshes;
+	header.sourceSize = info.size;
+	header.sourceTime = info.time;
+	header.sourceHash = hashFile(sourcePath);
+	writer.write(header);
+	return true;
+}
+
+void MeshCache::writeScene(Writer& writer, const aiScene* scene) {
+	Uint8 hasRoot = scene->mRootNode ? 1 : 0;
+	writer.write(hasRoot);
+	if (hasRoot) {
+		writeNode(writer, scene->mRootNode);
+	}
+	Uint32 numAnimations = scene->mAnimations ? scene->mNumAnimations : 0;
+	writer.write(numAnimations);
+	for (Uint32 c = 0; c < numAnimations; ++c) {
+		writeAnimation(writer, scene->mAnimations[c]);
+	}
+}
+
+aiScene* MeshCache::readScene(Reader& reader) {
+	aiScene* scene = new aiScene();
+
+	Uint8 hasRoot = 0;
+	reader.read(hasRoot);
+	if (hasRoot) {
+		scene->mRootNode = readNode(reader, nullptr, 0);
+	}
+
+	Uint32 numAnimations = 0;
+	if (reader.read(numAnimations) && numAnimations && reader.has(numAnimations)) {
+		scene->mAnimations = new aiAnimation*[numAnimations];
+		for (Uint32 c = 0; c < numAnimations; ++c) {
+			scene->mAnimations[c] = nullptr;
+		}
+		scene->mNumAnimations = numAnimations;
+		for (Uint32 c = 0; c < numAnimations && reader.isGood(); ++c) {
+			scene->mAnimations[c] = readAnimation(reader);
+		}
+	}
+
+	if (!reader.isGood() || (hasRoot && !scene->mRootNode)) {
+		delete scene;
+		return nullptr;
+	}
+	return scene;
+}
+
+void MeshCache::writeNode(Writer& writer, const aiNode* node) {
+	writer.writeString(node->mName.C_Str());
+	const ai_real* m = &node->mTransformation.a1;
+	for (int c = 0; c < 16; ++c) {
+		writer.write((float)m[c]);
+	}
+	writer.write(node->mNumChildren);
+	for (Uint32 c = 0; c < node->mNumChildren; ++c) {
+		writeNode(writer, node->mChildren[c]);
+	}
+}
+
+aiNode* MeshCache::readNode(Reader& reader, aiNode* parent, Uint32 depth) {
+	if (depth > maxNodeDepth) {
+		return nullptr;
+	}
+	aiNode* node = new aiNode();
+	node->mParent = parent;
+	reader.readString(node->mName);
+	ai_real* m = &node->mTransformation.a1;
+	for (int c = 0; c < 16; ++c) {
+		float value = 0.f;
+		reader.read(value);
+		m[c] = value;
+	}
+
+	Uint32 numChildren = 0;
+	if (reader.read(numChildren) && numChildren && reader.has(numChildren)) {
+		node->mChildren = new aiNode*[numChildren];
+		for (Uint32 c = 0; c < numChildren; ++c) {
+			node->mChildren[c] = nullptr;
+		}
+		for (Uint32 c = 0; c < numChildren && reader.isGood(); ++c) {
+			aiNode* child = readNode(reader, node, depth + 1);
+			if (!child) {
+				break;
+			}
+			node->mChildren[node->mNumChildren++] = child;
+		}
+		if (node->mNumChildren != numChildren) {
+			delete node;
+			return nullptr;
+		}
+	}
+	return node;
+}
+
+void MeshCache::writeAnimation(Writer& writer, const aiAnimation* animation) {
+	writer.writeString(animation->mName.C_Str());
+	writer.write(animation->mDuration);
+	writer.write(animation->mTicksPerSecond);
+	Uint32 numChannels = animation->mChannels ? animation->mNumChannels : 0;
+	writer.write(numChannels);
+	for (Uint32 c = 0; c < numChannels; ++c) {
+		const aiNodeAnim* channel = animation->mChannels[c];
+		writer.writeString(channel->mNodeName.C_Str());
+		writer.write((Uint32)channel->mPreState);
+		writer.write((Uint32)channel->mPostState);
+
+		writer.write(channel->mNumPositionKeys);
+		for (Uint32 k = 0; k < channel->mNumPositionKeys; ++k) {
+			const aiVectorKey& key = channel->mPositionKeys[k];
+			writer.write(key.mTime);
+			writer.write((float)key.mValue.x);
+			writer.write((float)key.mValue.y);
+			writer.write((float)key.mValue.z);
+		}
+		writer.write(channel->mNumRotationKeys);
+		for (Uint32 k = 0; k < channel->mNumRotationKeys; ++k) {
+			const aiQuatKey& key = channel->mRotationKeys[k];
+			writer.write(key.mTime);
+			writer.write((float)key.mValue.w);
+			writer.write((float)key.mValue.x);
+			writer.write((float)key.mValue.y);
+			writer.write((float)key.mValue.z);
+		}
+		writer.write(channel->mNumScalingKeys);
+		for (Uint32 k = 0; k < channel->mNumScalingKeys; ++k) {
+			const aiVectorKey& key = channel->mScalingKeys[k];
+			writer.write(key.mTime);
+			writer.write((float)key.mValue.x);
+			writer.write((float)key.mValue.y);
+			writer.write((float)key.mValue.z);
+		}
+	}
+}
+
+aiAnimation* MeshCache::readAnimation(Reader& reader) {
+	aiAnimation* animation = new aiAnimation();
+	reader.readString(animation->mName);
+	reader.read(animation->mDuration);
+	reader.read(animation->mTicksPerSecond);
+
+	Uint32 numChannels = 0;
+	if (!reader.read(numChannels) || !numChannels || !reader.has(numChannels)) {
+		return animation;
+	}
+	animation->mChannels = new aiNodeAnim*[numChannels];
+	for (Uint32 c = 0; c < numChannels; ++c) {
+		animation->mChannels[c] = nullptr;
+	}
+	animation->mNumChannels = numChannels;
+
+	for (Uint32 c = 0; c < numChannels && reader.isGood(); ++c) {
+		aiNodeAnim* channel = new aiNodeAnim();
+		animation->mChannels[c] = channel;
+		reader.readString(channel->mNodeName);
+		Uint32 preState = 0, postState = 0;
+		reader.read(preState);
+		reader.read(postState);
+		channel->mPreState = (aiAnimBehaviour)preState;
+		channel->mPostState = (aiAnimBehaviour)postState;
+
+		// each key is a double followed by 3 or 4 floats; check the count against what is left before allocating
+		const size_t vectorKeySize = sizeof(double) + sizeof(float) * 3;
+		const size_t quatKeySize = sizeof(double) + sizeof(float) * 4;
+		Uint32 count = 0;
+		if (reader.read(count) && count && reader.has(count * vectorKeySize)) {
+			channel->mPositionKeys = new aiVectorKey[count];
+			channel->mNumPositionKeys = count;
+			for (Uint32 k = 0; k < count && reader.isGood(); ++k) {
+				aiVectorKey& key = channel->mPositionKeys[k];
+				float x = 0.f, y = 0.f, z = 0.f;
+				reader.read(key.mTime);
+				reader.read(x); reader.read(y); reader.read(z);
+				key.mValue = aiVector3D(x, y, z);
+			}
+		}
+		count = 0;
+		if (reader.read(count) && count && reader.has(count * quatKeySize)) {
+			channel->mRotationKeys = new aiQuatKey[count];
+			channel->mNumRotationKeys = count;
+			for (Uint32 k = 0; k < count && reader.isGood(); ++k) {
+				aiQuatKey& key = channel->mRotationKeys[k];
+				float w = 1.f, x = 0.f, y = 0.f, z = 0.f;
+				reader.read(key.mTime);
+				reader.read(w); reader.read(x); reader.read(y); reader.read(z);
+				key.mValue = aiQuaternion(w, x, y, z);
+			}
+		}
+		count = 0;
+		if (reader.read(count) && count && reader.has(count * vectorKeySize)) {
+			channel->mScalingKeys = new aiVectorKey[count];
+			channel->mNumScalingKeys = count;
+			for (Uint32 k = 0; k < count && reader.isGood(); ++k) {
+				aiVectorKey& key = channel->mScalingKeys[k];
+				float x = 1.f, y = 1.f, z = 1.f;
+				reader.read(key.mTime);
+				reader.read(x); reader.read(y); reader.read(z);
+				key.mValue = aiVector3D(x, y, z);
+			}
+		}
+	}
+	return animation;
+}
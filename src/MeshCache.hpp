@@ -0,0 +1,189 @@
+//! @file MeshCache.hpp
+
+#pragma once
+
+#include <assimp/scene.h>
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+#include "String.hpp"
+
+//! The MeshCache stores imported meshes in a flat binary file so that later loads can skip Assimp entirely.
+//! A cache file holds everything a Mesh keeps after import: vertex streams, indices with adjacency, bones,
+//! the node hierarchy, and animation channels. Files are memory-mapped for reading and validated against
+//! the size, modification time and (if those differ) the content hash of the source asset.
+class MeshCache {
+public:
+	//! bump whenever the layout of a cache file changes
+	static const Uint32 version = 1;
+
+	//! cache file header
+	struct header_t {
+		char magic[4];
+		Uint32 version;
+		Uint32 importFlags;		//!< Assimp post-processing flags used to build the data
+		Uint32 numSubMeshes;
+		Uint64 sourceSize;
+		Sint64 sourceTime;
+		Uint64 sourceHash;
+	};
+
+	//! read-only file mapping
+	class MappedFile {
+	public:
+		MappedFile() = default;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&&) = delete;
+		~MappedFile();
+
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile& operator=(MappedFile&&) = delete;
+
+		//! map the given file
+		//! @param path the file to map
+		//! @return true on success
+		bool open(const char* path);
+
+		//! unmap the file
+		void close();
+
+		const Uint8*	getData() const		{ return data; }
+		size_t			getSize() const		{ return size; }
+
+	private:
+		const Uint8* data = nullptr;
+		size_t size = 0;
+#ifdef PLATFORM_WINDOWS
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+#else
+		int file = -1;
+#endif
+	};
+
+	//! bounds-checked cursor over a mapped cache file
+	class Reader {
+	public:
+		Reader(const Uint8* _data, size_t _size) :
+			data(_data),
+			size(_size) {}
+
+		//! read a plain value
+		//! @param value where to store the value
+		//! @return false if the file is truncated
+		template <typename T>
+		bool read(T& value) {
+			return readBytes(&value, sizeof(T));
+		}
+
+		//! copy bytes out of the file
+		//! @param dest where to store the bytes
+		//! @param bytes the number of bytes to copy
+		//! @return false if the file is truncated
+		bool readBytes(void* dest, size_t bytes);
+
+		//! read a length-prefixed string
+		//! @param str where to store the string
+		//! @return false if the file is truncated
+		bool readString(aiString& str);
+		bool readString(String& str);
+
+		//! check that enough bytes are left, flagging the reader as failed if not
+		//! @param bytes the number of bytes the caller is about to read
+		//! @return true if there is room
+		bool has(size_t bytes) {
+			good = good && bytes <= size - pos;
+			return good;
+		}
+
+		//! @return false if any read so far has failed
+		bool isGood() const { return good; }
+
+	private:
+		const Uint8* data;
+		size_t size;
+		size_t pos = 0;
+		bool good = true;
+	};
+
+	//! accumulates a cache file in memory
+	class Writer {
+	public:
+		//! write a plain value
+		//! @param value the value to write
+		template <typename T>
+		void write(const T& value) {
+			writeBytes(&value, sizeof(T));
+		}
+
+		//! write raw bytes
+		//! @param src the bytes to write
+		//! @param bytes the number of bytes
+		void writeBytes(const void* src, size_t bytes);
+
+		//! write a length-prefixed string
+		//! @param str the string to write
+		void writeString(const char* str);
+
+		//! write the buffer to disk, replacing the old file atomically
+		//! @param path the file to write
+		//! @return true on success
+		bool save(const char* path) const;
+
+	private:
+		ArrayList<Uint8> buffer;
+	};
+
+	//! size and modification time of a source asset
+	struct sourceinfo_t {
+		Uint64 size = 0;
+		Sint64 time = 0;
+	};
+
+	//! get the size and modification time of a file (for a file in an asset pack, the pack's time)
+	//! @param path the file to check
+	//! @param info where to store the result
+	//! @return true if the file exists
+	static bool getSourceInfo(const char* path, sourceinfo_t& info);
+
+	//! hash the contents of a file (64-bit FNV-1a)
+	//! @param path the file to hash
+	//! @return the hash, or 0 if the file could not be read
+	static Uint64 hashFile(const char* path);
+
+	//! @param sourcePath full path of the source asset
+	//! @return the path of the cache file for the given source asset
+	static String cachePathFor(const char* sourcePath);
+
+	//! map a cache file and check that it is still valid for its source
+	//! @param file the mapping to open
+	//! @param sourcePath full path of the source asset
+	//! @param importFlags the Assimp flags the caller would import with
+	//! @param header where to store the header of the cache file
+	//! @return true if the cache can be used
+	static bool open(MappedFile& file, const char* sourcePath, Uint32 importFlags, header_t& header);
+
+	//! begin a new cache file for the given source
+	//! @param writer the writer to fill
+	//! @param sourcePath full path of the source asset
+	//! @param importFlags the Assimp flags the data was imported with
+	//! @param numSubMeshes the number of submeshes that will follow
+	//! @return true if the source could be stamped
+	static bool begin(Writer& writer, const char* sourcePath, Uint32 importFlags, Uint32 numSubMeshes);
+
+	//! write the node hierarchy and animations of a scene
+	//! @param writer the writer to use
+	//! @param scene the scene to write
+	static void writeScene(Writer& writer, const aiScene* scene);
+
+	//! rebuild a scene holding only the node hierarchy and animations
+	//! @param reader the reader to use
+	//! @return a new scene (free with delete), or nullptr on failure
+	static aiScene* readScene(Reader& reader);
+
+private:
+	static void writeNode(Writer& writer, const aiNode* node);
+	static aiNode* readNode(Reader& reader, aiNode* parent, Uint32 depth);
+	static void writeAnimation(Writer& writer, const aiAnimation* animation);
+	static aiAnimation* readAnimation(Reader& reader);
+};
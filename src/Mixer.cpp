@@ -9,13 +9,44 @@
 #include "Main.hpp"
 #include "Engine.hpp"
 #include "Camera.hpp"
+#include "Entity.hpp"
 #include "Mixer.hpp"
+#include "Sound.hpp"
+#include "SoundStream.hpp"
+#include "Client.hpp"
+#include "World.hpp"
+
+#include <chrono>
+#include <cmath>
 
 Cvar cvar_volumeMaster("sound.volume.master", "master sound volume (0-100)", "100.0");
 Cvar cvar_volumeSFX("sound.volume.sfx", "sound effects volume (0-100)", "100.0");
 Cvar cvar_volumeMusic("sound.volume.music", "music volume (0-100)", "100.0");
 
+static Cvar cvar_occlusionBudget("sound.occlusion.budget", "number of sounds tested for occlusion each frame, taking turns", "8");
+static Cvar cvar_voices("sound.voices", "number of OpenAL sources shared by all 3D sounds; the least audible sounds past this play virtually (silently)", "32");
+
 Mixer::~Mixer() {
+	if (streamThread.joinable()) {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			quit = true;
+		}
+		streamWake.notify_one();
+		streamThread.join();
+	}
+	while (voiceList.getSize()) {
+		release(voiceList.peek());
+	}
+	for (auto& slot : slots) {
+		alDeleteSources(1, &slot.source);
+		if (slot.filter) {
+			alDeleteFilters(1, &slot.filter);
+		}
+	}
+	slots.clear();
+	freeSlots.clear();
+
 	alcMakeContextCurrent(NULL);
 	alcDestroyContext(context);
 	alcCloseDevice(device);
@@ -37,6 +68,36 @@ void Mixer::init() {
 	}
 	alGetError();
 
+	// create the source pool up front, each source with its own low pass filter
+	const Uint32 poolSize = (Uint32)std::max(cvar_voices.toInt(), 1);
+	slots.alloc(poolSize);
+	for (Uint32 c = 0; c < poolSize; ++c) {
+		slot_t slot;
+		alGenSources(1, &slot.source);
+		if (alGetError() != AL_NO_ERROR) {
+			mainEngine->fmsg(Engine::MSG_WARN, "audio device ran out of sources, using %u voices", c);
+			break;
+		}
+		alGenFilters(1, &slot.filter);
+		if (alGetError() == AL_NO_ERROR && alIsFilter(slot.filter)) {
+			alFilteri(slot.filter, AL_FILTER_TYPE, AL_FILTER_LOWPASS);
+			if (alGetError() != AL_NO_ERROR) {
+				alDeleteFilters(1, &slot.filter);
+				slot.filter = 0;
+			}
+		} else {
+			slot.filter = 0;
+		}
+		slots.push(slot);
+	}
+	freeSlots.alloc(slots.getSize());
+	for (Uint32 c = slots.getSize(); c > 0; --c) {
+		freeSlots.push((Sint32)(c - 1));
+	}
+
+	// the context is current for the whole process, so streams can be refilled from their own thread
+	streamThread = std::thread(&Mixer::runStreams, this);
+
 	initialized = true;
 }
 
@@ -96,5 +157,451 @@ int Mixer::playSound(const char* name, const bool loop) {
 }
 
 bool Mixer::stopSound(int channel) {
+	if (channel >= streamChannels) {
+		const Uint32 id = (Uint32)(channel - streamChannels);
+		if (!isVoicePlaying(id)) {
+			return false;
+		}
+		stopVoice(id);
+		return true;
+	}
 	return Mix_HaltChannel(channel) == 0;
-}
\ No newline at end of file
+}
+
+int Mixer::playStream(const Sound& sound, const bool loop) {
+	if (!sound.isStreamed()) {
+		return -1;
+	}
+	Uint32 id = playVoice(sound, loop, 0.f, maxPriority, true);
+	return id ? streamChannels + (int)id : -1;
+}
+
+double Mixer::now() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Uint32 Mixer::playVoice(const Sound& sound, const bool loop, const float range, const int priority, const bool relative) {
+	if (!initialized || !sound.isLoaded()) {
+		return 0;
+	}
+	voice_t* voice = new voice_t();
+	voice->id = nextVoice;
+	voice->sound = &sound;
+	voice->loop = loop;
+	voice->relative = relative;
+	voice->priority = std::min(priority, maxPriority);
+	voice->range = range;
+	voice->started = now();
+
+	// ids double as stream channels, so keep them clear of overflowing one
+	nextVoice = nextVoice >= (Uint32)(INT32_MAX - streamChannels) ? 1 : nextVoice + 1;
+
+	std::lock_guard<std::mutex> guard(lock);
+	voices.insert(voice->id, voice);
+	voiceList.push(voice);
+	return voice->id;
+}
+
+void Mixer::stopVoice(Uint32 id) {
+	std::lock_guard<std::mutex> guard(lock);
+	voice_t** voice = voices.find(id);
+	if (voice) {
+		release(*voice);
+	}
+}
+
+void Mixer::stopVoices(const Sound& sound) {
+	std::lock_guard<std::mutex> guard(lock);
+	for (Uint32 c = voiceList.getSize(); c > 0; --c) {
+		if (voiceList[c - 1]->sound == &sound) {
+			release(voiceList[c - 1]);
+		}
+	}
+}
+
+bool Mixer::isVoicePlaying(Uint32 id) const {
+	return id && voices.exists(id);
+}
+
+void Mixer::setVoicePosition(Uint32 id, World* world, const Vector& pos, const Vector& vel, const Vector& dir) {
+	voice_t** found = voices.find(id);
+	if (found) {
+		voice_t* voice = *found;
+		if (voice->world != world) {
+			voice->world = world;
+			voice->traced = false;
+			voice->changed = true;
+		}
+		voice->pos = pos;
+		voice->vel = vel;
+		voice->dir = dir;
+		voice->moved = true;
+	}
+}
+
+void Mixer::setVoiceGain(Uint32 id, const float gain) {
+	voice_t** found = voices.find(id);
+	if (found) {
+		voice_t* voice = *found;
+		if (voice->gain != gain) {
+			voice->gain = gain;
+			voice->changed = true;
+		}
+	}
+}
+
+void Mixer::release(voice_t* voice) {
+	if (voice->slot >= 0) {
+		virtualize(*voice);
+	}
+	voices.remove(voice->id);
+	for (Uint32 c = 0; c < voiceList.getSize(); ++c) {
+		if (voiceList[c] == voice) {
+			voiceList.removeAndRearrange(c);
+			break;
+		}
+	}
+	delete voice;
+}
+
+void Mixer::realize(voice_t& voice, double time) {
+	voice.slot = freeSlots.pop();
+	slot_t& slot = slots[voice.slot];
+	slot.voice = &voice;
+	const ALuint source = slot.source;
+
+	alSourcei(source, AL_SOURCE_RELATIVE, voice.relative ? AL_TRUE : AL_FALSE);
+	if (voice.relative) {
+		alSource3f(source, AL_POSITION, 0.f, 0.f, 0.f);
+		alSource3f(source, AL_VELOCITY, 0.f, 0.f, 0.f);
+		alSourcef(source, AL_ROLLOFF_FACTOR, 0.f);
+	} else {
+		alSourcef(source, AL_ROLLOFF_FACTOR, 1.f);
+		alSourcef(source, AL_REFERENCE_DISTANCE, voice.range / World::tileSize);
+	}
+	alSourcef(source, AL_PITCH, 1.f);
+	voice.moved = true;
+	voice.changed = true;
+	push(voice);
+
+	// pick up where the voice would be if it had been playing all along
+	const float length = voice.sound->getLength();
+	double offset = time - voice.started;
+	if (voice.loop && length > 0.f) {
+		offset = fmod(offset, (double)length);
+	}
+	if (voice.sound->isStreamed()) {
+		voice.stream = new SoundStream(voice.sound->getPath(), voice.sound->getWave(), source, voice.loop);
+		if (!voice.stream->start((float)offset)) {
+			delete voice.stream;
+			voice.stream = nullptr;
+			voice.finished = true;
+		}
+	} else {
+		alSourcei(source, AL_BUFFER, voice.sound->getBuffer());
+		alSourcei(source, AL_LOOPING, voice.loop ? AL_TRUE : AL_FALSE);
+		alSourcef(source, AL_SEC_OFFSET, (float)offset);
+		alSourcePlay(source);
+	}
+}
+
+void Mixer::virtualize(voice_t& voice) {
+	slot_t& slot = slots[voice.slot];
+	if (voice.stream) {
+		// the stream thread may be in the middle of refilling it
+		refilled.wait(lock, [&]() { return refilling != voice.stream; });
+
+		// stops the source and unqueues its buffers
+		delete voice.stream;
+		voice.stream = nullptr;
+	} else {
+		alSourceStop(slot.source);
+		alSourcei(slot.source, AL_BUFFER, 0);
+	}
+	slot.voice = nullptr;
+	freeSlots.push(voice.slot);
+	voice.slot = -1;
+	voice.traced = false;
+}
+
+void Mixer::push(voice_t& voice) {
+	const slot_t& slot = slots[voice.slot];
+	if (voice.moved && !voice.relative) {
+		float f = 2.f / World::tileSize;
+		alSource3f(slot.source, AL_POSITION, voice.pos.x*f, -voice.pos.z*f, voice.pos.y*f);
+		alSource3f(slot.source, AL_VELOCITY, voice.vel.x*f, -voice.vel.z*f, voice.vel.y*f);
+		alSource3f(slot.source, AL_DIRECTION, voice.dir.x, voice.dir.y, voice.dir.z);
+	}
+	if (voice.changed) {
+		// sounds are only heard in the listener's world
+		const bool heard = voice.relative || voice.world == listenerWorld;
+		alSourcef(slot.source, AL_GAIN, heard ? voice.gain : 0.f);
+		if (slot.filter) {
+			alFilterf(slot.filter, AL_LOWPASS_GAIN, 1.f - 0.75f * voice.lowpass);
+			alFilterf(slot.filter, AL_LOWPASS_GAINHF, 1.f - 0.75f * voice.lowpass);
+			alSourcei(slot.source, AL_DIRECT_FILTER, slot.filter);
+		}
+	}
+	voice.moved = false;
+	voice.changed = false;
+}
+
+void Mixer::update() {
+	if (!initialized) {
+		return;
+	}
+	auto start = std::chrono::high_resolution_clock::now();
+	const double time = now();
+	World* world = nullptr;
+	if (listener) {
+		listenerPos = listener->getGlobalPos();
+		world = listener->getEntity() ? listener->getEntity()->getWorld() : nullptr;
+	}
+	if (listenerWorld != world) {
+		listenerWorld = world;
+		for (auto voice : voiceList) {
+			voice->traced = false;
+			voice->changed = true;
+		}
+	}
+
+	// only the stream thread shares voices, and it does not touch anything occlusion needs
+	occlude(time);
+
+	std::lock_guard<std::mutex> guard(lock);
+
+	// retire voices which have played out, and rate the rest by how much they are heard.
+	// sounds in buffers finish by the clock, which also keeps virtual voices on time without touching OpenAL
+	for (Uint32 c = 0; c < voiceList.getSize();) {
+		voice_t* voice = voiceList[c];
+		if (!voice->loop && !voice->stream && time - voice->started >= voice->sound->getLength()) {
+			voice->finished = true;
+		}
+		if (voice->finished) {
+			release(voice);
+			continue;
+		}
+		if (voice->relative) {
+			voice->audibility = voice->gain;
+		} else if (voice->world != listenerWorld) {
+			voice->audibility = 0.f;
+		} else {
+			const float dist = std::max((voice->pos - listenerPos).length(), 1.f);
+			voice->audibility = voice->gain * std::min(voice->range / dist, 1.f) * (1.f - 0.75f * voice->lowpass);
+		}
+		if (voice->slot >= 0) {
+			// a voice holding a source keeps it against voices which are only slightly louder
+			voice->audibility *= 1.25f;
+		}
+		++c;
+	}
+
+	// the most audible voices get sources, with priority over everything else
+	class SortFn : public ArrayList<voice_t*>::SortFunction {
+	public:
+		virtual ~SortFn() {}
+		virtual const bool operator()(voice_t* a, voice_t* b) const override {
+			if (a->priority != b->priority) {
+				return a->priority > b->priority;
+			}
+			return a->audibility > b->audibility;
+		}
+	};
+	ranked.resize(voiceList.getSize());
+	for (Uint32 c = 0; c < voiceList.getSize(); ++c) {
+		ranked[c] = voiceList[c];
+	}
+	ranked.sort(SortFn());
+	const Uint32 numReal = std::min(ranked.getSize(), slots.getSize());
+	for (Uint32 c = numReal; c < ranked.getSize(); ++c) {
+		if (ranked[c]->slot >= 0) {
+			virtualize(*ranked[c]);
+			++voiceStats.steals;
+		}
+	}
+	for (Uint32 c = 0; c < numReal; ++c) {
+		voice_t& voice = *ranked[c];
+		if (voice.slot < 0) {
+			realize(voice, time);
+		} else if (voice.moved || voice.changed) {
+			push(voice);
+		}
+	}
+
+	const double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	++voiceStats.updates;
+	voiceStats.totalTime += elapsed;
+	voiceStats.maxTime = std::max(voiceStats.maxTime, elapsed);
+}
+
+//! how quickly a voice's low pass follows its occlusion, per second
+static const float occlusionFade = 3.f;
+
+void Mixer::occlude(double time) {
+	const float step = (float)std::min(time - lastUpdate, 1.0) * occlusionFade;
+	lastUpdate = time;
+
+	// voices which just got a source are tested straight away; the rest take turns within the budget
+	traceVoices.resize(0);
+	if (listenerWorld && voiceList.getSize()) {
+		const Uint32 budget = (Uint32)std::max(cvar_occlusionBudget.toInt(), 1);
+		for (Uint32 c = 0; c < voiceList.getSize() && traceVoices.getSize() < budget; ++c) {
+			voice_t* voice = voiceList[c];
+			if (voice->slot >= 0 && !voice->traced && !voice->relative && voice->world == listenerWorld) {
+				traceVoices.push(voice);
+			}
+		}
+		for (Uint32 c = 0; c < voiceList.getSize() && traceVoices.getSize() < budget; ++c) {
+			occlusionCursor = (occlusionCursor + 1) % voiceList.getSize();
+			voice_t* voice = voiceList[occlusionCursor];
+			if (voice->slot >= 0 && voice->traced && !voice->relative && voice->world == listenerWorld) {
+				traceVoices.push(voice);
+			}
+		}
+	}
+	if (traceVoices.getSize()) {
+		traceDests.resize(traceVoices.getSize());
+		for (Uint32 c = 0; c < traceVoices.getSize(); ++c) {
+			traceDests[c] = traceVoices[c]->pos;
+		}
+		listenerWorld->lineTestOccluded(listenerPos, traceDests, traceResults);
+		voiceStats.traces += traceVoices.getSize();
+		for (Uint32 c = 0; c < traceVoices.getSize(); ++c) {
+			voice_t* voice = traceVoices[c];
+			voice->occluded = traceResults[c];
+			if (!voice->traced) {
+				// nothing to ease from yet
+				voice->traced = true;
+				voice->lowpass = voice->occluded ? 1.f : 0.f;
+				voice->changed = true;
+			}
+		}
+	}
+
+	// ease towards the last result, so a voice that was tested a few frames ago still changes smoothly
+	for (auto voice : voiceList) {
+		if (!voice->traced) {
+			continue;
+		}
+		const float target = voice->occluded ? 1.f : 0.f;
+		if (voice->lowpass != target) {
+			voice->lowpass = voice->lowpass < target ? std::min(target, voice->lowpass + step) : std::max(target, voice->lowpass - step);
+			voice->changed = true;
+		}
+	}
+}
+
+void Mixer::runStreams() {
+	std::unique_lock<std::mutex> guard(lock);
+	while (!quit) {
+		// refills read the disk, so they happen without the lock, one stream at a time. A voice which has a
+		// source can't be released while its stream is marked as refilling (see virtualize())
+		for (Uint32 c = 0; c < slots.getSize() && !quit; ++c) {
+			voice_t* voice = slots[c].voice;
+			if (!voice || !voice->stream || voice->finished) {
+				continue;
+			}
+			SoundStream* stream = voice->stream;
+			refilling = stream;
+			guard.unlock();
+			const bool playing = stream->update();
+			guard.lock();
+			refilling = nullptr;
+			if (!playing) {
+				voice->finished = true;
+			}
+			refilled.notify_all();
+		}
+		streamWake.wait_for(guard, std::chrono::milliseconds(streamInterval));
+	}
+}
+
+static int console_voices(int argc, const char** argv) {
+	Client* client = mainEngine->getLocalClient();
+	Mixer* mixer = client ? client->getMixer() : nullptr;
+	if (!mixer || !mixer->isInitialized()) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "No mixer is running.");
+		return 1;
+	}
+	const Mixer::voicestats_t& stats = mixer->getVoiceStats();
+	mainEngine->fmsg(Engine::MSG_INFO, "%u voices, %u with sources (pool of %u), %u virtual",
+		mixer->getNumVoices(), mixer->getNumRealVoices(), mixer->getPoolSize(), mixer->getNumVoices() - mixer->getNumRealVoices());
+	mainEngine->fmsg(Engine::MSG_INFO, "%u updates: %.1f us avg, %.1f us max, %u voices stolen, %.1f occlusion rays per update",
+		stats.updates, stats.updates ? stats.totalTime * 1000000.0 / stats.updates : 0.0, stats.maxTime * 1000000.0, stats.steals,
+		stats.updates ? (double)stats.traces / stats.updates : 0.0);
+	mixer->resetVoiceStats();
+	return 0;
+}
+
+static Ccmd ccmd_voices("sound.voices.stats", "prints voice counts and the mixer's per-frame update time since the last call", &console_voices);
+
+static int console_voicesBenchmark(int argc, const char** argv) {
+	if (argc < 2) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "A sound is needed. ex: sound.voices.benchmark sounds/ambient/hum.wav 256 600");
+		return 1;
+	}
+	Client* client = mainEngine->getLocalClient();
+	Mixer* mixer = client ? client->getMixer() : nullptr;
+	if (!mixer || !mixer->isInitialized()) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "An audio device is needed (ALSOFT_DRIVERS=null gives a silent one).");
+		return 1;
+	}
+	Sound* sound = mainEngine->getSoundResource().dataForString(argv[1]);
+	if (!sound || !sound->isLoaded()) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "failed to load sound '%s'", argv[1]);
+		return 1;
+	}
+	const Uint32 numEmitters = argc > 2 ? std::max((Uint32)strtol(argv[2], nullptr, 10), 1U) : 256U;
+	const Uint32 numFrames = argc > 3 ? std::max((Uint32)strtol(argv[3], nullptr, 10), 1U) : 600U;
+
+	// emitters scattered around the listener, drifting about every frame
+	struct emitter_t {
+		Uint32 voice = 0;
+		Vector pos;
+		Vector vel;
+	};
+	ArrayList<emitter_t> emitters;
+	emitters.resize(numEmitters);
+	const Vector& center = mixer->getListenerPos();
+	Camera* camera = mixer->getListener();
+	World* world = camera && camera->getEntity() ? camera->getEntity()->getWorld() : nullptr;
+	for (auto& emitter : emitters) {
+		const float angle = mainEngine->getRandom().getFloat() * 2.f * PI;
+		const float dist = mainEngine->getRandom().getFloat() * 4096.f;
+		emitter.pos = center + Vector(cosf(angle) * dist, sinf(angle) * dist, 0.f);
+		emitter.vel = Vector(cosf(angle + PI / 2.f), sinf(angle + PI / 2.f), 0.f) * 8.f;
+		const float range = 256.f + mainEngine->getRandom().getFloat() * 768.f;
+		const int priority = (int)(mainEngine->getRandom().getUint32() % 3);
+		emitter.voice = mixer->playVoice(*sound, true, range, priority, false);
+		mixer->setVoicePosition(emitter.voice, world, emitter.pos, emitter.vel, Vector(1.f, 0.f, 0.f));
+		mixer->setVoiceGain(emitter.voice, 0.1f);
+	}
+
+	mixer->resetVoiceStats();
+	double cpu = 0.0;
+	for (Uint32 frame = 0; frame < numFrames; ++frame) {
+		auto start = std::chrono::high_resolution_clock::now();
+		for (auto& emitter : emitters) {
+			emitter.pos += emitter.vel;
+			mixer->setVoicePosition(emitter.voice, world, emitter.pos, emitter.vel, Vector(1.f, 0.f, 0.f));
+		}
+		mixer->update();
+		cpu += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	const Mixer::voicestats_t stats = mixer->getVoiceStats();
+	const Uint32 real = mixer->getNumRealVoices();
+	for (auto& emitter : emitters) {
+		mixer->stopVoice(emitter.voice);
+	}
+
+	mainEngine->fmsg(Engine::MSG_INFO, "%u emitters, %u frames: %u voices with sources (pool of %u), %u virtual, %u voices stolen",
+		numEmitters, numFrames, real, mixer->getPoolSize(), numEmitters - real, stats.steals);
+	mainEngine->fmsg(Engine::MSG_INFO, "audio cpu per frame: %.1f us avg (mixer update %.1f us avg, %.1f us max), %.1f occlusion rays",
+		cpu * 1000000.0 / numFrames, stats.updates ? stats.totalTime * 1000000.0 / stats.updates : 0.0, stats.maxTime * 1000000.0,
+		stats.updates ? (double)stats.traces / stats.updates : 0.0);
+	mixer->resetVoiceStats();
+	return 0;
+}
+
+static Ccmd ccmd_voicesBenchmark("sound.voices.benchmark", "plays a looping sound from many emitters around the listener and reports voices and per-frame audio cpu. ex: sound.voices.benchmark sounds/ambient/hum.wav 256 600", &console_voicesBenchmark);
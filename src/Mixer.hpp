@@ -3,11 +3,22 @@
 #pragma once
 
 #include "Console.hpp"
+#include "ArrayList.hpp"
+#include "Map.hpp"
+#include "Vector.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 class Camera;
+class World;
+class Sound;
+class SoundStream;
 
 //! The Mixer class contains all the state about 3D listeners in the world and the audio engine,
 //! and provides methods for playing 2D sounds, among other things.
+//! 3D sounds play on voices (see playVoice()), which share a fixed pool of OpenAL sources and filters.
 class Mixer {
 public:
 	Mixer() = default;
@@ -38,6 +49,77 @@ public:
 	//! @return true if the sound was stopped, otherwise false
 	bool stopSound(int channel);
 
+	//! channels returned by playStream() start here, above any SDL_mixer channel
+	static const int streamChannels = 0x10000;
+
+	//! milliseconds between refills of the streams
+	static const Uint32 streamInterval = 20;
+
+	//! highest voice priority (used for 2D sounds)
+	static const int maxPriority = 100;
+
+	//! play a streamed sound without any listener (2D)
+	//! @param sound the sound to play, which must be streamed
+	//! @param loop if true, the sound will loop indefinitely; otherwise, it will only play once
+	//! @return the channel the sound is playing on (for stopSound()), or -1 for errors
+	int playStream(const Sound& sound, const bool loop);
+
+	//! play a sound on a voice. Only the most audible voices get one of the mixer's sources (see the sound.voices
+	//! cvar); the rest are virtual: silent, but keeping their place in the sound until they win a source back
+	//! @param sound the sound to play
+	//! @param loop if true, the sound will loop until stopped; otherwise, it will only play once
+	//! @param range max distance the sound will play over
+	//! @param priority voices with a higher priority take sources before any with a lower one
+	//! @param relative if true, the sound plays at the listener (2D) rather than at a position
+	//! @return the voice, or 0 for errors
+	Uint32 playVoice(const Sound& sound, const bool loop, const float range, const int priority, const bool relative);
+
+	//! stop a voice
+	//! @param id the voice to stop
+	void stopVoice(Uint32 id);
+
+	//! stop every voice playing a sound (eg. because it is being unloaded)
+	//! @param sound the sound to stop
+	void stopVoices(const Sound& sound);
+
+	//! @param id a voice returned by playVoice()
+	//! @return true if the voice is still playing (really or virtually)
+	bool isVoicePlaying(Uint32 id) const;
+
+	//! place a voice in the world. Voices are only heard in the listener's world, muffled by any occluders
+	//! in the way (see update())
+	//! @param id the voice to move
+	//! @param world the world the sound is in
+	//! @param pos the position of the sound
+	//! @param vel the velocity of the sound
+	//! @param dir the direction the sound faces
+	void setVoicePosition(Uint32 id, World* world, const Vector& pos, const Vector& vel, const Vector& dir);
+
+	//! set how loud a voice is
+	//! @param id the voice to change
+	//! @param gain the volume of the voice (0 to silence it)
+	void setVoiceGain(Uint32 id, const float gain);
+
+	//! test a few voices for occlusion, hand sources to the most audible voices and send changes to OpenAL.
+	//! Called once per frame
+	void update();
+
+	//! voice statistics, accumulated since the last reset
+	struct voicestats_t {
+		Uint32 updates = 0;
+		double totalTime = 0.0;		//!< seconds spent in update()
+		double maxTime = 0.0;
+		Uint32 steals = 0;			//!< voices which lost their source to a more audible one
+		Uint32 traces = 0;			//!< occlusion rays cast
+	};
+
+	Uint32					getNumVoices() const		{ return voiceList.getSize(); }
+	Uint32					getNumRealVoices() const	{ return slots.getSize() - freeSlots.getSize(); }
+	Uint32					getPoolSize() const			{ return slots.getSize(); }
+	const voicestats_t&		getVoiceStats() const		{ return voiceStats; }
+	void					resetVoiceStats()			{ voiceStats = voicestats_t(); }
+	const Vector&			getListenerPos() const		{ return listenerPos; }
+
 	const ALCdevice*	getDevice() const { return device; }
 	const ALCcontext*	getContext() const { return context; }
 	bool				isInitialized() const { return initialized; }
@@ -49,6 +131,90 @@ private:
 	Camera* listener = nullptr;
 
 	bool initialized = false;
+
+	//! a sound being played
+	struct voice_t {
+		Uint32 id = 0;
+		const Sound* sound = nullptr;
+		bool loop = false;
+		bool relative = false;
+		int priority = 0;
+		float range = 0.f;
+		Vector pos;
+		Vector vel;
+		Vector dir;
+		World* world = nullptr;
+		float gain = 1.f;
+		float lowpass = 0.f;		//!< how muffled the voice is (0 for not at all, up to 1), eased towards occluded
+		bool occluded = false;
+		bool traced = false;		//!< occluded has been tested since the voice got its source
+		double started = 0.0;		//!< mixer clock when the voice was at the start of its sound
+		Sint32 slot = -1;			//!< the voice's source in the pool, or -1 if it is virtual
+		SoundStream* stream = nullptr;
+		bool finished = false;
+		bool moved = true;			//!< position needs to be sent to OpenAL
+		bool changed = true;		//!< gain and filter need to be sent to OpenAL
+		float audibility = 0.f;		//!< how much the voice is heard, for ranking
+	};
+
+	//! a pooled source
+	struct slot_t {
+		ALuint source = 0;
+		ALuint filter = 0;
+		voice_t* voice = nullptr;
+	};
+
+	//! voices and pool
+	Map<Uint32, voice_t*> voices;
+	ArrayList<voice_t*> voiceList;
+	ArrayList<voice_t*> ranked;
+	ArrayList<slot_t> slots;
+	ArrayList<Sint32> freeSlots;
+	Uint32 nextVoice = 1;
+	Vector listenerPos;
+	World* listenerWorld = nullptr;
+	voicestats_t voiceStats;
+	double lastUpdate = 0.0;
+
+	//! occlusion tests, gathered each frame and cast as one batch
+	Uint32 occlusionCursor = 0;		//!< where in voiceList the round robin of occlusion tests is up to
+	ArrayList<voice_t*> traceVoices;
+	ArrayList<Vector> traceDests;
+	ArrayList<bool> traceResults;
+
+	//! streaming thread (refills the streams of voices with a source). The thread only reads slots[].voice and
+	//! the stream and finished fields of those voices, so lock must be held to change them, or to add or remove
+	//! voices. Other voice fields (and looking voices up) belong to the main thread and need no lock
+	std::thread streamThread;
+	std::mutex lock;
+	std::condition_variable streamWake;
+	bool quit = false;
+
+	//! the stream the thread is refilling, outside the lock; virtualize() waits on refilled before deleting it
+	SoundStream* refilling = nullptr;
+	std::condition_variable_any refilled;
+
+	//! @return the mixer clock, in seconds
+	static double now();
+
+	//! give a voice a source and start it where it would be by now
+	void realize(voice_t& voice, double time);
+
+	//! take a voice's source back, leaving it to play silently
+	void virtualize(voice_t& voice);
+
+	//! send a voice's position, gain and filter to its source
+	void push(voice_t& voice);
+
+	//! cast this frame's occlusion tests and ease each voice's low pass towards its result
+	//! @param time the mixer clock
+	void occlude(double time);
+
+	//! free a voice which has stopped
+	void release(voice_t* voice);
+
+	//! streaming thread entry point
+	void runStreams();
 };
 
 extern Cvar cvar_volumeMaster;
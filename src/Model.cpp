@@ -31,10 +31,13 @@ bool Model::dontLoadMesh = false;
 const int Model::maxAnimations = 8;
 const char* Model::defaultMesh = "assets/block/block.FBX";
 
+//! name of the speaker which plays animation sounds
+static const StringID animSpeakerName("animSpeaker");
+
 Model::Model(Entity& _entity, Component* _parent) :
 	Component(_entity, _parent) {
 
-	name = typeStr[COMPONENT_MODEL];
+	setName(typeStr[COMPONENT_MODEL]);
 	meshStr = defaultMesh;
 	loadAnimations();
 
@@ -82,7 +85,7 @@ void Model::process() {
 	Component::process();
 
 	// find speaker
-	Speaker* speaker = findComponentByName<Speaker>("animSpeaker");
+	Speaker* speaker = findComponentByName<Speaker>(animSpeakerName);
 
 	// update animations
 	for (auto& pair : animations) {
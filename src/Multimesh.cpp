@@ -8,7 +8,7 @@
 
 Multimesh::Multimesh(Entity& _entity, Component* _parent) :
 	Component(_entity, _parent) {
-	name = typeStr[COMPONENT_MULTIMESH];
+	setName(typeStr[COMPONENT_MULTIMESH]);
 
 	meshStr = generateGUID();
 
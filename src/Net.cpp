@@ -6,6 +6,10 @@
 #include "Random.hpp"
 #include "Game.hpp"
 #include "Console.hpp"
+#include "Client.hpp"
+#include "Server.hpp"
+
+#include <chrono>
 
 Net::Net(Game& _parent) {
 	parent = &_parent;
@@ -43,48 +47,228 @@ void Net::unlockThread() {
 }
 
 void Net::update() {
+	const Uint32 now = SDL_GetTicks();
 	for (Uint32 remoteIndex = 0; remoteIndex < remotes.getSize(); ++remoteIndex) {
-		remote_t* remote = remotes[remoteIndex];
-
-		for (Uint32 c = 0; c < remote->resendStack.getSize(); ++c) {
-			safepacket_t* safepacket = remote->resendStack[c];
-
-			if (SDL_GetTicks() - safepacket->lastTimeSent >= msBeforeResend) {
-				if (sendPacket(remote->id, safepacket->packet)) {
-					++safepacket->resends;
-					if (safepacket->resends >= maxPacketRetries) {
-						remote->resendStack.remove(c);
-						delete safepacket;
-						--c;
-					} else {
-						safepacket->lastTimeSent = SDL_GetTicks();
-					}
-				}
+		remote_t& remote = *remotes[remoteIndex];
+
+		// resend anything that has waited longer than the timeout, backing off with each retry
+		for (Uint32 seq = remote.sendOldest; seq != remote.sendNext; ++seq) {
+			safepacket_t& safePacket = remote.sendWindow[seq & (safeWindowSize - 1)];
+			if (safePacket.id != seq) {
+				continue;
+			}
+			Uint32 timeout = remote.rto << (safePacket.resends < 2 ? safePacket.resends : 2);
+			if (timeout > msMaxResend) {
+				timeout = msMaxResend;
+			}
+			if (now - safePacket.lastTimeSent < timeout) {
+				continue;
+			}
+			if (safePacket.resends >= maxPacketRetries) {
+				safePacket.id = invalidID;
+				delete safePacket.packet;
+				safePacket.packet = nullptr;
+				++remote.safePacketsLost;
+				continue;
 			}
+			if (transmitSafePacket(remote, safePacket)) {
+				++safePacket.resends;
+				++remote.safePacketsResent;
+			}
+		}
+		while (remote.sendOldest != remote.sendNext && remote.sendWindow[remote.sendOldest & (safeWindowSize - 1)].id != remote.sendOldest) {
+			++remote.sendOldest;
+		}
+
+		// move held back packets into the window
+		while (remote.backlog.getSize() > 0 && remote.sendNext - remote.sendOldest < safeWindowSize) {
+			Node<Packet*>* node = remote.backlog.getFirst();
+			Packet* packet = node->getData();
+			remote.backlog.removeNode(node);
+			sendSafePacket(remote, *packet);
+			delete packet;
+		}
+
+		// one ack covers everything received since the last update
+		if (remote.ackPending) {
+			Packet ack;
+			writeAck(remote, ack, remote.rcvdNewest);
+			ack.write("ACKN");
+			signPacket(ack);
+			sendPacket(remote.id, ack);
+			remote.ackPending = false;
+		}
+		for (auto seq : remote.lateAcks) {
+			Packet ack;
+			writeAck(remote, ack, seq);
+			ack.write("ACKN");
+			signPacket(ack);
+			sendPacket(remote.id, ack);
 		}
+		remote.lateAcks.clear();
 	}
 }
 
-Uint32 Net::getRemoteWithID(const Uint32 remoteID) {
-	for (Uint32 c = 0; c < remotes.getSize(); ++c) {
-		remote_t* remote = remotes[c];
-		if (remote->id == remoteID) {
-			return c;
+bool Net::queueSafePacket(remote_t& remote, const Packet& packet) {
+	if (remote.sendNext - remote.sendOldest >= safeWindowSize || remote.backlog.getSize() > 0) {
+		// too many packets in flight, wait for some acks
+		remote.backlog.addNodeLast(new Packet(packet));
+		return true;
+	}
+	return sendSafePacket(remote, packet);
+}
+
+bool Net::sendSafePacket(remote_t& remote, const Packet& packet) {
+	const Uint32 seq = remote.sendNext++;
+	safepacket_t& safePacket = remote.sendWindow[seq & (safeWindowSize - 1)];
+	if (!safePacket.packet) {
+		safePacket.packet = new Packet();
+	}
+	safePacket.packet->copy(packet);
+	safePacket.id = seq;
+	safePacket.resends = 0;
+	++remote.safePacketsSent;
+	return transmitSafePacket(remote, safePacket);
+}
+
+bool Net::transmitSafePacket(remote_t& remote, safepacket_t& safePacket) {
+	// the header is rebuilt on every send so that it carries the latest ack
+	Packet packet(*safePacket.packet);
+	packet.write32(safePacket.id);
+	if (remote.rcvdAny) {
+		writeAck(remote, packet, remote.rcvdNewest);
+		remote.ackPending = false;
+	}
+	packet.write8(remote.rcvdAny ? 1 : 0);
+	packet.write("SAFE");
+	signPacket(packet);
+
+	safePacket.lastTimeSent = SDL_GetTicks();
+	return sendPacket(remote.id, packet);
+}
+
+void Net::writeAck(remote_t& remote, Packet& packet, Uint32 base) const {
+	Uint64 bits = 0;
+	for (Uint32 c = 0; c < ackBits; ++c) {
+		if (wasReceived(remote, base - 1 - c)) {
+			bits |= (Uint64)1 << c;
 		}
 	}
+	packet.write32((Uint32)(bits & 0xffffffff));
+	packet.write32((Uint32)(bits >> 32));
+	packet.write32(base);
+}
 
-	return UINT32_MAX;
+bool Net::wasReceived(const remote_t& remote, Uint32 seq) {
+	return remote.rcvdAny && remote.rcvdNewest - seq < safeWindowSize && remote.rcvdWindow[seq & (safeWindowSize - 1)] == seq;
 }
 
-Uint32 Net::getRemoteWithID(const Uint32 remoteID) const {
-	for (Uint32 c = 0; c < remotes.getSize(); ++c) {
-		const remote_t* remote = remotes[c];
-		if (remote->id == remoteID) {
-			return c;
+bool Net::receiveSafePacket(remote_t& remote, Packet& packet) {
+	Uint8 hasAck = 0;
+	if (!packet.read8(hasAck)) {
+		return false;
+	}
+	if (hasAck) {
+		receiveAck(remote, packet);
+	}
+	Uint32 seq;
+	if (!packet.read32(seq)) {
+		return false;
+	}
+
+	bool fresh;
+	if (!remote.rcvdAny || (Sint32)(seq - remote.rcvdNewest) > 0) {
+		remote.rcvdNewest = seq;
+		remote.rcvdAny = true;
+		fresh = true;
+	} else if (remote.rcvdNewest - seq >= safeWindowSize) {
+		// the sender never has more than a window in flight, so this was delivered long ago
+		fresh = false;
+	} else {
+		fresh = remote.rcvdWindow[seq & (safeWindowSize - 1)] != seq;
+	}
+	if (fresh) {
+		remote.rcvdWindow[seq & (safeWindowSize - 1)] = seq;
+	}
+
+	// ack even duplicates, since it means our last ack was lost
+	if (remote.rcvdNewest - seq <= ackBits) {
+		remote.ackPending = true;
+	} else {
+		remote.lateAcks.push(seq);
+	}
+
+	return fresh;
+}
+
+void Net::receiveAck(remote_t& remote, Packet& packet) {
+	Uint32 base, bitsLow, bitsHigh;
+	if (!packet.read32(base) || !packet.read32(bitsHigh) || !packet.read32(bitsLow)) {
+		return;
+	}
+	const Uint64 bits = ((Uint64)bitsHigh << 32) | bitsLow;
+
+	ackSafePacket(remote, base);
+	for (Uint32 c = 0; c < ackBits; ++c) {
+		if (bits & ((Uint64)1 << c)) {
+			ackSafePacket(remote, base - 1 - c);
 		}
 	}
+	while (remote.sendOldest != remote.sendNext && remote.sendWindow[remote.sendOldest & (safeWindowSize - 1)].id != remote.sendOldest) {
+		++remote.sendOldest;
+	}
+}
+
+void Net::ackSafePacket(remote_t& remote, Uint32 seq) {
+	if (seq - remote.sendOldest >= remote.sendNext - remote.sendOldest) {
+		// not in flight
+		return;
+	}
+	safepacket_t& safePacket = remote.sendWindow[seq & (safeWindowSize - 1)];
+	if (safePacket.id != seq) {
+		// already acked
+		return;
+	}
+	safePacket.id = invalidID;
+	delete safePacket.packet;
+	safePacket.packet = nullptr;
+
+	// only packets that were sent once give an unambiguous round trip time
+	if (safePacket.resends == 0) {
+		const float rtt = (float)(SDL_GetTicks() - safePacket.lastTimeSent);
+		if (!remote.rttMeasured) {
+			remote.srtt = rtt;
+			remote.rttVar = rtt / 2.f;
+			remote.rttMeasured = true;
+		} else {
+			remote.rttVar = remote.rttVar * .75f + fabs(remote.srtt - rtt) * .25f;
+			remote.srtt = remote.srtt * .875f + rtt * .125f;
+		}
+		Uint32 rto = (Uint32)(remote.srtt + std::max(remote.rttVar * 4.f, 10.f));
+		if (rto < msMinResend) {
+			rto = msMinResend;
+		} else if (rto > msMaxResend) {
+			rto = msMaxResend;
+		}
+		remote.rto = rto;
+	}
+}
+
+void Net::indexRemotes() {
+	remoteIndices.clear();
+	for (Uint32 c = 0; c < remotes.getSize(); ++c) {
+		remoteIndices.insert(remotes[c]->id, c);
+	}
+}
+
+Uint32 Net::getRemoteWithID(const Uint32 remoteID) {
+	const Uint32* index = remoteIndices.find(remoteID);
+	return index ? *index : UINT32_MAX;
+}
 
-	return UINT32_MAX;
+Uint32 Net::getRemoteWithID(const Uint32 remoteID) const {
+	const Uint32* index = remoteIndices.find(remoteID);
+	return index ? *index : UINT32_MAX;
 }
 
 static int console_join(int argc, const char** argv) {
@@ -111,5 +295,73 @@ static int console_say(int argc, const char** argv) {
 	return 0;
 }
 
+static int console_netStats(int argc, const char** argv) {
+	Game* games[2] = { mainEngine->getLocalClient(), mainEngine->getLocalServer() };
+	for (int c = 0; c < 2; ++c) {
+		if (!games[c] || !games[c]->getNet()) {
+			continue;
+		}
+		for (auto remote : games[c]->getNet()->getRemoteHosts()) {
+			Uint32 inFlight = 0;
+			for (Uint32 seq = remote->sendOldest; seq != remote->sendNext; ++seq) {
+				if (remote->sendWindow[seq & (Net::safeWindowSize - 1)].id == seq) {
+					++inFlight;
+				}
+			}
+			mainEngine->fmsg(Engine::MSG_INFO, "%s -> %s (%u): rtt %.1f ms (+/- %.1f), resend after %u ms",
+				c ? "server" : "client", remote->address, remote->id, remote->srtt, remote->rttVar, remote->rto);
+			mainEngine->fmsg(Engine::MSG_INFO, " safe packets: %u sent, %u resent, %u lost, %u in flight, %u held back",
+				remote->safePacketsSent, remote->safePacketsResent, remote->safePacketsLost, inFlight, remote->backlog.getSize());
+		}
+		Net* net = games[c]->getNet();
+		mainEngine->fmsg(Engine::MSG_INFO, "%s total: %llu packets (%llu bytes) sent, %llu packets (%llu bytes) received", c ? "server" : "client",
+			(unsigned long long)net->getPacketsSent(), (unsigned long long)net->getBytesSent(),
+			(unsigned long long)net->getPacketsReceived(), (unsigned long long)net->getBytesReceived());
+	}
+	auto& packets = Packet::getStats();
+	mainEngine->fmsg(Engine::MSG_INFO, "packets: %llu pooled, %llu heap allocated, %u/%u pool buffers in use (peak %u), %llu copies (%llu bytes)",
+		(unsigned long long)packets.pooled, (unsigned long long)packets.allocated, (Uint32)packets.inUse, Packet::poolSize, (Uint32)packets.peakInUse,
+		(unsigned long long)packets.copies, (unsigned long long)packets.bytesCopied);
+	return 0;
+}
+
+static int console_netFlood(int argc, const char** argv) {
+	Server* server = mainEngine->getLocalServer();
+	Client* client = mainEngine->getLocalClient();
+	if (!server || !client || !server->getNet()->isConnected() || !client->getNet()->isConnected() || server->getNet()->getRemoteHosts().getSize() == 0) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "%s needs a local server with the local client connected to it", argv[0]);
+		return 1;
+	}
+	Uint32 numPackets = argc > 1 ? (Uint32)strtol(argv[1], nullptr, 10) : 500;
+	Uint32 numRounds = argc > 2 ? (Uint32)strtol(argv[2], nullptr, 10) : 100;
+
+	auto& stats = Packet::getStats();
+	const Uint64 pooled = stats.pooled, allocated = stats.allocated, copies = stats.copies, bytesCopied = stats.bytesCopied;
+
+	// the server sprays unreliable packets over loopback, the client receives and parses them (and ignores them)
+	auto start = std::chrono::high_resolution_clock::now();
+	for (Uint32 round = 0; round < numRounds; ++round) {
+		for (Uint32 c = 0; c < numPackets; ++c) {
+			Packet packet;
+			packet.write32(c);
+			packet.write32(round);
+			packet.write("FLOD");
+			server->getNet()->signPacket(packet);
+			server->getNet()->broadcast(packet);
+		}
+		client->getNet()->update();
+		client->handleNetMessages();
+	}
+	double time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	time = std::max(time, 0.000001);
+
+	mainEngine->fmsg(Engine::MSG_INFO, "flooded %u packets in %.1f ms (%.0f packets/s)", numPackets * numRounds, time * 1000.0, numPackets * numRounds / time);
+	mainEngine->fmsg(Engine::MSG_INFO, " per second: %.0f pooled packets, %.0f heap allocations, %.0f copies (%.1f KB copied)",
+		(stats.pooled - pooled) / time, (stats.allocated - allocated) / time, (stats.copies - copies) / time, (stats.bytesCopied - bytesCopied) / time / 1024.0);
+	return 0;
+}
+
 static Ccmd ccmd_join("join", "connects to a remote server", &console_join);
-static Ccmd ccmd_say("say", "transmit a chat message to the remote server", &console_say);
\ No newline at end of file
+static Ccmd ccmd_say("say", "transmit a chat message to the remote server", &console_say);
+static Ccmd ccmd_netStats("net.stats", "reports round trip times and safe packet counts for every remote host", &console_netStats);
+static Ccmd ccmd_netFlood("net.flood", "floods the local client with packets from the local server and reports packet allocations and copies per second. ex: net.flood 500 100", &console_netFlood);
\ No newline at end of file
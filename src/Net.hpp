@@ -4,6 +4,8 @@
 
 #include "Main.hpp"
 #include "Packet.hpp"
+#include "LinkedList.hpp"
+#include "Map.hpp"
 
 class Game;
 
@@ -24,8 +26,8 @@ public:
 	//! invalid client id
 	static const Uint32 invalidID = UINT32_MAX;
 
-	//! maximum players
-	static const Uint32 maxPlayers = 4;
+	//! maximum number of remote hosts a server will accept
+	static const Uint32 maxPlayers = 64;
 
 	//! default server port
 	static const Uint16 defaultPort = 12916;
@@ -33,9 +35,20 @@ public:
 	//! max packet send retries
 	static const Uint16 maxPacketRetries = 10;
 
-	//! milliseconds between safe packet retries
+	//! milliseconds before the first resend of a safe packet, until a round trip time has been measured
 	static const Uint32 msBeforeResend = 200;
 
+	//! bounds for the adaptive resend timeout
+	static const Uint32 msMinResend = 50;
+	static const Uint32 msMaxResend = 2000;
+
+	//! number of safe packets that can be waiting for an ack from one host (must be a power of two).
+	//! further safe packets are held back until the window has room
+	static const Uint32 safeWindowSize = 256;
+
+	//! number of earlier packets acknowledged alongside the latest in every ack
+	static const Uint32 ackBits = 64;
+
 	//! network connection type
 	enum kind_t {
 		UNKNOWN,
@@ -46,27 +59,36 @@ public:
 
 	//! safe packet
 	struct safepacket_t {
-		Packet packet;
+		Packet* packet = nullptr;				//! payload, without the reliability header (from the packet pool)
 		Uint32 resends = 0;
 		Uint32 lastTimeSent = 0;
-		Uint32 id = invalidID;
+		Uint32 id = invalidID;					//! sequence number, or invalidID if the slot is free
 	};
 
 	//! remote host
 	struct remote_t {
+		remote_t() {
+			for (Uint32 c = 0; c < safeWindowSize; ++c) {
+				rcvdWindow[c] = invalidID;
+			}
+		}
+
 		virtual ~remote_t() {
 			while (packetStack.getSize() > 0) {
 				Packet* packet = packetStack.pop();
 				delete packet;
 			}
-			while (resendStack.getSize() > 0) {
-				safepacket_t* safePacket = resendStack.pop();
-				delete safePacket;
+			for (Uint32 c = 0; c < safeWindowSize; ++c) {
+				delete sendWindow[c].packet;
+			}
+			while (backlog.getSize() > 0) {
+				delete backlog.getFirst()->getData();
+				backlog.removeNode(backlog.getFirst());
 			}
+			delete[] sendWindow;
 		}
 
 		ArrayList<Packet*> packetStack;			//! packets received from the host
-		ArrayList<Uint32> safeRcvdHash[128];	//! hash list of safe packets received
 
 		char address[256] = { 0 };				//! address (hostname or ip address)
 		Uint16 port = 0;						//! port number
@@ -75,8 +97,28 @@ public:
 		Uint32 gid = invalidID;					//! client's generated id
 		Uint32 timestamp = 0;					//! the latest timestamp from this host; earlier packets might not be read
 
+		// sending safe packets
+		safepacket_t* sendWindow = new safepacket_t[safeWindowSize];	//! packets waiting for an ack, by sequence number
+		Uint32 sendNext = 0;					//! sequence number of the next safe packet
+		Uint32 sendOldest = 0;					//! oldest sequence number that may still be waiting for an ack
+		LinkedList<Packet*> backlog;			//! safe packets waiting for room in the window
+
+		// receiving safe packets
+		Uint32 rcvdWindow[safeWindowSize];		//! sequence numbers received recently, by sequence number
+		Uint32 rcvdNewest = 0;					//! newest sequence number received
+		bool rcvdAny = false;					//! false until the first safe packet arrives
+		bool ackPending = false;				//! true if received packets need acking at the next update
+		ArrayList<Uint32> lateAcks;				//! packets too far behind the newest to be covered by a regular ack
+
+		// round trip estimate
+		float srtt = 0.f;						//! smoothed round trip time (ms)
+		float rttVar = 0.f;						//! round trip time variation (ms)
+		bool rttMeasured = false;
+		Uint32 rto = msBeforeResend;			//! current resend timeout (ms)
+
 		Uint32 safePacketsSent = 0;				//! total number of safe packets sent TO this host
-		ArrayList<safepacket_t*> resendStack;	//! list of packets due for resend
+		Uint32 safePacketsResent = 0;			//! total number of resends TO this host
+		Uint32 safePacketsLost = 0;				//! safe packets which ran out of retries
 	};
 
 	//! connection request
@@ -180,6 +222,10 @@ public:
 	Uint32			        	getLocalID() const { return localID; }
 	Uint32		        		getLocalGID() const { return localGID; }
 	ArrayList<remote_t*>&		getRemoteHosts() { return remotes; }
+	Uint64						getPacketsSent() const { return packetsSent; }
+	Uint64						getBytesSent() const { return bytesSent; }
+	Uint64						getPacketsReceived() const { return packetsReceived; }
+	Uint64						getBytesReceived() const { return bytesReceived; }
 
 	void					setParent(Game* _parent) { parent = _parent; }
 
@@ -194,6 +240,16 @@ protected:
 	Uint32 numClients = 0;			//! increments by 1 with each connection
 
 	ArrayList<remote_t*> remotes;
+	Map<Uint32, Uint32> remoteIndices;	//! index into remotes, by remote id
+
+	//! traffic counters (maintained by the implementation)
+	Uint64 packetsSent = 0;
+	Uint64 bytesSent = 0;
+	Uint64 packetsReceived = 0;
+	Uint64 bytesReceived = 0;
+
+	//! rebuild the remote id lookup; call whenever remotes is changed
+	void indexRemotes();
 
 	//! completes a connection to a host
 	//! @param data the request data
@@ -213,8 +269,41 @@ protected:
 	//! @return an index to the remote host, or UINT32_MAX if they could not be found
 	Uint32 getRemoteWithID(const Uint32 remoteID);
 
+	//! queue a safe packet for a remote host, sending it right away if the window has room
+	//! @param remote the host to send to
+	//! @param packet the packet to send
+	//! @return false if the first send failed
+	bool queueSafePacket(remote_t& remote, const Packet& packet);
+
+	//! read the reliability header from a "SAFE" packet
+	//! @param remote the host that sent the packet
+	//! @param packet the packet, with the type already read
+	//! @return true if the packet is new and should be handled, false if it is a duplicate
+	bool receiveSafePacket(remote_t& remote, Packet& packet);
+
+	//! read an "ACKN" packet
+	//! @param remote the host that sent the packet
+	//! @param packet the packet, with the type already read
+	void receiveAck(remote_t& remote, Packet& packet);
+
 	//! gets the remote host with the given id
 	//! @param remoteID the id of the remote host to get
 	//! @return an index to the remote host, or UINT32_MAX if they could not be found
 	Uint32 getRemoteWithID(const Uint32 remoteID) const;
+
+private:
+	//! put a safe packet in the window and send it (the window must have room)
+	bool sendSafePacket(remote_t& remote, const Packet& packet);
+
+	//! send a packet from the window with an up-to-date reliability header
+	bool transmitSafePacket(remote_t& remote, safepacket_t& safePacket);
+
+	//! append the latest ack for a remote host to a packet
+	void writeAck(remote_t& remote, Packet& packet, Uint32 base) const;
+
+	//! mark a single sequence number as acknowledged
+	void ackSafePacket(remote_t& remote, Uint32 seq);
+
+	//! @return true if the given sequence number is in the receive window
+	static bool wasReceived(const remote_t& remote, Uint32 seq);
 };
@@ -88,6 +88,7 @@ bool NetSDL::connect(const char* address, Uint16 port) {
 	SDLremotes.push(remote);
 	remotes.push(remote);
 	remote->parent = this;
+	indexRemotes();
 
 	if (SDLNet_ResolveHost(&remote->host, address, port) == -1) {
 		mainEngine->fmsg(Engine::MSG_ERROR, "resolving host at %s:%d has failed:\n %s", address, port, SDLNet_GetError());
@@ -149,6 +150,23 @@ void NetSDL::completeConnection(void* data) {
 
 	const char* address = SDLNet_ResolveIP(&request->ip);
 
+	if (SDLremotes.getSize() >= maxPlayers) {
+		mainEngine->fmsg(Engine::MSG_WARN, "refused connection from %s:%d, server is full (%u players)", address ? address : "unknown", request->ip.port, maxPlayers);
+
+		// tell them to go away. they address us as remote 0
+		Packet packet;
+		packet.write("QUIT");
+		signPacket(packet);
+		Uint8* sendData = SDLsendPacket->data;
+		SDLsendPacket->channel = -1;
+		SDLsendPacket->data = (Uint8*)packet.data;
+		SDLsendPacket->len = (int)packet.offset;
+		SDLsendPacket->address = request->ip;
+		SDLNet_UDP_Send(SDLsocket, -1, SDLsendPacket);
+		SDLsendPacket->data = sendData;
+		return;
+	}
+
 	sdlremote_t* remote = new sdlremote_t();
 	strcpy(remote->address, address);
 	remote->host = request->ip;
@@ -157,6 +175,7 @@ void NetSDL::completeConnection(void* data) {
 	SDLremotes.push(remote);
 	remotes.push(remote);
 	remote->parent = this;
+	indexRemotes();
 
 	Uint32 clientID = numClients;
 	remote->id = clientID;
@@ -291,12 +310,18 @@ bool NetSDL::sendPacket(Uint32 remoteID, const Packet& packet) {
 
 	const sdlremote_t* remote = SDLremotes[index];
 
+	// send straight out of the packet's buffer
+	Uint8* sendData = SDLsendPacket->data;
 	SDLsendPacket->channel = -1;
-	SDLsendPacket->len = min((int)packet.offset, SDLsendPacket->maxlen);
+	SDLsendPacket->data = (Uint8*)packet.data;
+	SDLsendPacket->len = min((int)packet.offset, (int)Packet::maxLen);
 	SDLsendPacket->address = remote->host;
-	memcpy(SDLsendPacket->data, packet.data, packet.offset);
+	int sent = SDLNet_UDP_Send(SDLsocket, -1, SDLsendPacket);
+	SDLsendPacket->data = sendData;
+	++packetsSent;
+	bytesSent += SDLsendPacket->len;
 
-	if (SDLNet_UDP_Send(SDLsocket, -1, SDLsendPacket) != 0) {
+	if (sent != 0) {
 		return true;
 	} else {
 		mainEngine->fmsg(Engine::MSG_WARN, "failed to send SDL_Net UDP packet:\n %s", SDLNet_GetError());
@@ -317,24 +342,7 @@ bool NetSDL::sendPacketSafe(Uint32 remoteID, const Packet& packet) {
 	}
 
 	sdlremote_t* remote = SDLremotes[index];
-
-	safepacket_t* safePacket = new safepacket_t();
-
-	safePacket->id = remote->safePacketsSent;
-	safePacket->lastTimeSent = SDL_GetTicks();
-	safePacket->packet.copy(packet);
-
-	safePacket->packet.write32(safePacket->id);
-	safePacket->packet.write("SAFE");
-	signPacket(safePacket->packet);
-
-	if (sendPacket(remoteID, safePacket->packet)) {
-		remote->resendStack.push(safePacket);
-		++remote->safePacketsSent;
-		return true;
-	} else {
-		return false;
-	}
+	return queueSafePacket(*remote, packet);
 }
 
 bool NetSDL::broadcast(Packet& packet) {
@@ -426,13 +434,23 @@ int NetSDL::runThread(void* data) {
 				Uint32 remoteIndex = UINT32_MAX;
 				Packet* packet = new Packet();
 
+				// receive straight into the pooled packet
+				Uint8* recvData = net->SDLrecvPacket->data;
+				int recvMaxLen = net->SDLrecvPacket->maxlen;
+				net->SDLrecvPacket->data = (Uint8*)packet->data;
+				net->SDLrecvPacket->maxlen = Packet::maxLen;
 				net->SDLrecvPacket->channel = -1;
-				if ((result = SDLNet_UDP_Recv(net->SDLsocket, net->SDLrecvPacket)) == -1) {
+				result = SDLNet_UDP_Recv(net->SDLsocket, net->SDLrecvPacket);
+				net->SDLrecvPacket->data = recvData;
+				net->SDLrecvPacket->maxlen = recvMaxLen;
+
+				if (result == -1) {
 					mainEngine->fmsg(Engine::MSG_WARN, "failed to recv SDL_Net UDP packet:\n %s", SDLNet_GetError());
 				} else if (result == 1) {
-					memcpy(packet->data, net->SDLrecvPacket->data, net->SDLrecvPacket->len);
 					packet->offset = net->SDLrecvPacket->len;
-					Packet readPacket(*packet);
+					++net->packetsReceived;
+					net->bytesReceived += net->SDLrecvPacket->len;
+					Packet& readPacket = *packet;
 
 					Uint32 id;
 					Uint32 timestamp;
@@ -467,6 +485,8 @@ int NetSDL::runThread(void* data) {
 								mainEngine->fmsg(Engine::MSG_DEBUG, "message received from client with bad id (%d)", id);
 							}
 						} else {
+							// put back the header we peeked at
+							packet->offset = net->SDLrecvPacket->len;
 							sdlremote_t* remote = net->SDLremotes[remoteIndex];
 							remote->packetStack.push(packet);
 						}
@@ -526,41 +546,18 @@ int NetSDL::handleNetworkPacket(Packet& packet, const char* type, Uint32 remoteI
 		return 2;
 	}
 
-	// safe message -- queue and respond with ack
+	// safe message -- queue and ack at the next update
 	else if (strncmp(type, "SAFE", 4) == 0) {
 		Uint32 remoteIndex = getRemoteWithID(remoteID);
 		if (remoteIndex == UINT32_MAX) {
 			mainEngine->fmsg(Engine::MSG_DEBUG, "message received from client with bad id (%d)", remoteID);
 		} else {
-			Uint32 packetID;
-			packet.read32(packetID); // get the packet id
-
 			sdlremote_t* remote = SDLremotes[remoteIndex];
-			Uint32 hashIndex = packetID % 128;
-
-			bool foundPacket = false;
-			for (Uint32 c = 0; c < remote->safeRcvdHash[hashIndex].getSize(); ++c) {
-				Uint32 id = remote->safeRcvdHash[hashIndex][c];
-
-				if (id == packetID) {
-					foundPacket = true;
-					break;
-				}
-			}
-
-			if (!foundPacket) {
+			if (receiveSafePacket(*remote, packet)) {
 				// put the packet back onto the stack
 				Packet* newPacket = new Packet(packet);
 				remote->packetStack.push(newPacket);
-				remote->safeRcvdHash[hashIndex].push(packetID);
 			}
-
-			// now ack
-			Packet ack;
-			ack.write32(packetID);
-			ack.write("ACKN");
-			signPacket(ack);
-			sendPacket(remoteID, ack);
 		}
 
 		return 3;
@@ -569,20 +566,8 @@ int NetSDL::handleNetworkPacket(Packet& packet, const char* type, Uint32 remoteI
 	// safe message -- ack
 	else if (strncmp(type, "ACKN", 4) == 0) {
 		Uint32 remoteIndex = getRemoteWithID(remoteID);
-
-		Uint32 packetID;
-		if (packet.read32(packetID)) {
-			sdlremote_t* remote = SDLremotes[remoteIndex];
-
-			for (Uint32 c = 0; c < remote->resendStack.getSize(); ++c) {
-				safepacket_t* safePacket = remote->resendStack[c];
-
-				if (safePacket->id == packetID) {
-					remote->resendStack.remove(c);
-					delete safePacket;
-					break;
-				}
-			}
+		if (remoteIndex != UINT32_MAX) {
+			receiveAck(*SDLremotes[remoteIndex], packet);
 		}
 
 		return 4;
@@ -31,6 +31,7 @@ public:
 					break;
 				}
 			}
+			parent->indexRemotes();
 		}
 	};
 
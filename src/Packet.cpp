@@ -3,29 +3,91 @@
 #include "Main.hpp"
 #include "Engine.hpp"
 #include "Packet.hpp"
+#include "ArrayList.hpp"
 
-void Packet::clear() {
-	for (Uint32 c = 0; c < maxLen; ++c) {
-		data[c] = 0;
+#include <mutex>
+
+static Packet::stats_t packetStats;
+
+// a fixed block of packet-sized buffers with a free list, created the first time a packet is allocated
+class PacketPool {
+public:
+	PacketPool() {
+		buffers = (Uint8*)::operator new(blockSize * Packet::poolSize);
+		free.resize(Packet::poolSize);
+		for (Uint32 c = 0; c < Packet::poolSize; ++c) {
+			free[c] = Packet::poolSize - 1 - c;
+		}
 	}
-	offset = 0;
+
+	void* acquire() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (free.getSize() > 0) {
+				Uint32 index = free.pop();
+				Uint32 inUse = ++packetStats.inUse;
+				if (inUse > packetStats.peakInUse) {
+					packetStats.peakInUse = inUse;
+				}
+				++packetStats.pooled;
+				return buffers + index * blockSize;
+			}
+		}
+		++packetStats.allocated;
+		return ::operator new(blockSize);
+	}
+
+	void release(void* ptr) {
+		Uint8* block = (Uint8*)ptr;
+		if (block >= buffers && block < buffers + blockSize * Packet::poolSize) {
+			std::lock_guard<std::mutex> lock(mutex);
+			free.push((Uint32)((block - buffers) / blockSize));
+			--packetStats.inUse;
+		} else {
+			::operator delete(ptr);
+		}
+	}
+
+private:
+	static const size_t blockSize = sizeof(Packet);
+	Uint8* buffers = nullptr;
+	ArrayList<Uint32> free;
+	std::mutex mutex;
+};
+
+// never destroyed, since packets may still be freed during static destruction
+static PacketPool& getPacketPool() {
+	static PacketPool* pool = new PacketPool();
+	return *pool;
 }
 
-void Packet::copy(const Packet& src) {
-	offset = src.offset;
-	memcpy(data, src.data, offset);
+void* Packet::operator new(size_t size) {
+	assert(size == sizeof(Packet));
+	return getPacketPool().acquire();
 }
 
-bool Packet::write8(Uint8 value) {
-	return write((char*)(&value), 1);
+void Packet::operator delete(void* ptr) {
+	if (ptr) {
+		getPacketPool().release(ptr);
+	}
 }
 
-bool Packet::write16(Uint16 value) {
-	return write((char*)(&value), 2);
+const Packet::stats_t& Packet::getStats() {
+	return packetStats;
 }
 
-bool Packet::write32(Uint32 value) {
-	return write((char*)(&value), 4);
+void Packet::clear() {
+	offset = 0;
+}
+
+void Packet::copy(const Packet& src) {
+	if (&src == this) {
+		return;
+	}
+	offset = src.offset;
+	memcpy(data, src.data, offset);
+	++packetStats.copies;
+	packetStats.bytesCopied += offset;
 }
 
 bool Packet::write(const char* _data, unsigned int len) {
@@ -34,13 +96,11 @@ bool Packet::write(const char* _data, unsigned int len) {
 	}
 
 	if (offset + len > maxLen) {
-		mainEngine->fmsg(Engine::MSG_ERROR, "failed to write %d bytes to packet; packet is full!");
+		mainEngine->fmsg(Engine::MSG_ERROR, "failed to write %u bytes to packet; packet is full!", len);
 		return false;
 	}
 
-	for (unsigned int c = 0; c < len; ++c) {
-		data[offset + c] = _data[c];
-	}
+	memcpy(data + offset, _data, len);
 	offset += len;
 
 	return true;
@@ -58,20 +118,8 @@ bool Packet::sign(Uint32 timestamp, Uint32 id) {
 	return true;
 }
 
-bool Packet::read8(Uint8& data) {
-	return read((char*)(&data), 1);
-}
-
-bool Packet::read16(Uint16& data) {
-	return read((char*)(&data), 2);
-}
-
-bool Packet::read32(Uint32& data) {
-	return read((char*)(&data), 4);
-}
-
 bool Packet::read(char* _data, unsigned int len) {
-	if (len <= 0) {
+	if (len == 0) {
 		return false;
 	}
 	if (_data == nullptr) {
@@ -81,11 +129,8 @@ bool Packet::read(char* _data, unsigned int len) {
 		return false;
 	}
 
-	unsigned int _offset = (unsigned int)offset - len;
-	for (unsigned int c = 0; c < len; ++c) {
-		_data[c] = data[_offset + c];
-	}
 	offset -= len;
+	memcpy(_data, data + offset, len);
 
 	return true;
 }
\ No newline at end of file
@@ -4,7 +4,11 @@
 
 #include "Main.hpp"
 
+#include <atomic>
+
 //! A Packet is essentially a data buffer designed to be sent over the net.
+//! Packets created with new are drawn from a fixed pool of buffers, so the net layer can hand them around by pointer without touching the heap.
+//! Copying a packet only copies the bytes that have been written.
 class Packet {
 public:
 	Packet() = default;
@@ -21,9 +25,31 @@ public:
 
 	Packet& operator=(Packet&&) = delete;
 
+	//! take a buffer from the packet pool, falling back on the heap if the pool is empty
+	static void* operator new(size_t size);
+
+	//! return a buffer to the packet pool
+	static void operator delete(void* ptr);
+
 	//! max size of the data buffer
 	static const Uint32 maxLen = 1024;
 
+	//! number of buffers in the packet pool
+	static const Uint32 poolSize = 2048;
+
+	//! packet traffic counters
+	struct stats_t {
+		std::atomic<Uint64> pooled{ 0 };		//!< packets taken from the pool
+		std::atomic<Uint64> allocated{ 0 };		//!< packets allocated on the heap because the pool was empty
+		std::atomic<Uint64> copies{ 0 };		//!< packet copies
+		std::atomic<Uint64> bytesCopied{ 0 };	//!< bytes copied by those copies
+		std::atomic<Uint32> inUse{ 0 };			//!< pool buffers currently in use
+		std::atomic<Uint32> peakInUse{ 0 };		//!< most pool buffers ever in use at once
+	};
+
+	//! @return packet traffic counters
+	static const stats_t& getStats();
+
 	//! clears the contents of the packet buffer
 	void clear();
 
@@ -38,17 +64,17 @@ public:
 	//! writes 8 bits to the packet buffer
 	//! @param value the value to write to the buffer
 	//! @return true if the write succeeded, false if it failed (eg the packet buffer is full)
-	bool write8(Uint8 value);
+	bool write8(Uint8 value) { return writeValue(value); }
 
 	//! writes 16 bits to the packet buffer
 	//! @param value the value to write to the buffer
 	//! @return true if the write succeeded, false if it failed (eg the packet buffer is full)
-	bool write16(Uint16 value);
+	bool write16(Uint16 value) { return writeValue(value); }
 
 	//! writes 32 bits to the packet buffer
 	//! @param value the value to write to the buffer
 	//! @return true if the write succeeded, false if it failed (eg the packet buffer is full)
-	bool write32(Uint32 value);
+	bool write32(Uint32 value) { return writeValue(value); }
 
 	//! writes the specified number of bytes from the data buffer into the packet buffer
 	//! @param data the data to write to the buffer
@@ -64,17 +90,17 @@ public:
 	//! reads 8 bits from the packet buffer
 	//! @param data the data buffer to fill with the read data
 	//! @return true if the read succeeded, or false if it failed
-	bool read8(Uint8& data);
+	bool read8(Uint8& data) { return readValue(data); }
 
 	//! reads 16 bits from the packet buffer
 	//! @param data the data buffer to fill with the read data
 	//! @return true if the read succeeded, or false if it failed
-	bool read16(Uint16& data);
+	bool read16(Uint16& data) { return readValue(data); }
 
 	//! reads 32 bits from the packet buffer
 	//! @param data the data buffer to fill with the read data
 	//! @return true if the read succeeded, or false if it failed
-	bool read32(Uint32& data);
+	bool read32(Uint32& data) { return readValue(data); }
 
 	//! reads the specified number of bytes from the data buffer into the packet buffer
 	//! @param data the data buffer to copy the data to
@@ -82,6 +108,33 @@ public:
 	//! @return true if the read succeeded, false if it failed
 	bool read(char* data, unsigned int len);
 
-	char data[maxLen] = { 0 };
+	//! writes a plain value to the packet buffer
+	//! @param value the value to write to the buffer
+	//! @return true if the write succeeded, false if it failed (eg the packet buffer is full)
+	template <typename T>
+	bool writeValue(const T& value) {
+		if (offset + sizeof(T) > maxLen) {
+			return write((const char*)&value, sizeof(T));
+		}
+		memcpy(data + offset, &value, sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+
+	//! reads a plain value from the packet buffer
+	//! @param value the value to fill with the read data
+	//! @return true if the read succeeded, or false if it failed
+	template <typename T>
+	bool readValue(T& value) {
+		if (offset < sizeof(T)) {
+			return false;
+		}
+		offset -= sizeof(T);
+		memcpy(&value, data + offset, sizeof(T));
+		return true;
+	}
+
+	// only the first offset bytes are ever read, so the buffer is left uninitialized
+	char data[maxLen];
 	Uint32 offset = 0;
 };
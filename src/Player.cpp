@@ -40,6 +40,26 @@ static Cvar cvar_defaultController("player.default.enabled", "enable built-in fi
 Cvar cvar_fov("player.fov", "field of view", "70.0");
 Cvar cvar_mouselook("player.mouselook.playernum", "assigns mouse control to the given player", "0");
 
+// input bindings polled every frame, resolved to handles once
+static const Input::handle_t inputMoveUp = Input::handleFor("MoveUp");
+static const Input::handle_t inputMoveDown = Input::handleFor("MoveDown");
+static const Input::handle_t inputMoveLeft = Input::handleFor("MoveLeft");
+static const Input::handle_t inputMoveRight = Input::handleFor("MoveRight");
+static const Input::handle_t inputMoveForward = Input::handleFor("MoveForward");
+static const Input::handle_t inputMoveBackward = Input::handleFor("MoveBackward");
+static const Input::handle_t inputLean = Input::handleFor("Lean");
+static const Input::handle_t inputLeanLeft = Input::handleFor("LeanLeft");
+static const Input::handle_t inputLeanRight = Input::handleFor("LeanRight");
+static const Input::handle_t inputLookLeft = Input::handleFor("LookLeft");
+static const Input::handle_t inputLookRight = Input::handleFor("LookRight");
+static const Input::handle_t inputLookUp = Input::handleFor("LookUp");
+static const Input::handle_t inputLookDown = Input::handleFor("LookDown");
+static const Input::handle_t inputInteract = Input::handleFor("Interact");
+static const Input::handle_t inputStatus = Input::handleFor("Status");
+static const Input::handle_t inputHandLeft = Input::handleFor("HandLeft");
+static const Input::handle_t inputHandRight = Input::handleFor("HandRight");
+static const Input::handle_t inputInventory1 = Input::handleFor("Inventory1");
+
 Player::Player() {
 	Random& rand = mainEngine->getRandom();
 
@@ -365,23 +385,23 @@ void Player::control() {
 	buttonJump = false;
 	buttonCrouch = cvar_canCrouch.toInt() ? nearestCeiling <= totalHeight && !entity->isFalling() : false;
 	if (!client->isConsoleActive()) {
-		buttonCrouch |= input.binary("MoveDown");
+		buttonCrouch |= input.binary(inputMoveDown);
 
-		if (input.binary("MoveUp") && !jumped) {
+		if (input.binary(inputMoveUp) && !jumped) {
 			if (nearestCeiling > totalHeight && !buttonCrouch) {
 				buttonJump = true;
 			}
-		} else if (!input.binary("MoveUp") && jumped) {
+		} else if (!input.binary(inputMoveUp) && jumped) {
 			jumped = false;
 		}
 
-		if (!input.binary("Lean")) {
-			buttonRight = input.analog("MoveRight");
-			buttonLeft = input.analog("MoveLeft");
-			buttonForward = input.analog("MoveForward");
-			buttonBackward = input.analog("MoveBackward");
-			buttonLeanLeft = input.analog("LeanLeft");
-			buttonLeanRight = input.analog("LeanRight");
+		if (!input.binary(inputLean)) {
+			buttonRight = input.analog(inputMoveRight);
+			buttonLeft = input.analog(inputMoveLeft);
+			buttonForward = input.analog(inputMoveForward);
+			buttonBackward = input.analog(inputMoveBackward);
+			buttonLeanLeft = input.analog(inputLeanLeft);
+			buttonLeanRight = input.analog(inputLeanRight);
 
 			// restrict inputs to circle
 			float dir = atan2f(buttonForward - buttonBackward, buttonRight - buttonLeft);
@@ -392,8 +412,8 @@ void Player::control() {
 			buttonForward = min(sinDir, buttonForward);
 			buttonBackward = min(sinDir, buttonBackward);
 		} else {
-			buttonLeanLeft = input.analog("MoveLeft");
-			buttonLeanRight = input.analog("MoveRight");
+			buttonLeanLeft = input.analog(inputMoveLeft);
+			buttonLeanRight = input.analog(inputMoveRight);
 		}
 	}
 	if (buttonRight || buttonLeft || buttonForward || buttonBackward) {
@@ -502,8 +522,8 @@ void Player::control() {
 		}
 
 		// normal input looking
-		rot.yaw += ((input.analog("LookRight") - input.analog("LookLeft")) * PI) * timeFactor;
-		rot.pitch += ((input.analog("LookDown") - input.analog("LookUp")) * PI) * timeFactor * (cvar_zeroGravity.toInt() ? -1.f : 1.f);
+		rot.yaw += ((input.analog(inputLookRight) - input.analog(inputLookLeft)) * PI) * timeFactor;
+		rot.pitch += ((input.analog(inputLookDown) - input.analog(inputLookUp)) * PI) * timeFactor * (cvar_zeroGravity.toInt() ? -1.f : 1.f);
 	}
 
 	// rolling in zero-gravity
@@ -632,14 +652,14 @@ void Player::control() {
 		World* world = entity->getWorld();
 		if (camera && world)
 		{
-			if (input.binaryToggle("Interact")) {
+			if (input.binaryToggle(inputInteract)) {
 				if (holdingInteract)
 				{
 					// 60hz
 					interactHoldTime += timeFactor;
 				}
 				holdingInteract = true;
-				input.consumeBinaryToggle("Interact");
+				input.consumeBinaryToggle(inputInteract);
 				Vector start = camera->getGlobalPos();
 				Vector dest = start + camera->getGlobalAng().toVector() * 128;
 				World::hit_t hit = entity->lineTrace(start, dest);
@@ -679,15 +699,15 @@ void Player::control() {
 		}
 
 		// Toggling inventory
-		if (input.binaryToggle("Status"))
+		if (input.binaryToggle(inputStatus))
 		{
-			input.consumeBinaryToggle("Status");
+			input.consumeBinaryToggle(inputStatus);
 			entity->setInventoryVisibility(!inventoryVisible);
 			inventoryVisible = !inventoryVisible;
 		}
 
 		// using hand items (shooting)
-		if (lTool && input.binaryToggle("HandLeft")) {
+		if (lTool && input.binaryToggle(inputHandLeft)) {
 			Uint32 bone = lTool->findBoneIndex("emitter");
 			glm::mat4 mat = lTool->getGlobalMat();
 			if (bone != UINT32_MAX) {
@@ -696,7 +716,7 @@ void Player::control() {
 			auto red = WideVector(1.f, 0.f, 0.f, 1.f);
 			lTool->shootLaser(mat, red, 8.f, 1.f);
 		}
-		if (rTool && input.binaryToggle("HandRight")) {
+		if (rTool && input.binaryToggle(inputHandRight)) {
 			Uint32 bone = rTool->findBoneIndex("emitter");
 			glm::mat4 mat = rTool->getGlobalMat();
 			if (bone != UINT32_MAX) {
@@ -705,14 +725,14 @@ void Player::control() {
 			auto red = WideVector(1.f, 0.f, 0.f, 1.f);
 			rTool->shootLaser(mat, red, 8.f, 1.f);
 		}
-		input.consumeBinaryToggle("HandLeft");
-		input.consumeBinaryToggle("HandRight");
+		input.consumeBinaryToggle(inputHandLeft);
+		input.consumeBinaryToggle(inputHandRight);
 
 		// lamp
-		if (lamp && input.binaryToggle("Inventory1")) {
+		if (lamp && input.binaryToggle(inputInventory1)) {
 			lamp->setIntensity(lamp->getIntensity() == 0.f ? 1.f : 0.f);
 		}
-		input.consumeBinaryToggle("Inventory1");
+		input.consumeBinaryToggle(inputInventory1);
 	}
 }
 
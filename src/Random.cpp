@@ -2,49 +2,77 @@
 
 #include "Main.hpp"
 #include "Engine.hpp"
+#include "Console.hpp"
 #include "Random.hpp"
 
+#include <chrono>
+#include <atomic>
+
 Random::Random() {
 	seedTime();
 }
 
+Uint64 Random::splitMix64(Uint64& x) {
+	Uint64 z = (x += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
 void Random::seedBytes(const Uint8* seed, Uint32 size) {
 	if (!seed || !size)
 		return;
 
-	Sint32 i, j;
-
-	for (i = 0; i < 256; ++i)
-		s[i] = i;
-
-	for (i = j = 0; i < 256; ++i) {
-		j = (j + s[i] + getByte(seed, size, i)) & 255;
-		swapByte(s + i, s + j);
+	// fold the seed bytes into a 64-bit value (FNV-1a), then expand with splitmix64
+	Uint64 x = 0xCBF29CE484222325ULL;
+	for (Uint32 c = 0; c < size; ++c) {
+		x ^= seed[c];
+		x *= 0x100000001B3ULL;
 	}
-
-	s_i = s_j = 0;
+	seedValue64(x);
 }
 
 void Random::seedTime() {
-	static time_t t;
-	if (t == 0) {
-		t = time(nullptr);
-	} else {
-		++t;
-	}
-	seedBytes((const Uint8*)&t, sizeof(time_t));
+	// each generator seeded this way gets a unique seed, even if created in the same tick
+	static std::atomic<Uint64> counter(0);
+	Uint64 t = (Uint64)std::chrono::high_resolution_clock::now().time_since_epoch().count();
+	t ^= (Uint64)time(nullptr) << 32;
+	t += counter.fetch_add(1) * 0x9E3779B97F4A7C15ULL;
+	seedValue64(t);
 }
 
 void Random::seedValue(Uint32 seed) {
-	seedBytes((const Uint8*)&seed, sizeof(Uint32));
+	seedValue64((Uint64)seed);
 }
 
-Uint8 Random::getUint8() {
-	s_i = (s_i + 1) & 255;
-	s_j = (s_j + s[s_i]) & 255;
-	swapByte(s + s_i, s + s_j);
+void Random::seedValue64(Uint64 seed) {
+	Uint64 x = seed;
+	for (int c = 0; c < 4; ++c) {
+		s[c] = splitMix64(x);
+	}
+}
+
+static inline Uint64 rotl(const Uint64 x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+inline Uint64 Random::next() {
+	const Uint64 result = rotl(s[1] * 5, 7) * 9;
+	const Uint64 t = s[1] << 17;
 
-	return s[(s[s_i] + s[s_j]) & 255];
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+
+	return result;
+}
+
+Uint8 Random::getUint8() {
+	return (Uint8)(next() >> 56);
 }
 
 Sint8 Random::getSint8() {
@@ -52,46 +80,57 @@ Sint8 Random::getSint8() {
 }
 
 Uint16 Random::getUint16() {
-	Uint16 value;
-	getBytes((Uint8*)&value, sizeof(Uint16));
-	return value;
+	return (Uint16)(next() >> 48);
 }
 
 Sint16 Random::getSint16() {
-	Sint16 value;
-	getBytes((Uint8*)&value, sizeof(Sint16));
-	return value & INT16_MAX;
+	return getUint16() & INT16_MAX;
 }
 
 Uint32 Random::getUint32() {
-	Uint32 value;
-	getBytes((Uint8*)&value, sizeof(Uint32));
-	return value;
+	return (Uint32)(next() >> 32);
 }
 
 Sint32 Random::getSint32() {
-	Sint32 value;
-	getBytes((Uint8*)&value, sizeof(Sint32));
-	return value & INT16_MAX;
+	return getUint32() & INT16_MAX;
 }
 
 Uint64 Random::getUint64() {
-	Uint64 value;
-	getBytes((Uint8*)&value, sizeof(Uint64));
-	return value;
+	return next();
 }
 
 Sint64 Random::getSint64() {
-	Sint64 value;
-	getBytes((Uint8*)&value, sizeof(Sint64));
-	return value & INT16_MAX;
+	return getUint64() & INT16_MAX;
 }
 
 void Random::getBytes(Uint8* buffer, Uint32 size) {
-	while (size > 0) {
-		*buffer = getUint8();
-		++buffer;
-		--size;
+	while (size >= sizeof(Uint64)) {
+		Uint64 value = next();
+		memcpy(buffer, &value, sizeof(Uint64));
+		buffer += sizeof(Uint64);
+		size -= sizeof(Uint64);
+	}
+	if (size > 0) {
+		Uint64 value = next();
+		memcpy(buffer, &value, size);
+	}
+}
+
+void Random::fillUint32(Uint32* buffer, Uint32 count) {
+	Uint32 c = 0;
+	for (; c + 1 < count; c += 2) {
+		Uint64 value = next();
+		buffer[c] = (Uint32)(value >> 32);
+		buffer[c + 1] = (Uint32)value;
+	}
+	if (c < count) {
+		buffer[c] = getUint32();
+	}
+}
+
+void Random::fillFloat(float* buffer, Uint32 count) {
+	for (Uint32 c = 0; c < count; ++c) {
+		buffer[c] = getFloat();
 	}
 }
 
@@ -100,15 +139,165 @@ double Random::getDouble() {
 }
 
 float Random::getFloat() {
-	return getUint32() / (float)(UINT32_MAX);
+	// 24 bits is all the mantissa can hold, so this is exact and includes 1.0
+	return (next() >> 40) / (float)((1 << 24) - 1);
+}
+
+float Random::getFloatRange(float min, float max) {
+	return min + (max - min) * getFloat();
+}
+
+double Random::getDoubleRange(double min, double max) {
+	return min + (max - min) * getDouble();
 }
 
-inline void Random::swapByte(Uint8* a, Uint8* b) {
-	Uint8 temp = *a;
-	*a = *b;
-	*b = temp;
+Uint32 Random::getUint32Below(Uint32 bound) {
+	if (bound == 0) {
+		return 0;
+	}
+
+	// Lemire's nearly divisionless method
+	Uint64 m = (Uint64)getUint32() * (Uint64)bound;
+	Uint32 l = (Uint32)m;
+	if (l < bound) {
+		Uint32 threshold = (0u - bound) % bound;
+		while (l < threshold) {
+			m = (Uint64)getUint32() * (Uint64)bound;
+			l = (Uint32)m;
+		}
+	}
+	return (Uint32)(m >> 32);
+}
+
+Sint32 Random::getSint32Range(Sint32 min, Sint32 max) {
+	if (max <= min) {
+		return min;
+	}
+	Uint32 span = (Uint32)((Sint64)max - (Sint64)min + 1);
+	if (span == 0) {
+		// full 32-bit range
+		return (Sint32)getUint32();
+	}
+	return (Sint32)((Sint64)min + getUint32Below(span));
+}
+
+void Random::jumpBy(const Uint64 (&poly)[4]) {
+	Uint64 s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	for (int i = 0; i < 4; ++i) {
+		for (int b = 0; b < 64; ++b) {
+			if (poly[i] & ((Uint64)1 << b)) {
+				s0 ^= s[0];
+				s1 ^= s[1];
+				s2 ^= s[2];
+				s3 ^= s[3];
+			}
+			next();
+		}
+	}
+	s[0] = s0;
+	s[1] = s1;
+	s[2] = s2;
+	s[3] = s3;
+}
+
+void Random::jump() {
+	static const Uint64 poly[4] = {
+		0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL
+	};
+	jumpBy(poly);
+}
+
+void Random::longJump() {
+	static const Uint64 poly[4] = {
+		0x76E15D3EFEFDCBBFULL, 0xC5004E441C522FB3ULL, 0x77710069854EE241ULL, 0x39109BB02ACBE635ULL
+	};
+	jumpBy(poly);
+}
+
+Random Random::fork() {
+	Random result(*this);
+	jump();
+	return result;
+}
+
+// the previous RC4-style generator, kept only so the benchmark has something to compare against
+class RandomRC4 {
+public:
+	RandomRC4(Uint32 seed) {
+		for (int i = 0; i < 256; ++i)
+			s[i] = i;
+		const Uint8* bytes = (const Uint8*)&seed;
+		for (int i = 0, j = 0; i < 256; ++i) {
+			j = (j + s[i] + bytes[i % sizeof(Uint32)]) & 255;
+			std::swap(s[i], s[j]);
+		}
+	}
+
+	Uint8 getUint8() {
+		s_i = (s_i + 1) & 255;
+		s_j = (s_j + s[s_i]) & 255;
+		std::swap(s[s_i], s[s_j]);
+		return s[(s[s_i] + s[s_j]) & 255];
+	}
+
+	Uint32 getUint32() {
+		Uint32 value;
+		Uint8* buffer = (Uint8*)&value;
+		for (Uint32 c = 0; c < sizeof(Uint32); ++c) {
+			buffer[c] = getUint8();
+		}
+		return value;
+	}
+
+private:
+	Uint8 s[256];
+	Sint32 s_i = 0, s_j = 0;
+};
+
+static int console_randomBenchmark(int argc, const char** argv) {
+	Uint32 count = 10000000;
+	if (argc > 1) {
+		count = std::max(1, (int)strtol(argv[1], nullptr, 10));
+	}
+
+	typedef std::chrono::high_resolution_clock bench_clock;
+	Uint32 sink = 0;
+
+	auto start = bench_clock::now();
+	RandomRC4 rc4(1234);
+	for (Uint32 c = 0; c < count; ++c) {
+		sink += rc4.getUint32();
+	}
+	double rc4Time = std::chrono::duration<double>(bench_clock::now() - start).count();
+
+	start = bench_clock::now();
+	Random rand;
+	rand.seedValue(1234);
+	for (Uint32 c = 0; c < count; ++c) {
+		sink += rand.getUint32();
+	}
+	double xoshiroTime = std::chrono::duration<double>(bench_clock::now() - start).count();
+
+	ArrayList<Uint32> buffer;
+	buffer.resize(count);
+	start = bench_clock::now();
+	rand.fillUint32(buffer.getArray(), count);
+	double fillTime = std::chrono::duration<double>(bench_clock::now() - start).count();
+	sink += buffer[count - 1];
+
+	start = bench_clock::now();
+	for (Uint32 c = 0; c < 1000; ++c) {
+		Random stream = rand.fork();
+		sink += stream.getUint32();
+	}
+	double forkTime = std::chrono::duration<double>(bench_clock::now() - start).count();
+
+	mainEngine->fmsg(Engine::MSG_INFO, "generated %u 32-bit values (checksum %u):", count, sink);
+	mainEngine->fmsg(Engine::MSG_INFO, " rc4 getUint32: %.2f ms (%.1f M/s)", rc4Time * 1000.0, count / rc4Time / 1000000.0);
+	mainEngine->fmsg(Engine::MSG_INFO, " xoshiro getUint32: %.2f ms (%.1f M/s)", xoshiroTime * 1000.0, count / xoshiroTime / 1000000.0);
+	mainEngine->fmsg(Engine::MSG_INFO, " xoshiro fillUint32: %.2f ms (%.1f M/s)", fillTime * 1000.0, count / fillTime / 1000000.0);
+	mainEngine->fmsg(Engine::MSG_INFO, " fork: %.3f us per stream", forkTime * 1000.0);
+	return 0;
 }
 
-inline Uint8 Random::getByte(const Uint8* bytes, Uint32 num, Uint32 offset) {
-	return bytes[offset % num];
-}
\ No newline at end of file
+static Ccmd ccmd_randomBenchmark("random.benchmark", "measures random number generator throughput against the old rc4 generator", &console_randomBenchmark);
@@ -5,6 +5,9 @@
 #include "Main.hpp"
 
 //! The Random class is a random number generator.
+//! Internally this is xoshiro256**, which produces 64 bits per step and
+//! supports jumping ahead 2^128 / 2^192 steps to create independent streams
+//! (eg. one per worker thread) that are guaranteed not to overlap.
 class Random {
 public:
 	Random();
@@ -22,6 +25,10 @@ public:
 	//! @param seed the seed to use
 	void seedValue(Uint32 seed);
 
+	//! seed the rng based on the given 64-bit seed
+	//! @param seed the seed to use
+	void seedValue64(Uint64 seed);
+
 	//! seed the rng based on the given value
 	void seedBytes(const Uint8* seed, Uint32 size);
 
@@ -55,16 +62,66 @@ public:
 	//! @return a float (32-bit) (range 0-1, both inclusive)
 	float getFloat();
 
+	//! @param min the lowest value that may be returned
+	//! @param max the highest value that may be returned
+	//! @return a float (32-bit) in the range [min, max]
+	float getFloatRange(float min, float max);
+
+	//! @param min the lowest value that may be returned
+	//! @param max the highest value that may be returned
+	//! @return a double (64-bit) in the range [min, max]
+	double getDoubleRange(double min, double max);
+
+	//! returns an unbiased integer in the range [0, bound)
+	//! @param bound the exclusive upper bound (0 returns 0)
+	//! @return a random number
+	Uint32 getUint32Below(Uint32 bound);
+
+	//! returns an unbiased integer in the range [min, max]
+	//! @param min the lowest value that may be returned
+	//! @param max the highest value that may be returned
+	//! @return a random number
+	Sint32 getSint32Range(Sint32 min, Sint32 max);
+
 	//! generate a random value of the given size
 	//! @param buffer the buffer to place the random value in
 	//! @param size the size of the buffer in bytes
 	//! @return a random number
 	void getBytes(Uint8* buffer, Uint32 size);
 
+	//! fill an array with random 32-bit values
+	//! @param buffer the array to fill
+	//! @param count the number of elements in the array
+	void fillUint32(Uint32* buffer, Uint32 count);
+
+	//! fill an array with random floats (range 0-1)
+	//! @param buffer the array to fill
+	//! @param count the number of elements in the array
+	void fillFloat(float* buffer, Uint32 count);
+
+	//! advance the generator by 2^128 steps
+	//! equivalent to 2^128 calls to getUint64(), used to split off non-overlapping streams
+	void jump();
+
+	//! advance the generator by 2^192 steps
+	//! used to split off groups of streams that can each be jump()ed further
+	void longJump();
+
+	//! create an independent stream: returns a copy of this generator, then jumps this one ahead
+	//! so that the two never overlap. Calling this repeatedly yields one stream per worker thread.
+	//! @return the forked generator
+	Random fork();
+
 private:
-	unsigned char s[256];
-	Sint32 s_i, s_j;
+	Uint64 s[4];
+
+	//! step the generator
+	//! @return 64 random bits
+	inline Uint64 next();
+
+	//! apply one of the jump polynomials to the state
+	void jumpBy(const Uint64 (&poly)[4]);
 
-	inline void swapByte(Uint8* a, Uint8* b);
-	inline Uint8 getByte(const Uint8* bytes, Uint32 num, Uint32 offset);
-};
\ No newline at end of file
+	//! splitmix64, used to expand seeds into a full state
+	static Uint64 splitMix64(Uint64& x);
+};
@@ -300,9 +300,6 @@ int Renderer::initResources() {
 bool Renderer::changeVideoMode() {
 	mainEngine->fmsg(Engine::MSG_INFO, "changing video mode.");
 
-	// free text resource (it will probably be badly wrapped otherwise)
-	mainEngine->getTextResource().dumpCache();
-
 	// delete framebuffer cache (need to be resized)
 	framebufferResource.dumpCache();
 
@@ -718,11 +715,11 @@ void Renderer::drawConsole(const Sint32 height, const char* input, const LinkedL
 	for (const Node<Engine::logmsg_t>* node = logStart; node != nullptr; node = node->getPrev()) {
 		const Engine::logmsg_t& logMsg = node->getData();
 		const String* str = &logMsg.text;
-		Text* text = mainEngine->getTextResource().dataForString((*str).get());
+		Text* text = Text::get((*str).get(), Font::defaultFont);
 		if (text) {
 			Sint32 lines = 1;
-			for (size_t c = 0; text->getName()[c] != '\0'; ++c) {
-				if (text->getName()[c] == '\n') {
+			for (const char* c = str->get(); *c != '\0'; ++c) {
+				if (*c == '\n') {
 					++lines;
 				}
 			}
@@ -8,6 +8,7 @@
 
 #include "Asset.hpp"
 #include "Map.hpp"
+#include "StringID.hpp"
 
 enum resource_error_t {
 	ERROR_NONE,				//! no error
@@ -57,7 +58,7 @@ public:
 	Resource& operator=(const Resource&) = delete;
 	Resource& operator=(Resource&&) = delete;
 
-	Map<String, T*>&			getCache() { return cache; }
+	Map<StringID, T*>&			getCache() { return cache; }
 
 	//! number of items in the resource
 	//! @return the number of cached items in the resource
@@ -77,6 +78,17 @@ public:
 			error = resource_error_t::ERROR_CACHEFAILED;
 			return nullptr;
 		}
+		return dataForString(StringID(name));
+	}
+
+	//! same as dataForString(const char*), but the cache lookup is an integer compare
+	//! @param name the interned name of the data to load
+	//! @return the data, or nullptr if the data could not be loaded
+	T* dataForString(StringID name) {
+		if (name.empty()) {
+			error = resource_error_t::ERROR_CACHEFAILED;
+			return nullptr;
+		}
 
 		T** data = cache.find(name);
 		if (data) {
@@ -87,10 +99,10 @@ public:
 			T* data = nullptr;
 			if (stream) {
 				if (cache.getSize()) {
-					auto it = jobs.find(name);
+					auto it = jobs.find(name.get());
 					if (it == jobs.end()) {
-						if (Asset::valid(name)) {
-							jobs.emplace(name, std::async(std::launch::async, &Resource::load, this, name));
+						if (Asset::valid(name.get())) {
+							jobs.emplace(name.get(), std::async(std::launch::async, &Resource::load, this, name.get()));
 						} else {
 							error = resource_error_t::ERROR_CACHEFAILED;
 							return nullptr;
@@ -99,11 +111,11 @@ public:
 					error = resource_error_t::ERROR_CACHEINPROGRESS;
 					return nullptr;
 				} else {
-					data = load(name);
+					data = load(name.get());
 					data->finalize();
 				}
 			} else {
-				data = load(name);
+				data = load(name.get());
 				data->finalize();
 			}
 			Asset* base = data; //! enforce Asset base class
@@ -135,7 +147,7 @@ public:
 					data->finalize();
 					Asset* base = data; //! enforce Asset base class
 					if (base->isLoaded()) {
-						cache.insertUnique(name.c_str(), data);
+						cache.insertUnique(StringID(name.c_str()), data);
 						keys.push_back(name);
 					} else {
 						delete data;
@@ -163,10 +175,11 @@ public:
 
 	//! delete some specific data from the cache
 	virtual void deleteData(const char* name) override {
-		T** data = cache.find(name);
+		const StringID id = StringID::find(name);
+		T** data = cache.find(id);
 		if (data) {
 			delete *data;
-			cache.remove(name);
+			cache.remove(id);
 		}
 	}
 
@@ -183,7 +196,7 @@ public:
 	}
 
 private:
-	Map<String, T*> cache;
+	Map<StringID, T*> cache;
 	std::unordered_map<std::string, std::future<T*>> jobs;
 	T* defaultAsset = nullptr;
 
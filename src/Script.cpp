@@ -32,10 +32,22 @@
 #include "Character.hpp"
 #include "Multimesh.hpp"
 
+//! the by-string findComponentByName(), which is the overload lua can call
+template <typename T, typename Owner>
+using FindByNameFn = T*(Owner::*)(const char*);
+
 int Script::load(const char* _filename) {
 	filename = mainEngine->buildPath(_filename);
 
-	int result = luaL_dofile(lua, filename.get());
+	int result = 0;
+	ArrayList<Uint8> packed;
+	if (mainEngine->readPackedFile(filename.get(), packed)) {
+		StringBuf<256> chunkName("@%s", 1, filename.get());
+		result = luaL_loadbuffer(lua, (const char*)packed.getArray(), packed.getSize(), chunkName.get()) ||
+			lua_pcall(lua, 0, LUA_MULTRET, 0);
+	} else {
+		result = luaL_dofile(lua, filename.get());
+	}
 	if (result) {
 		mainEngine->fmsg(Engine::MSG_ERROR, "failed to load script '%s':", filename.get());
 		mainEngine->fmsg(Engine::MSG_ERROR, " %s", lua_tostring(lua, -1));
@@ -210,13 +222,38 @@ void Script::exposeEngine() {
 		.endClass()
 		;
 
+	typedef float(Input::*AnalogFn)(const char*) const;
+	AnalogFn analog = static_cast<AnalogFn>(&Input::analog);
+	typedef float(Input::*AnalogHandleFn)(Input::handle_t) const;
+	AnalogHandleFn analogHandle = static_cast<AnalogHandleFn>(&Input::analog);
+
+	typedef bool(Input::*BinaryFn)(const char*) const;
+	BinaryFn binary = static_cast<BinaryFn>(&Input::binary);
+	BinaryFn binaryToggle = static_cast<BinaryFn>(&Input::binaryToggle);
+	typedef bool(Input::*BinaryHandleFn)(Input::handle_t) const;
+	BinaryHandleFn binaryHandle = static_cast<BinaryHandleFn>(&Input::binary);
+	BinaryHandleFn binaryToggleHandle = static_cast<BinaryHandleFn>(&Input::binaryToggle);
+
+	typedef void(Input::*ConsumeFn)(const char*);
+	ConsumeFn consumeBinaryToggle = static_cast<ConsumeFn>(&Input::consumeBinaryToggle);
+	typedef void(Input::*ConsumeHandleFn)(Input::handle_t);
+	ConsumeHandleFn consumeBinaryToggleHandle = static_cast<ConsumeHandleFn>(&Input::consumeBinaryToggle);
+
 	luabridge::getGlobalNamespace(lua)
 		.beginClass<Input>("Input")
 		.addConstructor<void(*)()>()
-		.addFunction("analog", &Input::analog)
-		.addFunction("binary", &Input::binary)
-		.addFunction("binaryToggle", &Input::binaryToggle)
-		.addFunction("consumeBinaryToggle", &Input::consumeBinaryToggle)
+		.addStaticFunction("handleFor", &Input::handleFor)
+		.addStaticFunction("nameOf", &Input::nameOf)
+		.addFunction("analog", analog)
+		.addFunction("binary", binary)
+		.addFunction("binaryToggle", binaryToggle)
+		.addFunction("consumeBinaryToggle", consumeBinaryToggle)
+		.addFunction("analogHandle", analogHandle)
+		.addFunction("binaryHandle", binaryHandle)
+		.addFunction("binaryToggleHandle", binaryToggleHandle)
+		.addFunction("consumeBinaryToggleHandle", consumeBinaryToggleHandle)
+		.addFunction("getAnalogStates", &Input::getAnalogStates)
+		.addFunction("getBinaryStates", &Input::getBinaryStates)
 		.addFunction("binding", &Input::binding)
 		.addFunction("rebind", &Input::rebind)
 		.addFunction("refresh", &Input::refresh)
@@ -701,6 +738,20 @@ void Script::exposeEntity() {
 	typedef World* (Entity::*GetWorldFn)();
 	GetWorldFn getWorld = static_cast<GetWorldFn>(&Entity::getWorld);
 
+	typedef void (Entity::*SetKeyValueFn)(const char*, const char*);
+	SetKeyValueFn setKeyValue = static_cast<SetKeyValueFn>(&Entity::setKeyValue);
+	typedef void (Entity::*DeleteKeyValueFn)(const char*);
+	DeleteKeyValueFn deleteKeyValue = static_cast<DeleteKeyValueFn>(&Entity::deleteKeyValue);
+	typedef const char* (Entity::*GetKeyValueAsStringFn)(const char*) const;
+	GetKeyValueAsStringFn getKeyValueAsString = static_cast<GetKeyValueAsStringFn>(&Entity::getKeyValueAsString);
+	GetKeyValueAsStringFn getKeyValue = static_cast<GetKeyValueAsStringFn>(&Entity::getKeyValue);
+	typedef float (Entity::*GetKeyValueAsFloatFn)(const char*) const;
+	GetKeyValueAsFloatFn getKeyValueAsFloat = static_cast<GetKeyValueAsFloatFn>(&Entity::getKeyValueAsFloat);
+	typedef int (Entity::*GetKeyValueAsIntFn)(const char*) const;
+	GetKeyValueAsIntFn getKeyValueAsInt = static_cast<GetKeyValueAsIntFn>(&Entity::getKeyValueAsInt);
+	typedef bool (Entity::*GetKeyValueAsBoolFn)(const char*) const;
+	GetKeyValueAsBoolFn getKeyValueAsBool = static_cast<GetKeyValueAsBoolFn>(&Entity::getKeyValueAsBool);
+
 	luabridge::getGlobalNamespace(lua)
 		.beginClass<Entity>("Entity")
 		.addFunction("getGame", &Entity::getGame)
@@ -716,13 +767,13 @@ void Script::exposeEntity() {
 		.addFunction("getScriptStr", &Entity::getScriptStr)
 		.addFunction("isToBeDeleted", &Entity::isToBeDeleted)
 		.addFunction("getFlags", &Entity::getFlags)
-		.addFunction("setKeyValue", &Entity::setKeyValue)
-		.addFunction("deleteKeyValue", &Entity::deleteKeyValue)
-		.addFunction("getKeyValueAsString", &Entity::getKeyValueAsString)
-		.addFunction("getKeyValueAsFloat", &Entity::getKeyValueAsFloat)
-		.addFunction("getKeyValueAsInt", &Entity::getKeyValueAsInt)
-		.addFunction("getKeyValueAsBool", &Entity::getKeyValueAsBool)
-		.addFunction("getKeyValue", &Entity::getKeyValue)
+		.addFunction("setKeyValue", setKeyValue)
+		.addFunction("deleteKeyValue", deleteKeyValue)
+		.addFunction("getKeyValueAsString", getKeyValueAsString)
+		.addFunction("getKeyValueAsFloat", getKeyValueAsFloat)
+		.addFunction("getKeyValueAsInt", getKeyValueAsInt)
+		.addFunction("getKeyValueAsBool", getKeyValueAsBool)
+		.addFunction("getKeyValue", getKeyValue)
 		.addFunction("isFlag", &Entity::isFlag)
 		.addFunction("isFalling", &Entity::isFalling)
 		.addFunction("getLastUpdate", &Entity::getLastUpdate)
@@ -765,14 +816,14 @@ void Script::exposeEntity() {
 		.addFunction("addSpeaker", &Entity::addComponent<Speaker>)
 		.addFunction("addCharacter", &Entity::addComponent<Character>)
 		.addFunction("addMultimesh", &Entity::addComponent<Multimesh>)
-		.addFunction("findComponentByName", &Entity::findComponentByName<Component>)
-		.addFunction("findBBoxByName", &Entity::findComponentByName<BBox>)
-		.addFunction("findModelByName", &Entity::findComponentByName<Model>)
-		.addFunction("findLightByName", &Entity::findComponentByName<Light>)
-		.addFunction("findCameraByName", &Entity::findComponentByName<Camera>)
-		.addFunction("findSpeakerByName", &Entity::findComponentByName<Speaker>)
-		.addFunction("findCharacterByName", &Entity::findComponentByName<Character>)
-		.addFunction("findMultimeshByName", &Entity::findComponentByName<Multimesh>)
+		.addFunction("findComponentByName", static_cast<FindByNameFn<Component, Entity>>(&Entity::findComponentByName<Component>))
+		.addFunction("findBBoxByName", static_cast<FindByNameFn<BBox, Entity>>(&Entity::findComponentByName<BBox>))
+		.addFunction("findModelByName", static_cast<FindByNameFn<Model, Entity>>(&Entity::findComponentByName<Model>))
+		.addFunction("findLightByName", static_cast<FindByNameFn<Light, Entity>>(&Entity::findComponentByName<Light>))
+		.addFunction("findCameraByName", static_cast<FindByNameFn<Camera, Entity>>(&Entity::findComponentByName<Camera>))
+		.addFunction("findSpeakerByName", static_cast<FindByNameFn<Speaker, Entity>>(&Entity::findComponentByName<Speaker>))
+		.addFunction("findCharacterByName", static_cast<FindByNameFn<Character, Entity>>(&Entity::findComponentByName<Character>))
+		.addFunction("findMultimeshByName", static_cast<FindByNameFn<Multimesh, Entity>>(&Entity::findComponentByName<Multimesh>))
 		.addFunction("lineTrace", &Entity::lineTrace)
 		.addFunction("findAPath", &Entity::findAPath)
 		.addFunction("findRandomPath", &Entity::findRandomPath)
@@ -859,13 +910,13 @@ void Script::exposeComponent() {
 		.addFunction("addLight", &Component::addComponent<Light>)
 		.addFunction("addSpeaker", &Component::addComponent<Speaker>)
 		.addFunction("addCharacter", &Component::addComponent<Character>)
-		.addFunction("findComponentByName", &Component::findComponentByName<Component>)
-		.addFunction("findBBoxByName", &Component::findComponentByName<BBox>)
-		.addFunction("findModelByName", &Component::findComponentByName<Model>)
-		.addFunction("findLightByName", &Component::findComponentByName<Light>)
-		.addFunction("findCameraByName", &Component::findComponentByName<Camera>)
-		.addFunction("findSpeakerByName", &Component::findComponentByName<Speaker>)
-		.addFunction("findCharacterByName", &Component::findComponentByName<Character>)
+		.addFunction("findComponentByName", static_cast<FindByNameFn<Component, Component>>(&Component::findComponentByName<Component>))
+		.addFunction("findBBoxByName", static_cast<FindByNameFn<BBox, Component>>(&Component::findComponentByName<BBox>))
+		.addFunction("findModelByName", static_cast<FindByNameFn<Model, Component>>(&Component::findComponentByName<Model>))
+		.addFunction("findLightByName", static_cast<FindByNameFn<Light, Component>>(&Component::findComponentByName<Light>))
+		.addFunction("findCameraByName", static_cast<FindByNameFn<Camera, Component>>(&Component::findComponentByName<Camera>))
+		.addFunction("findSpeakerByName", static_cast<FindByNameFn<Speaker, Component>>(&Component::findComponentByName<Speaker>))
+		.addFunction("findCharacterByName", static_cast<FindByNameFn<Character, Component>>(&Component::findComponentByName<Character>))
 		.addFunction("rotate", &Component::rotate)
 		.addFunction("translate", &Component::translate)
 		.addFunction("scale", &Component::scale)
@@ -929,6 +980,13 @@ void Script::exposeModel() {
 		.endClass()
 		;
 
+	typedef float (AnimationState::*GetWeightFn)(const char*) const;
+	GetWeightFn getWeight = static_cast<GetWeightFn>(&AnimationState::getWeight);
+	GetWeightFn getWeightRate = static_cast<GetWeightFn>(&AnimationState::getWeightRate);
+	typedef void (AnimationState::*SetWeightFn)(const char*, float);
+	SetWeightFn setWeight = static_cast<SetWeightFn>(&AnimationState::setWeight);
+	SetWeightFn setWeightRate = static_cast<SetWeightFn>(&AnimationState::setWeightRate);
+
 	luabridge::getGlobalNamespace(lua)
 		.beginClass<AnimationState>("AnimationState")
 		.addFunction("getName", &AnimationState::getName)
@@ -937,14 +995,14 @@ void Script::exposeModel() {
 		.addFunction("getBegin", &AnimationState::getBegin)
 		.addFunction("getEnd", &AnimationState::getEnd)
 		.addFunction("getLength", &AnimationState::getLength)
-		.addFunction("getWeight", &AnimationState::getWeight)
-		.addFunction("getWeightRate", &AnimationState::getWeightRate)
+		.addFunction("getWeight", getWeight)
+		.addFunction("getWeightRate", getWeightRate)
 		.addFunction("isLoop", &AnimationState::isLoop)
 		.addFunction("isFinished", &AnimationState::isFinished)
 		.addFunction("setTicks", &AnimationState::setTicks)
 		.addFunction("setTicksRate", &AnimationState::setTicksRate)
-		.addFunction("setWeight", &AnimationState::setWeight)
-		.addFunction("setWeightRate", &AnimationState::setWeightRate)
+		.addFunction("setWeight", setWeight)
+		.addFunction("setWeightRate", setWeightRate)
 		.addFunction("setWeights", &AnimationState::setWeights)
 		.addFunction("setWeightRates", &AnimationState::setWeightRates)
 		.addFunction("clearWeights", &AnimationState::clearWeights)
@@ -1009,6 +1067,8 @@ void Script::exposeSpeaker() {
 		.addFunction("getDefaultSound", &Speaker::getDefaultSound)
 		.addFunction("getDefaultRange", &Speaker::getDefaultRange)
 		.addFunction("isDefaultLoop", &Speaker::isDefaultLoop)
+		.addFunction("getPriority", &Speaker::getPriority)
+		.addFunction("setPriority", &Speaker::setPriority)
 		.addFunction("isPlaying", &Speaker::isPlaying)
 		.addFunction("isPlayingAnything", &Speaker::isPlayingAnything)
 		.endClass()
@@ -12,6 +12,15 @@
 #include "NetSDL.hpp"
 #include "Console.hpp"
 #include "BBox.hpp"
+#include "Random.hpp"
+
+#include <chrono>
+#include <memory>
+
+static Cvar cvar_interestEnabled("server.interest.enabled", "only replicate entities to clients that are close enough to see them", "1");
+static Cvar cvar_interestNear("server.interest.near", "entities within this distance of a client's player are replicated on every update", "1024");
+static Cvar cvar_interestFar("server.interest.far", "entities within this distance are replicated at a reduced rate; beyond it they are despawned on the client", "4096");
+static Cvar cvar_interestFarRate("server.interest.farrate", "entities in the far band are replicated once every this many updates", "4");
 
 Server::Server() {
 	net = new NetSDL(*this);
@@ -52,8 +61,9 @@ void Server::handleNetMessages() {
 		// receive packets
 		Packet* recvPacket = nullptr;
 		while ((recvPacket = net->recvPacket(remoteIndex)) != nullptr) {
-			Packet packet(*recvPacket);
-			delete recvPacket;
+			// parse straight out of the received buffer, which goes back to the pool after this iteration
+			std::unique_ptr<Packet> owner(recvPacket);
+			Packet& packet = *recvPacket;
 
 			Uint32 id, timestamp;
 			if (packet.read32(id) && packet.read32(timestamp)) {
@@ -165,12 +175,17 @@ void Server::handleNetMessages() {
 								// create new player
 								Player newPlayer(nameStr.get(), colors);
 
-								serverID = (Uint32)players.getSize();
+								// take the lowest free server id, so ids stay unique as players come and go
+								serverID = 0;
+								while (findPlayer(serverID)) {
+									++serverID;
+								}
 								newPlayer.setServerID(serverID);
 								newPlayer.setClientID(clientID);
 								newPlayer.setLocalID(localID);
 
 								player = &players.addNodeLast(newPlayer)->getData();
+								invalidatePlayerIndex();
 							}
 
 							// pick a random world to spawn in
@@ -585,6 +600,187 @@ void Server::onDisconnect(Uint32 remoteID) {
 			players.removeNode(node);
 		}
 	}
+	invalidatePlayerIndex();
+	interests.remove(remoteID);
+}
+
+Server::band_t Server::relevance(const Entity& entity, const ArrayList<viewer_t>& viewers, bool wasRelevant, bool useInterest) {
+	if (!useInterest || entity.isFlag(Entity::flag_t::FLAG_RELEVANT) || viewers.getSize() == 0) {
+		// clients without a player in the game yet get everything, like they used to
+		return BAND_NEAR;
+	}
+
+	float nearest = -1.f;
+	for (auto& viewer : viewers) {
+		if (viewer.world != entity.getWorld()) {
+			continue;
+		}
+		float dist = (entity.getPos() - viewer.pos).lengthSquared();
+		if (nearest < 0.f || dist < nearest) {
+			nearest = dist;
+		}
+	}
+	if (nearest < 0.f) {
+		// none of the client's players are in this world
+		return BAND_NONE;
+	}
+
+	const float nearDist = cvar_interestNear.toFloat();
+	const float farDist = cvar_interestFar.toFloat() * (wasRelevant ? 1.1f : 1.f);
+	if (nearest <= nearDist * nearDist) {
+		return BAND_NEAR;
+	} else if (nearest <= farDist * farDist) {
+		return BAND_FAR;
+	} else {
+		return BAND_NONE;
+	}
+}
+
+void Server::replicateEntities(ArrayList<replicant_t>& replicants, Uint32 cycle, bool useInterest, bool send, replicationstats_t& stats) {
+	const Uint32 farRate = (Uint32)std::max(1, cvar_interestFarRate.toInt());
+	for (auto& replicant : replicants) {
+		replicant.next.clear();
+	}
+
+	for (auto world : worlds) {
+		for (auto pair : world->getEntities()) {
+			Entity* entity = pair.b;
+
+			if (!entity->isFlag(Entity::flag_t::FLAG_UPDATE) || entity->isFlag(Entity::flag_t::FLAG_LOCAL)) {
+				// don't update local-only entities
+				continue;
+			}
+
+			const Uint64 key = ((Uint64)world->getID() << 32) | entity->getUID();
+			Player* player = entity->getPlayer();
+
+			// packets are built once per entity and shared by every client that needs them
+			Packet update, despawn;
+			bool updateBuilt = false, despawnBuilt = false;
+
+			for (auto& replicant : replicants) {
+				if (player && player->getClientID() == replicant.id) {
+					// do not (normally) tell a client where their players are!
+					continue;
+				}
+
+				// until a client is primed, assume it has every entity (eg from the world file)
+				const bool known = replicant.interest->entities.exists(key);
+				const bool wasRelevant = known || !replicant.interest->primed;
+				band_t band = relevance(*entity, replicant.viewers, wasRelevant, useInterest);
+
+				if (band == BAND_NONE) {
+					if (wasRelevant) {
+						if (!despawnBuilt) {
+							despawn.write32(entity->getUID());
+							despawn.write32(world->getID());
+							despawn.write("ENTX");
+							net->signPacket(despawn);
+							despawnBuilt = true;
+						}
+						++stats.despawns;
+						stats.bytes += despawn.offset;
+						if (send) {
+							net->sendPacketSafe(replicant.id, despawn);
+						}
+					}
+					continue;
+				}
+				replicant.next.insert(key, (Uint8)band);
+
+				// entities entering interest are sent right away, which spawns them on the client.
+				// far updates are staggered by uid so they don't all land on the same cycle
+				if (known && band == BAND_FAR && (cycle + entity->getUID()) % farRate != 0) {
+					continue;
+				}
+
+				if (!updateBuilt) {
+					entity->updatePacket(update);
+					net->signPacket(update);
+					updateBuilt = true;
+				}
+				if (known) {
+					++stats.updates;
+				} else {
+					++stats.spawns;
+				}
+				stats.bytes += update.offset;
+				if (send) {
+					net->sendPacket(replicant.id, update);
+				}
+			}
+		}
+	}
+
+	for (auto& replicant : replicants) {
+		replicant.interest->entities.swap(std::move(replicant.next));
+		replicant.interest->primed = true;
+	}
+}
+
+void Server::soakReplication(Uint32 numBots, Uint32 numCycles) {
+	// bots start on random entities, so they are spread over the populated parts of each world
+	ArrayList<viewer_t> anchors;
+	for (auto world : worlds) {
+		for (auto pair : world->getEntities()) {
+			viewer_t anchor;
+			anchor.world = world;
+			anchor.pos = pair.b->getPos();
+			anchors.push(anchor);
+		}
+	}
+	if (anchors.getSize() == 0) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "no entities to replicate, load a world first");
+		return;
+	}
+
+	Random rand;
+	rand.seedValue(numBots);
+	ArrayList<viewer_t> bots;
+	for (Uint32 c = 0; c < numBots; ++c) {
+		bots.push(anchors[rand.getUint32Below(anchors.getSize())]);
+	}
+
+	const char* modes[2] = { "full", "interest" };
+	for (int mode = 0; mode < 2; ++mode) {
+		ArrayList<interest_t> states;
+		states.resize(numBots);
+		ArrayList<replicant_t> replicants;
+		replicants.resize(numBots);
+		for (Uint32 c = 0; c < numBots; ++c) {
+			replicants[c].id = UINT32_MAX - c;
+			replicants[c].interest = &states[c];
+		}
+
+		// both modes walk the bots along the same paths
+		Random walk;
+		walk.seedValue(numBots + 1);
+
+		replicationstats_t stats;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (Uint32 cycle = 0; cycle < numCycles; ++cycle) {
+			for (Uint32 c = 0; c < numBots; ++c) {
+				viewer_t& bot = bots[c];
+				bot.pos.x += walk.getFloatRange(-32.f, 32.f);
+				bot.pos.y += walk.getFloatRange(-32.f, 32.f);
+				replicants[c].viewers.clear();
+				replicants[c].viewers.push(bot);
+			}
+			replicateEntities(replicants, cycle, mode == 1, false, stats);
+		}
+		double time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		// put the bots back for the next mode
+		rand.seedValue(numBots);
+		for (Uint32 c = 0; c < numBots; ++c) {
+			bots[c] = anchors[rand.getUint32Below(anchors.getSize())];
+		}
+
+		const double cycles = (double)std::max(1U, numCycles);
+		mainEngine->fmsg(Engine::MSG_INFO, "%s replication, %u bots, %u cycles:", modes[mode], numBots, numCycles);
+		mainEngine->fmsg(Engine::MSG_INFO, " per cycle: %.1f spawns, %.1f updates, %.1f despawns, %.1f KB, %.3f ms",
+			stats.spawns / cycles, stats.updates / cycles, stats.despawns / cycles, stats.bytes / cycles / 1024.0, time * 1000.0 / cycles);
+	}
 }
 
 void Server::preProcess() {
@@ -611,35 +807,42 @@ void Server::postProcess() {
 	if (framesToRun) {
 		script->dispatch("postprocess");
 
-		// send entity updates to client
+		// send entity updates to clients
 		if (net->isConnected()) {
 			if (ticks % (mainEngine->getTicksPerSecond() / 10) == 0) {
-				for (auto world : worlds) {
-					for (auto pair : world->getEntities()) {
-						auto entity = pair.b;
-
-						if (!entity->isFlag(Entity::flag_t::FLAG_UPDATE) || entity->isFlag(Entity::flag_t::FLAG_LOCAL)) {
-							// don't update local-only entities
-							continue;
-						}
-
-						for (Uint32 c = 0; c < net->getRemoteHosts().getSize(); ++c) {
-							const Net::remote_t* remote = net->getRemoteHosts()[c];
+				const ArrayList<Net::remote_t*>& remotes = net->getRemoteHosts();
 
-							Player* player = entity->getPlayer();
-							if (player && player->getClientID() == remote->id) {
-								// do not (normally) tell a client where their players are!
-								continue;
-							}
+				// make sure every client has interest state before taking pointers into the map
+				for (Uint32 c = 0; c < remotes.getSize(); ++c) {
+					if (!interests.exists(remotes[c]->id)) {
+						interests.insert(remotes[c]->id, interest_t());
+					}
+				}
 
-							// update entity for client
-							Packet packet;
-							entity->updatePacket(packet);
-							net->signPacket(packet);
-							net->sendPacket(remote->id, packet);
-						}
+				ArrayList<replicant_t> replicants;
+				replicants.resize(remotes.getSize());
+				Map<Uint32, Uint32> replicantIndices;
+				for (Uint32 c = 0; c < remotes.getSize(); ++c) {
+					replicant_t& replicant = replicants[c];
+					replicant.id = remotes[c]->id;
+					replicant.interest = interests.find(replicant.id);
+					replicantIndices.insert(replicant.id, c);
+				}
+				for (Node<Player>* node = players.getFirst(); node != nullptr; node = node->getNext()) {
+					Player& player = node->getData();
+					Entity* entity = player.getEntity();
+					const Uint32* index = replicantIndices.find(player.getClientID());
+					if (index && entity && entity->getWorld()) {
+						viewer_t viewer;
+						viewer.world = entity->getWorld();
+						viewer.pos = entity->getPos();
+						replicants[*index].viewers.push(viewer);
 					}
 				}
+
+				lastReplication = replicationstats_t();
+				replicateEntities(replicants, replicationCycle, cvar_interestEnabled.toInt() != 0, true, lastReplication);
+				++replicationCycle;
 			}
 		}
 
@@ -744,6 +947,30 @@ static int console_serverCountEntities(int argc, const char** argv) {
 	return 0;
 }
 
+static int console_serverInterestStats(int argc, const char** argv) {
+	Server* server = mainEngine->getLocalServer();
+	if (!server) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "No server currently running.");
+		return 1;
+	}
+	auto& stats = server->getReplicationStats();
+	mainEngine->fmsg(Engine::MSG_INFO, "last replication cycle: %u spawns, %u updates, %u despawns, %u bytes",
+		stats.spawns, stats.updates, stats.despawns, stats.bytes);
+	return 0;
+}
+
+static int console_serverInterestSoak(int argc, const char** argv) {
+	Server* server = mainEngine->getLocalServer();
+	if (!server) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "No server currently running.");
+		return 1;
+	}
+	Uint32 bots = argc > 1 ? (Uint32)strtol(argv[1], nullptr, 10) : 64;
+	Uint32 cycles = argc > 2 ? (Uint32)strtol(argv[2], nullptr, 10) : 100;
+	server->soakReplication(bots, cycles);
+	return 0;
+}
+
 static Ccmd ccmd_host("host", "inits a new local server", &console_host);
 static Ccmd ccmd_serverReset("server.reset", "restarts the local server", &console_serverReset);
 static Ccmd ccmd_serverCloseMaps("server.closemaps", "close all maps on the server", &console_serverReset);
@@ -751,4 +978,6 @@ static Ccmd ccmd_serverDisconnect("server.disconnect", "disconnects the server f
 static Ccmd ccmd_serverMap("server.map", "loads a world file on the local server", &console_serverMap);
 static Ccmd ccmd_serverSaveMap("server.savemap", "saves the given level to disk", &console_serverSaveMap);
 static Ccmd ccmd_serverCount("server.count", "counts the number of levels running on the server", &console_serverCount);
-static Ccmd ccmd_serverCountEntities("server.countentities", "count the number of entities in all worlds on the server", &console_serverCountEntities);
\ No newline at end of file
+static Ccmd ccmd_serverCountEntities("server.countentities", "count the number of entities in all worlds on the server", &console_serverCountEntities);
+static Ccmd ccmd_serverInterestStats("server.interest.stats", "reports what the last entity replication cycle sent", &console_serverInterestStats);
+static Ccmd ccmd_serverInterestSoak("server.interest.soak", "replicates the loaded worlds to simulated clients with and without interest management. ex: server.interest.soak 64 100", &console_serverInterestSoak);
\ No newline at end of file
@@ -3,8 +3,12 @@
 #pragma once
 
 #include "Game.hpp"
+#include "ArrayList.hpp"
+#include "Map.hpp"
+#include "Vector.hpp"
 
 class Script;
+class Entity;
 
 //! A Server implements the Game interface and lives in the Engine.
 //! In order to play a singleplayer or listening game, the engine instantiates a Client and a Server, meaning there are two Game states running at once.
@@ -51,6 +55,68 @@ public:
 	//! update all clients about the players that are connected to me
 	void updateAllClientsAboutPlayers();
 
+	//! run entity replication against simulated clients without sending anything, comparing interest management to full replication
+	//! @param numBots the number of simulated clients
+	//! @param numCycles the number of replication cycles to run
+	void soakReplication(Uint32 numBots, Uint32 numCycles);
+
+	//! how closely a client follows an entity
+	enum band_t {
+		BAND_NONE,		//!< not replicated (despawned on the client)
+		BAND_FAR,		//!< replicated at a reduced rate
+		BAND_NEAR		//!< replicated on every update
+	};
+
+	//! a point a client sees the game from (one of its players)
+	struct viewer_t {
+		const World* world = nullptr;
+		Vector pos;
+	};
+
+	//! replication state for a single client
+	struct interest_t {
+		Map<Uint64, Uint8> entities;	//!< entities the client is following (key = world id << 32 | entity uid, value = band)
+		bool primed = false;			//!< false until the client has been through its first replication cycle
+	};
+
+	//! replication counts for one or more cycles
+	struct replicationstats_t {
+		Uint32 spawns = 0;		//!< updates for entities entering a client's interest
+		Uint32 updates = 0;		//!< updates for entities the client was already following
+		Uint32 despawns = 0;	//!< entities leaving a client's interest
+		Uint32 bytes = 0;
+	};
+
+	//! decide how closely a client should follow an entity
+	//! @param entity the entity to test
+	//! @param viewers every point the client sees the game from
+	//! @param wasRelevant true if the client already follows the entity (grows the far band a little to stop flickering at the edge)
+	//! @param useInterest if false, every entity is near
+	//! @return the band the entity falls in
+	static band_t relevance(const Entity& entity, const ArrayList<viewer_t>& viewers, bool wasRelevant, bool useInterest);
+
+	const replicationstats_t&	getReplicationStats() const { return lastReplication; }
+
 private:
 	Script* script = nullptr;
+
+	//! a client taking part in a replication cycle
+	struct replicant_t {
+		Uint32 id = 0;
+		ArrayList<viewer_t> viewers;
+		interest_t* interest = nullptr;
+		Map<Uint64, Uint8> next;		//!< interest set being built for the next cycle
+	};
+
+	Map<Uint32, interest_t> interests;	//!< per-client replication state, by remote id
+	Uint32 replicationCycle = 0;
+	replicationstats_t lastReplication;
+
+	//! send (or count) entity updates for one replication cycle
+	//! @param replicants the clients to replicate to
+	//! @param cycle the cycle number, which staggers far band updates
+	//! @param useInterest if false, replicate everything to everyone
+	//! @param send if false, only count what would be sent
+	//! @param stats counts are added to this
+	void replicateEntities(ArrayList<replicant_t>& replicants, Uint32 cycle, bool useInterest, bool send, replicationstats_t& stats);
 };
\ No newline at end of file
@@ -33,75 +33,61 @@ bool Shader::init() {
 }
 
 int Shader::load() {
-	FILE* fp;
-
-	// open file
-	fp = fopen(path.get(), "r");
-	if (fp == NULL)
-		return 1; // file not found
-	clearerr(fp);
-
-	// length of preproc defines
-	static const char* definePrefix = "#define ";
-	static const char* defineSuffix = "\n";
-	GLint definesLength = 0;
-	GLint definePrefixLen = (GLint)strlen(definePrefix);
-	GLint defineSuffixLen = (GLint)strlen(defineSuffix);
-	for (auto& define : defines) {
-		definesLength += definePrefixLen + (GLint)define.length() + defineSuffixLen;
+	// read the whole source, from the asset pack or from disk
+	ArrayList<Uint8> source;
+	if (!mainEngine->readPackedFile(path.get(), source)) {
+		FILE* fp = fopen(path.get(), "rb");
+		if (fp == NULL)
+			return 1; // file not found
+		fseek(fp, 0, SEEK_END);
+		long size = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+		source.resize((Uint32)std::max(size, 0L));
+		if (size > 0 && fread(source.getArray(), 1, (size_t)size, fp) != (size_t)size) {
+			source.clear();
+		}
+		fclose(fp);
 	}
 
-	// determine length of file
-	Uint32 len = 0;
-	for (; !feof(fp); ++len)
-		fgetc(fp);
-
-	// reset to beginning of file
-	fseek(fp, 0, SEEK_SET);
-	clearerr(fp);
-
 	// error if empty file
+	Uint32 len = source.getSize();
 	if (len <= 0) {
-		fclose(fp);
 		return 2; // empty file
 	}
 
-	// allocate memory for source
-	shaderSource.alloc(len + definesLength + 1);
-	shaderSource[len + definesLength] = '\0';
-	int i = 0;
+	// length of preproc defines
+	static const char* definePrefix = "#define ";
+	static const char* defineSuffix = "\n";
+	Uint32 definesLength = 0;
+	Uint32 definePrefixLen = (Uint32)strlen(definePrefix);
+	Uint32 defineSuffixLen = (Uint32)strlen(defineSuffix);
+	for (auto& define : defines) {
+		definesLength += definePrefixLen + define.length() + defineSuffixLen;
+	}
 
-	// read version directive from source
+	// the version directive has to stay ahead of the defines
+	Uint32 versionLen = 0;
 	if (defines.getSize() > 0) {
-		for (; !feof(fp); ++i) {
-			GLchar c = (GLchar)fgetc(fp);
-			shaderSource[i] = c;
-			if (c == '\n') {
-				++i;
-				shaderSource[i] = '\0';
-				break;
-			}
-		}
+		while (versionLen < len && source[versionLen++] != '\n');
 	}
 
-	// insert defines
+	// assemble the version directive, defines, and the rest of the shader source
+	shaderSource.alloc(len + definesLength + 1);
+	Uint32 i = 0;
+	memcpy(&shaderSource[i], source.getArray(), versionLen);
+	i += versionLen;
 	for (auto& define : defines) {
-		shaderSource.append(definePrefix);
-		shaderSource.append(define.get());
-		shaderSource.append(defineSuffix);
-		i += (int)definePrefixLen;
-		i += (int)define.length();
-		i += (int)defineSuffixLen;
+		memcpy(&shaderSource[i], definePrefix, definePrefixLen);
+		i += definePrefixLen;
+		memcpy(&shaderSource[i], define.get(), define.length());
+		i += define.length();
+		memcpy(&shaderSource[i], defineSuffix, defineSuffixLen);
+		i += defineSuffixLen;
 	}
-
-	// read rest of shader source
-	for (; !feof(fp); ++i)
-		shaderSource[i] = (GLchar)fgetc(fp);
+	memcpy(&shaderSource[i], source.getArray() + versionLen, len - versionLen);
+	i += len - versionLen;
 	shaderSource[i] = '\0';
-	shaderSource[i - 1] = '\0';
 
-	// close file, return success
-	fclose(fp);
 	return 0;
 }
 
@@ -13,14 +13,33 @@
 #include "Camera.hpp"
 
 const ShaderProgram* ShaderProgram::currentShader = nullptr;
+ShaderProgram::lightblock_t ShaderProgram::lightBlock;
+ShaderProgram::lightstats_t ShaderProgram::lightStats;
+
+// uniform array names, in lightuniform_t order
+static const char* lightUniformNames[ShaderProgram::LIGHT_UNIFORM_MAX] = {
+	"gLightPos",
+	"gLightColor",
+	"gLightIntensity",
+	"gLightRadius",
+	"gLightArc",
+	"gLightScale",
+	"gLightDirection",
+	"gLightShape",
+	"gShadowmapEnabled",
+	"gShadowmap",
+	"gLightProj"
+};
 
 ShaderProgram::ShaderProgram() : Asset() {
 	programObject = glCreateProgram();
+	findLightUniforms();
 }
 
 ShaderProgram::ShaderProgram(const char* _name) : Asset(_name) {
 	path = mainEngine->buildPath(_name).get();
 	programObject = glCreateProgram();
+	findLightUniforms();
 	loaded = FileHelper::readObject(path.get(), *this);
 }
 
@@ -57,6 +76,8 @@ int ShaderProgram::link() {
 		// successfully linked
 		mainEngine->msg(Engine::MSG_DEBUG, "linked shader program successfully");
 		broken = false;
+		uniforms.clear();
+		findLightUniforms();
 		return 0;
 	} else {
 		// show error message
@@ -78,7 +99,22 @@ int ShaderProgram::link() {
 		broken = true;
 		return 1;
 	}
-	uniforms.clear();
+}
+
+void ShaderProgram::findLightUniforms() {
+	GLint linked = GL_FALSE;
+	glGetProgramiv(programObject, GL_LINK_STATUS, &linked);
+
+	char buf[32];
+	for (int uniform = 0; uniform < LIGHT_UNIFORM_MAX; ++uniform) {
+		const char* name = lightUniformNames[uniform];
+		int len = (int)strlen(name);
+		for (Uint32 index = 0; index < maxLights; ++index) {
+			lightUniforms[uniform][index] = !linked ? -1 : glGetUniformLocation(programObject, uniformArray(buf, name, len, index));
+		}
+	}
+	numLightsUniform = !linked ? -1 : glGetUniformLocation(programObject, "gNumLights");
+	lightsUploaded = 0;
 }
 
 ShaderProgram& ShaderProgram::mount() {
@@ -139,72 +175,119 @@ const char* ShaderProgram::uniformArray(char* buf, const char* name, int len, in
 	return buf;
 }
 
-Uint32 ShaderProgram::uploadLights(const Camera& camera, const ArrayList<Light*>& lights, Uint32 maxLights, Uint32 textureUnit) {
-	char buf[32];
-	Uint32 index = 0;
-	for (auto light : lights) {
-		Vector lightAng = light->getGlobalAng().toVector();
-		glm::vec3 lightDir(lightAng.x, -lightAng.z, lightAng.y);
-		glm::vec3 lightPos(light->getGlobalPos().x, -light->getGlobalPos().z, light->getGlobalPos().y);
-		glm::vec3 lightScale(light->getGlobalScale().x, -light->getGlobalScale().z, light->getGlobalScale().y);
-
-		glUniform3fv(getUniformLocation(uniformArray(buf, "gLightPos", 9, index)), 1, glm::value_ptr(lightPos));
-		glUniform3fv(getUniformLocation(uniformArray(buf, "gLightColor", 11, index)), 1, glm::value_ptr(glm::vec3(light->getColor())));
-		glUniform1f(getUniformLocation(uniformArray(buf, "gLightIntensity", 15, index)), light->getIntensity());
-		glUniform1f(getUniformLocation(uniformArray(buf, "gLightRadius", 12, index)), light->getRadius());
-		glUniform1f(getUniformLocation(uniformArray(buf, "gLightArc", 9, index)), light->getArc() * PI / 180.f);
-		glUniform3fv(getUniformLocation(uniformArray(buf, "gLightScale", 11, index)), 1, glm::value_ptr(lightScale));
-		glUniform3fv(getUniformLocation(uniformArray(buf, "gLightDirection", 15, index)), 1, glm::value_ptr(lightDir));
-		glUniform1i(getUniformLocation(uniformArray(buf, "gLightShape", 11, index)), static_cast<GLint>(light->getShape()));
-		if (light->isShadow() && light->getEntity()->isFlag(Entity::FLAG_SHADOW) && cvar_shadowsEnabled.toInt()) {
-			glUniform1i(getUniformLocation(uniformArray(buf, "gShadowmapEnabled", 17, index)), GL_TRUE);
-			glUniform1i(getUniformLocation(uniformArray(buf, "gShadowmap", 10, index)), textureUnit);
-			light->getShadowMap().bindForReading(GL_TEXTURE0 + textureUnit, GL_DEPTH_ATTACHMENT);
-			//glm::mat4 lightProj = glm::perspective( glm::radians(90.f), 1.f, 1.f, light->getRadius() );
-			glm::mat4 lightProj = Camera::makeInfReversedZProj(glm::radians(90.f), 1.f, 1.f);
-			glUniformMatrix4fv(getUniformLocation(uniformArray(buf, "gLightProj", 10, index)), 1, GL_FALSE, glm::value_ptr(lightProj));
-		} else {
-			glUniform1i(getUniformLocation(uniformArray(buf, "gShadowmapEnabled", 17, index)), GL_FALSE);
-			glUniform1i(getUniformLocation(uniformArray(buf, "gShadowmap", 10, index)), textureUnit);
-			camera.getEntity()->getWorld()->getDefaultShadow().bindForReading(GL_TEXTURE0 + textureUnit, GL_DEPTH_ATTACHMENT);
+void ShaderProgram::packLights(const Camera& camera, const ArrayList<Light*>& lights) {
+	lightblock_t& block = lightBlock;
+	block.source = &lights;
+	block.camera = &camera;
+	block.numLights = std::min(lights.getSize(), (Uint32)maxLights);
+	++block.generation;
+	if (block.generation == 0) {
+		// zero means "nothing uploaded"
+		++block.generation;
+	}
+	++lightStats.packs;
+
+	const Shadow* defaultShadow = &camera.getEntity()->getWorld()->getDefaultShadow();
+	const bool shadowsEnabled = cvar_shadowsEnabled.toInt() != 0;
+	for (Uint32 index = 0; index < maxLights; ++index) {
+		if (index >= block.numLights) {
+			block.shadowmapEnabled[index] = GL_FALSE;
+			block.shadowMaps[index] = defaultShadow;
+			continue;
 		}
+		Light* light = lights[index];
+		Vector lightAng = light->getGlobalAng().toVector();
+		const Vector& pos = light->getGlobalPos();
+		const Vector& scale = light->getGlobalScale();
+		glm::vec3 color(light->getColor());
 
-		++index;
-		++textureUnit;
-		if (index >= maxLights) {
-			break;
+		block.pos[index * 3 + 0] = pos.x;
+		block.pos[index * 3 + 1] = -pos.z;
+		block.pos[index * 3 + 2] = pos.y;
+		block.color[index * 3 + 0] = color.r;
+		block.color[index * 3 + 1] = color.g;
+		block.color[index * 3 + 2] = color.b;
+		block.intensity[index] = light->getIntensity();
+		block.radius[index] = light->getRadius();
+		block.arc[index] = light->getArc() * PI / 180.f;
+		block.scale[index * 3 + 0] = scale.x;
+		block.scale[index * 3 + 1] = -scale.z;
+		block.scale[index * 3 + 2] = scale.y;
+		block.direction[index * 3 + 0] = lightAng.x;
+		block.direction[index * 3 + 1] = -lightAng.z;
+		block.direction[index * 3 + 2] = lightAng.y;
+		block.shape[index] = static_cast<GLint>(light->getShape());
+
+		if (light->isShadow() && light->getEntity()->isFlag(Entity::FLAG_SHADOW) && shadowsEnabled) {
+			block.shadowmapEnabled[index] = GL_TRUE;
+			block.shadowMaps[index] = &light->getShadowMap();
+		} else {
+			block.shadowmapEnabled[index] = GL_FALSE;
+			block.shadowMaps[index] = defaultShadow;
 		}
 	}
-	for (; index < maxLights; ++index) {
-		glUniform1i(getUniformLocation(uniformArray(buf, "gShadowmapEnabled", 17, index)), GL_FALSE);
-		glUniform1i(getUniformLocation(uniformArray(buf, "gShadowmap", 10, index)), textureUnit);
-		camera.getEntity()->getWorld()->getDefaultShadow().bindForReading(GL_TEXTURE0 + textureUnit, GL_DEPTH_ATTACHMENT);
-		++textureUnit;
+}
+
+Uint32 ShaderProgram::uploadLights(const Camera& camera, const ArrayList<Light*>& lights, Uint32 maxLights, Uint32 textureUnit) {
+	const lightblock_t& block = lightBlock;
+	if (block.source != &lights || block.camera != &camera || block.numLights != std::min(lights.getSize(), (Uint32)ShaderProgram::maxLights)) {
+		packLights(camera, lights);
 	}
+	const Uint32 numLights = std::min(block.numLights, maxLights);
+	const Uint32 numSlots = std::min(maxLights, (Uint32)ShaderProgram::maxLights);
 
-	index = 0u;
-	for (auto light : lights) {
-		/*if (light->isShadow() && light->getEntity()->isFlag(Entity::FLAG_SHADOW) && cvar_shadowsEnabled.toInt()) {
-			glUniform1i(getUniformLocation(uniformArray(buf, "gUIDmap", 7, index)), textureUnit);
-			light->getShadowMap().bindForReading(GL_TEXTURE0 + textureUnit, GL_COLOR_ATTACHMENT0);
-		} else {
-			glUniform1i(getUniformLocation(uniformArray(buf, "gUIDmap", 7, index)), textureUnit);
-			camera.getEntity()->getWorld()->getDefaultShadow().bindForReading(GL_TEXTURE0 + textureUnit, GL_COLOR_ATTACHMENT0);
-		}*/
-
-		++index;
-		++textureUnit;
-		if (index >= maxLights) {
-			break;
+	// uniform values live in the program, so only the first draw after a pack (or a texture unit change) sends them.
+	// every array is sent in one call starting from element zero
+	if (lightsUploaded != block.generation || lightsTextureUnit != textureUnit) {
+		lightsUploaded = block.generation;
+		lightsTextureUnit = textureUnit;
+		++lightStats.uploads;
+
+		if (numLights) {
+			glUniform3fv(lightUniforms[LIGHT_POS][0], numLights, block.pos);
+			glUniform3fv(lightUniforms[LIGHT_COLOR][0], numLights, block.color);
+			glUniform1fv(lightUniforms[LIGHT_INTENSITY][0], numLights, block.intensity);
+			glUniform1fv(lightUniforms[LIGHT_RADIUS][0], numLights, block.radius);
+			glUniform1fv(lightUniforms[LIGHT_ARC][0], numLights, block.arc);
+			glUniform3fv(lightUniforms[LIGHT_SCALE][0], numLights, block.scale);
+			glUniform3fv(lightUniforms[LIGHT_DIRECTION][0], numLights, block.direction);
+			glUniform1iv(lightUniforms[LIGHT_SHAPE][0], numLights, block.shape);
 		}
+
+		GLint units[ShaderProgram::maxLights];
+		for (Uint32 index = 0; index < numSlots; ++index) {
+			units[index] = (GLint)(textureUnit + index);
+		}
+		glUniform1iv(lightUniforms[LIGHT_SHADOWMAP_ENABLED][0], numSlots, block.shadowmapEnabled);
+		glUniform1iv(lightUniforms[LIGHT_SHADOWMAP][0], numSlots, units);
+
+		//glm::mat4 lightProj = glm::perspective( glm::radians(90.f), 1.f, 1.f, light->getRadius() );
+		static const glm::mat4 lightProj = Camera::makeInfReversedZProj(glm::radians(90.f), 1.f, 1.f);
+		for (Uint32 index = 0; index < numLights; ++index) {
+			if (block.shadowmapEnabled[index]) {
+				glUniformMatrix4fv(lightUniforms[LIGHT_PROJ][index], 1, GL_FALSE, glm::value_ptr(lightProj));
+			}
+		}
+
+		glUniform1i(numLightsUniform, (GLint)numLights);
+	} else {
+		++lightStats.skipped;
+	}
+
+	// texture bindings are shared by every program, so they are always made
+	for (Uint32 index = 0; index < numSlots; ++index) {
+		block.shadowMaps[index]->bindForReading(GL_TEXTURE0 + textureUnit + index, GL_DEPTH_ATTACHMENT);
 	}
-	/*for (; index < maxLights; ++index) {
-		glUniform1i(getUniformLocation(uniformArray(buf, "gUIDmap", 7, index)), textureUnit);
-		camera.getEntity()->getWorld()->getDefaultShadow().bindForReading(GL_TEXTURE0 + textureUnit, GL_COLOR_ATTACHMENT0);
-		++textureUnit;
-	}*/
 
-	glUniform1i(getUniformLocation("gNumLights"), (GLint)lights.getSize());
+	// the units after the shadow maps stay reserved for the (disabled) UID maps
+	return textureUnit + numSlots + numLights;
+}
+
+static int console_lightStats(int argc, const char** argv) {
+	const ShaderProgram::lightstats_t& stats = ShaderProgram::getLightStats();
+	mainEngine->fmsg(Engine::MSG_INFO, "lights: %llu packs, %llu uploads, %llu draws reused uploaded lights",
+		(unsigned long long)stats.packs, (unsigned long long)stats.uploads, (unsigned long long)stats.skipped);
+	return 0;
+}
 
-	return textureUnit;
-}
\ No newline at end of file
+static Ccmd ccmd_lightStats("render.lights.stats", "prints how often light uniforms were packed, uploaded, and reused", &console_lightStats);
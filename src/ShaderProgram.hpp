@@ -9,6 +9,8 @@
 #include "Map.hpp"
 
 class Light;
+class Camera;
+class Shadow;
 
 //! A ShaderProgram links multiple Shader objects together into a single program that can be used to render an object
 class ShaderProgram : public Asset {
@@ -25,17 +27,80 @@ public:
 	ShaderProgram& operator=(const ShaderProgram&) = delete;
 	ShaderProgram& operator=(ShaderProgram&&) = delete;
 
+	//! most lights a program can be given at once
+	static const Uint32 maxLights = 16;
+
+	//! per-light uniform arrays, whose locations are resolved once when the program links
+	enum lightuniform_t {
+		LIGHT_POS,
+		LIGHT_COLOR,
+		LIGHT_INTENSITY,
+		LIGHT_RADIUS,
+		LIGHT_ARC,
+		LIGHT_SCALE,
+		LIGHT_DIRECTION,
+		LIGHT_SHAPE,
+		LIGHT_SHADOWMAP_ENABLED,
+		LIGHT_SHADOWMAP,
+		LIGHT_PROJ,
+		LIGHT_UNIFORM_MAX
+	};
+
+	//! light data for a draw pass, packed once and shared by every program that draws with it
+	struct lightblock_t {
+		const ArrayList<Light*>* source = nullptr;	//!< the list the block was packed from
+		const Camera* camera = nullptr;				//!< the camera the block was packed for
+		Uint32 generation = 0;						//!< bumped every time the block is repacked
+		Uint32 numLights = 0;
+		GLfloat pos[maxLights * 3];
+		GLfloat color[maxLights * 3];
+		GLfloat intensity[maxLights];
+		GLfloat radius[maxLights];
+		GLfloat arc[maxLights];
+		GLfloat scale[maxLights * 3];
+		GLfloat direction[maxLights * 3];
+		GLint shape[maxLights];
+		GLint shadowmapEnabled[maxLights];			//!< filled for all maxLights slots
+		const Shadow* shadowMaps[maxLights];		//!< filled for all maxLights slots
+	};
+
+	//! light upload counters
+	struct lightstats_t {
+		Uint64 packs = 0;		//!< times the light block was packed
+		Uint64 uploads = 0;		//!< draws which sent light uniforms to a program
+		Uint64 skipped = 0;		//!< draws whose program already held the packed lights
+	};
+
 	//! gets the location of a uniform variable
 	//! @param name the name of the variable to be retrieved
 	//! @return the location of the uniform with the given name
 	GLuint getUniformLocation(const char* name);
 
+	//! gets the location of an element in a per-light uniform array
+	//! @param uniform the uniform array
+	//! @param index the light index
+	//! @return the location of the element, or -1 if the program doesn't use it
+	GLint getLightUniformLocation(lightuniform_t uniform, Uint32 index) const {
+		return index < maxLights ? lightUniforms[uniform][index] : -1;
+	}
+
+	//! pack the given lights into the shared light block, to be reused by every draw until the next pack
+	//! @param camera The camera that the scene is being drawn from
+	//! @param lights The lights to pack
+	static void packLights(const Camera& camera, const ArrayList<Light*>& lights);
+
+	//! forget that this program holds the packed lights, eg after setting light uniforms by hand
+	void invalidateLights() { lightsUploaded = 0; }
+
+	static const lightstats_t&	getLightStats() { return lightStats; }
+
 	//! binds an attribute to a shader variable
 	//! @param index the index of the attribute to assign to the variable
 	//! @param name the name of the variable to bind the attribute to
 	void bindAttribLocation(GLuint index, const GLchar* name);
 
-	//! uploads light data to the shader, if it hasn't already been uploaded
+	//! uploads light data to the shader, if it hasn't already been uploaded.
+	//! the lights are packed first unless they are already in the light block
 	//! @param camera The camera that the scene is being drawn from
 	//! @param lights The lights to upload
 	//! @param maxLights Maximum number of lights that can be uploaded
@@ -72,4 +137,18 @@ private:
 	GLuint programObject = 0;
 	Map<StringBuf<32>, GLuint> uniforms;
 	bool broken = false;
+
+	//! locations of the per-light uniforms, indexed by [uniform][light]
+	GLint lightUniforms[LIGHT_UNIFORM_MAX][maxLights];
+	GLint numLightsUniform = -1;
+
+	//! generation of the light block last uploaded, and the texture unit its shadow maps started at
+	Uint32 lightsUploaded = 0;
+	Uint32 lightsTextureUnit = 0;
+
+	static lightblock_t lightBlock;
+	static lightstats_t lightStats;
+
+	//! resolve the per-light uniform locations
+	void findLightUniforms();
 };
@@ -5,12 +5,37 @@
 #include "Camera.hpp"
 #include "Sound.hpp"
 #include "Mixer.hpp"
+#include "Client.hpp"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+static Cvar cvar_streamThreshold("sound.stream.threshold", "sound files of at least this many kilobytes are streamed instead of decoded up front (wave files only; 0 disables streaming)", "1024");
 
 Sound::Sound(const char* _name) : Asset(_name) {
 	path = mainEngine->buildPath(_name).get();
 
 	mainEngine->fmsg(Engine::MSG_DEBUG, "loading sound '%s'...", _name);
-	if ((chunk = Mix_LoadWAV(path.get())) == NULL) {
+	ArrayList<Uint8> packed;
+	const bool isPacked = mainEngine->readPackedFile(path.get(), packed);
+
+	// long sounds are decoded as they play, so loading them only reads the header
+	struct stat st;
+	const Sint64 threshold = (Sint64)cvar_streamThreshold.toInt() * 1024;
+	if (!isPacked && threshold > 0 && stat(path.get(), &st) == 0 && (Sint64)st.st_size >= threshold &&
+		SoundStream::readHeader(path.get(), wave)) {
+		mainEngine->fmsg(Engine::MSG_DEBUG, "streaming sound '%s'", _name);
+		streamed = true;
+		loaded = true;
+		return;
+	}
+
+	if (isPacked) {
+		chunk = Mix_LoadWAV_RW(SDL_RWFromConstMem(packed.getArray(), (int)packed.getSize()), 1);
+	} else {
+		chunk = Mix_LoadWAV(path.get());
+	}
+	if (chunk == NULL) {
 		mainEngine->fmsg(Engine::MSG_ERROR, "unable to load sound file '%s': %s", _name, Mix_GetError());
 		return;
 	}
@@ -21,11 +46,37 @@ Sound::Sound(const char* _name) : Asset(_name) {
 }
 
 Sound::~Sound() {
-	alDeleteBuffers(1, &buffer);
-	Mix_FreeChunk(chunk);
+	// voices still on the sound must let go of its buffer first
+	Client* client = mainEngine ? mainEngine->getLocalClient() : nullptr;
+	Mixer* mixer = client ? client->getMixer() : nullptr;
+	if (mixer && mixer->isInitialized()) {
+		mixer->stopVoices(*this);
+	}
+	if (buffer) {
+		alDeleteBuffers(1, &buffer);
+	}
+	if (chunk) {
+		Mix_FreeChunk(chunk);
+	}
+}
+
+float Sound::getLength() const {
+	if (streamed) {
+		return wave.rate && wave.blockAlign ? (float)wave.dataSize / (float)(wave.rate * wave.blockAlign) : 0.f;
+	} else if (chunk) {
+		return (float)chunk->alen / (2.f * 44100.f);
+	} else {
+		return 0.f;
+	}
 }
 
 int Sound::play(const bool loop) {
+	if (streamed) {
+		Client* client = mainEngine->getLocalClient();
+		Mixer* mixer = client ? client->getMixer() : nullptr;
+		return mixer ? mixer->playStream(*this, loop) : -1;
+	}
+
 	int loops = loop ? -1 : 0;
 	int channel = Mix_PlayChannel(-1, chunk, loops);
 
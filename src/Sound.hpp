@@ -3,8 +3,11 @@
 #pragma once
 
 #include "Asset.hpp"
+#include "SoundStream.hpp"
 
 //! A Sound is an audio asset loaded from disk. You can play it directly here if you want.
+//! Long sounds are streamed: rather than being decoded up front, each playback decodes the file as it goes
+//! (see SoundStream). A streamed sound has no buffer, so it is played through the Mixer.
 class Sound : public Asset {
 public:
 	Sound() = default;
@@ -18,13 +21,20 @@ public:
 
 	//! plays the sound without any listener (2D)
 	//! @param loop if true, the sound will loop indefinitely; otherwise, it will only play once
-	//! @return the SDL_mixer channel that the sound is playing on, or -1 if there were errors
+	//! @return the SDL_mixer channel that the sound is playing on (or Mixer channel, if streamed), or -1 if there were errors
 	int play(const bool loop);
 
+	//! @return the length of the sound, in seconds
+	float getLength() const;
+
 	virtual type_t	        getType() const { return ASSET_SOUND; }
 	ALuint		        	getBuffer() const { return buffer; }
+	bool					isStreamed() const { return streamed; }
+	const SoundStream::wave_t&	getWave() const { return wave; }
 
 private:
 	ALuint buffer = 0;
 	Mix_Chunk* chunk = nullptr;
+	bool streamed = false;
+	SoundStream::wave_t wave;
 };
@@ -0,0 +1,328 @@
+// SoundStream.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "SoundStream.hpp"
+#include "Client.hpp"
+#include "Mixer.hpp"
+#include "Console.hpp"
+
+#include <chrono>
+#include <thread>
+
+// wave format tags
+static const Uint16 waveFormatPCM = 0x0001;
+static const Uint16 waveFormatFloat = 0x0003;
+static const Uint16 waveFormatExtensible = 0xFFFE;
+
+static Uint16 readLE16(const Uint8* p) {
+	return (Uint16)(p[0] | (p[1] << 8));
+}
+
+static Uint32 readLE32(const Uint8* p) {
+	return (Uint32)p[0] | ((Uint32)p[1] << 8) | ((Uint32)p[2] << 16) | ((Uint32)p[3] << 24);
+}
+
+ALenum SoundStream::wave_t::getFormat() const {
+	if (bits == 8) {
+		return channels == 2 ? AL_FORMAT_STEREO8 : AL_FORMAT_MONO8;
+	}
+	return channels == 2 ? AL_FORMAT_STEREO16 : AL_FORMAT_MONO16;
+}
+
+Uint32 SoundStream::wave_t::getFrameSize() const {
+	return channels * (bits == 8 ? 1 : 2);
+}
+
+bool SoundStream::readHeader(const char* path, wave_t& wave) {
+	FILE* fp = path ? fopen(path, "rb") : nullptr;
+	if (!fp) {
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	const long fileSize = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	Uint8 riff[12];
+	if (fread(riff, 1, sizeof(riff), fp) != sizeof(riff) || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+		fclose(fp);
+		return false;
+	}
+
+	// walk the chunks until the samples, which must come after the format
+	bool haveFormat = false;
+	Uint16 formatTag = 0;
+	Uint8 header[8];
+	while (fread(header, 1, sizeof(header), fp) == sizeof(header)) {
+		const Uint32 size = readLE32(header + 4);
+		const long start = ftell(fp);
+		if (memcmp(header, "fmt ", 4) == 0) {
+			Uint8 format[26];
+			const size_t len = fread(format, 1, std::min((size_t)size, sizeof(format)), fp);
+			if (len < 16) {
+				break;
+			}
+			formatTag = readLE16(format);
+			wave.channels = readLE16(format + 2);
+			wave.rate = readLE32(format + 4);
+			wave.blockAlign = readLE16(format + 12);
+			wave.bits = readLE16(format + 14);
+			if (formatTag == waveFormatExtensible && len >= 26) {
+				formatTag = readLE16(format + 24);
+			}
+			haveFormat = true;
+		} else if (memcmp(header, "data", 4) == 0) {
+			if (!haveFormat) {
+				break;
+			}
+			wave.dataOffset = (Uint32)start;
+			wave.dataSize = (Uint32)std::min((long)size, fileSize - start);
+			wave.floatingPoint = formatTag == waveFormatFloat;
+			fclose(fp);
+
+			const bool supported =
+				(formatTag == waveFormatPCM && (wave.bits == 8 || wave.bits == 16 || wave.bits == 24 || wave.bits == 32)) ||
+				(formatTag == waveFormatFloat && wave.bits == 32);
+			return supported &&
+				(wave.channels == 1 || wave.channels == 2) &&
+				wave.rate > 0 &&
+				wave.blockAlign == wave.channels * (wave.bits / 8);
+		}
+
+		// chunks are padded to an even size
+		if (fseek(fp, start + (long)size + (long)(size & 1), SEEK_SET) != 0) {
+			break;
+		}
+	}
+	fclose(fp);
+	return false;
+}
+
+SoundStream::SoundStream(const char* _path, const wave_t& _wave, ALuint _source, bool _loop) :
+	path(_path),
+	wave(_wave),
+	source(_source),
+	loop(_loop)
+{
+	for (Uint32 c = 0; c < numBuffers; ++c) {
+		buffers[c] = 0;
+	}
+}
+
+SoundStream::~SoundStream() {
+	if (source) {
+		// buffers cannot be deleted while they are queued
+		alSourceStop(source);
+		alSourcei(source, AL_BUFFER, 0);
+	}
+	if (buffers[0]) {
+		alDeleteBuffers(numBuffers, buffers);
+	}
+	if (fp) {
+		fclose(fp);
+	}
+}
+
+bool SoundStream::start(float offset) {
+	// skip whole frames up to the offset
+	Uint32 skip = 0;
+	if (offset > 0.f && wave.blockAlign) {
+		skip = std::min((Uint32)(offset * wave.rate), wave.dataSize / wave.blockAlign) * wave.blockAlign;
+	}
+	fp = fopen(path.get(), "rb");
+	if (!fp || fseek(fp, (long)(wave.dataOffset + skip), SEEK_SET) != 0) {
+		return false;
+	}
+	remaining = wave.dataSize - skip;
+	bufferSize = std::max(wave.rate * bufferMilliseconds / 1000, 1U) * wave.getFrameSize();
+	alGenBuffers(numBuffers, buffers);
+	if (!fill(buffers[0])) {
+		return false;
+	}
+	alSourceQueueBuffers(source, 1, &buffers[0]);
+	alSourcePlay(source);
+
+	// with the first block playing, fill the rest of the ring
+	for (Uint32 c = 1; c < numBuffers; ++c) {
+		if (fill(buffers[c])) {
+			alSourceQueueBuffers(source, 1, &buffers[c]);
+		}
+	}
+	return true;
+}
+
+bool SoundStream::update() {
+	ALint processed = 0;
+	alGetSourcei(source, AL_BUFFERS_PROCESSED, &processed);
+	for (; processed > 0; --processed) {
+		ALuint buffer = 0;
+		alSourceUnqueueBuffers(source, 1, &buffer);
+		if (fill(buffer)) {
+			alSourceQueueBuffers(source, 1, &buffer);
+		}
+	}
+
+	ALint state = AL_STOPPED;
+	ALint queued = 0;
+	alGetSourcei(source, AL_SOURCE_STATE, &state);
+	alGetSourcei(source, AL_BUFFERS_QUEUED, &queued);
+	if (state == AL_STOPPED) {
+		if (queued == 0) {
+			return false;
+		}
+
+		// the source ran dry before the stream caught up
+		alSourcePlay(source);
+	}
+	return true;
+}
+
+bool SoundStream::fill(ALuint buffer) {
+	if (!fp) {
+		return false;
+	}
+	const Uint32 frames = bufferSize / wave.getFrameSize();
+	const Uint32 want = frames * wave.blockAlign;
+	raw.resize(want);
+
+	Uint32 got = 0;
+	Uint32 gotAtRestart = UINT32_MAX;
+	while (got < want) {
+		if (remaining == 0) {
+			// a loop which yields nothing would spin forever
+			if (!loop || got == gotAtRestart) {
+				break;
+			}
+			gotAtRestart = got;
+			fseek(fp, (long)wave.dataOffset, SEEK_SET);
+			remaining = wave.dataSize;
+		}
+		const Uint32 len = std::min(want - got, remaining);
+		const Uint32 read = (Uint32)fread(&raw[got], 1, len, fp);
+		got += read;
+		remaining -= read;
+		if (read < len) {
+			remaining = 0;
+		}
+	}
+	got -= got % wave.blockAlign;
+	if (got == 0) {
+		return false;
+	}
+
+	// 8 and 16-bit samples are handed over as they are, anything wider is cut down to 16 bits
+	const Uint32 numFrames = got / wave.blockAlign;
+	const Uint32 numSamples = numFrames * wave.channels;
+	const Uint8* data = raw.getArray();
+	Uint32 size = got;
+	if (wave.bits > 16) {
+		pcm.resize(numSamples * 2);
+		Sint16* out = (Sint16*)pcm.getArray();
+		const Uint32 stride = wave.bits / 8;
+		for (Uint32 c = 0; c < numSamples; ++c) {
+			const Uint8* sample = data + c * stride;
+			if (wave.floatingPoint) {
+				float value;
+				memcpy(&value, sample, sizeof(value));
+				value = std::min(std::max(value, -1.f), 1.f);
+				out[c] = (Sint16)(value * 32767.f);
+			} else {
+				out[c] = (Sint16)readLE16(sample + stride - 2);
+			}
+		}
+		data = pcm.getArray();
+		size = numSamples * 2;
+	}
+	alBufferData(buffer, wave.getFormat(), data, (ALsizei)size, (ALsizei)wave.rate);
+	return true;
+}
+
+// plays a source until its first sample has been mixed
+// @return the seconds it took, or a negative number if it never started
+static double waitForFirstSample(ALuint source, SoundStream* stream, std::chrono::high_resolution_clock::time_point start) {
+	for (;;) {
+		ALint offset = 0;
+		alGetSourcei(source, AL_SAMPLE_OFFSET, &offset);
+		auto now = std::chrono::high_resolution_clock::now();
+		const double elapsed = std::chrono::duration<double>(now - start).count();
+		if (offset > 0) {
+			return elapsed;
+		}
+		if (elapsed > 2.0) {
+			return -1.0;
+		}
+		if (stream) {
+			stream->update();
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(250));
+	}
+}
+
+static int console_streamBenchmark(int argc, const char** argv) {
+	if (argc < 2) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "A sound file is needed. ex: sound.stream.benchmark sounds/music/theme.wav");
+		return 1;
+	}
+	Client* client = mainEngine->getLocalClient();
+	Mixer* mixer = client ? client->getMixer() : nullptr;
+	if (!mixer || !mixer->isInitialized()) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "An audio device is needed (ALSOFT_DRIVERS=null or wave gives a silent one).");
+		return 1;
+	}
+	String path = mainEngine->buildPath(argv[1]).get();
+	SoundStream::wave_t wave;
+	if (!SoundStream::readHeader(path.get(), wave)) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "'%s' is not a wave file that can be streamed", path.get());
+		return 1;
+	}
+
+	// whole: decode everything and upload it into one buffer, as a Sound which is not streamed does
+	ALuint source = 0, buffer = 0;
+	alGenSources(1, &source);
+	alSourcef(source, AL_GAIN, 0.f);
+	auto start = std::chrono::high_resolution_clock::now();
+	Mix_Chunk* chunk = Mix_LoadWAV(path.get());
+	if (!chunk) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "failed to load '%s': %s", path.get(), Mix_GetError());
+		alDeleteSources(1, &source);
+		return 1;
+	}
+	alGenBuffers(1, &buffer);
+	alBufferData(buffer, AL_FORMAT_MONO16, chunk->abuf, chunk->alen, 44100);
+	const double wholeLoad = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	alSourcei(source, AL_BUFFER, buffer);
+	alSourcePlay(source);
+	const double wholeFirst = waitForFirstSample(source, nullptr, start);
+	const Uint64 wholeBytes = (Uint64)chunk->alen * 2; // the chunk, and OpenAL's copy
+	alSourceStop(source);
+	alSourcei(source, AL_BUFFER, 0);
+	alDeleteBuffers(1, &buffer);
+	Mix_FreeChunk(chunk);
+
+	// streamed: decode the first block and start playing, then keep the ring topped up
+	start = std::chrono::high_resolution_clock::now();
+	double streamFirst = -1.0;
+	Uint64 streamBytes = 0;
+	{
+		SoundStream stream(path.get(), wave, source, false);
+		if (stream.start()) {
+			streamFirst = waitForFirstSample(source, &stream, start);
+			streamBytes = stream.getMemoryBytes();
+		}
+	}
+	alDeleteSources(1, &source);
+
+	auto ms = [](double seconds) { return seconds < 0.0 ? -1.0 : seconds * 1000.0; };
+	mainEngine->fmsg(Engine::MSG_INFO, "%s: %u Hz, %u channels, %u-bit, %u KB of samples",
+		argv[1], wave.rate, (unsigned)wave.channels, (unsigned)wave.bits, wave.dataSize / 1024);
+	mainEngine->fmsg(Engine::MSG_INFO, "whole: loaded in %.2f ms, first sample after %.2f ms, %llu KB resident",
+		ms(wholeLoad), ms(wholeFirst), (unsigned long long)(wholeBytes / 1024));
+	mainEngine->fmsg(Engine::MSG_INFO, "streamed: first sample after %.2f ms, %llu KB resident",
+		ms(streamFirst), (unsigned long long)(streamBytes / 1024));
+	if (wholeFirst < 0.0 || streamFirst < 0.0) {
+		mainEngine->fmsg(Engine::MSG_WARN, "the device never started mixing (-1 ms); try ALSOFT_DRIVERS=null");
+	}
+	return 0;
+}
+
+static Ccmd ccmd_streamBenchmark("sound.stream.benchmark", "times loading a wave file whole against streaming it, and compares the memory each keeps. ex: sound.stream.benchmark sounds/music/theme.wav", &console_streamBenchmark);
@@ -0,0 +1,88 @@
+//! @file SoundStream.hpp
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+#include "String.hpp"
+
+//! A SoundStream plays a long sound without ever holding all of it: the file is decoded a block at a time
+//! into a small ring of OpenAL buffers, which are queued on a source and refilled as it finishes with them.
+//! Streams are refilled by the Mixer's streaming thread (see Mixer::playVoice()); a Sound is streamed when
+//! its file is large enough (see the sound.stream.threshold cvar) and in a format a stream can decode.
+//! Only PCM wave files (8, 16, 24 or 32-bit integer, or 32-bit float, mono or stereo) can be streamed.
+class SoundStream {
+public:
+	//! buffers queued on the source at a time
+	static const Uint32 numBuffers = 4;
+
+	//! length of audio each buffer holds
+	static const Uint32 bufferMilliseconds = 250;
+
+	//! layout of a wave file's samples
+	struct wave_t {
+		Uint32 dataOffset = 0;		//!< start of the sample data, from the start of the file
+		Uint32 dataSize = 0;		//!< size of the sample data
+		Uint32 rate = 0;			//!< frames per second
+		Uint16 channels = 0;
+		Uint16 bits = 0;			//!< bits per sample in the file
+		Uint16 blockAlign = 0;		//!< bytes per frame in the file
+		bool floatingPoint = false;
+
+		//! @return the OpenAL format the samples are decoded to
+		ALenum getFormat() const;
+
+		//! @return bytes per frame once decoded
+		Uint32 getFrameSize() const;
+	};
+
+	//! read the header of a wave file
+	//! @param path the file to read
+	//! @param wave where to store the layout of the samples
+	//! @return true if the file is a wave file that can be streamed
+	static bool readHeader(const char* path, wave_t& wave);
+
+	//! @param _path the file to stream
+	//! @param _wave the layout of the file, from readHeader()
+	//! @param _source the OpenAL source to play on (owned by the caller)
+	//! @param _loop if true, the stream starts over when it reaches the end of the file
+	SoundStream(const char* _path, const wave_t& _wave, ALuint _source, bool _loop);
+	SoundStream(const SoundStream&) = delete;
+	SoundStream(SoundStream&&) = delete;
+	~SoundStream();
+
+	SoundStream& operator=(const SoundStream&) = delete;
+	SoundStream& operator=(SoundStream&&) = delete;
+
+	//! open the file, queue the first block and start the source playing
+	//! @param offset seconds into the sound to start from
+	//! @return true on success
+	bool start(float offset = 0.f);
+
+	//! refill the buffers the source has finished with, restarting it if it ran dry
+	//! @return false once the stream has played to the end
+	bool update();
+
+	ALuint		getSource() const			{ return source; }
+
+	//! @return the memory the stream keeps for samples, in bytes
+	Uint32		getMemoryBytes() const		{ return bufferSize * (numBuffers + 1) + raw.getMaxSize(); }
+
+private:
+	String path;
+	wave_t wave;
+	ALuint source = 0;
+	bool loop = false;
+
+	FILE* fp = nullptr;
+	Uint32 remaining = 0;			//!< bytes of sample data left to read before the end (or next loop)
+	ALuint buffers[numBuffers];
+	Uint32 bufferSize = 0;			//!< bytes of decoded samples per buffer
+	ArrayList<Uint8> raw;			//!< samples as read from the file
+	ArrayList<Uint8> pcm;			//!< samples as handed to OpenAL
+
+	//! decode the next block of the file into a buffer
+	//! @param buffer the buffer to fill
+	//! @return false if there was nothing left to decode
+	bool fill(ALuint buffer);
+};
@@ -0,0 +1,347 @@
+//! @file SpatialHash.hpp
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+#include "Map.hpp"
+#include "Vector.hpp"
+
+//! A SpatialHash sorts boxes into a sparse grid of uniform cells, so that overlap queries only visit nearby objects.
+//! Every cell remembers when its contents last changed. Callers can cache the result of a query and later ask
+//! for the newest change in the same region to find out whether the cached result is still good.
+//! Objects which would cover too many cells are kept in a separate list that every query checks.
+template <typename T>
+class SpatialHash {
+public:
+	//! most cells an object may cover before it is stored as an oversized object
+	static const Uint32 maxCellsPerObject = 64;
+
+	SpatialHash() = default;
+	SpatialHash(float _cellSize) :
+		cellSize(_cellSize) {}
+	SpatialHash(const SpatialHash&) = delete;
+	SpatialHash(SpatialHash&&) = delete;
+	~SpatialHash() = default;
+
+	SpatialHash& operator=(const SpatialHash&) = delete;
+	SpatialHash& operator=(SpatialHash&&) = delete;
+
+	float		getCellSize() const		{ return cellSize; }
+	Uint32		getNumObjects() const	{ return indices.getSize(); }
+	Uint32		getNumCells() const		{ return cells.getSize(); }
+	Uint32		getNumOversized() const	{ return oversized.objects.getSize(); }
+
+	//! @return a stamp no older than any change made so far
+	Uint32		getStamp() const		{ return stamp; }
+
+	//! change the size of the cells, re-sorting every object
+	//! @param _cellSize the new cell size (in world units)
+	void setCellSize(float _cellSize) {
+		if (_cellSize == cellSize || _cellSize <= 0.f) {
+			return;
+		}
+		cellSize = _cellSize;
+		cells.clear();
+		oversized.objects.clear();
+		resetStamp = ++stamp;
+		for (Uint32 c = 0; c < objects.getSize(); ++c) {
+			auto& object = objects[c];
+			if (object.used) {
+				object.range = rangeFor(object.min, object.max);
+				link(c);
+			}
+		}
+	}
+
+	//! insert an object, or move one that is already in the hash
+	//! @param id unique id of the object
+	//! @param value what queries return for this object
+	//! @param min the minimum corner of the object's bounds
+	//! @param max the maximum corner of the object's bounds
+	void update(Uint32 id, const T& value, const Vector& min, const Vector& max) {
+		Uint32* found = indices.find(id);
+		if (found) {
+			auto& object = objects[*found];
+			object.sweep = sweepCount;
+			if (object.value == value && object.min == min && object.max == max) {
+				return;
+			}
+			unlink(*found);
+			object.value = value;
+			object.min = min;
+			object.max = max;
+			object.range = rangeFor(min, max);
+			link(*found);
+		} else {
+			Uint32 index;
+			if (freeObjects.getSize()) {
+				index = freeObjects.pop();
+			} else {
+				index = objects.getSize();
+				objects.push(object_t());
+			}
+			auto& object = objects[index];
+			object.id = id;
+			object.value = value;
+			object.min = min;
+			object.max = max;
+			object.range = rangeFor(min, max);
+			object.sweep = sweepCount;
+			object.mark = 0;
+			object.used = true;
+			indices.insert(id, index);
+			link(index);
+		}
+	}
+
+	//! remove an object from the hash
+	//! @param id the id the object was inserted with
+	void remove(Uint32 id) {
+		Uint32* found = indices.find(id);
+		if (found) {
+			Uint32 index = *found;
+			unlink(index);
+			objects[index].used = false;
+			objects[index].value = T();
+			freeObjects.push(index);
+			indices.remove(id);
+		}
+	}
+
+	//! remove every object which has not been updated since the last sweep
+	void sweep() {
+		for (Uint32 c = 0; c < objects.getSize(); ++c) {
+			const auto& object = objects[c];
+			if (object.used && object.sweep != sweepCount) {
+				remove(object.id);
+			}
+		}
+		++sweepCount;
+	}
+
+	//! remove every object
+	void clear() {
+		objects.clear();
+		freeObjects.clear();
+		indices.clear();
+		cells.clear();
+		oversized.objects.clear();
+		resetStamp = ++stamp;
+	}
+
+	//! find every object whose bounds overlap a box
+	//! @param min the minimum corner of the box
+	//! @param max the maximum corner of the box
+	//! @param result the list to append to (each object appears once)
+	void query(const Vector& min, const Vector& max, ArrayList<T>& result) {
+		++mark;
+		range_t range = rangeFor(min, max);
+		if (range.getNumCells() > cells.getSize()) {
+			// cheaper to walk the cells we have than the cells we might have
+			for (auto& pair : cells) {
+				if (range.contains(pair.b.coords)) {
+					gather(pair.b.objects, min, max, result);
+				}
+			}
+		} else {
+			Sint32 coords[3];
+			for (coords[0] = range.min[0]; coords[0] <= range.max[0]; ++coords[0]) {
+				for (coords[1] = range.min[1]; coords[1] <= range.max[1]; ++coords[1]) {
+					for (coords[2] = range.min[2]; coords[2] <= range.max[2]; ++coords[2]) {
+						const cell_t* cell = cells.find(keyFor(coords));
+						if (cell) {
+							gather(cell->objects, min, max, result);
+						}
+					}
+				}
+			}
+		}
+		gather(oversized.objects, min, max, result);
+	}
+
+	//! find the newest change made in a region
+	//! @param min the minimum corner of the region
+	//! @param max the maximum corner of the region
+	//! @return the stamp of the newest change to any object overlapping the region
+	Uint32 getStamp(const Vector& min, const Vector& max) const {
+		Uint32 result = std::max(resetStamp, oversized.stamp);
+		range_t range = rangeFor(min, max);
+		if (range.getNumCells() > cells.getSize()) {
+			for (auto& pair : cells) {
+				if (range.contains(pair.b.coords)) {
+					result = std::max(result, pair.b.stamp);
+				}
+			}
+		} else {
+			Sint32 coords[3];
+			for (coords[0] = range.min[0]; coords[0] <= range.max[0]; ++coords[0]) {
+				for (coords[1] = range.min[1]; coords[1] <= range.max[1]; ++coords[1]) {
+					for (coords[2] = range.min[2]; coords[2] <= range.max[2]; ++coords[2]) {
+						const cell_t* cell = cells.find(keyFor(coords));
+						if (cell) {
+							result = std::max(result, cell->stamp);
+						}
+					}
+				}
+			}
+		}
+		return result;
+	}
+
+private:
+	//! cell coordinates are clamped to this many cells either side of the origin
+	static const Sint32 coordLimit = (1 << 20) - 1;
+
+	//! the cells covered by a box
+	struct range_t {
+		Sint32 min[3];
+		Sint32 max[3];
+
+		Uint64 getNumCells() const {
+			return (Uint64)(max[0] - min[0] + 1) * (Uint64)(max[1] - min[1] + 1) * (Uint64)(max[2] - min[2] + 1);
+		}
+		bool contains(const Sint32 (&coords)[3]) const {
+			return coords[0] >= min[0] && coords[0] <= max[0] &&
+				coords[1] >= min[1] && coords[1] <= max[1] &&
+				coords[2] >= min[2] && coords[2] <= max[2];
+		}
+	};
+
+	struct object_t {
+		Uint32 id = 0;
+		T value = T();
+		Vector min;
+		Vector max;
+		range_t range;
+		Uint32 sweep = 0;		//!< sweep count when the object was last updated
+		Uint32 mark = 0;		//!< last query which visited the object
+		bool used = false;
+	};
+
+	struct cell_t {
+		ArrayList<Uint32> objects;
+		Uint32 stamp = 0;		//!< newest change to this cell
+		Sint32 coords[3] = { 0, 0, 0 };
+	};
+
+	float cellSize = 512.f;
+	ArrayList<object_t> objects;
+	ArrayList<Uint32> freeObjects;
+	Map<Uint32, Uint32> indices;	//!< object id -> index into objects
+	Map<Uint64, cell_t> cells;
+	cell_t oversized;
+	Uint32 stamp = 0;
+	Uint32 resetStamp = 0;			//!< stamp of the last clear, which every region has seen
+	Uint32 sweepCount = 1;
+	Uint32 mark = 0;
+
+	Sint32 coordFor(float f) const {
+		const float cell = f / cellSize;
+		if (!(cell > (float)-coordLimit)) {
+			return -coordLimit;	// also catches NaN
+		} else if (!(cell < (float)coordLimit)) {
+			return coordLimit;
+		}
+		return (Sint32)floorf(cell);
+	}
+
+	range_t rangeFor(const Vector& min, const Vector& max) const {
+		range_t range;
+		range.min[0] = coordFor(min.x); range.max[0] = std::max(range.min[0], coordFor(max.x));
+		range.min[1] = coordFor(min.y); range.max[1] = std::max(range.min[1], coordFor(max.y));
+		range.min[2] = coordFor(min.z); range.max[2] = std::max(range.min[2], coordFor(max.z));
+		return range;
+	}
+
+	//! pack cell coordinates into a key. The bits are scrambled with an invertible mix,
+	//! since the map takes the low bits of the key as its bucket
+	static Uint64 keyFor(const Sint32 (&coords)[3]) {
+		Uint64 key =
+			((Uint64)(coords[0] + coordLimit) << 42) |
+			((Uint64)(coords[1] + coordLimit) << 21) |
+			((Uint64)(coords[2] + coordLimit));
+		key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+		return key ^ (key >> 31);
+	}
+
+	//! add an object to the cells it covers
+	void link(Uint32 index) {
+		const range_t& range = objects[index].range;
+		++stamp;
+		if (range.getNumCells() > maxCellsPerObject) {
+			oversized.objects.push(index);
+			oversized.stamp = stamp;
+			return;
+		}
+		Sint32 coords[3];
+		for (coords[0] = range.min[0]; coords[0] <= range.max[0]; ++coords[0]) {
+			for (coords[1] = range.min[1]; coords[1] <= range.max[1]; ++coords[1]) {
+				for (coords[2] = range.min[2]; coords[2] <= range.max[2]; ++coords[2]) {
+					Uint64 key = keyFor(coords);
+					cell_t* cell = cells.find(key);
+					if (!cell) {
+						cell_t newCell;
+						newCell.coords[0] = coords[0];
+						newCell.coords[1] = coords[1];
+						newCell.coords[2] = coords[2];
+						cells.insert(key, newCell);
+						cell = cells.find(key);
+					}
+					cell->objects.push(index);
+					cell->stamp = stamp;
+				}
+			}
+		}
+	}
+
+	//! remove an object from the cells it covers. Emptied cells are kept so that they remember the change
+	void unlink(Uint32 index) {
+		const range_t& range = objects[index].range;
+		++stamp;
+		if (range.getNumCells() > maxCellsPerObject) {
+			unlinkFrom(oversized, index);
+			return;
+		}
+		Sint32 coords[3];
+		for (coords[0] = range.min[0]; coords[0] <= range.max[0]; ++coords[0]) {
+			for (coords[1] = range.min[1]; coords[1] <= range.max[1]; ++coords[1]) {
+				for (coords[2] = range.min[2]; coords[2] <= range.max[2]; ++coords[2]) {
+					cell_t* cell = cells.find(keyFor(coords));
+					if (cell) {
+						unlinkFrom(*cell, index);
+					}
+				}
+			}
+		}
+	}
+
+	void unlinkFrom(cell_t& cell, Uint32 index) {
+		for (Uint32 c = 0; c < cell.objects.getSize(); ++c) {
+			if (cell.objects[c] == index) {
+				cell.objects[c] = cell.objects.peek();
+				cell.objects.pop();
+				break;
+			}
+		}
+		cell.stamp = stamp;
+	}
+
+	//! append the objects in a cell which overlap a box and have not been visited by this query
+	void gather(const ArrayList<Uint32>& list, const Vector& min, const Vector& max, ArrayList<T>& result) {
+		for (auto index : list) {
+			auto& object = objects[index];
+			if (object.mark == mark) {
+				continue;
+			}
+			object.mark = mark;
+			if (object.max.x < min.x || object.min.x > max.x ||
+				object.max.y < min.y || object.min.y > max.y ||
+				object.max.z < min.z || object.min.z > max.z) {
+				continue;
+			}
+			result.push(object.value);
+		}
+	}
+};
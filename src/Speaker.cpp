@@ -22,10 +22,10 @@ const char* Speaker::materialStr = "assets/editor/speaker/material.json";
 Speaker::Speaker(Entity& _entity, Component* _parent) :
 	Component(_entity, _parent) {
 	for (int i = 0; i < maxSources; ++i) {
-		sources[i] = 0;
+		voices[i] = 0;
 	}
 
-	name = typeStr[COMPONENT_SPEAKER];
+	setName(typeStr[COMPONENT_SPEAKER]);
 
 	// add a bbox for editor usage
 	if (mainEngine->isEditorRunning()) {
@@ -40,12 +40,18 @@ Speaker::Speaker(Entity& _entity, Component* _parent) :
 	attributes.push(new AttributeFile("Default Sound", "wav,ogg,mp3,FLAC,mod", defaultSound));
 	attributes.push(new AttributeBool("Loop", defaultLoop));
 	attributes.push(new AttributeFloat("Range", defaultRange));
+	attributes.push(new AttributeInt("Priority", priority));
 }
 
 Speaker::~Speaker() {
 	stopAllSounds();
 }
 
+static Mixer* getMixer() {
+	Client* client = mainEngine->getLocalClient();
+	return client ? client->getMixer() : nullptr;
+}
+
 int Speaker::playSound(const char* _name, const bool loop, float range) {
 	if (!_name || strlen(_name) == 0) {
 		return -1;
@@ -57,11 +63,16 @@ int Speaker::playSound(const char* _name, const bool loop, float range) {
 		return -1;
 	}
 
+	Mixer* mixer = getMixer();
+	if (!mixer) {
+		return -1;
+	}
+
 	Sound* sound = mainEngine->getSoundResource().dataForString(StringBuf<64>("%s", 1, _name).get());
 	if (sound) {
 		int index = maxSources;
 		for (int i = 0; i < maxSources; ++i) {
-			if (sources[i] == 0) {
+			if (!mixer->isVoicePlaying(voices[i])) {
 				index = i;
 				break;
 			}
@@ -70,42 +81,14 @@ int Speaker::playSound(const char* _name, const bool loop, float range) {
 			mainEngine->fmsg(Engine::MSG_WARN, "'%s' cannot play sound '%s', no more available sources.", name.get(), _name);
 			return -1;
 		}
-		alGenSources(1, &sources[index]);
-		alSourcei(sources[index], AL_BUFFER, sound->getBuffer());
-		alSourcef(sources[index], AL_PITCH, 1.0f);
-		alSourcef(sources[index], AL_GAIN, 0.0f);
-		if (loop) {
-			alSourcei(sources[index], AL_LOOPING, AL_TRUE);
-		} else {
-			alSourcei(sources[index], AL_LOOPING, AL_FALSE);
-		}
 
-		// create low pass filter
-		alGenFilters(1, &filters[index]);
-		if (alIsFilter(filters[index]) && alGetError() == AL_NO_ERROR) {
-			alFilteri(filters[index], AL_FILTER_TYPE, AL_FILTER_LOWPASS);
-			if (alGetError() != AL_NO_ERROR) {
-				mainEngine->fmsg(Engine::MSG_ERROR, "failed to setup lowpass filter");
-			} else {
-				alSourcei(sources[index], AL_DIRECT_FILTER, filters[index]);
-			}
-		} else {
-			mainEngine->fmsg(Engine::MSG_ERROR, "failed to create lowpass filter");
+		// the voice stays silent until process() has placed it
+		voices[index] = mixer->playVoice(*sound, loop, range, std::min(priority, maxPriority), false);
+		if (!voices[index]) {
+			return -1;
 		}
-
-		// position and orient the sound in 3D space
-		auto& m = gMat;
-		ALfloat orientation[6] = { m[0][0], m[0][1], m[0][2], m[1][0], m[1][1], m[1][2] };
-
-		float f = 2.f / World::tileSize;
-		alSource3f(sources[index], AL_POSITION, gPos.x*f, -gPos.z*f, gPos.y*f);
-		alSource3f(sources[index], AL_VELOCITY, entity->getVel().x*f, -entity->getVel().z*f, entity->getVel().y*f);
-		alSourcefv(sources[index], AL_DIRECTION, orientation);
-		alSourcef(sources[index], AL_REFERENCE_DISTANCE, range / World::tileSize);
-		//alSourcef(sources[index], AL_MAX_DISTANCE, range / Tile::size);
-
-		// play the sound
-		alSourcePlay(sources[index]);
+		mixer->setVoicePosition(voices[index], entity->getWorld(), gPos, entity->getVel(), Vector(gMat[0][0], gMat[0][1], gMat[0][2]));
+		mixer->setVoiceGain(voices[index], 0.f);
 		return index;
 	} else {
 		mainEngine->fmsg(Engine::MSG_WARN, "'%s' could not play sound '%s', sound not cached.", name.get(), _name);
@@ -123,29 +106,22 @@ bool Speaker::isPlayingAnything() const {
 }
 
 bool Speaker::isPlaying(int index) const {
-	if (!sources[index]) {
-		return false;
-	}
-	ALint state = AL_PLAYING;
-	alGetSourcei(sources[index], AL_SOURCE_STATE, &state);
-	if (state == AL_PLAYING) {
-		return true;
-	} else {
+	if (index < 0 || index >= maxSources || !voices[index]) {
 		return false;
 	}
+	Mixer* mixer = getMixer();
+	return mixer && mixer->isVoicePlaying(voices[index]);
 }
 
 bool Speaker::stopSound(const int index) {
 	if (index < 0 || index >= maxSources)
 		return false;
-	if (!sources[index])
+	if (!isPlaying(index)) {
+		voices[index] = 0;
 		return false;
-	if (!isPlaying(index))
-		return false;
-	alSourceStop(sources[index]);
-	alDeleteSources(1, &sources[index]);
-	alDeleteFilters(1, &filters[index]);
-	sources[index] = 0;
+	}
+	getMixer()->stopVoice(voices[index]);
+	voices[index] = 0;
 	return true;
 }
 
@@ -181,84 +157,34 @@ void Speaker::draw(Camera& camera, const ArrayList<Light*>& lights) {
 	}
 }
 
-static Cvar cvar_speakerCull("speaker.cull", "accuracy for speakers' occlusion culling", "7");
-
 void Speaker::process() {
 	Component::process();
 
-	// update sound sources
+	// forget voices which have finished
+	bool playing = false;
 	for (int i = 0; i < maxSources; ++i) {
-		if (sources[i]) {
-			ALint state = AL_STOPPED;
-			alGetSourcei(sources[i], AL_SOURCE_STATE, &state);
-			if (state == AL_PLAYING) {
-				auto& m = gMat;
-				ALfloat orientation[6] = { m[0][0], m[0][1], m[0][2], m[1][0], m[1][1], m[1][2] };
-
-				float f = 2.f / World::tileSize;
-				alSource3f(sources[i], AL_POSITION, gPos.x*f, -gPos.z*f, gPos.y*f);
-				alSource3f(sources[i], AL_VELOCITY, entity->getVel().x*f, -entity->getVel().z*f, entity->getVel().y*f);
-				alSourcefv(sources[i], AL_DIRECTION, orientation);
-
-				// figure out if the source and the listener are in the same world
-				bool inWorld = false;
-				Camera* camera = nullptr;
-				Mixer* mixer = nullptr;
-				if (entity->getWorld() != nullptr) {
-					if (!entity->getWorld()->isShowTools() || !mainEngine->isEditorRunning()) {
-						Client* client = mainEngine->getLocalClient();
-						if (client) {
-							mixer = client->getMixer();
-							if (mixer) {
-								camera = mixer->getListener();
-								if (camera) {
-									const Entity* listener = camera->getEntity();
-									if (listener) {
-										if (listener->getWorld() == entity->getWorld()) {
-											inWorld = true;
-										}
-									}
-								}
-							}
-						}
-					}
-				}
-
-				// if they are in the same world, do a line trace and
-				// apply a low-pass filter if an occluder blocks the sound source
-				if (inWorld) {
-					World* world = entity->getWorld();
-					LinkedList<World::hit_t> hits;
-					world->lineTraceList(camera->getGlobalPos(), gPos, hits);
-					bool newBlocked = false;
-					for (auto& hit : hits) {
-						if (hit.manifest && hit.manifest->entity) {
-							if (hit.manifest->entity->isFlag(Entity::FLAG_OCCLUDE)) {
-								newBlocked = true;
-								break;
-							}
-						}
-					}
-					if (blocked != newBlocked &&
-						(entity->getTicks() - timeSinceChange > (Uint32)mainEngine->getTicksPerSecond() || !timeSinceChange)) {
-						timeSinceChange = entity->getTicks();
-						blocked = newBlocked;
-					}
-					float oldFactor = lowpassFactor;
-					lowpassFactor = blocked ? min(1.f, lowpassFactor + 0.05f) : max(0.f, lowpassFactor - 0.05f);
-					if (oldFactor != lowpassFactor) {
-						alFilterf(filters[i], AL_LOWPASS_GAIN, 1.f - 0.75f * lowpassFactor);
-						alFilterf(filters[i], AL_LOWPASS_GAINHF, 1.f - 0.75f * lowpassFactor);
-						alSourcei(sources[i], AL_DIRECT_FILTER, filters[i]);
-					}
-					alSourcef(sources[i], AL_GAIN, 1.f);
-				} else {
-					alSourcef(sources[i], AL_GAIN, 0.f);
-				}
+		if (voices[i]) {
+			if (isPlaying(i)) {
+				playing = true;
 			} else {
-				alDeleteSources(1, &sources[i]);
-				alDeleteFilters(1, &filters[i]);
-				sources[i] = 0;
+				voices[i] = 0;
+			}
+		}
+	}
+	if (!playing) {
+		return;
+	}
+
+	// the mixer works out whether the listener can hear the voices, and how muffled they are
+	Mixer* mixer = getMixer();
+	if (mixer) {
+		World* world = entity->getWorld();
+		const bool editing = world && world->isShowTools() && mainEngine->isEditorRunning();
+		const Vector dir(gMat[0][0], gMat[0][1], gMat[0][2]);
+		for (int i = 0; i < maxSources; ++i) {
+			if (voices[i]) {
+				mixer->setVoicePosition(voices[i], world, gPos, entity->getVel(), dir);
+				mixer->setVoiceGain(voices[i], editing ? 0.f : 1.f);
 			}
 		}
 	}
@@ -302,11 +228,14 @@ void Speaker::load(FILE* fp) {
 void Speaker::serialize(FileInterface * file) {
 	Component::serialize(file);
 
-	Uint32 version = 0;
+	Uint32 version = 1;
 	file->property("Speaker::version", version);
 	file->property("defaultSound", defaultSound);
 	file->property("defaultLoop", defaultLoop);
 	file->property("defaultRange", defaultRange);
+	if (version >= 1) {
+		file->property("priority", priority);
+	}
 
 	if (file->isReading()) {
 		if (!defaultSound.empty()) {
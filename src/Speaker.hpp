@@ -19,6 +19,9 @@ public:
 	//! max sounds per component
 	static const int maxSources = 8;
 
+	//! priority of speakers' voices; 2D sounds play above all of them (see Mixer::maxPriority)
+	static const int maxPriority = 99;
+
 	//! speaker model
 	static const char* meshStr;
 	static const char* materialStr;
@@ -68,15 +71,18 @@ public:
 	const char*			getDefaultSound() const { return defaultSound.get(); }
 	bool				isDefaultLoop() const { return defaultLoop; }
 	float				getDefaultRange() const { return defaultRange; }
+	int					getPriority() const { return priority; }
 
 	void		setDefaultSound(const char* name) { defaultSound = name; }
 	void		setDefaultLoop(const bool b) { defaultLoop = b; }
 	void		setDefaultRange(const float _range) { defaultRange = _range; }
+	void		setPriority(const int _priority) { priority = std::min(_priority, maxPriority); }
 
 	Speaker& operator=(const Speaker& src) {
 		defaultSound = src.defaultSound;
 		defaultLoop = src.defaultLoop;
 		defaultRange = src.defaultRange;
+		priority = src.priority;
 		stopAllSounds();
 		playSound(defaultSound.get(), defaultLoop, defaultRange);
 		updateNeeded = true;
@@ -86,13 +92,10 @@ public:
 	Speaker& operator=(Speaker&&) = delete;
 
 private:
-	ALuint sources[maxSources];
-	ALuint filters[maxSources];
+	Uint32 voices[maxSources];		//!< mixer voices (see Mixer::playVoice()), or 0
 
 	String defaultSound;
 	bool defaultLoop = false;
 	float defaultRange = 256.f;
-	Uint32 timeSinceChange = 0;
-	bool blocked = true;
-	float lowpassFactor = 0.f;
+	int priority = 0;				//!< voices of higher priority speakers keep their sources over louder ones
 };
\ No newline at end of file
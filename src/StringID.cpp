@@ -0,0 +1,216 @@
+// StringID.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "StringID.hpp"
+#include "Map.hpp"
+
+#include <mutex>
+#include <chrono>
+
+//! an interned string
+struct stringentry_t {
+	const char* str = "";
+	Uint32 length = 0;
+	Uint32 hash = 0;
+};
+
+//! Entries live in fixed-size blocks which are never moved or freed, so a StringID can be turned back into
+//! its string without taking the lock. Only interning (and finding) a string has to lock.
+class StringTable {
+public:
+	static const Uint32 blockBits = 12;
+	static const Uint32 blockSize = 1 << blockBits;
+	static const Uint32 maxBlocks = 1024;
+
+	StringTable() {
+		blocks[0] = new stringentry_t[blockSize];
+		blocks[0][0].hash = hashString("", 0);
+		numStrings = 1;
+		slots.resize(1024);
+	}
+
+	const stringentry_t& entry(Uint32 id) const {
+		return blocks[id >> blockBits][id & (blockSize - 1)];
+	}
+
+	//! find a string's id
+	//! @param str the string
+	//! @param add if true, the string is interned when it is not in the table
+	//! @return the id, or 0 if the string is not in the table
+	Uint32 lookup(const char* str, bool add) {
+		if (!str || str[0] == '\0') {
+			return 0;
+		}
+		const Uint32 length = (Uint32)strlen(str);
+		const Uint32 hash = hashString(str, length);
+
+		std::lock_guard<std::mutex> guard(lock);
+		Uint32 mask = slots.getSize() - 1;
+		Uint32 index = hash & mask;
+		for (Uint32 id = slots[index]; id != 0; index = (index + 1) & mask, id = slots[index]) {
+			const stringentry_t& e = entry(id);
+			if (e.hash == hash && e.length == length && memcmp(e.str, str, length) == 0) {
+				return id;
+			}
+		}
+		if (!add) {
+			return 0;
+		}
+
+		const Uint32 id = numStrings;
+		const Uint32 block = id >> blockBits;
+		if (block >= maxBlocks) {
+			mainEngine->fmsg(Engine::MSG_ERROR, "string table is full, cannot intern '%s'", str);
+			return 0;
+		}
+		if (!blocks[block]) {
+			blocks[block] = new stringentry_t[blockSize];
+		}
+		char* copy = new char[length + 1];
+		memcpy(copy, str, length + 1);
+		stringentry_t& e = blocks[block][id & (blockSize - 1)];
+		e.str = copy;
+		e.length = length;
+		e.hash = hash;
+		++numStrings;
+		numBytes += length + 1;
+
+		// keep the index at most half full
+		if (numStrings * 2 > slots.getSize()) {
+			rehash(slots.getSize() * 2);
+		} else {
+			slots[index] = id;
+		}
+		return id;
+	}
+
+	Uint32 getNumStrings() {
+		std::lock_guard<std::mutex> guard(lock);
+		return numStrings;
+	}
+
+	Uint32 getSizeInBytes() {
+		std::lock_guard<std::mutex> guard(lock);
+		Uint32 numBlocks = (numStrings + blockSize - 1) >> blockBits;
+		return numBytes + numBlocks * blockSize * sizeof(stringentry_t) + slots.getSize() * sizeof(Uint32);
+	}
+
+private:
+	std::mutex lock;
+	stringentry_t* blocks[maxBlocks] = { nullptr };
+	Uint32 numStrings = 0;
+	Uint32 numBytes = 0;
+
+	//! open addressed index from string hashes to ids (0 is an empty slot)
+	ArrayList<Uint32> slots;
+
+	//! FNV-1a
+	static Uint32 hashString(const char* str, Uint32 length) {
+		Uint32 hash = 2166136261u;
+		for (Uint32 c = 0; c < length; ++c) {
+			hash ^= (Uint8)str[c];
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	void rehash(Uint32 size) {
+		slots.resize(0);
+		slots.resize(size);
+		const Uint32 mask = size - 1;
+		for (Uint32 id = 1; id < numStrings; ++id) {
+			Uint32 index = entry(id).hash & mask;
+			while (slots[index]) {
+				index = (index + 1) & mask;
+			}
+			slots[index] = id;
+		}
+	}
+};
+
+//! the table is made on first use and never destroyed, so StringIDs held by static objects stay valid
+static StringTable& getTable() {
+	static StringTable* table = new StringTable();
+	return *table;
+}
+
+StringID::StringID(const char* str) :
+	id(getTable().lookup(str, true)) {}
+
+StringID StringID::find(const char* str) {
+	StringID result;
+	result.id = getTable().lookup(str, false);
+	return result;
+}
+
+const char* StringID::get() const {
+	return getTable().entry(id).str;
+}
+
+Uint32 StringID::getLength() const {
+	return getTable().entry(id).length;
+}
+
+Uint32 StringID::getHash() const {
+	return getTable().entry(id).hash;
+}
+
+Uint32 StringID::getNumStrings() {
+	return getTable().getNumStrings();
+}
+
+Uint32 StringID::getSizeInBytes() {
+	return getTable().getSizeInBytes();
+}
+
+static int console_stringsStats(int argc, const char** argv) {
+	mainEngine->fmsg(Engine::MSG_INFO, "%u interned strings, %u bytes", StringID::getNumStrings(), StringID::getSizeInBytes());
+	return 0;
+}
+
+static Ccmd ccmd_stringsStats("strings.stats", "prints the number of interned strings and the memory they use", &console_stringsStats);
+
+static int console_stringsBenchmark(int argc, const char** argv) {
+	Uint32 count = 1000;
+	if (argc >= 2) {
+		count = std::max(1, (int)strtol(argv[1], nullptr, 10));
+	}
+	const Uint32 lookups = 1000000;
+
+	ArrayList<String> names;
+	ArrayList<StringID> ids;
+	Map<String, Uint32> byString;
+	Map<StringID, Uint32> byID;
+	for (Uint32 c = 0; c < count; ++c) {
+		StringBuf<32> name("bench.key.%u", 1, c);
+		names.push(String(name.get()));
+		ids.push(StringID(name.get()));
+		byString.insert(names.peek(), c);
+		byID.insert(ids.peek(), c);
+	}
+
+	// looking up by char* is how most callers use a string keyed map, which builds a String every time
+	typedef std::chrono::high_resolution_clock bench_clock;
+	Uint32 sum = 0;
+	auto start = bench_clock::now();
+	for (Uint32 c = 0; c < lookups; ++c) {
+		const Uint32* value = byString.find(names[c % count].get());
+		sum += value ? *value : 0;
+	}
+	const double stringTime = std::chrono::duration<double>(bench_clock::now() - start).count();
+
+	start = bench_clock::now();
+	for (Uint32 c = 0; c < lookups; ++c) {
+		const Uint32* value = byID.find(ids[c % count]);
+		sum += value ? *value : 0;
+	}
+	const double idTime = std::chrono::duration<double>(bench_clock::now() - start).count();
+
+	mainEngine->fmsg(Engine::MSG_INFO, "%u lookups in %u keys (checksum %u):", lookups, count, sum);
+	mainEngine->fmsg(Engine::MSG_INFO, "  String keys:   %.2f ns per lookup", stringTime * 1e9 / lookups);
+	mainEngine->fmsg(Engine::MSG_INFO, "  StringID keys: %.2f ns per lookup", idTime * 1e9 / lookups);
+	return 0;
+}
+
+static Ccmd ccmd_stringsBenchmark("strings.benchmark", "times map lookups keyed by String against lookups keyed by StringID. ex: strings.benchmark 1000", &console_stringsBenchmark);
@@ -0,0 +1,57 @@
+//! @file StringID.hpp
+
+#pragma once
+
+#include "Main.hpp"
+
+//! A StringID stands for a string held in a table shared by the whole engine (the string is "interned").
+//! Each distinct string gets a 32-bit id the first time it is seen, and keeps it until the program exits,
+//! so comparing or hashing StringIDs is an integer operation and needs no allocation.
+//! Id 0 is the empty string; it is also what find() returns for strings which were never interned.
+class StringID {
+public:
+	StringID() = default;
+	StringID(const StringID&) = default;
+	StringID(StringID&&) = default;
+	~StringID() = default;
+
+	StringID& operator=(const StringID&) = default;
+	StringID& operator=(StringID&&) = default;
+
+	//! intern a string, adding it to the table if it is new
+	//! @param str the string
+	explicit StringID(const char* str);
+
+	//! look up a string without adding it to the table
+	//! @param str the string
+	//! @return the string's id, or an empty StringID if the string has never been interned
+	static StringID find(const char* str);
+
+	//! @return the interned string (never nullptr)
+	const char* get() const;
+
+	//! @return the length of the string, in bytes
+	Uint32 getLength() const;
+
+	//! @return the hash of the string's characters, worked out once when it was interned
+	Uint32 getHash() const;
+
+	Uint32 getID() const { return id; }
+	bool empty() const { return id == 0; }
+
+	//! ids are handed out one after another, which spreads them evenly across a Map's buckets
+	//! @return the value Map uses to hash the StringID
+	unsigned long hash() const { return id; }
+
+	bool operator==(const StringID& src) const { return id == src.id; }
+	bool operator!=(const StringID& src) const { return id != src.id; }
+
+	//! @return the number of strings interned so far
+	static Uint32 getNumStrings();
+
+	//! @return the memory used by the table, in bytes
+	static Uint32 getSizeInBytes();
+
+private:
+	Uint32 id = 0;
+};
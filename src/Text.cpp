@@ -11,141 +11,19 @@
 #include "Renderer.hpp"
 #include "Client.hpp"
 #include "Text.hpp"
+#include "Font.hpp"
+
+#include <chrono>
 
 GLuint Text::vao = 0;
 GLuint Text::vbo[BUFFER_TYPE_LENGTH] = { 0 };
 
-const GLfloat Text::positions[8]{
-	0.f, 0.f,
-	0.f, 1.f,
-	1.f, 1.f,
-	1.f, 0.f
-};
-
-const GLfloat Text::texcoords[8]{
-	0.f, 0.f,
-	0.f, 1.f,
-	1.f, 1.f,
-	1.f, 0.f
-};
-
-const GLuint Text::indices[6]{
-	0, 1, 2,
-	0, 2, 3
-};
-
-Text::Text(const char* _name) : Asset(_name) {
-	loaded = true;
-}
-
-Text::~Text() {
-	if (surf) {
-		SDL_FreeSurface(surf);
-		surf = nullptr;
-	}
-	if (texid) {
-		glDeleteTextures(1, &texid);
-		texid = 0;
-	}
-}
-
-void Text::render() {
-	Client* client = mainEngine->getLocalClient();
-	if (!client) {
-		return;
-	}
-	Renderer* renderer = client->getRenderer();
-	if (!renderer) {
-		return;
-	} else if (!renderer->isInitialized()) {
-		return;
-	}
+Text Text::ring[ringSize];
+Uint32 Text::ringIndex = 0;
 
-	// load font
-	String strToRender;
-	StringBuf<64> fontName;
-	Uint32 fontIndex = 0u;
-	if ((fontIndex = name.find(fontBreak)) != String::npos) {
-		fontName = name.substr(fontIndex + 1, UINT32_MAX).get();
-		strToRender = name.substr(0, fontIndex).get();
-	} else {
-		fontName = Font::defaultFont;
-		strToRender = name.get();
-	}
-	Font* font = mainEngine->getFontResource().dataForString(fontName.get());
-	if (!font) {
-		return;
-	}
-	TTF_Font* ttf = font->getTTF();
-
-	const Sint32 xres = renderer->getXres();
-	SDL_Color colorBlack = { 0, 0, 0, 255 };
-	SDL_Color colorWhite = { 255, 255, 255, 255 };
-
-	if (surf) {
-		SDL_FreeSurface(surf);
-		surf = nullptr;
-	}
-
-	if (outlineSize > 0) {
-		TTF_SetFontOutline(ttf, outlineSize);
-		surf = TTF_RenderUTF8_Blended_Wrapped(ttf, strToRender.get(), colorBlack, xres);
-		TTF_SetFontOutline(ttf, 0);
-		SDL_Surface* text = TTF_RenderUTF8_Blended_Wrapped(ttf, strToRender.get(), colorWhite, xres);
-		SDL_Rect rect;
-		rect.x = 1; rect.y = 1;
-		SDL_BlitSurface(text, NULL, surf, &rect);
-		SDL_FreeSurface(text);
-	} else {
-		TTF_SetFontOutline(ttf, 0);
-		surf = TTF_RenderUTF8_Blended_Wrapped(ttf, strToRender.get(), colorWhite, xres);
-	}
-	assert(surf);
-	if (texid == 0) {
-		glGenTextures(1, &texid);
-	}
-
-	width = 0;
-	height = 0;
-	int scan = surf->pitch / surf->format->BytesPerPixel;
-	for (int y = 0; y < surf->h; ++y) {
-		for (int x = 0; x < surf->w; ++x) {
-			if (((Uint32 *)surf->pixels)[x + y * scan] != 0) {
-				width = max(width, x);
-				height = max(height, y);
-			}
-		}
-	}
-	width += 4;
-	height += 4;
-
-	// translate the original surface to an RGBA surface
-	SDL_Surface* newSurf = SDL_CreateRGBSurface(0, width, height, 32, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
-	SDL_Rect dest;
-	SDL_Rect src;
-	src.x = 0;
-	src.y = 0;
-	src.w = width;
-	src.h = height;
-	dest.x = 0;
-	dest.y = 0;
-	SDL_BlitSurface(surf, &src, newSurf, &dest); // blit onto a purely RGBA Surface
-	SDL_FreeSurface(surf);
-	surf = newSurf;
-
-	// load the new surface as a GL texture
-	SDL_LockSurface(surf);
-	glBindTexture(GL_TEXTURE_2D, texid);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, surf->w, surf->h);
-	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, surf->w, surf->h, GL_RGBA, GL_UNSIGNED_BYTE, surf->pixels);
-	SDL_UnlockSurface(surf);
-
-	rendered = true;
-}
+ArrayList<GLfloat> Text::positions;
+ArrayList<GLfloat> Text::texcoords;
+ArrayList<GLuint> Text::indices;
 
 void Text::createStaticData() {
 	// initialize buffer names
@@ -157,24 +35,19 @@ void Text::createStaticData() {
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao);
 
-	// upload vertex data
+	// vertex, texcoord and index data are uploaded with each text
 	glGenBuffers(1, &vbo[VERTEX_BUFFER]);
 	glBindBuffer(GL_ARRAY_BUFFER, vbo[VERTEX_BUFFER]);
-	glBufferData(GL_ARRAY_BUFFER, 4 * 2 * sizeof(GLfloat), positions, GL_DYNAMIC_DRAW);
 	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
 	glEnableVertexAttribArray(0);
 
-	// upload texcoord data
 	glGenBuffers(1, &vbo[TEXCOORD_BUFFER]);
 	glBindBuffer(GL_ARRAY_BUFFER, vbo[TEXCOORD_BUFFER]);
-	glBufferData(GL_ARRAY_BUFFER, 4 * 2 * sizeof(GLfloat), texcoords, GL_DYNAMIC_DRAW);
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, NULL);
 	glEnableVertexAttribArray(1);
 
-	// upload index data
 	glGenBuffers(1, &vbo[INDEX_BUFFER]);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo[INDEX_BUFFER]);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, 2 * 3 * sizeof(GLuint), indices, GL_STATIC_DRAW);
 
 	// unbind vertex array
 	glBindVertexArray(0);
@@ -202,10 +75,58 @@ void Text::drawColor(Rect<int> src, Rect<int> dest, const glm::vec4& color) {
 	int xres = renderer->getXres();
 	int yres = renderer->getYres();
 
-	if (!rendered) {
-		render();
+	// a get() since this text was laid out may have filled the atlas and started it over
+	if (atlas && generation != atlas->getGeneration()) {
+		atlas->layout(str.get(), wrap, quads, width, height);
+		generation = atlas->getGeneration();
+	}
+	if (!atlas || quads.empty()) {
+		return;
+	}
+
+	src.w = src.w <= 0 ? width : src.w;
+	src.h = src.h <= 0 ? height : src.h;
+	dest.w = dest.w <= 0 ? src.w : dest.w;
+	dest.h = dest.h <= 0 ? src.h : dest.h;
+	const float scaleX = (float)dest.w / (float)src.w;
+	const float scaleY = (float)dest.h / (float)src.h;
+	const float atlasW = (float)atlas->getWidth();
+	const float atlasH = (float)atlas->getHeight();
+
+	// clip each glyph to the subsection and place it on-screen
+	positions.resize(0);
+	texcoords.resize(0);
+	indices.resize(0);
+	for (auto& quad : quads) {
+		const int x0 = std::max(quad.dest.x, src.x);
+		const int y0 = std::max(quad.dest.y, src.y);
+		const int x1 = std::min(quad.dest.x + quad.dest.w, src.x + src.w);
+		const int y1 = std::min(quad.dest.y + quad.dest.h, src.y + src.h);
+		if (x0 >= x1 || y0 >= y1) {
+			continue;
+		}
+		const GLfloat u0 = (GLfloat)(quad.src.x + x0 - quad.dest.x) / atlasW;
+		const GLfloat v0 = (GLfloat)(quad.src.y + y0 - quad.dest.y) / atlasH;
+		const GLfloat u1 = (GLfloat)(quad.src.x + x1 - quad.dest.x) / atlasW;
+		const GLfloat v1 = (GLfloat)(quad.src.y + y1 - quad.dest.y) / atlasH;
+		const GLfloat left = dest.x + (x0 - src.x) * scaleX;
+		const GLfloat top = (GLfloat)yres - (dest.y + (y0 - src.y) * scaleY);
+		const GLfloat right = dest.x + (x1 - src.x) * scaleX;
+		const GLfloat bottom = (GLfloat)yres - (dest.y + (y1 - src.y) * scaleY);
+
+		const GLuint base = positions.getSize() / 2;
+		positions.push(left); positions.push(top);
+		positions.push(left); positions.push(bottom);
+		positions.push(right); positions.push(bottom);
+		positions.push(right); positions.push(top);
+		texcoords.push(u0); texcoords.push(v0);
+		texcoords.push(u0); texcoords.push(v1);
+		texcoords.push(u1); texcoords.push(v1);
+		texcoords.push(u1); texcoords.push(v0);
+		indices.push(base + 0); indices.push(base + 1); indices.push(base + 2);
+		indices.push(base + 0); indices.push(base + 2); indices.push(base + 3);
 	}
-	if (!rendered) {
+	if (indices.empty()) {
 		return;
 	}
 
@@ -221,17 +142,14 @@ void Text::drawColor(Rect<int> src, Rect<int> dest, const glm::vec4& color) {
 	//glDisable(GL_LIGHTING);
 	glEnable(GL_BLEND);
 
-	src.w = src.w <= 0 ? surf->w : src.w;
-	src.h = src.h <= 0 ? surf->h : src.h;
-	dest.w = dest.w <= 0 ? surf->w : dest.w;
-	dest.h = dest.h <= 0 ? surf->h : dest.h;
-
 	// create view matrix
 	glm::mat4 viewMatrix = glm::ortho(0.f, (float)xres, 0.f, (float)yres, 1.f, -1.f);
 
-	// bind texture
+	// bind texture (uploading any new glyphs)
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texid);
+	if (!atlas->bind()) {
+		return;
+	}
 
 	// upload uniform variables
 	glUniformMatrix4fv(shader.getUniformLocation("gView"), 1, GL_FALSE, glm::value_ptr(viewMatrix));
@@ -241,28 +159,16 @@ void Text::drawColor(Rect<int> src, Rect<int> dest, const glm::vec4& color) {
 	// bind vertex array
 	glBindVertexArray(vao);
 
-	// upload positions
-	GLfloat positions[8] = {
-		(GLfloat)dest.x, (GLfloat)(yres - dest.y),
-		(GLfloat)dest.x, (GLfloat)(yres - dest.y - dest.h),
-		(GLfloat)(dest.x + dest.w), (GLfloat)(yres - dest.y - dest.h),
-		(GLfloat)(dest.x + dest.w), (GLfloat)(yres - dest.y)
-	};
+	// upload geometry
 	glBindBuffer(GL_ARRAY_BUFFER, vbo[VERTEX_BUFFER]);
-	glBufferData(GL_ARRAY_BUFFER, 4 * 2 * sizeof(GLfloat), positions, GL_DYNAMIC_DRAW);
-
-	// upload texcoords
-	GLfloat texcoords[8] = {
-		(float)src.x / (float)surf->w, (float)src.y / (float)surf->h,
-		(float)src.x / (float)surf->w, (float)(src.y + src.h) / (float)surf->h,
-		(float)(src.x + src.w) / (float)surf->w, (float)(src.y + src.h) / (float)surf->h,
-		(float)(src.x + src.w) / (float)surf->w, (float)src.y / (float)surf->h
-	};
+	glBufferData(GL_ARRAY_BUFFER, positions.getSize() * sizeof(GLfloat), positions.getArray(), GL_DYNAMIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, vbo[TEXCOORD_BUFFER]);
-	glBufferData(GL_ARRAY_BUFFER, 4 * 2 * sizeof(GLfloat), texcoords, GL_DYNAMIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, texcoords.getSize() * sizeof(GLfloat), texcoords.getArray(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo[INDEX_BUFFER]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.getSize() * sizeof(GLuint), indices.getArray(), GL_DYNAMIC_DRAW);
 
 	// draw
-	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, NULL);
+	glDrawElements(GL_TRIANGLES, (GLsizei)indices.getSize(), GL_UNSIGNED_INT, NULL);
 	glBindVertexArray(0);
 }
 
@@ -273,14 +179,97 @@ Text* Text::get(const char* str, const char* font) {
 	if (font == nullptr || font[0] == '\0') {
 		font = Font::defaultFont;
 	}
-	size_t len0 = strlen(str);
-	size_t len1 = strlen(font);
-	String textAndFont;
-	textAndFont.alloc((Uint32)(len0 + len1 + 2));
-	textAndFont.format("%s%c%s", str, Text::fontBreak, font);
-	Text* text = mainEngine->getTextResource().dataForString(textAndFont.get());
-	if (text && !text->rendered) {
-		text->render();
+	Font* actualFont = mainEngine->getFontResource().dataForString(font);
+	if (!actualFont) {
+		return nullptr;
+	}
+	GlyphAtlas* atlas = actualFont->getAtlas();
+	if (!atlas) {
+		return nullptr;
+	}
+
+	// long lines wrap at the edge of the screen
+	int wrap = 0;
+	Client* client = mainEngine->getLocalClient();
+	Renderer* renderer = client ? client->getRenderer() : nullptr;
+	if (renderer && renderer->isInitialized()) {
+		wrap = renderer->getXres();
+	}
+
+	// text drawn every frame is usually still laid out from the last one
+	for (auto& text : ring) {
+		if (text.atlas == atlas && text.generation == atlas->getGeneration() && text.wrap == wrap && text.str == str) {
+			return &text;
+		}
 	}
-	return text;
-}
\ No newline at end of file
+
+	Text& text = ring[ringIndex];
+	ringIndex = (ringIndex + 1) % ringSize;
+	text.str = str;
+	text.atlas = atlas;
+	text.wrap = wrap;
+	atlas->layout(str, wrap, text.quads, text.width, text.height);
+	text.generation = atlas->getGeneration();
+	return &text;
+}
+
+static int console_textBenchmark(int argc, const char** argv) {
+	const Uint32 count = argc > 1 ? std::max((Uint32)strtol(argv[1], nullptr, 10), 1U) : 10000U;
+	const char* fontName = argc > 2 ? argv[2] : Font::defaultFont;
+	Font* font = mainEngine->getFontResource().dataForString(fontName);
+	GlyphAtlas* atlas = font ? font->getAtlas() : nullptr;
+	if (!atlas) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "failed to load font '%s'", fontName);
+		return 1;
+	}
+
+	// every string is different, like timers and coordinates. Nothing here needs a GPU
+	const Uint32 glyphsBefore = atlas->getNumGlyphs();
+	ArrayList<GlyphAtlas::quad_t> quads;
+	Uint32 numQuads = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (Uint32 c = 0; c < count; ++c) {
+		StringBuf<64> str("frame %u: x=%.2f y=%.2f", 3, c, c * 0.37f, c * -1.91f);
+		int w = 0, h = 0;
+		atlas->layout(str.get(), 0, quads, w, h);
+		numQuads += quads.getSize();
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	mainEngine->fmsg(Engine::MSG_INFO, "laid out %u unique strings (%u quads) in %.2f ms, %.2f us each",
+		count, numQuads, seconds * 1000.0, seconds * 1000000.0 / count);
+	mainEngine->fmsg(Engine::MSG_INFO, "atlas is %dx%d with %u glyphs (%u rasterized by the benchmark)",
+		atlas->getWidth(), atlas->getHeight(), atlas->getNumGlyphs(), atlas->getNumGlyphs() - glyphsBefore);
+	return 0;
+}
+
+static Ccmd ccmd_textBenchmark("text.benchmark", "lays out many different strings with a font's glyph atlas and reports the cost. ex: text.benchmark 10000 fonts/mono.ttf#16", &console_textBenchmark);
+
+static int console_textAtlasSave(int argc, const char** argv) {
+	if (argc < 2) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "A file is needed. ex: text.atlas.save atlas.bmp fonts/mono.ttf#16");
+		return 1;
+	}
+	const char* fontName = argc > 2 ? argv[2] : Font::defaultFont;
+	Font* font = mainEngine->getFontResource().dataForString(fontName);
+	GlyphAtlas* atlas = font ? font->getAtlas() : nullptr;
+	if (!atlas) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "failed to load font '%s'", fontName);
+		return 1;
+	}
+	const ArrayList<Uint32>& pixels = atlas->getPixels();
+	SDL_Surface* surf = SDL_CreateRGBSurfaceFrom((void*)pixels.getArray(), atlas->getWidth(), atlas->getHeight(), 32,
+		atlas->getWidth() * 4, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+	if (!surf || SDL_SaveBMP(surf, argv[1]) != 0) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "failed to save '%s': %s", argv[1], SDL_GetError());
+		if (surf) {
+			SDL_FreeSurface(surf);
+		}
+		return 1;
+	}
+	SDL_FreeSurface(surf);
+	mainEngine->fmsg(Engine::MSG_INFO, "saved %dx%d atlas of %u glyphs to '%s'", atlas->getWidth(), atlas->getHeight(), atlas->getNumGlyphs(), argv[1]);
+	return 0;
+}
+
+static Ccmd ccmd_textAtlasSave("text.atlas.save", "saves a font's glyph atlas to a bitmap. ex: text.atlas.save atlas.bmp fonts/mono.ttf#16", &console_textAtlasSave);
@@ -2,19 +2,20 @@
 
 #pragma once
 
-#include "Asset.hpp"
 #include "Main.hpp"
 #include "Rect.hpp"
 #include "String.hpp"
+#include "ArrayList.hpp"
+#include "GlyphAtlas.hpp"
 
-//! Contains some text that was rendered to a texture with a ttf font.
-class Text : public Asset {
+//! Contains some text laid out with a ttf font's glyph atlas (see GlyphAtlas), drawn as one batch of quads.
+//! Nothing is rasterized for a new string, only for glyphs the font has never drawn before.
+class Text {
 public:
 	Text() = default;
-	Text(const char* _name);
 	Text(const Text&) = delete;
 	Text(Text&&) = delete;
-	virtual ~Text();
+	~Text() = default;
 
 	Text& operator=(const Text&) = delete;
 	Text& operator=(Text&&) = delete;
@@ -22,23 +23,20 @@ public:
 	//! size of the black text outline
 	static const int outlineSize = 1;
 
-	//! special char marks font to be used
-	static const char fontBreak = 8;
+	//! number of texts get() lays out before reusing one
+	static const Uint32 ringSize = 64;
 
-	//! get a Text object from the engine
+	//! get a Text object from the engine. Texts live in a small ring which get() reuses, so the Text should
+	//! be drawn straight away: it is only good until get() has been called ringSize more times
 	//! @param str The Text's string
 	//! @param font the Text's font
 	//! @return the Text or nullptr if it could not be retrieved
 	static Text* get(const char* str, const char* font);
 
-	virtual type_t	        getType() const { return ASSET_TEXT; }
-	GLuint			        getTexID() const { return texid; }
-	const SDL_Surface*		getSurf() const { return surf; }
+	const char*				getString() const { return str.get(); }
 	unsigned int		    getWidth() const { return width; }
 	unsigned int		    getHeight()	const { return height; }
-
-	//! renders the text using its pre-specified parameters. this should usually not be called by the user.
-	void render();
+	const ArrayList<GlyphAtlas::quad_t>& getQuads() const { return quads; }
 
 	//! draws the text
 	//! @param src defines a subsection of the text image to actually draw (width 0 and height 0 uses whole image)
@@ -57,13 +55,23 @@ public:
 	static void deleteStaticData();
 
 private:
-	GLuint texid = 0;
-	SDL_Surface* surf = nullptr;
+	String str;
+	GlyphAtlas* atlas = nullptr;
+	Uint32 generation = 0;			//!< the atlas generation the quads were laid out in
+	int wrap = 0;
+	ArrayList<GlyphAtlas::quad_t> quads;
+
+	int width = 0;
+	int height = 0;
 
-	//! static geometry data for rendering the image to a quad
-	static const GLuint indices[6];
-	static const GLfloat positions[8];
-	static const GLfloat texcoords[8];
+	//! texts handed out by get()
+	static Text ring[ringSize];
+	static Uint32 ringIndex;
+
+	//! geometry for drawing, rebuilt for each text
+	static ArrayList<GLfloat> positions;
+	static ArrayList<GLfloat> texcoords;
+	static ArrayList<GLuint> indices;
 	enum buffer_t {
 		VERTEX_BUFFER,
 		TEXCOORD_BUFFER,
@@ -72,8 +80,4 @@ private:
 	};
 	static GLuint vbo[BUFFER_TYPE_LENGTH];
 	static GLuint vao;
-
-	int width = 0;
-	int height = 0;
-	bool rendered = false;
 };
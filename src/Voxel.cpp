@@ -1,16 +1,22 @@
 // Voxel.cpp
 
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "Console.hpp"
 #include "Voxel.hpp"
-#include "LinkedList.hpp"
+#include "ArrayList.hpp"
+#include "Adjacency.hpp"
+
+#include <chrono>
 
 // voxel structure
 typedef struct voxel_t
 {
 	~voxel_t() {
-		delete data;
+		delete[] data;
 	}
 	Sint32 sizex, sizey, sizez;
-	Uint8* data;
+	Uint8* data = nullptr;
 	Uint8 palette[256][3];
 } voxel_t;
 
@@ -28,959 +34,195 @@ typedef struct polyquad_t
 	int side;
 } polyquad_t;
 
-// triangle structure
-typedef struct polytriangle_t
+// describes how each of the six sides is sliced and merged.
+// quads are swept along the "a" axis and grown along the "b" axis; corners are laid out as
+// v0 = (a0, bStart), v1 = (a1, bStart), v2 = (a1, bEnd), v3 = (a0, bEnd), which keeps the winding
+// consistent with the face normal.
+typedef struct voxelside_t
 {
-	vertex_t vertex[3];
-	vertex_t normal[3];
-	Uint8 r, g, b;
-} polytriangle_t;
-
-// polymodel structure
-typedef struct polymodel_t
+	int n, a, b;		// normal, sweep and grow axes (0 = x, 1 = y, 2 = z)
+	int dir;			// direction of the normal along its axis
+	bool bStartHigh;	// true if v0/v1 sit on the high edge of the b axis
+} voxelside_t;
+
+static const voxelside_t voxelSides[6] = {
+	{ 0, 1, 2,  1, false },	// front  (+x)
+	{ 0, 1, 2, -1, true },	// back   (-x)
+	{ 1, 0, 2,  1, true },	// right  (+y)
+	{ 1, 0, 2, -1, false },	// left   (-y)
+	{ 2, 0, 1,  1, false },	// bottom (+z)
+	{ 2, 0, 1, -1, true },	// top    (-z)
+};
+
+// statistics from the last mesh generation, for the benchmark
+static Uint32 lastExposedFaces = 0;
+
+// greedy mesher: for every slice along every side, build a 2D mask of exposed faces and merge
+// same-colored runs into the largest rectangles possible. runs in O(voxels) with flat arrays.
+static void generateQuads(const voxel_t* model, ArrayList<polyquad_t>& quads)
 {
-	polytriangle_t* faces;
-	Uint32 numfaces;
-	GLuint vbo;
-	GLuint colors;
-	GLuint va;
-} polymodel_t;
+	const Sint32 size[3] = { model->sizex, model->sizey, model->sizez };
+	const Sint32 stride[3] = { model->sizey * model->sizez, model->sizez, 1 };
+	const float offset[3] = { -model->sizex / 2.f, -model->sizey / 2.f, -model->sizez / 2.f - 1.f };
 
-VoxelMeshData generateVBOs(polymodel_t* model)
-{
-	VoxelMeshData result(model->numfaces);
+	lastExposedFaces = 0;
 
-	for (Uint32 i = 0; i < model->numfaces; i++)
+	ArrayList<Uint8> mask;
+	for (int s = 0; s < 6; ++s)
 	{
-		const polytriangle_t *face = &model->faces[i];
-		for (int vert_index = 0; vert_index < 3; vert_index++)
-		{
-			int data_index = i * 9 + vert_index * 3;
-			const vertex_t *vert = &face->vertex[vert_index];
-			const vertex_t *norm = &face->normal[vert_index];
-
-			result.positions[data_index] = vert->x;
-			result.positions[data_index + 1] = -vert->z;
-			result.positions[data_index + 2] = vert->y;
-
-			result.colors[data_index] = face->r / 255.f;
-			result.colors[data_index + 1] = face->g / 255.f;
-			result.colors[data_index + 2] = face->b / 255.f;
-
-			result.normals[data_index] = norm->x;
-			result.normals[data_index + 1] = -norm->z;
-			result.normals[data_index + 2] = norm->y;
-		}
-	}
-
-	return result;
-}
-
-VoxelMeshData generatePolyModel(voxel_t* model)
-{
-	Sint32 x, y, z;
-	Uint32 i;
-	Uint32 index, indexdown[3];
-	Uint8 newcolor, oldcolor;
-	bool buildingquad;
-	polyquad_t* quad1, *quad2;
-	Uint32 numquads;
-	LinkedList<polyquad_t> quads;
-
-	polymodel_t polymodel;
+		const voxelside_t& side = voxelSides[s];
+		const Sint32 sizeA = size[side.a];
+		const Sint32 sizeB = size[side.b];
+		mask.resize(sizeA * sizeB);
 
-	numquads = 0;
-	polymodel.numfaces = 0;
-	indexdown[0] = model->sizez * model->sizey;
-	indexdown[1] = model->sizez;
-	indexdown[2] = 1;
-
-	// find front faces
-	for (x = model->sizex - 1; x >= 0; x--)
-	{
-		for (z = 0; z < model->sizez; z++)
+		for (Sint32 n = 0; n < size[side.n]; ++n)
 		{
-			oldcolor = 255;
-			buildingquad = false;
-			for (y = 0; y < model->sizey; y++)
+			// build mask of exposed faces in this slice
+			const bool edge = side.dir > 0 ? (n == size[side.n] - 1) : (n == 0);
+			for (Sint32 j = 0; j < sizeB; ++j)
 			{
-				index = z + y * model->sizez + x * model->sizey * model->sizez;
-				newcolor = model->data[index];
-				if (buildingquad == true)
-				{
-					bool doit = false;
-					if (newcolor != oldcolor)
-					{
-						doit = true;
-					} else if (x < model->sizex - 1)
-						if (model->data[index + indexdown[0]] >= 0 && model->data[index + indexdown[0]] < 255)
-						{
-							doit = true;
-						}
-					if (doit)
-					{
-						// add the last two vertices to the previous quad
-						buildingquad = false;
-
-						Node<polyquad_t>* currentNode = quads.getLast();
-						quad1 = &currentNode->getData();
-						quad1->vertex[1].x = x - model->sizex / 2.f + 1;
-						quad1->vertex[1].y = y - model->sizey / 2.f;
-						quad1->vertex[1].z = z - model->sizez / 2.f - 1;
-						quad1->vertex[2].x = x - model->sizex / 2.f + 1;
-						quad1->vertex[2].y = y - model->sizey / 2.f;
-						quad1->vertex[2].z = z - model->sizez / 2.f;
-
-						// optimize quad
-						Node<polyquad_t>* node;
-						for (i = 0, node = quads.getFirst(); i < numquads - 1; i++, node = node->getNext())
-						{
-							quad2 = &node->getData();
-							if (quad1->side == quad2->side)
-							{
-								if (quad1->r == quad2->r && quad1->g == quad2->g && quad1->b == quad2->b)
-								{
-									if (quad2->vertex[3].x == quad1->vertex[0].x && quad2->vertex[3].y == quad1->vertex[0].y && quad2->vertex[3].z == quad1->vertex[0].z)
-									{
-										if (quad2->vertex[2].x == quad1->vertex[1].x && quad2->vertex[2].y == quad1->vertex[1].y && quad2->vertex[2].z == quad1->vertex[1].z)
-										{
-											quad2->vertex[2].z++;
-											quad2->vertex[3].z++;
-											quads.removeNode(currentNode);
-											numquads--;
-											polymodel.numfaces -= 2;
-											break;
-										}
-									}
-								}
-							}
-						}
-					}
-				}
-				if (newcolor != oldcolor || !buildingquad)
+				for (Sint32 i = 0; i < sizeA; ++i)
 				{
-					if (newcolor != 255)
+					Uint32 index = n * stride[side.n] + i * stride[side.a] + j * stride[side.b];
+					Uint8 color = model->data[index];
+					if (color != 255 && !edge && model->data[index + side.dir * stride[side.n]] != 255)
 					{
-						bool doit = false;
-						if (x == model->sizex - 1)
-						{
-							doit = true;
-						} else if (model->data[index + indexdown[0]] == 255)
-						{
-							doit = true;
-						}
-						if (doit)
-						{
-							// start building a quad
-							buildingquad = true;
-							numquads++;
-							polymodel.numfaces += 2;
-
-							polyquad_t newQuad;
-							quad1 = &newQuad;
-
-							quad1->side = 0;
-							quad1->vertex[0].x = x - model->sizex / 2.f + 1;
-							quad1->vertex[0].y = y - model->sizey / 2.f;
-							quad1->vertex[0].z = z - model->sizez / 2.f - 1;
-							quad1->vertex[3].x = x - model->sizex / 2.f + 1;
-							quad1->vertex[3].y = y - model->sizey / 2.f;
-							quad1->vertex[3].z = z - model->sizez / 2.f;
-							quad1->r = model->palette[model->data[index]][0];
-							quad1->g = model->palette[model->data[index]][1];
-							quad1->b = model->palette[model->data[index]][2];
-
-							Node<polyquad_t>* newNode = quads.addNodeLast(newQuad);
-						}
+						color = 255;
 					}
-				}
-				oldcolor = newcolor;
-			}
-			if (buildingquad == true)
-			{
-				// add the last two vertices to the previous quad
-				buildingquad = false;
-
-				Node<polyquad_t>* currentNode = quads.getLast();
-				quad1 = &currentNode->getData();
-				quad1->vertex[1].x = x - model->sizex / 2.f + 1;
-				quad1->vertex[1].y = y - model->sizey / 2.f;
-				quad1->vertex[1].z = z - model->sizez / 2.f - 1;
-				quad1->vertex[2].x = x - model->sizex / 2.f + 1;
-				quad1->vertex[2].y = y - model->sizey / 2.f;
-				quad1->vertex[2].z = z - model->sizez / 2.f;
-
-				// optimize quad
-				Node<polyquad_t>* node;
-				for (i = 0, node = quads.getFirst(); i < numquads - 1; i++, node = node->getNext())
-				{
-					quad2 = &node->getData();
-					if (quad1->side == quad2->side)
+					if (color != 255)
 					{
-						if (quad1->r == quad2->r && quad1->g == quad2->g && quad1->b == quad2->b)
-						{
-							if (quad2->vertex[3].x == quad1->vertex[0].x && quad2->vertex[3].y == quad1->vertex[0].y && quad2->vertex[3].z == quad1->vertex[0].z)
-							{
-								if (quad2->vertex[2].x == quad1->vertex[1].x && quad2->vertex[2].y == quad1->vertex[1].y && quad2->vertex[2].z == quad1->vertex[1].z)
-								{
-									quad2->vertex[2].z++;
-									quad2->vertex[3].z++;
-									quads.removeNode(currentNode);
-									numquads--;
-									polymodel.numfaces -= 2;
-									break;
-								}
-							}
-						}
+						++lastExposedFaces;
 					}
+					mask[i + j * sizeA] = color;
 				}
 			}
-		}
-	}
 
-	// find back faces
-	for (x = 0; x < model->sizex; x++)
-	{
-		for (z = 0; z < model->sizez; z++)
-		{
-			oldcolor = 255;
-			buildingquad = false;
-			for (y = 0; y < model->sizey; y++)
+			// merge mask into rectangles
+			for (Sint32 j = 0; j < sizeB; ++j)
 			{
-				index = z + y * model->sizez + x * model->sizey * model->sizez;
-				newcolor = model->data[index];
-				if (buildingquad == true)
+				for (Sint32 i = 0; i < sizeA; )
 				{
-					bool doit = false;
-					if (newcolor != oldcolor)
-					{
-						doit = true;
-					} else if (x > 0)
-						if (model->data[index - indexdown[0]] >= 0 && model->data[index - indexdown[0]] < 255)
-						{
-							doit = true;
-						}
-					if (doit)
+					Uint8 color = mask[i + j * sizeA];
+					if (color == 255)
 					{
-						// add the last two vertices to the previous quad
-						buildingquad = false;
-
-						Node<polyquad_t>* currentNode = quads.getLast();
-						quad1 = &currentNode->getData();
-						quad1->vertex[1].x = x - model->sizex / 2.f;
-						quad1->vertex[1].y = y - model->sizey / 2.f;
-						quad1->vertex[1].z = z - model->sizez / 2.f;
-						quad1->vertex[2].x = x - model->sizex / 2.f;
-						quad1->vertex[2].y = y - model->sizey / 2.f;
-						quad1->vertex[2].z = z - model->sizez / 2.f - 1;
-
-						// optimize quad
-						Node<polyquad_t>* node;
-						for (i = 0, node = quads.getFirst(); i < numquads - 1; i++, node = node->getNext())
-						{
-							quad2 = &node->getData();
-							if (quad1->side == quad2->side)
-							{
-								if (quad1->r == quad2->r && quad1->g == quad2->g && quad1->b == quad2->b)
-								{
-									if (quad2->vertex[0].x == quad1->vertex[3].x && quad2->vertex[0].y == quad1->vertex[3].y && quad2->vertex[0].z == quad1->vertex[3].z)
-									{
-										if (quad2->vertex[1].x == quad1->vertex[2].x && quad2->vertex[1].y == quad1->vertex[2].y && quad2->vertex[1].z == quad1->vertex[2].z)
-										{
-											quad2->vertex[0].z++;
-											quad2->vertex[1].z++;
-											quads.removeNode(currentNode);
-											numquads--;
-											polymodel.numfaces -= 2;
-											break;
-										}
-									}
-								}
-							}
-						}
+						++i;
+						continue;
 					}
-				}
-				if (newcolor != oldcolor || !buildingquad)
-				{
-					if (newcolor != 255)
-					{
-						bool doit = false;
-						if (x == 0)
-						{
-							doit = true;
-						} else if (model->data[index - indexdown[0]] == 255)
-						{
-							doit = true;
-						}
-						if (doit)
-						{
-							// start building a quad
-							buildingquad = true;
-							numquads++;
-							polymodel.numfaces += 2;
-
-							polyquad_t newQuad;
-							quad1 = &newQuad;
-
-							quad1->side = 1;
-							quad1->vertex[0].x = x - model->sizex / 2.f;
-							quad1->vertex[0].y = y - model->sizey / 2.f;
-							quad1->vertex[0].z = z - model->sizez / 2.f;
-							quad1->vertex[3].x = x - model->sizex / 2.f;
-							quad1->vertex[3].y = y - model->sizey / 2.f;
-							quad1->vertex[3].z = z - model->sizez / 2.f - 1;
-							quad1->r = model->palette[model->data[index]][0];
-							quad1->g = model->palette[model->data[index]][1];
-							quad1->b = model->palette[model->data[index]][2];
-
-							Node<polyquad_t>* newNode = quads.addNodeLast(newQuad);
-						}
-					}
-				}
-				oldcolor = newcolor;
-			}
-			if (buildingquad == true)
-			{
-				// add the last two vertices to the previous quad
-				buildingquad = false;
-
-				Node<polyquad_t>* currentNode = quads.getLast();
-				quad1 = &currentNode->getData();
-				quad1->vertex[1].x = x - model->sizex / 2.f;
-				quad1->vertex[1].y = y - model->sizey / 2.f;
-				quad1->vertex[1].z = z - model->sizez / 2.f;
-				quad1->vertex[2].x = x - model->sizex / 2.f;
-				quad1->vertex[2].y = y - model->sizey / 2.f;
-				quad1->vertex[2].z = z - model->sizez / 2.f - 1;
 
-				// optimize quad
-				Node<polyquad_t>* node;
-				for (i = 0, node = quads.getFirst(); i < numquads - 1; i++, node = node->getNext())
-				{
-					quad2 = &node->getData();
-					if (quad1->side == quad2->side)
+					// grow along the a axis
+					Sint32 w = 1;
+					while (i + w < sizeA && mask[i + w + j * sizeA] == color)
 					{
-						if (quad1->r == quad2->r && quad1->g == quad2->g && quad1->b == quad2->b)
-						{
-							if (quad2->vertex[0].x == quad1->vertex[3].x && quad2->vertex[0].y == quad1->vertex[3].y && quad2->vertex[0].z == quad1->vertex[3].z)
-							{
-								if (quad2->vertex[1].x == quad1->vertex[2].x && quad2->vertex[1].y == quad1->vertex[2].y && quad2->vertex[1].z == quad1->vertex[2].z)
-								{
-									quad2->vertex[0].z++;
-									quad2->vertex[1].z++;
-									quads.removeNode(currentNode);
-									numquads--;
-									polymodel.numfaces -= 2;
-									break;
-								}
-							}
-						}
+						++w;
 					}
-				}
-			}
-		}
-	}
 
-	// find right faces
-	for (y = model->sizey - 1; y >= 0; y--)
-	{
-		for (z = 0; z < model->sizez; z++)
-		{
-			oldcolor = 255;
-			buildingquad = false;
-			for (x = 0; x < model->sizex; x++)
-			{
-				index = z + y * model->sizez + x * model->sizey * model->sizez;
-				newcolor = model->data[index];
-				if (buildingquad == true)
-				{
-					bool doit = false;
-					if (newcolor != oldcolor)
-					{
-						doit = true;
-					} else if (y < model->sizey - 1)
-						if (model->data[index + indexdown[1]] >= 0 && model->data[index + indexdown[1]] < 255)
-						{
-							doit = true;
-						}
-					if (doit)
+					// grow along the b axis
+					Sint32 h = 1;
+					for (; j + h < sizeB; ++h)
 					{
-						// add the last two vertices to the previous quad
-						buildingquad = false;
-
-						Node<polyquad_t>* currentNode = quads.getLast();
-						quad1 = &currentNode->getData();
-						quad1->vertex[1].x = x - model->sizex / 2.f;
-						quad1->vertex[1].y = y - model->sizey / 2.f + 1;
-						quad1->vertex[1].z = z - model->sizez / 2.f;
-						quad1->vertex[2].x = x - model->sizex / 2.f;
-						quad1->vertex[2].y = y - model->sizey / 2.f + 1;
-						quad1->vertex[2].z = z - model->sizez / 2.f - 1;
-
-						// optimize quad
-						Node<polyquad_t>* node;
-						for (i = 0, node = quads.getFirst(); i < numquads - 1; i++, node = node->getNext())
+						Sint32 k = 0;
+						for (; k < w; ++k)
 						{
-							quad2 = &node->getData();
-							if (quad1->side == quad2->side)
+							if (mask[i + k + (j + h) * sizeA] != color)
 							{
-								if (quad1->r == quad2->r && quad1->g == quad2->g && quad1->b == quad2->b)
-								{
-									if (quad2->vertex[0].x == quad1->vertex[3].x && quad2->vertex[0].y == quad1->vertex[3].y && quad2->vertex[0].z == quad1->vertex[3].z)
-									{
-										if (quad2->vertex[1].x == quad1->vertex[2].x && quad2->vertex[1].y == quad1->vertex[2].y && quad2->vertex[1].z == quad1->vertex[2].z)
-										{
-											quad2->vertex[0].z++;
-											quad2->vertex[1].z++;
-											quads.removeNode(currentNode);
-											numquads--;
-											polymodel.numfaces -= 2;
-											break;
-										}
-									}
-								}
+								break;
 							}
 						}
-					}
-				}
-				if (newcolor != oldcolor || !buildingquad)
-				{
-					if (newcolor != 255)
-					{
-						bool doit = false;
-						if (y == model->sizey - 1)
+						if (k < w)
 						{
-							doit = true;
-						} else if (model->data[index + indexdown[1]] == 255)
-						{
-							doit = true;
-						}
-						if (doit)
-						{
-							// start building a quad
-							buildingquad = true;
-							numquads++;
-							polymodel.numfaces += 2;
-
-							polyquad_t newQuad;
-							quad1 = &newQuad;
-
-							quad1->side = 2;
-							quad1->vertex[0].x = x - model->sizex / 2.f;
-							quad1->vertex[0].y = y - model->sizey / 2.f + 1;
-							quad1->vertex[0].z = z - model->sizez / 2.f;
-							quad1->vertex[3].x = x - model->sizex / 2.f;
-							quad1->vertex[3].y = y - model->sizey / 2.f + 1;
-							quad1->vertex[3].z = z - model->sizez / 2.f - 1;
-							quad1->r = model->palette[model->data[index]][0];
-							quad1->g = model->palette[model->data[index]][1];
-							quad1->b = model->palette[model->data[index]][2];
-
-							Node<polyquad_t>* newNode = quads.addNodeLast(newQuad);
+							break;
 						}
 					}
-				}
-				oldcolor = newcolor;
-			}
-			if (buildingquad == true)
-			{
-				// add the last two vertices to the previous quad
-				buildingquad = false;
-				Node<polyquad_t>* currentNode = quads.getLast();
-				quad1 = &currentNode->getData();
-				quad1->vertex[1].x = x - model->sizex / 2.f;
-				quad1->vertex[1].y = y - model->sizey / 2.f + 1;
-				quad1->vertex[1].z = z - model->sizez / 2.f;
-				quad1->vertex[2].x = x - model->sizex / 2.f;
-				quad1->vertex[2].y = y - model->sizey / 2.f + 1;
-				quad1->vertex[2].z = z - model->sizez / 2.f - 1;
 
-				// optimize quad
-				Node<polyquad_t>* node;
-				for (i = 0, node = quads.getFirst(); i < numquads - 1; i++, node = node->getNext())
-				{
-					quad2 = &node->getData();
-					if (quad1->side == quad2->side)
+					// consume the rectangle
+					for (Sint32 y = 0; y < h; ++y)
 					{
-						if (quad1->r == quad2->r && quad1->g == quad2->g && quad1->b == quad2->b)
-						{
-							if (quad2->vertex[0].x == quad1->vertex[3].x && quad2->vertex[0].y == quad1->vertex[3].y && quad2->vertex[0].z == quad1->vertex[3].z)
-							{
-								if (quad2->vertex[1].x == quad1->vertex[2].x && quad2->vertex[1].y == quad1->vertex[2].y && quad2->vertex[1].z == quad1->vertex[2].z)
-								{
-									quad2->vertex[0].z++;
-									quad2->vertex[1].z++;
-									quads.removeNode(currentNode);
-									numquads--;
-									polymodel.numfaces -= 2;
-									break;
-								}
-							}
-						}
+						memset(&mask[i + (j + y) * sizeA], 255, w);
 					}
-				}
-			}
-		}
-	}
-
-	// find left faces
-	for (y = 0; y < model->sizey; y++)
-	{
-		for (z = 0; z < model->sizez; z++)
-		{
-			oldcolor = 255;
-			buildingquad = false;
-			for (x = 0; x < model->sizex; x++)
-			{
-				index = z + y * model->sizez + x * model->sizey * model->sizez;
-				newcolor = model->data[index];
-				if (buildingquad == true)
-				{
-					bool doit = false;
-					if (newcolor != oldcolor)
-					{
-						doit = true;
-					} else if (y > 0)
-						if (model->data[index - indexdown[1]] >= 0 && model->data[index - indexdown[1]] < 255)
-						{
-							doit = true;
-						}
-					if (doit)
-					{
-						// add the last two vertices to the previous quad
-						buildingquad = false;
 
-						Node<polyquad_t>* currentNode = quads.getLast();
-						quad1 = &currentNode->getData();
-						quad1->vertex[1].x = x - model->sizex / 2.f;
-						quad1->vertex[1].y = y - model->sizey / 2.f;
-						quad1->vertex[1].z = z - model->sizez / 2.f - 1;
-						quad1->vertex[2].x = x - model->sizex / 2.f;
-						quad1->vertex[2].y = y - model->sizey / 2.f;
-						quad1->vertex[2].z = z - model->sizez / 2.f;
-
-						// optimize quad
-						Node<polyquad_t>* node;
-						for (i = 0, node = quads.getFirst(); i < numquads - 1; i++, node = node->getNext())
-						{
-							quad2 = &node->getData();
-							if (quad1->side == quad2->side)
-							{
-								if (quad1->r == quad2->r && quad1->g == quad2->g && quad1->b == quad2->b)
-								{
-									if (quad2->vertex[3].x == quad1->vertex[0].x && quad2->vertex[3].y == quad1->vertex[0].y && quad2->vertex[3].z == quad1->vertex[0].z)
-									{
-										if (quad2->vertex[2].x == quad1->vertex[1].x && quad2->vertex[2].y == quad1->vertex[1].y && quad2->vertex[2].z == quad1->vertex[1].z)
-										{
-											quad2->vertex[2].z++;
-											quad2->vertex[3].z++;
-											quads.removeNode(currentNode);
-											numquads--;
-											polymodel.numfaces -= 2;
-											break;
-										}
-									}
-								}
-							}
-						}
-					}
-				}
-				if (newcolor != oldcolor || !buildingquad)
-				{
-					if (newcolor != 255)
+					// emit quad
+					polyquad_t quad;
+					quad.side = s;
+					quad.r = model->palette[color][0];
+					quad.g = model->palette[color][1];
+					quad.b = model->palette[color][2];
+
+					float plane = (side.dir > 0 ? n + 1 : n) + offset[side.n];
+					float a0 = i + offset[side.a];
+					float a1 = i + w + offset[side.a];
+					float bLow = j + offset[side.b];
+					float bHigh = j + h + offset[side.b];
+					float bStart = side.bStartHigh ? bHigh : bLow;
+					float bEnd = side.bStartHigh ? bLow : bHigh;
+
+					const float corners[4][2] = { { a0, bStart }, { a1, bStart }, { a1, bEnd }, { a0, bEnd } };
+					for (int v = 0; v < 4; ++v)
 					{
-						bool doit = false;
-						if (y == 0)
-						{
-							doit = true;
-						} else if (model->data[index - indexdown[1]] == 255)
-						{
-							doit = true;
-						}
-						if (doit)
-						{
-							// start building a quad
-							buildingquad = true;
-							numquads++;
-							polymodel.numfaces += 2;
-
-							polyquad_t newQuad;
-							quad1 = &newQuad;
-
-							quad1->side = 3;
-							quad1->vertex[0].x = x - model->sizex / 2.f;
-							quad1->vertex[0].y = y - model->sizey / 2.f;
-							quad1->vertex[0].z = z - model->sizez / 2.f - 1;
-							quad1->vertex[3].x = x - model->sizex / 2.f;
-							quad1->vertex[3].y = y - model->sizey / 2.f;
-							quad1->vertex[3].z = z - model->sizez / 2.f;
-							quad1->r = model->palette[model->data[index]][0];
-							quad1->g = model->palette[model->data[index]][1];
-							quad1->b = model->palette[model->data[index]][2];
-
-							Node<polyquad_t>* newNode = quads.addNodeLast(newQuad);
-						}
+						float pos[3];
+						pos[side.n] = plane;
+						pos[side.a] = corners[v][0];
+						pos[side.b] = corners[v][1];
+						quad.vertex[v].x = pos[0];
+						quad.vertex[v].y = pos[1];
+						quad.vertex[v].z = pos[2];
 					}
-				}
-				oldcolor = newcolor;
-			}
-			if (buildingquad == true)
-			{
-				// add the last two vertices to the previous quad
-				buildingquad = false;
-				Node<polyquad_t>* currentNode = quads.getLast();
-				quad1 = &currentNode->getData();
-				quad1->vertex[1].x = x - model->sizex / 2.f;
-				quad1->vertex[1].y = y - model->sizey / 2.f;
-				quad1->vertex[1].z = z - model->sizez / 2.f - 1;
-				quad1->vertex[2].x = x - model->sizex / 2.f;
-				quad1->vertex[2].y = y - model->sizey / 2.f;
-				quad1->vertex[2].z = z - model->sizez / 2.f;
+					quads.push(quad);
 
-				// optimize quad
-				Node<polyquad_t>* node;
-				for (i = 0, node = quads.getFirst(); i < numquads - 1; i++, node = node->getNext())
-				{
-					quad2 = &node->getData();
-					if (quad1->side == quad2->side)
-					{
-						if (quad1->r == quad2->r && quad1->g == quad2->g && quad1->b == quad2->b)
-						{
-							if (quad2->vertex[3].x == quad1->vertex[0].x && quad2->vertex[3].y == quad1->vertex[0].y && quad2->vertex[3].z == quad1->vertex[0].z)
-							{
-								if (quad2->vertex[2].x == quad1->vertex[1].x && quad2->vertex[2].y == quad1->vertex[1].y && quad2->vertex[2].z == quad1->vertex[1].z)
-								{
-									quad2->vertex[2].z++;
-									quad2->vertex[3].z++;
-									quads.removeNode(currentNode);
-									numquads--;
-									polymodel.numfaces -= 2;
-									break;
-								}
-							}
-						}
-					}
+					i += w;
 				}
 			}
 		}
 	}
+}
 
-	// find bottom faces
-	for (z = model->sizez - 1; z >= 0; z--)
-	{
-		for (y = 0; y < model->sizey; y++)
-		{
-			oldcolor = 255;
-			buildingquad = false;
-			for (x = 0; x < model->sizex; x++)
-			{
-				index = z + y * model->sizez + x * model->sizey * model->sizez;
-				newcolor = model->data[index];
-				if (buildingquad == true)
-				{
-					bool doit = false;
-					if (newcolor != oldcolor)
-					{
-						doit = true;
-					} else if (z < model->sizez - 1)
-						if (model->data[index + indexdown[2]] >= 0 && model->data[index + indexdown[2]] < 255)
-						{
-							doit = true;
-						}
-					if (doit)
-					{
-						// add the last two vertices to the previous quad
-						buildingquad = false;
-
-						Node<polyquad_t>* currentNode = quads.getLast();
-						quad1 = &currentNode->getData();
-						quad1->vertex[1].x = x - model->sizex / 2.f;
-						quad1->vertex[1].y = y - model->sizey / 2.f;
-						quad1->vertex[1].z = z - model->sizez / 2.f;
-						quad1->vertex[2].x = x - model->sizex / 2.f;
-						quad1->vertex[2].y = y - model->sizey / 2.f + 1;
-						quad1->vertex[2].z = z - model->sizez / 2.f;
-
-						// optimize quad
-						Node<polyquad_t>* node;
-						for (i = 0, node = quads.getFirst(); i < numquads - 1; i++, node = node->getNext())
-						{
-							quad2 = &node->getData();
-							if (quad1->side == quad2->side)
-							{
-								if (quad1->r == quad2->r && quad1->g == quad2->g && quad1->b == quad2->b)
-								{
-									if (quad2->vertex[3].x == quad1->vertex[0].x && quad2->vertex[3].y == quad1->vertex[0].y && quad2->vertex[3].z == quad1->vertex[0].z)
-									{
-										if (quad2->vertex[2].x == quad1->vertex[1].x && quad2->vertex[2].y == quad1->vertex[1].y && quad2->vertex[2].z == quad1->vertex[1].z)
-										{
-											quad2->vertex[2].y++;
-											quad2->vertex[3].y++;
-											quads.removeNode(currentNode);
-											numquads--;
-											polymodel.numfaces -= 2;
-											break;
-										}
-									}
-								}
-							}
-						}
-					}
-				}
-				if (newcolor != oldcolor || !buildingquad)
-				{
-					if (newcolor != 255)
-					{
-						bool doit = false;
-						if (z == model->sizez - 1)
-						{
-							doit = true;
-						} else if (model->data[index + indexdown[2]] == 255)
-						{
-							doit = true;
-						}
-						if (doit)
-						{
-							// start building a quad
-							buildingquad = true;
-							numquads++;
-							polymodel.numfaces += 2;
-
-							polyquad_t newQuad;
-							quad1 = &newQuad;
-
-							quad1->side = 4;
-							quad1->vertex[0].x = x - model->sizex / 2.f;
-							quad1->vertex[0].y = y - model->sizey / 2.f;
-							quad1->vertex[0].z = z - model->sizez / 2.f;
-							quad1->vertex[3].x = x - model->sizex / 2.f;
-							quad1->vertex[3].y = y - model->sizey / 2.f + 1;
-							quad1->vertex[3].z = z - model->sizez / 2.f;
-							quad1->r = model->palette[model->data[index]][0];
-							quad1->g = model->palette[model->data[index]][1];
-							quad1->b = model->palette[model->data[index]][2];
-
-							Node<polyquad_t>* newNode = quads.addNodeLast(newQuad);
-						}
-					}
-				}
-				oldcolor = newcolor;
-			}
-			if (buildingquad == true)
-			{
-				// add the last two vertices to the previous quad
-				buildingquad = false;
-
-				Node<polyquad_t>* currentNode = quads.getLast();
-				quad1 = &currentNode->getData();
-				quad1->vertex[1].x = x - model->sizex / 2.f;
-				quad1->vertex[1].y = y - model->sizey / 2.f;
-				quad1->vertex[1].z = z - model->sizez / 2.f;
-				quad1->vertex[2].x = x - model->sizex / 2.f;
-				quad1->vertex[2].y = y - model->sizey / 2.f + 1;
-				quad1->vertex[2].z = z - model->sizez / 2.f;
+// each quad is split into two triangles which share the 0-2 diagonal
+static const GLuint quadTriangles[6] = {
+	0, 2, 3,
+	0, 1, 2,
+};
 
-				// optimize quad
-				Node<polyquad_t>* node;
-				for (i = 0, node = quads.getFirst(); i < numquads - 1; i++, node = node->getNext())
-				{
-					quad2 = &node->getData();
-					if (quad1->side == quad2->side)
-					{
-						if (quad1->r == quad2->r && quad1->g == quad2->g && quad1->b == quad2->b)
-						{
-							if (quad2->vertex[3].x == quad1->vertex[0].x && quad2->vertex[3].y == quad1->vertex[0].y && quad2->vertex[3].z == quad1->vertex[0].z)
-							{
-								if (quad2->vertex[2].x == quad1->vertex[1].x && quad2->vertex[2].y == quad1->vertex[1].y && quad2->vertex[2].z == quad1->vertex[1].z)
-								{
-									quad2->vertex[2].y++;
-									quad2->vertex[3].y++;
-									quads.removeNode(currentNode);
-									numquads--;
-									polymodel.numfaces -= 2;
-									break;
-								}
-							}
-						}
-					}
-				}
-			}
-		}
-	}
+VoxelMeshData generatePolyModel(const voxel_t* model)
+{
+	ArrayList<polyquad_t> quads;
+	generateQuads(model, quads);
 
-	// find top faces
-	for (z = 0; z < model->sizez; z++)
+	VoxelMeshData result(quads.getSize());
+	ArrayList<GLuint> triangles;
+	triangles.resize(quads.getSize() * 6);
+	for (Uint32 q = 0; q < quads.getSize(); ++q)
 	{
-		for (y = 0; y < model->sizey; y++)
-		{
-			oldcolor = 255;
-			buildingquad = false;
-			for (x = 0; x < model->sizex; x++)
-			{
-				index = z + y * model->sizez + x * model->sizey * model->sizez;
-				newcolor = model->data[index];
-				if (buildingquad == true)
-				{
-					bool doit = false;
-					if (newcolor != oldcolor)
-					{
-						doit = true;
-					} else if (z > 0)
-						if (model->data[index - indexdown[2]] >= 0 && model->data[index - indexdown[2]] < 255)
-						{
-							doit = true;
-						}
-					if (doit)
-					{
-						// add the last two vertices to the previous quad
-						buildingquad = false;
-
-						Node<polyquad_t>* currentNode = quads.getLast();
-						quad1 = &currentNode->getData();
-						quad1->vertex[1].x = x - model->sizex / 2.f;
-						quad1->vertex[1].y = y - model->sizey / 2.f + 1;
-						quad1->vertex[1].z = z - model->sizez / 2.f - 1;
-						quad1->vertex[2].x = x - model->sizex / 2.f;
-						quad1->vertex[2].y = y - model->sizey / 2.f;
-						quad1->vertex[2].z = z - model->sizez / 2.f - 1;
+		const polyquad_t& quad = quads[q];
+		const voxelside_t& side = voxelSides[quad.side];
 
-						// optimize quad
-						Node<polyquad_t>* node;
-						for (i = 0, node = quads.getFirst(); i < numquads - 1; i++, node = node->getNext())
-						{
-							quad2 = &node->getData();
-							if (quad1->side == quad2->side)
-							{
-								if (quad1->r == quad2->r && quad1->g == quad2->g && quad1->b == quad2->b)
-								{
-									if (quad2->vertex[0].x == quad1->vertex[3].x && quad2->vertex[0].y == quad1->vertex[3].y && quad2->vertex[0].z == quad1->vertex[3].z)
-									{
-										if (quad2->vertex[1].x == quad1->vertex[2].x && quad2->vertex[1].y == quad1->vertex[2].y && quad2->vertex[1].z == quad1->vertex[2].z)
-										{
-											quad2->vertex[0].y++;
-											quad2->vertex[1].y++;
-											quads.removeNode(currentNode);
-											numquads--;
-											polymodel.numfaces -= 2;
-											break;
-										}
-									}
-								}
-							}
-						}
-					}
-				}
-				if (newcolor != oldcolor || !buildingquad)
-				{
-					if (newcolor != 255)
-					{
-						bool doit = false;
-						if (z == 0)
-						{
-							doit = true;
-						} else if (model->data[index - indexdown[2]] == 255)
-						{
-							doit = true;
-						}
-						if (doit)
-						{
-							// start building a quad
-							buildingquad = true;
-							numquads++;
-							polymodel.numfaces += 2;
+		float normal[3] = { 0.f, 0.f, 0.f };
+		normal[side.n] = (float)side.dir;
 
-							polyquad_t newQuad;
-							quad1 = &newQuad;
+		for (Uint32 v = 0; v < 4; ++v)
+		{
+			Uint32 vertex = q * 4 + v;
+			const vertex_t& vert = quad.vertex[v];
 
-							quad1->side = 5;
-							quad1->vertex[0].x = x - model->sizex / 2.f;
-							quad1->vertex[0].y = y - model->sizey / 2.f + 1;
-							quad1->vertex[0].z = z - model->sizez / 2.f - 1;
-							quad1->vertex[3].x = x - model->sizex / 2.f;
-							quad1->vertex[3].y = y - model->sizey / 2.f;
-							quad1->vertex[3].z = z - model->sizez / 2.f - 1;
-							quad1->r = model->palette[model->data[index]][0];
-							quad1->g = model->palette[model->data[index]][1];
-							quad1->b = model->palette[model->data[index]][2];
+			result.positions[vertex * 3] = vert.x;
+			result.positions[vertex * 3 + 1] = -vert.z;
+			result.positions[vertex * 3 + 2] = vert.y;
 
-							Node<polyquad_t>* newNode = quads.addNodeLast(newQuad);
-						}
-					}
-				}
-				oldcolor = newcolor;
-			}
-			if (buildingquad == true)
-			{
-				// add the last two vertices to the previous quad
-				buildingquad = false;
+			result.colors[vertex * 4] = quad.r / 255.f;
+			result.colors[vertex * 4 + 1] = quad.g / 255.f;
+			result.colors[vertex * 4 + 2] = quad.b / 255.f;
+			result.colors[vertex * 4 + 3] = 1.f;
 
-				Node<polyquad_t>* currentNode = quads.getLast();
-				quad1 = &currentNode->getData();
-				quad1->vertex[1].x = x - model->sizex / 2.f;
-				quad1->vertex[1].y = y - model->sizey / 2.f + 1;
-				quad1->vertex[1].z = z - model->sizez / 2.f - 1;
-				quad1->vertex[2].x = x - model->sizex / 2.f;
-				quad1->vertex[2].y = y - model->sizey / 2.f;
-				quad1->vertex[2].z = z - model->sizez / 2.f - 1;
-
-				// optimize quad
-				Node<polyquad_t>* node;
-				for (i = 0, node = quads.getFirst(); i < numquads - 1; i++, node = node->getNext())
-				{
-					quad2 = &node->getData();
-					if (quad1->side == quad2->side)
-					{
-						if (quad1->r == quad2->r && quad1->g == quad2->g && quad1->b == quad2->b)
-						{
-							if (quad2->vertex[0].x == quad1->vertex[3].x && quad2->vertex[0].y == quad1->vertex[3].y && quad2->vertex[0].z == quad1->vertex[3].z)
-							{
-								if (quad2->vertex[1].x == quad1->vertex[2].x && quad2->vertex[1].y == quad1->vertex[2].y && quad2->vertex[1].z == quad1->vertex[2].z)
-								{
-									quad2->vertex[0].y++;
-									quad2->vertex[1].y++;
-									quads.removeNode(currentNode);
-									numquads--;
-									polymodel.numfaces -= 2;
-									break;
-								}
-							}
-						}
-					}
-				}
-			}
+			result.normals[vertex * 3] = normal[0];
+			result.normals[vertex * 3 + 1] = -normal[2];
+			result.normals[vertex * 3 + 2] = normal[1];
 		}
-	}
-
-	// translate quads into triangles
-	polymodel.faces = (polytriangle_t*)malloc(sizeof(polytriangle_t) * polymodel.numfaces);
-	for (i = 0; i < polymodel.numfaces; i++)
-	{
-		Node<polyquad_t>* node = quads.nodeForIndex(i / 2);
-		polyquad_t* quad = &node->getData();
-		polymodel.faces[i].r = quad->r;
-		polymodel.faces[i].g = quad->g;
-		polymodel.faces[i].b = quad->b;
-		if (i % 2)
-		{
-			polymodel.faces[i].vertex[0] = quad->vertex[0];
-			polymodel.faces[i].vertex[1] = quad->vertex[1];
-			polymodel.faces[i].vertex[2] = quad->vertex[2];
-		} else
+		for (Uint32 c = 0; c < 6; ++c)
 		{
-			polymodel.faces[i].vertex[0] = quad->vertex[0];
-			polymodel.faces[i].vertex[1] = quad->vertex[2];
-			polymodel.faces[i].vertex[2] = quad->vertex[3];
-		}
-
-		for (Uint32 c = 0; c < 3; ++c) {
-			polymodel.faces[i].normal[c].x = (quad->side == 0 ? 1.f : (quad->side == 1 ? -1.f : 0));
-			polymodel.faces[i].normal[c].y = (quad->side == 2 ? 1.f : (quad->side == 3 ? -1.f : 0));
-			polymodel.faces[i].normal[c].z = (quad->side == 4 ? 1.f : (quad->side == 5 ? -1.f : 0));
+			triangles[q * 6 + c] = q * 4 + quadTriangles[c];
 		}
 	}
+	Adjacency::build(triangles.getArray(), quads.getSize() * 2, result.indices.get());
 
-	// now store models into VBOs
-	return generateVBOs(&polymodel);
+	return result;
 }
 
 voxel_t* loadVoxel(const char* filename)
@@ -1001,6 +243,12 @@ voxel_t* loadVoxel(const char* filename)
 		fread(&model->sizey, sizeof(Sint32), 1, file);
 		model->sizez = 0;
 		fread(&model->sizez, sizeof(Sint32), 1, file);
+		if (model->sizex <= 0 || model->sizey <= 0 || model->sizez <= 0)
+		{
+			fclose(file);
+			delete model;
+			return NULL;
+		}
 		model->data = new Uint8[model->sizex * model->sizey * model->sizez];
 		memset(model->data, 0, sizeof(Uint8)*model->sizex * model->sizey * model->sizez);
 		fread(model->data, sizeof(Uint8), model->sizex * model->sizey * model->sizez, file);
@@ -1024,33 +272,60 @@ voxel_t* loadVoxel(const char* filename)
 VoxelMeshData VoxelReader::readVoxel(const char* path) {
 	voxel_t* voxelModel = loadVoxel(path);
 	if (!voxelModel) {
-		return false;
+		return VoxelMeshData(0);
 	}
 
-	return generatePolyModel(voxelModel);
+	VoxelMeshData result = generatePolyModel(voxelModel);
+	delete voxelModel;
+	return result;
 }
 
-GLuint VoxelMeshData::findAdjacentIndex(GLuint index1, GLuint index2, GLuint index3) {
-	GLuint indices[6];
-	for (Uint32 index = 0; index < indexCount; index += 6) {
-		indices[0] = this->indices[index];
-		indices[1] = this->indices[index + 2];
-		indices[2] = this->indices[index + 4];
-		indices[3] = this->indices[index];
-		indices[4] = this->indices[index + 2];
-		indices[5] = this->indices[index + 4];
-		for (int edge = 0; edge < 3; ++edge) {
-			GLuint v1 = indices[edge]; // first edge index
-			GLuint v2 = indices[edge + 1]; // second edge index
-			GLuint vOpp = indices[edge + 2]; // index of opposite vertex
-
-			// if the edge matches the search edge and the opposite vertex does not match
-			if (((v1 == index1 && v2 == index2) || (v2 == index1 && v1 == index2)) && vOpp != index3) {
-				return vOpp; // we have found the adjacent vertex
+static int console_voxelBenchmark(int argc, const char** argv) {
+	voxel_t* model = nullptr;
+	if (argc > 1) {
+		String path = mainEngine->buildPath(argv[1]);
+		model = loadVoxel(path.get());
+		if (!model) {
+			mainEngine->fmsg(Engine::MSG_ERROR, "failed to load voxel model '%s'", path.get());
+			return 1;
+		}
+	} else {
+		// generate a 256^3 test model: a noisy sphere with several colors so that merging is non-trivial
+		const Sint32 dim = 256;
+		model = new voxel_t();
+		model->sizex = model->sizey = model->sizez = dim;
+		model->data = new Uint8[dim * dim * dim];
+		for (int c = 0; c < 256; ++c) {
+			model->palette[c][0] = model->palette[c][1] = model->palette[c][2] = (Uint8)c;
+		}
+		Random rand;
+		rand.seedValue(dim);
+		const float radius = dim * 0.45f;
+		for (Sint32 x = 0; x < dim; ++x) {
+			for (Sint32 y = 0; y < dim; ++y) {
+				for (Sint32 z = 0; z < dim; ++z) {
+					float dx = x - dim / 2.f, dy = y - dim / 2.f, dz = z - dim / 2.f;
+					float dist = sqrtf(dx * dx + dy * dy + dz * dz);
+					Uint8 color = 255;
+					if (dist < radius - (rand.getUint8() & 3)) {
+						color = (Uint8)((x / 16 + y / 32 + z / 64) & 7);
+					}
+					model->data[z + y * dim + x * dim * dim] = color;
+				}
 			}
 		}
 	}
 
-	// no opposite edge found
-	return index3;
-}
\ No newline at end of file
+	auto start = std::chrono::high_resolution_clock::now();
+	VoxelMeshData data = generatePolyModel(model);
+	double time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	mainEngine->fmsg(Engine::MSG_INFO, "voxel model %dx%dx%d meshed in %.2f ms", model->sizex, model->sizey, model->sizez, time * 1000.0);
+	mainEngine->fmsg(Engine::MSG_INFO, " exposed faces: %u (%u verts unmerged)", lastExposedFaces, lastExposedFaces * 6);
+	mainEngine->fmsg(Engine::MSG_INFO, " merged quads: %u, verts: %u, indices: %u", data.vertexCount / 4, data.vertexCount, data.indexCount);
+
+	delete model;
+	return 0;
+}
+
+static Ccmd ccmd_voxelBenchmark("voxel.benchmark", "meshes a voxel model (or a generated 256^3 model) and reports build time and vertex counts", &console_voxelBenchmark);
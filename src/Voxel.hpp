@@ -9,24 +9,17 @@
 class Mesh;
 
 //! Contains all the data associated with a voxel Mesh.
+//! Voxel meshes are built out of quads; each quad has its own 4 vertices and two triangles.
 struct VoxelMeshData {
 	VoxelMeshData() = delete;
-	VoxelMeshData(Uint32 numFaces) {
-		vertexCount = 3 * numFaces;
-		indexCount = vertexCount * 2;
+	VoxelMeshData(Uint32 numQuads) {
+		vertexCount = 4 * numQuads;
+		indexCount = 12 * numQuads;
 		size = vertexCount * 3;
 		positions.reset(new GLfloat[size]);
-		colors.reset(new GLfloat[size]);
+		colors.reset(new GLfloat[vertexCount * 4]);
 		normals.reset(new GLfloat[size]);
 		indices.reset(new GLuint[indexCount]);
-		for (Uint32 c = 0; c < vertexCount; ++c) {
-			indices[c * 2] = (GLuint)c;
-		}
-		for (Uint32 i = 0; i < indexCount; i += 6) {
-			indices[i + 1] = findAdjacentIndex(indices[i], indices[i + 2], indices[i + 4]);
-			indices[i + 3] = findAdjacentIndex(indices[i + 2], indices[i + 4], indices[i]);
-			indices[i + 5] = findAdjacentIndex(indices[i + 4], indices[i], indices[i + 2]);
-		}
 	}
 	VoxelMeshData(const VoxelMeshData&) = delete;
 	VoxelMeshData(VoxelMeshData&&) = default;
@@ -35,17 +28,14 @@ struct VoxelMeshData {
 	VoxelMeshData& operator=(const VoxelMeshData&) = delete;
 	VoxelMeshData& operator=(VoxelMeshData&&) = default;
 
-	//! 24bit positions, colors
+	//! 24bit positions, normals; 32bit colors
 	std::unique_ptr<GLfloat[]> positions;
 	std::unique_ptr<GLfloat[]> colors;
 	std::unique_ptr<GLfloat[]> normals;
-	std::unique_ptr<GLuint[]> indices;
+	std::unique_ptr<GLuint[]> indices;		//!< 2 uints per vertex (first is vertex, second is adjacent vertex)
 	Uint32 vertexCount;
 	Uint32 indexCount;
 	Uint32 size;
-
-private:
-	GLuint findAdjacentIndex(GLuint index1, GLuint index2, GLuint index3);
 };
 
 class VoxelReader {
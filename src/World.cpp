@@ -11,6 +11,7 @@
 #include "Entity.hpp"
 #include "BBox.hpp"
 #include "Generator.hpp"
+#include "WorldChunks.hpp"
 
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
@@ -42,6 +43,12 @@ World::~World() {
 		mainEngine->fmsg(Engine::MSG_INFO, "deleting world '%s'", nameStr.get());
 	}
 
+	// stop streaming before the entities go
+	if (chunks) {
+		delete chunks;
+		chunks = nullptr;
+	}
+
 	// delete entities
 	for (auto& pair : entities) {
 		Entity* entity = pair.b;
@@ -436,6 +443,48 @@ void World::lineTraceList(const Vector& origin, const Vector& dest, LinkedList<W
 	}
 }
 
+//! ray callback which takes the first occluding entity it meets, and ends the ray there
+class OccluderRayResultCallback : public btCollisionWorld::RayResultCallback {
+public:
+	virtual ~OccluderRayResultCallback() {}
+
+	void reset() {
+		m_collisionObject = nullptr;
+		m_closestHitFraction = btScalar(1.f);
+	}
+
+	virtual btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult, bool normalInWorldSpace) override {
+		auto manifest = static_cast<World::physics_manifest_t*>(rayResult.m_collisionObject->getUserPointer());
+		if (!manifest || !manifest->entity) {
+			return m_closestHitFraction;
+		}
+		Entity* entity = manifest->entity;
+		if (!entity->isFlag(Entity::flag_t::FLAG_OCCLUDE)) {
+			return m_closestHitFraction;
+		}
+		if (!entity->isFlag(Entity::flag_t::FLAG_ALLOWTRACE) && (!mainEngine->isEditorRunning() || !entity->isShouldSave())) {
+			return m_closestHitFraction;
+		}
+
+		// a fraction of zero tells bullet to stop testing the ray
+		m_collisionObject = rayResult.m_collisionObject;
+		m_closestHitFraction = btScalar(0.f);
+		return m_closestHitFraction;
+	}
+};
+
+void World::lineTestOccluded(const Vector& origin, const ArrayList<Vector>& dests, ArrayList<bool>& outResult) {
+	btVector3 btOrigin(origin);
+	OccluderRayResultCallback callback;
+	outResult.resize(dests.getSize());
+	for (Uint32 c = 0; c < dests.getSize(); ++c) {
+		btVector3 btDest(dests[c]);
+		callback.reset();
+		bulletDynamicsWorld->rayTest(btOrigin, btDest, callback);
+		outResult[c] = callback.hasHit();
+	}
+}
+
 World::hit_t World::lineTraceNoEntities(const Vector& origin, const Vector& dest) {
 	hit_t emptyResult;
 
@@ -523,6 +572,11 @@ void World::process() {
 		}
 	}
 
+	// stream chunks in and out around players
+	if (chunks) {
+		chunks->update();
+	}
+
 	// step physics
 	if (!mainEngine->isEditorRunning()) {
 		float step = 1.f / (float)mainEngine->getTicksPerSecond();
@@ -19,6 +19,7 @@ class Script;
 class Entity;
 class Game;
 class BBox;
+class WorldChunks;
 
 //! The World class basically represents a Level in the game. It is a self-contained universe predominantly filled with entities.
 //! The World class itself is abstract and there are multiple world types; the current version of the engine uses BasicWorld
@@ -125,6 +126,13 @@ public:
 	//! @param outResult the list which will contain all of the hit_t structures (sorted nearest to furthest)
 	void lineTraceList(const Vector& origin, const Vector& dest, LinkedList<hit_t>& outResult);
 
+	//! test whether anything occluding (see Entity::FLAG_OCCLUDE) lies between one point and several others.
+	//! Each ray stops at the first occluder it meets, so this is much cheaper than lineTraceList()
+	//! @param origin the starting point of the rays
+	//! @param dests the ending point of each ray
+	//! @param outResult set to true for each ray which is blocked, false otherwise
+	void lineTestOccluded(const Vector& origin, const ArrayList<Vector>& dests, ArrayList<bool>& outResult);
+
 	//! perform a line test (raytrace) through the world, skipping entities
 	//! @param origin the starting point of the ray
 	//! @param dest the ending point of the ray
@@ -220,7 +228,9 @@ public:
 	Shadow&						getDefaultShadow() { return defaultShadow; }
 	const Shadow&				getDefaultShadow() const { return defaultShadow; }
 	Entity*						getShadowCamera() { return shadowCamera; }
+	WorldChunks*				getChunks() { return chunks; }
 	void						setMaxUID(Uint32 uid) { uids = std::max(uids, uid); }
+	Uint32						getMaxUID() const { return uids; }
 
 	bool				isPointerActive() const { return pointerActive; }
 	const Vector&		getPointerPos() const { return pointerPos; }
@@ -260,6 +270,9 @@ protected:
 	Map<Uint32, Entity*> entities;
 	ArrayList<Entity*> entitiesToInsert;
 
+	//! streams entities in and out around players, if the world was loaded from a chunk store
+	WorldChunks* chunks = nullptr;
+
 	//! lasers
 	ArrayList<laser_t> lasers;
 
@@ -0,0 +1,791 @@
+// WorldChunks.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "WorldChunks.hpp"
+#include "MeshCache.hpp"
+#include "BasicWorld.hpp"
+#include "Entity.hpp"
+#include "File.hpp"
+#include "Console.hpp"
+#include "Client.hpp"
+#include "Server.hpp"
+#include "Random.hpp"
+
+#include <chrono>
+
+static const char chunkMagic[4] = { 'S', 'P', 'C', 'S' };
+
+static Cvar cvar_chunkRadius("world.chunks.radius", "chunks within this many chunks of a player are streamed in; they are streamed out again one chunk further away", "2");
+
+// chunk coordinates are clamped to this many chunks either side of the origin
+static const Sint32 chunkCoordLimit = (1 << 24);
+
+static Sint32 chunkCoordFor(float f, float chunkSize) {
+	const float chunk = f / chunkSize;
+	if (!(chunk > (float)-chunkCoordLimit)) {
+		return -chunkCoordLimit;	// also catches NaN
+	} else if (!(chunk < (float)chunkCoordLimit)) {
+		return chunkCoordLimit;
+	}
+	return (Sint32)floorf(chunk);
+}
+
+// append bytes to a growing buffer
+static void appendBytes(ArrayList<Uint8>& buffer, const void* src, size_t bytes) {
+	const Uint32 oldSize = buffer.getSize();
+	const Uint32 newSize = oldSize + (Uint32)bytes;
+	if (newSize > buffer.getMaxSize()) {
+		buffer.alloc(std::max(newSize, buffer.getMaxSize() * 2U));
+	}
+	buffer.resize(newSize);
+	memcpy(&buffer[oldSize], src, bytes);
+}
+
+// append an entity to chunk data, as an entity header followed by the entity's binary serialization
+// @return the number of bytes added
+static size_t appendEntity(ArrayList<Uint8>& buffer, Entity& entity, Uint32 uid) {
+	const Uint32 start = buffer.getSize();
+	WorldChunks::entityheader_t header;
+	header.size = 0;
+	header.uid = uid;
+	header.flags = entity.getFlags();
+	appendBytes(buffer, &header, sizeof(header));
+	FileHelper::writeObject(buffer, entity);
+	header.size = buffer.getSize() - start - (Uint32)sizeof(header);
+	memcpy(&buffer[start], &header, sizeof(header));
+	return buffer.getSize() - start;
+}
+
+Uint64 WorldChunks::keyFor(Sint32 x, Sint32 y) {
+	// the map takes the low bits of the key as its bucket, so mix them
+	Uint64 key = ((Uint64)(Uint32)x << 32) | (Uint64)(Uint32)y;
+	key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+	return key ^ (key >> 31);
+}
+
+WorldChunks::Builder::~Builder() {
+	for (auto& pair : chunks) {
+		delete pair.b;
+	}
+	chunks.clear();
+}
+
+WorldChunks::Builder::chunk_t& WorldChunks::Builder::chunkFor(Sint32 x, Sint32 y) {
+	const Uint64 key = keyFor(x, y);
+	chunk_t** found = chunks.find(key);
+	if (found) {
+		return **found;
+	}
+	chunk_t* chunk = new chunk_t();
+	chunk->x = x;
+	chunk->y = y;
+	chunks.insert(key, chunk);
+	return *chunk;
+}
+
+void WorldChunks::Builder::add(Entity& entity, Uint32 uid) {
+	uid = uid == UINT32_MAX ? entity.getUID() : uid;
+	maxUID = std::max(maxUID, uid);
+	const Vector& pos = entity.getPos();
+	chunk_t& chunk = chunkFor(chunkCoordFor(pos.x, chunkSize), chunkCoordFor(pos.y, chunkSize));
+	appendEntity(chunk.data, entity, uid);
+	++chunk.numEntities;
+	++numEntities;
+}
+
+void WorldChunks::Builder::addEntities(Sint32 x, Sint32 y, Uint32 _numEntities) {
+	if (!_numEntities) {
+		return;
+	}
+	chunkFor(x, y).numEntities += _numEntities;
+	numEntities += _numEntities;
+}
+
+void WorldChunks::Builder::addData(Sint32 x, Sint32 y, const Uint8* data, size_t size, Uint32 _numEntities) {
+	if (!size) {
+		return;
+	}
+	chunk_t& chunk = chunkFor(x, y);
+	appendBytes(chunk.data, data, size);
+	chunk.numEntities += _numEntities;
+	numEntities += _numEntities;
+}
+
+bool WorldChunks::Builder::save(const char* path, const char* name) const {
+	header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, chunkMagic, sizeof(chunkMagic));
+	header.version = version;
+	header.chunkSize = chunkSize;
+	header.numChunks = chunks.getSize();
+	header.nameSize = name ? (Uint32)strlen(name) : 0;
+	header.maxUID = maxUID;
+	header.dataOffset = sizeof(header_t) + header.nameSize + sizeof(record_t) * (Uint64)header.numChunks;
+
+	MeshCache::Writer writer;
+	writer.write(header);
+	writer.writeBytes(name, header.nameSize);
+	Uint64 offset = 0;
+	for (auto& pair : chunks) {
+		const chunk_t* chunk = pair.b;
+		record_t record;
+		record.x = chunk->x;
+		record.y = chunk->y;
+		record.numEntities = chunk->numEntities;
+		record.size = chunk->data.getSize();
+		record.offset = offset;
+		writer.write(record);
+		offset += record.size;
+	}
+	for (auto& pair : chunks) {
+		const chunk_t* chunk = pair.b;
+		writer.writeBytes(chunk->data.getArray(), chunk->data.getSize());
+	}
+	if (!writer.save(path)) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "failed to write chunk store '%s'", path);
+		return false;
+	}
+	return true;
+}
+
+WorldChunks::WorldChunks(World& _world, bool _replica) :
+	world(_world),
+	replica(_replica)
+{
+}
+
+WorldChunks::~WorldChunks() {
+	if (thread.joinable()) {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			quit = true;
+		}
+		wake.notify_one();
+		thread.join();
+	}
+	for (auto request : requests) {
+		delete request;
+	}
+	requests.clear();
+	for (auto reply : replies) {
+		delete reply;
+	}
+	replies.clear();
+	for (auto& pair : chunks) {
+		delete pair.b;
+	}
+	chunks.clear();
+}
+
+bool WorldChunks::isChunkStore(const char* path) {
+	FILE* fp = fopen(path, "rb");
+	if (!fp) {
+		return false;
+	}
+	char magic[4];
+	const bool result = fread(magic, sizeof(magic), 1, fp) == 1 && memcmp(magic, chunkMagic, sizeof(chunkMagic)) == 0;
+	fclose(fp);
+	return result;
+}
+
+bool WorldChunks::build(World& world, const char* path, float chunkSize) {
+	Builder builder(chunkSize);
+	for (auto& pair : world.getEntities()) {
+		Entity* entity = pair.b;
+		if (entity->isToBeDeleted() || !entity->isShouldSave() || entity->getPlayer()) {
+			continue;
+		}
+		builder.add(*entity);
+	}
+	return builder.save(path, world.getNameStr().get());
+}
+
+bool WorldChunks::readStore(const char* path, header_t& header, String& name, ArrayList<record_t>* records) {
+	FILE* fp = fopen(path, "rb");
+	if (!fp) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "Unable to open chunk store '%s' for read (%d)", path, errno);
+		return false;
+	}
+
+	if (fread(&header, sizeof(header), 1, fp) != 1 ||
+		memcmp(header.magic, chunkMagic, sizeof(chunkMagic)) != 0 ||
+		header.version != version ||
+		!(header.chunkSize > 0.f)) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "'%s' is not a chunk store this version can read", path);
+		fclose(fp);
+		return false;
+	}
+
+	name.alloc(header.nameSize + 1);
+	name[header.nameSize] = '\0';
+	bool good = header.nameSize == 0 || fread(&name[0], header.nameSize, 1, fp) == 1;
+
+	if (records) {
+		records->resize(header.numChunks);
+		good = good && (header.numChunks == 0 || fread(records->getArray(), sizeof(record_t), header.numChunks, fp) == header.numChunks);
+	}
+	fclose(fp);
+	if (!good) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "chunk store '%s' is truncated", path);
+		return false;
+	}
+	return true;
+}
+
+bool WorldChunks::open(const char* _path) {
+	header_t header;
+	String name;
+	ArrayList<record_t> records;
+	if (!readStore(_path, header, name, &records)) {
+		return false;
+	}
+
+	path = _path;
+	dataOffset = header.dataOffset;
+	chunkSize = header.chunkSize;
+	for (Uint32 c = 0; c < records.getSize(); ++c) {
+		const record_t& record = records[c];
+		const Vector min(record.x * chunkSize, record.y * chunkSize, 0.f);
+		const Vector max = min + Vector(chunkSize, chunkSize, 0.f);
+		boundsMin = c ? Vector(std::min(boundsMin.x, min.x), std::min(boundsMin.y, min.y), 0.f) : min;
+		boundsMax = c ? Vector(std::max(boundsMax.x, max.x), std::max(boundsMax.y, max.y), 0.f) : max;
+
+		chunk_t& chunk = findOrCreate(record.x, record.y);
+		chunk.inMemory = false;
+		chunk.offset = record.offset;
+		chunk.size = record.size;
+		chunk.numEntities = record.numEntities;
+		numStoredEntities += record.numEntities;
+	}
+	world.setNameStr(name.get());
+
+	// entities made while the world runs must not take a uid which is waiting in the store
+	world.setMaxUID(header.maxUID);
+
+	thread = std::thread(&WorldChunks::run, this);
+
+	mainEngine->fmsg(Engine::MSG_INFO, "opened chunk store '%s': %u chunks, %llu entities",
+		_path, chunks.getSize(), (unsigned long long)numStoredEntities);
+	return true;
+}
+
+bool WorldChunks::save(const char* _path) {
+	if (replica) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "only the server can save the chunk store of '%s'", world.getNameStr().get());
+		return false;
+	}
+	finishLoading();
+
+	// chunks which are not live are copied over as they are, from memory or from the store
+	FILE* fp = path.empty() ? nullptr : fopen(path.get(), "rb");
+	Builder builder(chunkSize);
+	ArrayList<Uint8> data;
+	bool good = true;
+	for (auto& pair : chunks) {
+		chunk_t& chunk = *pair.b;
+		if (chunk.state == CHUNK_ACTIVE) {
+			continue;
+		}
+		if (chunk.inMemory) {
+			builder.addData(chunk.x, chunk.y, chunk.data.getArray(), chunk.data.getSize(), 0);
+		} else if (chunk.size) {
+			data.resize(chunk.size);
+			good = good && fp &&
+#ifdef PLATFORM_WINDOWS
+				_fseeki64(fp, (__int64)(dataOffset + chunk.offset), SEEK_SET) == 0 &&
+#else
+				fseeko(fp, (off_t)(dataOffset + chunk.offset), SEEK_SET) == 0 &&
+#endif
+				fread(data.getArray(), 1, chunk.size, fp) == chunk.size;
+			builder.addData(chunk.x, chunk.y, data.getArray(), data.getSize(), 0);
+		}
+		builder.addData(chunk.x, chunk.y, chunk.extra.getArray(), chunk.extra.getSize(), 0);
+		builder.addEntities(chunk.x, chunk.y, chunk.numEntities);
+	}
+	if (fp) {
+		fclose(fp);
+	}
+	if (!good) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "failed to read chunk store '%s'", path.get());
+		return false;
+	}
+
+	// live entities
+	for (auto& pair : world.getEntities()) {
+		Entity* entity = pair.b;
+		if (isStreamed(entity)) {
+			builder.add(*entity);
+		}
+	}
+	builder.setMaxUID(world.getMaxUID());
+
+	if (!builder.save(_path, world.getNameStr().get())) {
+		return false;
+	}
+	mainEngine->fmsg(Engine::MSG_INFO, "saved chunk store '%s': %u chunks, %u entities", _path, builder.getNumChunks(), builder.getNumEntities());
+	return true;
+}
+
+void WorldChunks::coordsFor(const Vector& pos, Sint32& x, Sint32& y) const {
+	x = chunkCoordFor(pos.x, chunkSize);
+	y = chunkCoordFor(pos.y, chunkSize);
+}
+
+WorldChunks::chunk_t* WorldChunks::find(Sint32 x, Sint32 y) {
+	chunk_t** found = chunks.find(keyFor(x, y));
+	return found ? *found : nullptr;
+}
+
+WorldChunks::chunk_t& WorldChunks::findOrCreate(Sint32 x, Sint32 y) {
+	chunk_t* chunk = find(x, y);
+	if (!chunk) {
+		chunk = new chunk_t();
+		chunk->x = x;
+		chunk->y = y;
+		chunk->inMemory = true;
+		chunks.insert(keyFor(x, y), chunk);
+	}
+	return *chunk;
+}
+
+bool WorldChunks::isStreamed(Entity* entity) const {
+	// a replica leaves the entities it was sent to the server, which removes them when they go out of range
+	return !entity->isToBeDeleted() && entity->isShouldSave() && !entity->getPlayer() && !(replica && entity->isReplicated());
+}
+
+bool WorldChunks::isSentToClients(Uint32 flags) {
+	return (flags & static_cast<Uint32>(Entity::flag_t::FLAG_UPDATE)) && !(flags & static_cast<Uint32>(Entity::flag_t::FLAG_LOCAL));
+}
+
+void WorldChunks::update() {
+	receive();
+	if (updates++ % updateInterval) {
+		return;
+	}
+	const Uint32 stamp = updates;
+
+	// find where the players are
+	focus.copy(probes);
+	for (auto& pair : world.getEntities()) {
+		Entity* entity = pair.b;
+		if (entity->getPlayer() && !entity->isToBeDeleted()) {
+			focus.push(entity->getPos());
+		}
+	}
+
+	// ask for the chunks around them, and keep the ones a little further out
+	const Sint32 loadRadius = std::max(cvar_chunkRadius.toInt(), 0);
+	const Sint32 keepRadius = loadRadius + 1;
+	if (loadAll) {
+		for (auto& pair : chunks) {
+			chunk_t& chunk = *pair.b;
+			chunk.wanted = stamp;
+			if (chunk.state == CHUNK_UNLOADED) {
+				load(chunk);
+			}
+		}
+	}
+	for (auto& pos : focus) {
+		Sint32 fx, fy;
+		coordsFor(pos, fx, fy);
+		for (Sint32 y = -keepRadius; y <= keepRadius; ++y) {
+			for (Sint32 x = -keepRadius; x <= keepRadius; ++x) {
+				const bool inRange = x * x + y * y <= loadRadius * loadRadius;
+				chunk_t* chunk = inRange ? &findOrCreate(fx + x, fy + y) : find(fx + x, fy + y);
+				if (!chunk) {
+					continue;
+				}
+				chunk->wanted = stamp;
+				if (inRange && chunk->state == CHUNK_UNLOADED) {
+					load(*chunk);
+				}
+			}
+		}
+	}
+
+	// chunks nobody is near any more give up their entities, as does empty space that something wandered into
+	unloading.resize(0);
+	for (Uint32 c = 0; c < active.getSize(); ++c) {
+		chunk_t& chunk = *active[c];
+		if (chunk.wanted != stamp) {
+			chunk.state = CHUNK_UNLOADING;
+			chunk.inMemory = true;
+			chunk.data.resize(0);
+			unloading.push(&chunk);
+			active[c] = active.peek();
+			active.pop();
+			--c;
+		}
+	}
+	for (auto& pair : world.getEntities()) {
+		Entity* entity = pair.b;
+		if (!isStreamed(entity)) {
+			continue;
+		}
+		Sint32 x, y;
+		coordsFor(entity->getPos(), x, y);
+		chunk_t& chunk = findOrCreate(x, y);
+		if (chunk.state == CHUNK_UNLOADED || chunk.state == CHUNK_UNLOADING) {
+			store(chunk, *entity);
+		}
+	}
+	for (auto chunk : unloading) {
+		chunk->state = CHUNK_UNLOADED;
+	}
+}
+
+void WorldChunks::finishLoading() {
+	while (numLoading) {
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			done.wait(guard, [this]() { return !replies.empty(); });
+		}
+		receive();
+	}
+}
+
+void WorldChunks::load(chunk_t& chunk) {
+	if (chunk.inMemory || !chunk.size) {
+		// nothing to wait for
+		activate(chunk, chunk.data.getArray(), chunk.inMemory ? chunk.data.getSize() : 0);
+		return;
+	}
+	request_t* request = new request_t();
+	request->chunk = &chunk;
+	request->offset = dataOffset + chunk.offset;
+	request->size = chunk.size;
+	chunk.state = CHUNK_LOADING;
+	++numLoading;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		requests.push(request);
+	}
+	wake.notify_one();
+}
+
+void WorldChunks::activate(chunk_t& chunk, const Uint8* data, size_t size) {
+	for (int source = 0; source < 2; ++source) {
+		const Uint8* ptr = source == 0 ? data : chunk.extra.getArray();
+		const size_t end = source == 0 ? size : chunk.extra.getSize();
+		size_t pos = 0;
+		while (pos + sizeof(entityheader_t) <= end) {
+			entityheader_t header;
+			memcpy(&header, ptr + pos, sizeof(header));
+			pos += sizeof(header);
+			const Uint32 entitySize = header.size;
+			if (entitySize > end - pos) {
+				mainEngine->fmsg(Engine::MSG_WARN, "chunk (%d, %d) of '%s' is corrupt", chunk.x, chunk.y, path.get());
+				break;
+			}
+			if (replica && isSentToClients(header.flags)) {
+				// the server sends this one
+				pos += entitySize;
+				continue;
+			}
+			if (world.uidToEntity(header.uid)) {
+				mainEngine->fmsg(Engine::MSG_WARN, "entity %u in chunk (%d, %d) of '%s' is already in the world", header.uid, chunk.x, chunk.y, path.get());
+				pos += entitySize;
+				continue;
+			}
+			Entity* entity = new Entity(&world, header.uid);
+			if (!FileHelper::readObject(ptr + pos, entitySize, *entity)) {
+				mainEngine->fmsg(Engine::MSG_WARN, "chunk (%d, %d) of '%s' is corrupt", chunk.x, chunk.y, path.get());
+				world.getEntities().remove(entity->getUID());
+				delete entity;
+				break;
+			}
+			entity->update();
+			pos += entitySize;
+		}
+	}
+
+	// the entities are live now, so the copies can go
+	if (chunk.inMemory) {
+		memoryBytes -= chunk.data.getSize();
+		chunk.data.clear();
+	}
+	memoryBytes -= chunk.extra.getSize();
+	chunk.extra.clear();
+	numStoredEntities -= chunk.numEntities;
+	chunk.numEntities = 0;
+	chunk.state = CHUNK_ACTIVE;
+	active.push(&chunk);
+}
+
+void WorldChunks::store(chunk_t& chunk, Entity& entity) {
+	ArrayList<Uint8>& data = chunk.state == CHUNK_UNLOADING ? chunk.data : chunk.extra;
+	memoryBytes += appendEntity(data, entity, entity.getUID());
+	++chunk.numEntities;
+	++numStoredEntities;
+
+	// tell every client to drop the entity if the server replicated it, as the world does when it deletes one.
+	// Clearing FLAG_UPDATE stops the world sending a second notice. Entities which were never sent are streamed
+	// by each client itself
+	const bool sent = world.isServerObj() && isSentToClients(entity.getFlags());
+	Server* server = sent ? mainEngine->getLocalServer() : nullptr;
+	if (server) {
+		Packet packet;
+		packet.write32(entity.getUID());
+		packet.write32(world.getID());
+		packet.write("ENTD");
+		server->getNet()->signPacket(packet);
+		server->getNet()->broadcastSafe(packet);
+		entity.resetFlag(static_cast<Uint32>(Entity::flag_t::FLAG_UPDATE));
+	}
+	entity.remove();
+}
+
+void WorldChunks::receive() {
+	ArrayList<request_t*> arrived;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (replies.empty()) {
+			return;
+		}
+		arrived.swap(std::move(replies));
+	}
+	for (auto reply : arrived) {
+		chunk_t& chunk = *reply->chunk;
+		if (reply->data.getSize() != reply->size) {
+			mainEngine->fmsg(Engine::MSG_WARN, "failed to read chunk (%d, %d) of '%s'", chunk.x, chunk.y, path.get());
+		}
+		bytesRead += reply->data.getSize();
+		--numLoading;
+		activate(chunk, reply->data.getArray(), reply->data.getSize());
+		delete reply;
+	}
+}
+
+void WorldChunks::run() {
+	FILE* fp = fopen(path.get(), "rb");
+	while (1) {
+		request_t* request = nullptr;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [this]() { return quit || !requests.empty(); });
+			if (quit) {
+				break;
+			}
+			request = requests.remove(0);
+		}
+
+		request->data.resize(request->size);
+		const bool good = fp &&
+#ifdef PLATFORM_WINDOWS
+			_fseeki64(fp, (__int64)request->offset, SEEK_SET) == 0 &&
+#else
+			fseeko(fp, (off_t)request->offset, SEEK_SET) == 0 &&
+#endif
+			fread(request->data.getArray(), 1, request->size, fp) == request->size;
+		if (!good) {
+			request->data.resize(0);
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			replies.push(request);
+		}
+		done.notify_all();
+	}
+	if (fp) {
+		fclose(fp);
+	}
+}
+
+// finds a game to host a temporary world, preferring the local server
+static Game* findHostGame() {
+	Game* game = mainEngine->getLocalServer();
+	if (!game) {
+		game = mainEngine->getLocalClient();
+	}
+	if (!game) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "A client or server is needed to host the world.");
+	}
+	return game;
+}
+
+static int console_chunksBuild(int argc, const char** argv) {
+	if (argc < 3) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "A world file and an output file are needed. ex: world.chunks.build maps/sample.wlb maps/sample.wlc 1024");
+		return 1;
+	}
+	Game* game = findHostGame();
+	if (!game) {
+		return 1;
+	}
+	const float chunkSize = argc > 3 ? (float)strtod(argv[3], nullptr) : 1024.f;
+	if (!(chunkSize > 0.f)) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "The chunk size must be positive.");
+		return 1;
+	}
+
+	BasicWorld world(game, true, UINT32_MAX, "Untitled World");
+	if (!FileHelper::readObject(mainEngine->buildPath(argv[1]).get(), world)) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "failed to read '%s'", argv[1]);
+		return 1;
+	}
+	return WorldChunks::build(world, mainEngine->buildPath(argv[2]).get(), chunkSize) ? 0 : 1;
+}
+
+static Ccmd ccmd_chunksBuild("world.chunks.build", "converts a world file into a chunk store which is streamed in around players. ex: world.chunks.build maps/sample.wlb maps/sample.wlc 1024", &console_chunksBuild);
+
+static int console_chunksGenerate(int argc, const char** argv) {
+	if (argc < 2) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "An output file is needed. ex: world.chunks.generate maps/huge.wlc 250000 131072 1024 Box");
+		return 1;
+	}
+	Game* game = findHostGame();
+	if (!game) {
+		return 1;
+	}
+	const Uint32 numEntities = argc > 2 ? (Uint32)strtol(argv[2], nullptr, 10) : 250000;
+	const float extent = argc > 3 ? (float)strtod(argv[3], nullptr) : 131072.f;
+	const float chunkSize = argc > 4 ? (float)strtod(argv[4], nullptr) : 1024.f;
+	const char* defName = argc > 5 ? argv[5] : "Box";
+	if (!(chunkSize > 0.f)) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "The chunk size must be positive.");
+		return 1;
+	}
+	const Entity::def_t* def = Entity::findDef(defName);
+	if (!def) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "There is no entity def called '%s'.", defName);
+		return 1;
+	}
+
+	// one entity is moved about and written out over and over, so the world never needs to be in memory
+	BasicWorld world(game, true, UINT32_MAX, "Generated World");
+	world.initialize(false);
+	Entity* entity = Entity::spawnFromDef(&world, *def, Vector(), Rotation());
+	if (!entity) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "Failed to spawn an entity from def '%s'.", defName);
+		return 1;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	Random rand;
+	rand.seedValue(1);
+	WorldChunks::Builder builder(chunkSize);
+	for (Uint32 c = 0; c < numEntities; ++c) {
+		const Vector pos(rand.getFloatRange(-extent, extent), rand.getFloatRange(-extent, extent), 0.f);
+		entity->setPos(pos);
+		entity->setNewPos(pos);
+		builder.add(*entity, c + 1);
+	}
+	if (!builder.save(mainEngine->buildPath(argv[1]).get(), "Generated World")) {
+		return 1;
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	mainEngine->fmsg(Engine::MSG_INFO, "generated '%s': %u x '%s' in %u chunks (%.1f s)",
+		argv[1], builder.getNumEntities(), defName, builder.getNumChunks(), seconds);
+	return 0;
+}
+
+static Ccmd ccmd_chunksGenerate("world.chunks.generate", "writes a chunk store full of randomly placed entities. ex: world.chunks.generate maps/huge.wlc 250000 131072 1024 Box", &console_chunksGenerate);
+
+static int console_chunksBenchmark(int argc, const char** argv) {
+	if (argc < 2) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "A chunk store is needed. ex: world.chunks.benchmark maps/huge.wlc 8 30 512");
+		return 1;
+	}
+	Game* game = findHostGame();
+	if (!game) {
+		return 1;
+	}
+	const Uint32 numProbes = argc > 2 ? std::max((Uint32)strtol(argv[2], nullptr, 10), 1U) : 8;
+	const Uint32 seconds = argc > 3 ? std::max((Uint32)strtol(argv[3], nullptr, 10), 1U) : 30;
+	const float speed = argc > 4 ? (float)strtod(argv[4], nullptr) : 512.f;
+
+	BasicWorld* world = new BasicWorld(game, true, UINT32_MAX, "Untitled World");
+	if (!world->loadFile(mainEngine->buildPath(argv[1]).get()) || !world->getChunks()) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "'%s' could not be opened as a chunk store", argv[1]);
+		delete world;
+		return 1;
+	}
+	world->initialize(false);
+	WorldChunks& chunks = *world->getChunks();
+	const Uint64 totalEntities = chunks.getNumStoredEntities();
+
+	typedef std::chrono::high_resolution_clock clock;
+	const Uint32 tps = (Uint32)mainEngine->getTicksPerSecond();
+	const float step = speed / tps;
+	const Vector& min = chunks.getBoundsMin();
+	const Vector& max = chunks.getBoundsMax();
+
+	// probes stand in for players, wandering across the world in straight lines
+	Random rand;
+	rand.seedValue(1);
+	ArrayList<Vector> probes, velocities;
+	for (Uint32 c = 0; c < numProbes; ++c) {
+		const float angle = rand.getFloatRange(0.f, 2.f * PI);
+		probes.push(Vector(rand.getFloatRange(min.x, max.x), rand.getFloatRange(min.y, max.y), 0.f));
+		velocities.push(Vector(cosf(angle) * step, sinf(angle) * step, 0.f));
+	}
+
+	double total = 0.0, worst = 0.0;
+	Uint64 residentSum = 0, bodySum = 0;
+	Uint32 residentMax = 0, bodyMax = 0;
+	const Uint32 ticks = seconds * tps;
+	for (Uint32 tick = 0; tick < ticks; ++tick) {
+		for (Uint32 c = 0; c < numProbes; ++c) {
+			Vector& pos = probes[c];
+			Vector& vel = velocities[c];
+			pos += vel;
+			if (pos.x < min.x || pos.x > max.x) {
+				vel.x = -vel.x;
+			}
+			if (pos.y < min.y || pos.y > max.y) {
+				vel.y = -vel.y;
+			}
+		}
+		chunks.setProbes(probes);
+
+		auto start = clock::now();
+		world->process();
+		const double time = std::chrono::duration<double>(clock::now() - start).count();
+		total += time;
+		worst = std::max(worst, time);
+
+		const Uint32 resident = world->getEntities().getSize();
+		const Uint32 bodies = (Uint32)world->getBulletDynamicsWorld()->getNumCollisionObjects();
+		residentSum += resident;
+		residentMax = std::max(residentMax, resident);
+		bodySum += bodies;
+		bodyMax = std::max(bodyMax, bodies);
+	}
+	mainEngine->fmsg(Engine::MSG_INFO, "%s: %llu entities in %u chunks, %u probes at %.0f units/s for %u s",
+		argv[1], (unsigned long long)totalEntities, chunks.getNumChunks(), numProbes, speed, seconds);
+	mainEngine->fmsg(Engine::MSG_INFO, " streamed: tick %.3f ms avg, %.3f ms max (budget %.3f ms)",
+		total * 1000.0 / ticks, worst * 1000.0, 1000.0 / tps);
+	mainEngine->fmsg(Engine::MSG_INFO, " live entities %.0f avg, %u max; physics objects %.0f avg, %u max",
+		(double)residentSum / ticks, residentMax, (double)bodySum / ticks, bodyMax);
+	mainEngine->fmsg(Engine::MSG_INFO, " %u chunks active, %.1f MB read from the store, %.1f MB held for visited chunks",
+		chunks.getNumActiveChunks(), chunks.getBytesRead() / 1048576.0, chunks.getMemoryBytes() / 1048576.0);
+
+	// the whole world at once, as it would be without streaming
+	chunks.setLoadAll(true);
+	auto start = clock::now();
+	for (Uint32 c = 0; c < WorldChunks::updateInterval; ++c) {
+		world->process();
+	}
+	chunks.finishLoading();
+	const double loadTime = std::chrono::duration<double>(clock::now() - start).count();
+	total = 0.0;
+	worst = 0.0;
+	for (Uint32 tick = 0; tick < tps; ++tick) {
+		start = clock::now();
+		world->process();
+		const double time = std::chrono::duration<double>(clock::now() - start).count();
+		total += time;
+		worst = std::max(worst, time);
+	}
+	mainEngine->fmsg(Engine::MSG_INFO, " everything: tick %.3f ms avg, %.3f ms max, %u live entities, %d physics objects (loaded in %.2f s)",
+		total * 1000.0 / tps, worst * 1000.0, world->getEntities().getSize(),
+		world->getBulletDynamicsWorld()->getNumCollisionObjects(), loadTime);
+
+	delete world;
+	return 0;
+}
+
+static Ccmd ccmd_chunksBenchmark("world.chunks.benchmark", "streams a chunk store around wandering probes, reporting tick time, live entities and physics objects, then compares with the whole world loaded. ex: world.chunks.benchmark maps/huge.wlc 8 30 512", &console_chunksBenchmark);
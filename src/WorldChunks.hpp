@@ -0,0 +1,266 @@
+//! @file WorldChunks.hpp
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+#include "Map.hpp"
+#include "String.hpp"
+#include "Vector.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class World;
+class Entity;
+
+//! WorldChunks streams a large world in and out around its players.
+//! The world is cut into square columns (chunks) on the horizontal plane, and its entities are kept in a chunk
+//! store: a file holding a table of chunks followed by each chunk's entities in the binary format.
+//! Only chunks near a player (or a probe, see setProbes()) have live entities. Everything else sits in the store,
+//! or in memory as compact binary data once it has been visited, with no entity processing and no physics bodies.
+//! Chunk data is read from the store by a background thread, so ticks never wait on the disk.
+//! Entities keep their uid in the store, so each time one streams in it is the same entity to the server's clients.
+//! A client of a server opens the store as a replica: it streams the entities the server never replicates
+//! (static geometry and local entities) itself, and gets the rest from the server.
+class WorldChunks {
+public:
+	//! bump whenever the layout of a chunk store changes
+	static const Uint32 version = 2;
+
+	//! ticks between streaming updates
+	static const Uint32 updateInterval = 4;
+
+	//! chunk store header
+	struct header_t {
+		char magic[4];
+		Uint32 version;
+		float chunkSize;		//!< width of a chunk (in world units)
+		Uint32 numChunks;
+		Uint32 nameSize;		//!< length of the world name, which follows the header
+		Uint32 maxUID;			//!< highest entity uid in the store
+		Uint64 dataOffset;		//!< start of the chunk data, from the start of the file
+	};
+
+	//! chunk table entry
+	struct record_t {
+		Sint32 x, y;			//!< chunk coordinates
+		Uint32 numEntities;
+		Uint32 size;			//!< size of the chunk's data
+		Uint64 offset;			//!< start of the chunk's data, from dataOffset
+	};
+
+	//! chunk data is a run of entities, each one this header followed by its binary serialization
+	struct entityheader_t {
+		Uint32 size;			//!< size of the serialization
+		Uint32 uid;
+		Uint32 flags;			//!< the entity's flags, so a replica can skip entities without reading them
+	};
+
+	//! collects entities into chunks and writes them to a chunk store
+	class Builder {
+	public:
+		Builder(float _chunkSize) :
+			chunkSize(_chunkSize) {}
+		Builder(const Builder&) = delete;
+		Builder(Builder&&) = delete;
+		~Builder();
+
+		Builder& operator=(const Builder&) = delete;
+		Builder& operator=(Builder&&) = delete;
+
+		//! add an entity to the chunk under it
+		//! @param entity the entity to add
+		//! @param uid the uid to store the entity with (UINT32_MAX for its own)
+		void add(Entity& entity, Uint32 uid = UINT32_MAX);
+
+		//! add entities which are already serialized
+		//! @param x the chunk x coordinate
+		//! @param y the chunk y coordinate
+		//! @param data chunk data, as stored in a chunk store
+		//! @param size the size of the data
+		//! @param numEntities the number of entities in the data (or 0 to count them with addEntities())
+		void addData(Sint32 x, Sint32 y, const Uint8* data, size_t size, Uint32 numEntities);
+
+		//! count entities whose data was added with addData()
+		//! @param x the chunk x coordinate
+		//! @param y the chunk y coordinate
+		//! @param numEntities the number of entities
+		void addEntities(Sint32 x, Sint32 y, Uint32 numEntities);
+
+		//! write everything added so far to a file
+		//! @param path the file to write
+		//! @param name the name of the world
+		//! @return true on success
+		bool save(const char* path, const char* name) const;
+
+		Uint32	getNumEntities() const	{ return numEntities; }
+		Uint32	getNumChunks() const	{ return chunks.getSize(); }
+
+		//! make sure the store's highest uid covers entities added with addData()
+		void	setMaxUID(Uint32 uid)	{ maxUID = std::max(maxUID, uid); }
+
+	private:
+		struct chunk_t {
+			Sint32 x = 0, y = 0;
+			Uint32 numEntities = 0;
+			ArrayList<Uint8> data;
+		};
+
+		float chunkSize;
+		Uint32 numEntities = 0;
+		Uint32 maxUID = 0;
+		Map<Uint64, chunk_t*> chunks;
+
+		chunk_t& chunkFor(Sint32 x, Sint32 y);
+	};
+
+	//! @param _world the world to stream entities into
+	//! @param _replica if true, the world belongs to a server, and only entities it does not replicate are streamed
+	WorldChunks(World& _world, bool _replica);
+	WorldChunks(const WorldChunks&) = delete;
+	WorldChunks(WorldChunks&&) = delete;
+	~WorldChunks();
+
+	WorldChunks& operator=(const WorldChunks&) = delete;
+	WorldChunks& operator=(WorldChunks&&) = delete;
+
+	//! @param path the file to check
+	//! @return true if the file is a chunk store
+	static bool isChunkStore(const char* path);
+
+	//! write every entity in a world to a chunk store
+	//! @param world the world to write
+	//! @param path the file to write
+	//! @param chunkSize the width of a chunk (in world units)
+	//! @return true on success
+	static bool build(World& world, const char* path, float chunkSize);
+
+	//! open a chunk store. No entities are created until a player or probe is near them
+	//! @param path the file to read
+	//! @return true on success
+	bool open(const char* path);
+
+	//! write the whole world, streamed in or not, to a chunk store. A replica cannot, as it only holds part of it
+	//! @param path the file to write
+	//! @return true on success
+	bool save(const char* path);
+
+	//! stream chunks in and out around the players. Called by the world before it processes its entities
+	void update();
+
+	//! block until every chunk that has been asked for is active
+	void finishLoading();
+
+	//! set points which keep chunks active in addition to the players, for tools and tests
+	//! @param _probes the points to use
+	void setProbes(const ArrayList<Vector>& _probes) { probes.copy(_probes); }
+
+	//! stream in every chunk regardless of distance (eg. for comparisons)
+	//! @param _loadAll if true, every chunk is kept active
+	void setLoadAll(bool _loadAll) { loadAll = _loadAll; }
+
+	bool		isReplica() const				{ return replica; }
+	float		getChunkSize() const			{ return chunkSize; }
+	Uint32		getNumChunks() const			{ return chunks.getSize(); }
+	Uint32		getNumActiveChunks() const		{ return active.getSize(); }
+	Uint32		getNumLoadingChunks() const		{ return numLoading; }
+	Uint64		getNumStoredEntities() const	{ return numStoredEntities; }
+	Uint64		getMemoryBytes() const			{ return memoryBytes; }
+	Uint64		getBytesRead() const			{ return bytesRead; }
+	const Vector&	getBoundsMin() const		{ return boundsMin; }
+	const Vector&	getBoundsMax() const		{ return boundsMax; }
+
+	//! get the chunk coordinates of a point
+	//! @param pos the point
+	//! @param x the chunk x coordinate
+	//! @param y the chunk y coordinate
+	void coordsFor(const Vector& pos, Sint32& x, Sint32& y) const;
+
+private:
+	enum state_t {
+		CHUNK_UNLOADED,		//!< entities are in the store or in memory
+		CHUNK_LOADING,		//!< data has been asked for
+		CHUNK_ACTIVE,		//!< entities are live in the world
+		CHUNK_UNLOADING		//!< entities are being written back this update
+	};
+
+	struct chunk_t {
+		Sint32 x = 0, y = 0;
+		state_t state = CHUNK_UNLOADED;
+		bool inMemory = false;		//!< if true, data replaces what the store holds for this chunk
+		Uint64 offset = 0;			//!< where the chunk's data is in the store
+		Uint32 size = 0;
+		Uint32 numEntities = 0;		//!< entities held in data (or the store) and extra
+		ArrayList<Uint8> data;		//!< entities written back when the chunk was unloaded
+		ArrayList<Uint8> extra;		//!< entities which wandered in while the chunk was unloaded
+		Uint32 wanted = 0;			//!< last update which had a player within the unload radius
+	};
+
+	//! read request (also used for the reply)
+	struct request_t {
+		chunk_t* chunk = nullptr;
+		Uint64 offset = 0;
+		Uint32 size = 0;
+		ArrayList<Uint8> data;
+	};
+
+	World& world;
+	bool replica = false;
+	String path;
+	Uint64 dataOffset = 0;
+	float chunkSize = 1024.f;
+	Map<Uint64, chunk_t*> chunks;
+	ArrayList<chunk_t*> active;
+	ArrayList<chunk_t*> unloading;
+	Vector boundsMin;			//!< corners of the chunks in the store
+	Vector boundsMax;
+	ArrayList<Vector> probes;
+	ArrayList<Vector> focus;
+	bool loadAll = false;
+	Uint32 updates = 0;
+
+	Uint32 numLoading = 0;
+	Uint64 numStoredEntities = 0;
+	Uint64 memoryBytes = 0;
+	Uint64 bytesRead = 0;
+
+	//! reader thread
+	std::thread thread;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+	ArrayList<request_t*> requests;
+	ArrayList<request_t*> replies;
+	bool quit = false;
+
+	//! read the header, world name and (optionally) chunk table of a chunk store
+	static bool readStore(const char* path, header_t& header, String& name, ArrayList<record_t>* records);
+
+	static Uint64 keyFor(Sint32 x, Sint32 y);
+	chunk_t* find(Sint32 x, Sint32 y);
+	chunk_t& findOrCreate(Sint32 x, Sint32 y);
+
+	//! @return true if an entity should be streamed with the chunk under it
+	bool isStreamed(Entity* entity) const;
+
+	//! @param flags an entity's flags
+	//! @return true if the server sends entities with these flags to its clients (see Server::replicateEntities())
+	static bool isSentToClients(Uint32 flags);
+
+	//! ask the reader thread for a chunk's data
+	void load(chunk_t& chunk);
+
+	//! create the entities of a chunk whose data has arrived
+	void activate(chunk_t& chunk, const Uint8* data, size_t size);
+
+	//! move an entity into a chunk's data and remove it from the world
+	void store(chunk_t& chunk, Entity& entity);
+
+	//! handle every reply from the reader thread
+	void receive();
+
+	//! reader thread entry point
+	void run();
+};
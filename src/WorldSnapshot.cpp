@@ -0,0 +1,257 @@
+// WorldSnapshot.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "WorldSnapshot.hpp"
+#include "MeshCache.hpp"
+#include "BasicWorld.hpp"
+#include "Entity.hpp"
+#include "File.hpp"
+#include "Console.hpp"
+#include "Client.hpp"
+#include "Server.hpp"
+
+#include <chrono>
+
+static const char snapshotMagic[4] = { 'S', 'P', 'W', 'S' };
+static const char* snapshotDir = "cache/worlds";
+
+String WorldSnapshot::pathFor(const char* sourcePath) {
+	Uint64 hash = 0xCBF29CE484222325ULL;
+	for (const char* c = sourcePath; c && *c; ++c) {
+		hash ^= (Uint8)*c;
+		hash *= 0x100000001B3ULL;
+	}
+	String result;
+	result.alloc((Uint32)strlen(snapshotDir) + 24);
+	result.format("%s/%016llx.snap", snapshotDir, (unsigned long long)hash);
+	return result;
+}
+
+// appends a string to a string table
+// @return the offset of the string in the table
+static Uint32 addString(ArrayList<char>& strings, const char* str) {
+	const Uint32 offset = strings.getSize();
+	const Uint32 len = str ? (Uint32)strlen(str) : 0;
+	if (offset + len + 1 > strings.getMaxSize()) {
+		strings.alloc(std::max(offset + len + 1, strings.getMaxSize() * 2));
+	}
+	strings.resize(offset + len + 1);
+	if (len) {
+		memcpy(&strings[offset], str, len);
+	}
+	strings[offset + len] = '\0';
+	return offset;
+}
+
+bool WorldSnapshot::save(BasicWorld& world, const char* sourcePath) {
+	MeshCache::sourceinfo_t info;
+	if (!MeshCache::getSourceInfo(sourcePath, info)) {
+		return false;
+	}
+
+	// entities go out in the order they were created, which is the order the source lists them in
+	ArrayList<Entity*> entities;
+	for (auto& pair : world.getEntities()) {
+		Entity* entity = pair.b;
+		if (entity->isToBeDeleted() || !entity->isShouldSave()) {
+			continue;
+		}
+		entities.push(entity);
+	}
+	class SortFn : public ArrayList<Entity*>::SortFunction {
+	public:
+		virtual ~SortFn() {}
+		virtual const bool operator()(Entity* a, Entity* b) const override {
+			return a->getUID() < b->getUID();
+		}
+	};
+	entities.sort(SortFn());
+
+	ArrayList<entity_t> records;
+	ArrayList<char> strings;
+	ArrayList<Uint8> data;
+	records.alloc(entities.getSize());
+	const Uint32 name = addString(strings, world.getNameStr().get());
+	for (auto entity : entities) {
+		entity_t record;
+		record.offset = data.getSize();
+		if (!FileHelper::writeObject(data, *entity)) {
+			return false;
+		}
+		record.size = (Uint32)(data.getSize() - record.offset);
+		record.name = addString(strings, entity->getName().get());
+		records.push(record);
+	}
+
+	header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+	header.version = version;
+	header.sourceSize = info.size;
+	header.sourceTime = info.time;
+	header.sourceHash = MeshCache::hashFile(sourcePath);
+	header.name = name;
+	header.numEntities = records.getSize();
+	header.stringsOffset = (Uint32)(sizeof(header_t) + sizeof(entity_t) * records.getSize());
+	header.stringsSize = strings.getSize();
+	header.dataOffset = header.stringsOffset + header.stringsSize;
+	header.dataSize = data.getSize();
+
+	MeshCache::Writer writer;
+	writer.write(header);
+	writer.writeBytes(records.getArray(), sizeof(entity_t) * records.getSize());
+	writer.writeBytes(strings.getArray(), strings.getSize());
+	writer.writeBytes(data.getArray(), data.getSize());
+
+	String path = pathFor(sourcePath);
+	if (!writer.save(path.get())) {
+		mainEngine->fmsg(Engine::MSG_WARN, "failed to write world snapshot '%s'", path.get());
+		return false;
+	}
+	mainEngine->fmsg(Engine::MSG_DEBUG, "wrote world snapshot '%s': %u entities, %llu bytes",
+		path.get(), header.numEntities, (unsigned long long)(header.dataOffset + header.dataSize));
+	return true;
+}
+
+bool WorldSnapshot::load(BasicWorld& world, const char* sourcePath) {
+	String path = pathFor(sourcePath);
+	MeshCache::MappedFile file;
+	if (!file.open(path.get())) {
+		return false;
+	}
+
+	header_t header;
+	MeshCache::Reader reader(file.getData(), file.getSize());
+	if (!reader.read(header) ||
+		memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0 ||
+		header.version != version) {
+		return false;
+	}
+
+	MeshCache::sourceinfo_t info;
+	if (!MeshCache::getSourceInfo(sourcePath, info) || info.size != header.sourceSize) {
+		return false;
+	}
+	if (info.time != header.sourceTime) {
+		// the timestamp changed (eg. a fresh checkout), so fall back to comparing contents
+		if (MeshCache::hashFile(sourcePath) != header.sourceHash) {
+			return false;
+		}
+
+		// contents are the same: restamp the snapshot so the next load can skip the hash
+		file.close();
+		header.sourceTime = info.time;
+		FILE* fp = fopen(path.get(), "r+b");
+		if (fp) {
+			fwrite(&header, sizeof(header_t), 1, fp);
+			fclose(fp);
+		}
+		if (!file.open(path.get())) {
+			return false;
+		}
+	}
+
+	// check every table against the file before creating anything
+	const Uint8* base = file.getData();
+	const Uint64 size = file.getSize();
+	if ((Uint64)header.stringsOffset < sizeof(header_t) + (Uint64)sizeof(entity_t) * header.numEntities ||
+		(Uint64)header.stringsOffset + header.stringsSize > size ||
+		(Uint64)header.dataOffset < (Uint64)header.stringsOffset + header.stringsSize ||
+		(Uint64)header.dataOffset + header.dataSize > size ||
+		header.stringsSize == 0 ||
+		base[header.stringsOffset + header.stringsSize - 1] != '\0' ||
+		header.name >= header.stringsSize) {
+		mainEngine->fmsg(Engine::MSG_WARN, "world snapshot '%s' is corrupt", path.get());
+		return false;
+	}
+	const entity_t* records = (const entity_t*)(base + sizeof(header_t));
+	for (Uint32 c = 0; c < header.numEntities; ++c) {
+		if (records[c].offset + records[c].size > header.dataSize) {
+			mainEngine->fmsg(Engine::MSG_WARN, "world snapshot '%s' is corrupt", path.get());
+			return false;
+		}
+	}
+
+	const char* strings = (const char*)(base + header.stringsOffset);
+	const Uint8* data = base + header.dataOffset;
+	ArrayList<Entity*> created;
+	created.alloc(header.numEntities);
+	for (Uint32 c = 0; c < header.numEntities; ++c) {
+		Entity* entity = new Entity(&world);
+		created.push(entity);
+		if (!FileHelper::readObject(data + records[c].offset, records[c].size, *entity)) {
+			mainEngine->fmsg(Engine::MSG_WARN, "world snapshot '%s' is corrupt", path.get());
+			for (auto badEntity : created) {
+				world.getEntities().remove(badEntity->getUID());
+				delete badEntity;
+			}
+			return false;
+		}
+	}
+	world.setNameStr(strings + header.name);
+
+	mainEngine->fmsg(Engine::MSG_DEBUG, "loaded world '%s' from snapshot: %u entities", sourcePath, header.numEntities);
+	return true;
+}
+
+static int console_snapshotBenchmark(int argc, const char** argv) {
+	if (argc < 2) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "A world file is needed. ex: world.snapshot.benchmark maps/sample.wlb 8");
+		return 1;
+	}
+	Game* game = mainEngine->getLocalServer();
+	if (!game) {
+		game = mainEngine->getLocalClient();
+	}
+	if (!game) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "A client or server is needed to host the test worlds.");
+		return 1;
+	}
+	String path = mainEngine->buildPath(argv[1]).get();
+	const Uint32 iterations = argc > 2 ? std::max((Uint32)strtol(argv[2], nullptr, 10), 1U) : 8U;
+
+	// make sure there is a fresh snapshot to read
+	{
+		BasicWorld world(game, true, UINT32_MAX, "Snapshot Benchmark");
+		if (!FileHelper::readObject(path.get(), world)) {
+			mainEngine->fmsg(Engine::MSG_ERROR, "failed to read '%s'", path.get());
+			return 1;
+		}
+		if (!WorldSnapshot::save(world, path.get())) {
+			mainEngine->fmsg(Engine::MSG_ERROR, "failed to write a snapshot for '%s'", path.get());
+			return 1;
+		}
+	}
+
+	double sourceTime = 0.0, snapshotTime = 0.0;
+	Uint32 sourceEntities = 0, snapshotEntities = 0;
+	for (Uint32 c = 0; c < iterations; ++c) {
+		{
+			BasicWorld world(game, true, UINT32_MAX, "Snapshot Benchmark");
+			auto start = std::chrono::high_resolution_clock::now();
+			FileHelper::readObject(path.get(), world);
+			sourceTime += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			sourceEntities = (Uint32)world.getEntities().getSize();
+		}
+		{
+			BasicWorld world(game, true, UINT32_MAX, "Snapshot Benchmark");
+			auto start = std::chrono::high_resolution_clock::now();
+			if (!WorldSnapshot::load(world, path.get())) {
+				mainEngine->fmsg(Engine::MSG_ERROR, "failed to load the snapshot for '%s'", path.get());
+				return 1;
+			}
+			snapshotTime += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			snapshotEntities = (Uint32)world.getEntities().getSize();
+		}
+	}
+
+	const bool match = sourceEntities == snapshotEntities;
+	mainEngine->fmsg(match ? Engine::MSG_INFO : Engine::MSG_ERROR, "%s: source %.2f ms, snapshot %.2f ms (%.1fx), %u entities%s",
+		argv[1], sourceTime * 1000.0 / iterations, snapshotTime * 1000.0 / iterations,
+		snapshotTime > 0.0 ? sourceTime / snapshotTime : 0.0, snapshotEntities,
+		match ? "" : " (MISMATCH)");
+	return 0;
+}
+
+static Ccmd ccmd_snapshotBenchmark("world.snapshot.benchmark", "times loading a world from its source file against its snapshot. ex: world.snapshot.benchmark maps/sample.wlb 8", &console_snapshotBenchmark);
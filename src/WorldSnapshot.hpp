@@ -0,0 +1,58 @@
+//! @file WorldSnapshot.hpp
+
+#pragma once
+
+#include "Main.hpp"
+#include "String.hpp"
+
+class BasicWorld;
+
+//! A WorldSnapshot is a binary image of a world file, written the first time the world is loaded so that
+//! later loads can skip parsing the source. The file is memory-mapped and holds a fixed header, a table
+//! with one record per entity, a string table, and each entity's binary serialization laid end to end.
+//! Entities are read straight out of the mapping, so a load touches no stdio and allocates nothing but the
+//! entities themselves. Like the MeshCache, a snapshot is validated against the size, modification time and
+//! (if those differ) the content hash of its source file, and is rebuilt whenever it goes stale.
+class WorldSnapshot {
+public:
+	//! bump whenever the layout of a snapshot, or the serialization of anything in it, changes
+	static const Uint32 version = 1;
+
+	//! snapshot file header
+	struct header_t {
+		char magic[4];
+		Uint32 version;
+		Uint64 sourceSize;
+		Sint64 sourceTime;
+		Uint64 sourceHash;
+		Uint32 name;			//!< offset of the world name in the string table
+		Uint32 numEntities;
+		Uint32 stringsOffset;	//!< start of the string table, from the start of the file
+		Uint32 stringsSize;
+		Uint32 dataOffset;		//!< start of the entity data, from the start of the file
+		Uint64 dataSize;
+	};
+
+	//! entity record
+	struct entity_t {
+		Uint64 offset;			//!< start of the entity's data, from dataOffset
+		Uint32 size;			//!< size of the entity's data
+		Uint32 name;			//!< offset of the entity's name in the string table (for tools)
+	};
+
+	//! @param sourcePath full path of the world file
+	//! @return the path of the snapshot for the given world file
+	static String pathFor(const char* sourcePath);
+
+	//! write a snapshot of a world
+	//! @param world the world to write, freshly loaded from sourcePath
+	//! @param sourcePath full path of the file the world was loaded from
+	//! @return true on success
+	static bool save(BasicWorld& world, const char* sourcePath);
+
+	//! fill a world from its snapshot
+	//! @param world the world to fill, which should be empty
+	//! @param sourcePath full path of the world file
+	//! @return true if the snapshot was valid and the world was loaded, false if the source must be read instead
+	static bool load(BasicWorld& world, const char* sourcePath);
+};